@@ -188,6 +188,7 @@ set(SDKLIB_HEADERS
     include/mega/version.h
     include/mega/node.h
     include/mega/mediafileattribute.h
+    include/mega/metrics.h
     include/mega/process.h
     include/mega/mega_csv.h
     include/mega/name_collision.h
@@ -243,6 +244,7 @@ set(SDKLIB_SOURCES
     src/mega_utf8proc.cpp
     src/mega_zxcvbn.cpp
     src/megaclient.cpp
+    src/metrics.cpp
     src/node.cpp
     src/pendingcontactrequest.cpp
     src/textchat.cpp
@@ -481,6 +483,7 @@ target_compile_definitions(SDKlib
     $<$<BOOL:${USE_LIBUV}>:HAVE_LIBUV>
     $<$<PLATFORM_ID:iOS>:USE_IOS>
     $<$<PLATFORM_ID:Android>:USE_POLL>
+    $<$<PLATFORM_ID:Linux>:USE_EPOLL>
     $<$<PLATFORM_ID:Android>:USE_INOTIFY>
     $<$<PLATFORM_ID:Android>:HAVE_SDK_CONFIG_H>
 )
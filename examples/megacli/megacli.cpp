@@ -167,6 +167,7 @@ Usage:
 R"(
   -e=arg               Use the isolated gfx processor. This gives executable binary path
   -n=arg               Endpoint name (default: mega_gfxworker_megacli)
+  -w=arg               Number of isolated gfx processes (default: 1)
 )"
 #endif
 ;
@@ -176,6 +177,8 @@ struct Config
 
     std::string endpointName;
 
+    size_t processCount = 1;
+
     std::string clientType;
 
     static Config fromArguments(const Arguments& arguments);
@@ -197,6 +200,9 @@ Config Config::fromArguments(const Arguments& arguments)
 
     // endpoint name
     config.endpointName = arguments.getValue("-n", "mega_gfxworker_megacli");
+
+    // process count, minimum 1
+    config.processCount = static_cast<size_t>(std::max(1, std::stoi(arguments.getValue("-w", "1"))));
 #endif
 
     config.clientType = arguments.getValue("-c", "default");
@@ -208,7 +214,7 @@ static std::unique_ptr<IGfxProvider> createGfxProvider([[maybe_unused]] const Co
 {
 #if defined(ENABLE_ISOLATED_GFX)
     GfxIsolatedProcess::Params params{config.endpointName, config.executable};
-    if (auto provider = GfxProviderIsolatedProcess::create(params))
+    if (auto provider = GfxProviderIsolatedProcess::create(params, config.processCount))
     {
         return provider;
     }
@@ -3187,6 +3193,25 @@ void exec_codeTimings(autocomplete::ACState& s)
 
 #endif
 
+void exec_metrics(autocomplete::ACState& s)
+{
+    bool reset = s.extractflag("-reset");
+
+    if (s.words.size() > 1)
+    {
+        metrics::setEnabled(s.words[1].s == "on");
+        cout << "Metrics " << (metrics::enabled() ? "enabled" : "disabled") << endl;
+        return;
+    }
+
+    cout << metrics::Registry::instance().prometheus() << flush;
+
+    if (reset)
+    {
+        metrics::Registry::instance().reset();
+    }
+}
+
 std::function<void()> onCompletedUploads;
 
 void setAppendAndUploadOnCompletedUploads(string local_path, int count, bool allowDuplicateVersions)
@@ -4416,10 +4441,14 @@ static void exec_fuseflags(autocomplete::ACState& state)
     std::string flushDelay;
     std::string logLevel;
     std::string fileExplorerView;
+    std::string partialReadAheadBlocks;
+    std::string partialReadBlockSize;
 
     state.extractflagparam("-flush-delay", flushDelay);
     state.extractflagparam("-log-level", logLevel);
     state.extractflagparam("-file-explorer-view", fileExplorerView);
+    state.extractflagparam("-partial-read-ahead-blocks", partialReadAheadBlocks);
+    state.extractflagparam("-partial-read-block-size", partialReadBlockSize);
 
     auto flags = client->mFuseService.serviceFlags();
 
@@ -4432,6 +4461,12 @@ static void exec_fuseflags(autocomplete::ACState& state)
     if (!fileExplorerView.empty())
         flags.mFileExplorerView = fuse::toFileExplorerView(fileExplorerView);
 
+    if (!partialReadAheadBlocks.empty())
+        flags.mPartialReadAheadBlocks = std::stoul(partialReadAheadBlocks);
+
+    if (!partialReadBlockSize.empty())
+        flags.mPartialReadBlockSize = std::stoul(partialReadBlockSize);
+
     parseCacheFlags(flags.mInodeCacheFlags);
     parseExecutorFlags(flags.mMountExecutorFlags, "mount");
     parseExecutorFlags(flags.mServiceExecutorFlags, "service");
@@ -4447,6 +4482,8 @@ static void exec_fuseflags(autocomplete::ACState& state)
               << "Flush Delay: " << flags.mFlushDelay.count() << "s\n"
               << "Log Level: " << toString(flags.mLogLevel) << "\n"
               << "File Explorer View: " << toString(flags.mFileExplorerView) << "\n"
+              << "Partial Read Ahead Blocks: " << flags.mPartialReadAheadBlocks << "\n"
+              << "Partial Read Block Size: " << flags.mPartialReadBlockSize << "\n"
               << "Mount Max Thread Count: " << flags.mMountExecutorFlags.mMaxWorkers << "\n"
               << "Mount Max Thread Idle Time: " << flags.mMountExecutorFlags.mIdleTime.count()
               << "s\n"
@@ -5290,6 +5327,7 @@ autocomplete::ACN autocompleteSyntax()
     p->Add(exec_sendDeferred, sequence(text("senddeferred"), opt(flag("-reset"))));
     p->Add(exec_codeTimings, sequence(text("codetimings"), opt(flag("-reset"))));
 #endif
+    p->Add(exec_metrics, sequence(text("metrics"), opt(flag("-reset")), opt(either(text("on"), text("off")))));
 
     p->Add(exec_treecompare, sequence(text("treecompare"), localFSPath(), remoteFSPath(client, &cwd)));
     p->Add(exec_generatetestfilesfolders, sequence(text("generatetestfilesfolders"),
@@ -5465,6 +5503,8 @@ autocomplete::ACN autocompleteSyntax()
                      sequence(flag("-mount-max-thread-count"), wholenumber("count", 16)),
                      sequence(flag("-mount-max-thread-idle-time"), wholenumber("seconds", 16)),
                      sequence(flag("-mount-min-thread-count"), wholenumber("count", 0)),
+                     sequence(flag("-partial-read-ahead-blocks"), wholenumber("count", 4)),
+                     sequence(flag("-partial-read-block-size"), wholenumber("bytes", 0)),
                      sequence(flag("-service-max-thread-count"), wholenumber("count", 16)),
                      sequence(flag("-service-max-thread-idle-time"), wholenumber("seconds", 16)),
                      sequence(flag("-service-min-thread-count"), wholenumber("count", 0))))));
@@ -49,6 +49,7 @@
 #include "mega/logging.h"
 #include "mega/megaapp.h"
 #include "mega/megaclient.h"
+#include "mega/metrics.h"
 #include "mega/node.h"
 #include "mega/pendingcontactrequest.h"
 #include "mega/proxy.h"
@@ -138,6 +138,12 @@ public:
     Error move(NodeHandle source,
                NodeHandle target);
 
+    // Download a range of a file's content from the cloud.
+    virtual void partialDownload(PartialDownloadCallback callback,
+                                 NodeHandle handle,
+                                 m_off_t offset,
+                                 m_off_t length) = 0;
+
     // Query who a node's parent is.
     virtual NodeHandle parentHandle(NodeHandle handle) const = 0;
 
@@ -566,6 +566,36 @@ public:
 
     void ctr_crypt(byte *, unsigned, m_off_t, ctr_iv, byte *mac, bool encrypt, bool initmac = true);
 
+    /**
+     * @brief One of the independent buffers processed by ctr_crypt_lanes()
+     *
+     * The members are the arguments of ctr_crypt() that differ between buffers.
+     */
+    struct CtrLane
+    {
+        byte* data;
+        unsigned len;
+        m_off_t pos;
+        byte* mac;
+        bool initmac;
+    };
+
+    /**
+     * @brief ctr_crypt() for several buffers at once
+     *
+     * A CBC-MAC is serial within a buffer, but the MAC blocks of different
+     * buffers are independent, and so is the CTR keystream. They are handed
+     * to the cipher together, which pipelines them (AES-NI where available),
+     * instead of one block per call.
+     *
+     * @param lanes Buffers with the same requirements as in ctr_crypt().
+     * @param count Number of buffers; CTR_LANES are processed together.
+     */
+    void ctr_crypt_lanes(CtrLane* lanes, size_t count, ctr_iv ctriv, bool encrypt);
+
+    // buffers interleaved by ctr_crypt_lanes()
+    static constexpr size_t CTR_LANES = 8;
+
     static void setint64(int64_t, byte*);
 
     static void xorblock(const byte*, byte*);
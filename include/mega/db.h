@@ -71,6 +71,7 @@ enum class DBError
     DB_ERROR_RANGE = 25,
     DB_ERROR_NOTADB = 26,
     DB_ERROR_INDEX_OVERFLOW = 100, // SDK internal error
+    DB_ERROR_WRITES_LOST = 101, // SDK internal error: the cache has to be reloaded
 };
 
 using DBErrorCallback = std::function<void(DBError)>;
@@ -310,7 +311,11 @@ enum DbOpenFlag
     // Recycle legacy database, if present.
     DB_OPEN_FLAG_RECYCLE = 0x1,
     // Operations should always be transacted.
-    DB_OPEN_FLAG_TRANSACTED = 0x2
+    DB_OPEN_FLAG_TRANSACTED = 0x2,
+    // Maintain a full-text index of node names, descriptions and tags.
+    DB_OPEN_FLAG_SEARCH_INDEX = 0x4,
+    // Commit writes to tables with nodes on a thread of their own.
+    DB_OPEN_FLAG_ASYNC_WRITES = 0x8
 }; // DbOpenFlag
 
 struct MEGA_API DbAccess
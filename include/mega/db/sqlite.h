@@ -27,8 +27,12 @@
 
 #include "mega/db.h"
 
+#include <chrono>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <thread>
 #include <sqlite3.h>
 
 namespace mega {
@@ -47,6 +51,9 @@ protected:
     // handler for DB errors ('interrupt' is true if caller can be interrupted by CancelToken)
     void errorHandler(int sqliteError, const std::string& operation, bool interrupt);
 
+    // whether an unmatched begin() has been issued
+    bool inTransaction() const;
+
 public:
     void rewind() override;
     bool next(uint32_t*, string*) override;
@@ -61,19 +68,31 @@ public:
 
     SqliteDbTable(PrnGen &rng, sqlite3*, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack);
     ~SqliteDbTable() override;
-
-private:
-    // whether an unmatched begin() has been issued
-    bool inTransaction() const;
 };
 
 /**
  * This class implements DbTable iface (by deriving SqliteDbTable), and additionally
  * implements DbTableNodes iface too, so it allows to manage `nodes` table.
+ *
+ * When opened with DB_OPEN_FLAG_ASYNC_WRITES, writes to both tables are committed by a thread
+ * of its own, on a second connection. Writes of a transaction are coalesced per record and per
+ * node, and handed to that thread when the transaction is committed, which commits whatever
+ * accumulated in a single SQLite transaction. Until then, lookups by record id and node handle
+ * are answered from the pending writes; other queries wait for them to be committed.
  */
 class MEGA_API SqliteAccountState : public SqliteDbTable, public DBTableNodes
 {
 public:
+    // Access to table `statecache`, through the asynchronous writer if there's one
+    void rewind() override;
+    bool get(uint32_t, string*) override;
+    bool put(uint32_t, char*, unsigned) override;
+    bool del(uint32_t) override;
+    void truncate() override;
+    void begin() override;
+    void commit() override;
+    void abort() override;
+
     // Access to table `nodes`
     bool getNode(mega::NodeHandle nodehandle, NodeSerialized& nodeSerialized) override;
     bool getNodesByOrigFingerprint(const std::string& fingerprint, std::vector<std::pair<NodeHandle, NodeSerialized>> &nodes) override;
@@ -135,10 +154,31 @@ public:
     void createIndexes() override;
 
     void remove() override;
-    SqliteAccountState(PrnGen &rng, sqlite3*, FileSystemAccess &fsAccess, const mega::LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack);
+
+    // 'writerDb' is the connection of the asynchronous writer, nullptr to write synchronously
+    SqliteAccountState(PrnGen &rng, sqlite3*, FileSystemAccess &fsAccess, const mega::LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack, const bool searchIndex, sqlite3* writerDb = nullptr);
     void finalise();
     virtual ~SqliteAccountState();
 
+    // Counters of the asynchronous writer
+    struct AsyncWriteStats
+    {
+        // writes not committed yet, once coalesced
+        size_t queued = 0;
+
+        // group commits, the writes they were asked for and the rows they changed after coalescing
+        uint64_t commits = 0;
+        uint64_t writes = 0;
+        uint64_t rows = 0;
+
+        // time spent committing, and the longest commit
+        std::chrono::microseconds commitTime{0};
+        std::chrono::microseconds maxCommitTime{0};
+    };
+
+    // all zero if writes are synchronous
+    AsyncWriteStats asyncWriteStats() const;
+
     // Callback registered by some long-time running queries, so they can be canceled
     // If the progress callback returns non-zero, the operation is interrupted
     static int progressHandler(void *);
@@ -160,13 +200,81 @@ public:
      */
     static void userMatchFilter(sqlite3_context* context, int argc, sqlite3_value** argv);
 
+    // Method called when query uses 'foldSearchText'
+    // Folds text the way it's stored in the search index (see foldCaseAccent())
+    static void userFoldSearchText(sqlite3_context* context, int argc, sqlite3_value** argv);
+
+    // Method called when query uses 'appendAncestor'
+    // Appends a handle to a node's ancestry: the handles of its ancestors, from the top, 6 bytes
+    // each in big-endian order, so that the ancestry of every node below another starts with the
+    // ancestry of that one followed by its handle. NULL ancestry is empty, an UNDEF handle isn't
+    // appended.
+    static void userAppendAncestor(sqlite3_context* context, int argc, sqlite3_value** argv);
+
+    /**
+     * @brief Builds the FTS5 query used to narrow down searchNodes() with the search index.
+     *
+     * The query selects a superset of the nodes whose name, description or tags satisfy the
+     * text criteria of the filter, so matchFilter() still decides which nodes are returned.
+     *
+     * @return The query, or an empty string if the index can't narrow down the criteria.
+     */
+    static std::string searchIndexQuery(const NodeSearchFilter& filter);
+
 private:
     // Iterate over a SQL query row by row and fill the map
     // Allow at least the following containers:
     bool processSqlQueryNodes(sqlite3_stmt *stmt, std::vector<std::pair<mega::NodeHandle, mega::NodeSerialized>>& nodes);
 
+    // whether the 'nodesearch' full-text index is present and maintained
+    const bool mSearchIndex;
+
+    // whether the 'ancestry' column is populated, indexed and maintained, so that queries about
+    // ancestors and descendants can use it rather than walking the tree (see createNodeIndexes())
+    std::atomic<bool> mAncestryIndex{false};
+
+    // Writes not committed yet, coalesced per record and per node
+    struct PendingWrites;
+    // What pending writes say about a node
+    struct PendingNode;
+    // Commits pending writes on a thread and connection of its own
+    class AsyncWriter;
+    // The writes of the open transaction, applied for a query from another thread (see flushWrites())
+    class StagedWritesOverlay;
+
+    std::unique_ptr<AsyncWriter> mAsyncWriter;
+
+    // writes of the open transaction, until it's committed (only with mAsyncWriter)
+    std::unique_ptr<PendingWrites> mStagedWrites;
+    // protects mStagedWrites, as queries may come from other threads than writes
+    std::mutex mStagedWritesMutex;
+    // the thread that began the open transaction, the only one that may write it here
+    std::thread::id mTransactionThread;
+
+    // Record a write to be committed asynchronously.
+    // Returns false if writes are synchronous, so the caller has to do it.
+    bool queueWrite(const std::function<void(PendingWrites&)>& write);
+
+    // Make the DB reflect every write issued so far, for queries pending writes can't answer.
+    // Queries from another thread than the open transaction's keep what's returned until they're
+    // done: it rolls that transaction's writes back.
+    std::unique_ptr<StagedWritesOverlay> flushWrites();
+
+    // Whether queries can rely on the ancestry column, with the writes of the overlay if any
+    bool ancestryIndex(const StagedWritesOverlay* overlay) const;
+
+    // Whether pending writes decide the content of a record or node (else, it's up to the DB)
+    bool lookupPendingRecord(uint32_t index, std::optional<std::string>& content);
+    bool lookupPendingNode(NodeHandle nodeHandle, PendingNode& node);
+
+    // Forward errors of the asynchronous writer to errorHandler()
+    void reportAsyncErrors();
+
     // if add a new sqlite3_stmt update finalise()
     sqlite3_stmt* mStmtPutNode = nullptr;
+    sqlite3_stmt* mStmtPutSearchText = nullptr;
+    sqlite3_stmt* mStmtChildAncestry = nullptr;
+    sqlite3_stmt* mStmtUpdateAncestry = nullptr;
     sqlite3_stmt* mStmtUpdateNode = nullptr;
     sqlite3_stmt* mStmtUpdateNodeAndFlags = nullptr;
     sqlite3_stmt* mStmtTypeAndSizeNode = nullptr;
@@ -178,12 +286,15 @@ private:
     sqlite3_stmt* mStmtNumChildren = nullptr;
     std::map<size_t, sqlite3_stmt*> mStmtGetChildren;
     std::map<size_t, sqlite3_stmt*> mStmtSearchNodes;
+    std::map<size_t, sqlite3_stmt*> mStmtSearchNodesByAncestry;
     sqlite3_stmt* mStmtNodeTagsBelow = nullptr;
+    sqlite3_stmt* mStmtNodeTagsBelowByAncestry = nullptr;
     sqlite3_stmt* mStmtNodesByFp = nullptr;
     sqlite3_stmt* mStmtNodeByFp = nullptr;
     sqlite3_stmt* mStmtNodeByOrigFp = nullptr;
     sqlite3_stmt* mStmtChildNode = nullptr;
     sqlite3_stmt* mStmtIsAncestor = nullptr;
+    sqlite3_stmt* mStmtIsAncestorByAncestry = nullptr;
     sqlite3_stmt* mStmtNumChild = nullptr;
     sqlite3_stmt* mStmtRecents = nullptr; // For getRecentNodes()
     sqlite3_stmt* mStmtFavourites = nullptr;
@@ -321,6 +432,10 @@ private:
     bool stripExistingColumns(sqlite3* db, vector<NewColumn>& cols);
     bool addColumn(sqlite3* db, const string& name, const string& type);
     bool migrateDataToColumns(sqlite3* db, vector<NewColumn>&& cols);
+
+    // create (and populate from existing nodes) the optional full-text index used by searchNodes()
+    // returns false if the index is unavailable, in which case searches don't use it
+    bool createSearchIndex(sqlite3* db);
 };
 
 class OrderByClause
@@ -22,6 +22,8 @@
 #pragma once
 
 #include <array>
+#include <functional>
+#include <vector>
 
 #include "types.h"
 
@@ -52,6 +54,16 @@ struct MEGA_API FileFingerprint : public Cacheable
     // Generates a fingerprint by iterating through `is`
     bool genfingerprint(InputStreamAccess* is, m_time_t cmtime, bool ignoremtime = false);
 
+    // Generates the fingerprints of several files concurrently, each with its own mtime.
+    //
+    // open(i) returns a stream for the i-th file, or nullptr if it can't be read, in which
+    // case that fingerprint is left untouched. Files are read by up to `threads` threads at
+    // once, which pays off when the storage serves reads in parallel. Returns how many
+    // fingerprints were generated.
+    static size_t genfingerprints(const std::vector<FileFingerprint*>& fingerprints,
+                                  const std::function<std::unique_ptr<InputStreamAccess>(size_t)>& open,
+                                  unsigned threads);
+
     // Includes CRC and mtime
     // Be wary that these must be used in pair; do not mix with serialize pair
     void serializefingerprint(string* d) const;
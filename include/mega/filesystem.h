@@ -31,6 +31,7 @@
 #include <mega/localpath.h>
 
 #include <atomic>
+#include <string_view>
 
 namespace mega {
 
@@ -857,6 +858,35 @@ int platformCompareUtf(const string&, bool unescape1, const LocalPath&, bool une
 int platformCompareUtf(const LocalPath&, bool unescape1, const string&, bool unescape2);
 int platformCompareUtf(const LocalPath&, bool unescape1, const LocalPath&, bool unescape2);
 
+// A name prepared for being compared many times, as when sorting the children of a folder.
+// Decoding and case folding happen once, here, rather than on every comparison.
+// Keys order and match exactly as compareUtf() does for the names they were made from.
+class MEGA_API CollationKey
+{
+public:
+    // The name must outlive the key.
+    CollationKey(const string& name, bool unescaping, bool caseInsensitive);
+
+    int compare(const CollationKey& other) const;
+
+private:
+    // What's compared: UTF-8, whose bytes order as its code points do.
+    std::string_view folded() const;
+
+    const string* mName;
+
+    // The name's code points, case-folded, if they can't be compared as they are in the name.
+    string mFolded;
+
+    bool mUnescaping;
+    bool mCaseInsensitive;
+    bool mCopied = false;
+
+    // Whether comparisons need compareUtf(), as when the name has escapes that may be
+    // decoded depending on the other name.
+    bool mExact = false;
+}; // CollationKey
+
 struct MEGA_API FSNode
 {
     // A structure convenient for containing just the attributes of one item from the filesystem
@@ -999,6 +1029,16 @@ public:
     // Issue a scan for the given target.
     RequestPtr queueScan(LocalPath targetPath, handle expectedFsid, bool followSymlinks, map<LocalPath, FSNode>&& priorScanChildren, shared_ptr<Waiter> waiter);
 
+    // How many directories can be scanned at once, by all services.
+    static size_t numThreads();
+
+    // Changes how many directories can be scanned at once.
+    // Scans already queued still complete.
+    static void setNumThreads(size_t numThreads);
+
+    static constexpr size_t DEFAULT_THREADS = 4;
+    static constexpr size_t MAX_THREADS = 16;
+
     // Track performance (debug only)
     static CodeCounter::ScopeStats syncScanTime;
 
@@ -1046,9 +1086,15 @@ private:
     // Worker shared by all services.
     static std::unique_ptr<Worker> mWorker;
 
+    // How many threads the worker has.
+    static size_t mNumThreads;
+
     // Synchronizes access to the above.
     static std::mutex mWorkerLock;
 
+    // Synchronizes updates to syncScanTime.
+    static std::mutex mStatsLock;
+
 }; // ScanService
 
 // True if type denotes a network filesystem.
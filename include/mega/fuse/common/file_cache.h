@@ -123,12 +123,18 @@ public:
     // Where is an inode's local state located?
     LocalPath path(const FileExtension& extension, InodeID id) const;
 
+    // Where are the blocks fetched by partial reads of an inode located?
+    LocalPath partialPath(InodeID id) const;
+
     // Remove an inode's content from the cache.
     void remove(const FileExtension& extension, InodeID id);
 
     // Where is the cache storing its data?
     const LocalPath mCachePath;
 
+    // Where is the cache storing content fetched by partial reads?
+    const LocalPath mPartialPath;
+
     // Which context owns this cache?
     platform::ServiceContext& mContext;
 }; // FileCache
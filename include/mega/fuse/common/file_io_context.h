@@ -55,8 +55,12 @@ class FileIOContext
     // Bundles up state required to perform a flush.
     class FlushContext;
 
+    // Bundles up state required to serve partial reads.
+    class PartialContext;
+
     // Convenience.
     using FlushContextPtr = std::shared_ptr<FlushContext>;
+    using PartialContextPtr = std::shared_ptr<PartialContext>;
 
     // Create the file.
     common::ErrorOr<FileAccessSharedPtr> create();
@@ -94,6 +98,12 @@ class FileIOContext
               m_off_t hint = -1)
       -> common::ErrorOr<FileAccessSharedPtr>;
 
+    // Retrieve a context suitable for serving partial reads, if any.
+    //
+    // A context will only be returned if partial reads are enabled and
+    // this file has no local content.
+    PartialContextPtr partialContext(FileIOContextSharedLock& lock);
+
     // What file does this entry represent?
     FileInodeRef mFile;
 
@@ -118,6 +128,12 @@ class FileIOContext
     // True if we need to flush this file's content to the cloud.
     bool mFlushNeeded;
 
+    // State required to serve partial reads, if any.
+    PartialContextPtr mPartialContext;
+
+    // Serializes access to mPartialContext.
+    std::mutex mPartialLock;
+
     // Represents a queued periodic flush, if any.
     common::Task mPeriodicFlushTask;
 
@@ -33,6 +33,15 @@ struct ServiceFlags
 
     // Specifies how the service should manage its worker threads.
     common::TaskExecutorFlags mServiceExecutorFlags;
+
+    // How large is each block fetched when serving a partial read?
+    //
+    // When zero, a file's entire content is downloaded into the cache
+    // before any read against that file can be satisfied.
+    std::size_t mPartialReadBlockSize = 0;
+
+    // How many blocks should we fetch ahead of a sequential reader?
+    std::size_t mPartialReadAheadBlocks = 4;
 }; // ServiceFlags
 
 } // fuse
@@ -22,6 +22,7 @@
 #ifndef GFX_H
 #define GFX_H 1
 
+#include <condition_variable>
 #include <mutex>
 
 #include "mega/types.h"
@@ -67,6 +68,7 @@ class MEGA_API GfxJobQueue
         GfxJobQueue();
         void push(GfxJob *job);
         GfxJob *pop();
+        size_t size();
 };
 
 class MEGA_API GfxDimension
@@ -111,6 +113,10 @@ public:
     // list of supported video extensions (NULL if no pre-filtering is needed)
     virtual const char* supportedvideoformats() = 0;
 
+    // How many calls to generateImages() can usefully run at once. Providers returning
+    // more than one must be thread safe: GfxProc then calls them from as many threads.
+    virtual size_t concurrency() { return 1; }
+
     static std::unique_ptr<IGfxProvider> createInternalGfxProvider();
 };
 
@@ -160,14 +166,22 @@ protected:
 class MEGA_API GfxProc
 {
     std::atomic<bool> finished{false};
-    WAIT_CLASS waiter;
     std::mutex mutex;
-    THREAD_CLASS thread;
+    std::vector<std::unique_ptr<THREAD_CLASS>> threads;
     bool threadstarted = false;
     SymmCipher mCheckEventsKey;
+
+    // processing threads wait for requests, pushed with the mutex held
+    std::mutex requestsMutex;
+    std::condition_variable requestsPushed;
     GfxJobQueue requests;
+
     GfxJobQueue responses;
     std::unique_ptr<IGfxProvider>  mGfxProvider;
+    size_t mConcurrency = 1;
+
+    // jobs requested and not yet processed by checkevents()
+    std::atomic<size_t> mPendingJobs{0};
 
     static void *threadEntryPoint(void *param);
     void loop();
@@ -214,9 +228,12 @@ public:
 
     MegaClient* client = nullptr;
 
-    // start a thread that will do the processing
+    // start the threads that will do the processing, as many as the provider's concurrency()
     void startProcessingThread();
 
+    // number of jobs queued or in progress, for a view of how far behind thumbnails are
+    size_t pendingJobs() const { return mPendingJobs; }
+
     // The provided IGfxProvider implements library specific image processing
     // Thread safety among IGfxProvider methods is guaranteed by GfxProc
     GfxProc(std::unique_ptr<IGfxProvider>);
@@ -2,6 +2,7 @@
 
 #include "mega.h"
 #include "mega/gfx.h"
+#include "mega/scoped_helpers.h"
 
 #include <atomic>
 #include <chrono>
@@ -110,6 +111,9 @@ public:
         // Convert to args used to launch isolated process
         std::vector<std::string> toArgs() const;
 
+        // The params of the index-th process of a pool: all but the first need an endpoint of their own
+        Params forPoolMember(size_t index) const;
+
         bool isValid() const
         {
             return !endpointName.empty() && !executable.empty();
@@ -147,12 +151,42 @@ private:
     HelloBeater mBeater;
 };
 
+// Hands out the processes of a pool, each one to a single user at a time.
+class GfxProcessPool
+{
+public:
+    // size is at least 1
+    explicit GfxProcessPool(size_t size);
+
+    // Wait for a process that isn't busy and mark it busy: it is released when the returned
+    // destructor runs, whether the work on it succeeded or not
+    std::pair<size_t, ScopedDestructor> acquire();
+
+    size_t size() const { return mBusy.size(); }
+
+private:
+    void release(size_t index);
+
+    std::vector<bool> mBusy;
+
+    // where to start looking for an idle process, so that work is spread over all of them
+    size_t mNext = 0;
+
+    std::mutex mMutex;
+
+    std::condition_variable mReleased;
+};
+
+// Generates images with a pool of isolated processes, each working on one file at a time,
+// so that they can work in parallel while a crash only affects the file being processed.
 class GfxProviderIsolatedProcess : public IGfxProvider
 {
 public:
 
     GfxProviderIsolatedProcess(std::unique_ptr<GfxIsolatedProcess> process);
 
+    GfxProviderIsolatedProcess(std::vector<std::unique_ptr<GfxIsolatedProcess>> processes);
+
     std::vector<std::string> generateImages(const LocalPath& localfilepath,
                                             const std::vector<GfxDimension>& dimensions) override;
 
@@ -160,8 +194,11 @@ public:
 
     const char* supportedvideoformats() override;
 
+    size_t concurrency() override;
+
+    // processCount is at least 1
     static std::unique_ptr<GfxProviderIsolatedProcess>
-        create(const GfxIsolatedProcess::Params& params);
+        create(const GfxIsolatedProcess::Params& params, size_t processCount = 1);
 
 private:
 
@@ -192,9 +229,11 @@ private:
 
     Formats mFormats;
 
-    std::unique_ptr<GfxIsolatedProcess> mProcess;
+    std::vector<std::unique_ptr<GfxIsolatedProcess>> mProcesses;
 
-    std::string mEndpointName;
+    std::vector<std::string> mEndpointNames;
+
+    GfxProcessPool mPool;
 };
 
 }
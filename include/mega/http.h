@@ -531,6 +531,10 @@ public:
     // len must be < 2^31
     virtual byte* nextbuffer(unsigned datasize) = 0;
 
+    // true if buffers stay valid after the next call to nextbuffer(),
+    // so that several chunks can be encrypted together
+    virtual bool keepsBuffers() const { return false; }
+
     bool encrypt(m_off_t pos, m_off_t npos, string& urlSuffix);
 
 private:
@@ -539,6 +543,7 @@ private:
     uint64_t ctriv;     // initialization vector for CTR mode
     byte crc[CRCSIZE];
     void updateCRC(byte* data, unsigned size, unsigned offset);
+    void encryptChunks(vector<chunkmac_map::CtrChunk>& chunks, m_off_t pos);
 };
 
 class MEGA_API EncryptBufferByChunks : public EncryptByChunks
@@ -547,6 +552,7 @@ class MEGA_API EncryptBufferByChunks : public EncryptByChunks
     byte *chunkstart;
 
     byte* nextbuffer(unsigned bufsize) override;
+    bool keepsBuffers() const override { return true; }
 
 public:
     EncryptBufferByChunks(byte* b, SymmCipher* k, chunkmac_map* m, uint64_t iv);
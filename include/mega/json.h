@@ -27,6 +27,23 @@
 
 namespace mega {
 
+// Kernels that scan JSON text, one set per instruction set.
+// The set used by JSON and JSONSplitter is picked once, among those built for this CPU.
+struct MEGA_API JSONKernels
+{
+    const char* name;
+
+    // Returns the closing quote of the string whose contents start at `p`, skipping escaped
+    // characters, or the terminating null character if the string is not closed.
+    const char* (*stringEnd)(const char* p);
+
+    // Every set usable on this CPU, the portable reference first and the preferred one last.
+    static const std::vector<const JSONKernels*>& available();
+
+    // The preferred set for this CPU.
+    static const JSONKernels& best();
+};
+
 // linear non-strict JSON scanner
 struct MEGA_API JSON
 {
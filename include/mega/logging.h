@@ -86,6 +86,16 @@
 
     In performance mode, only outputting to a logger assigned through `setOutputClass` is supported.
     Output streams are not supported.
+
+    5) Outside performance mode, messages can be formatted and output on a background thread.
+
+    SimpleLogger::setAsyncOutput(true);
+
+    The logging thread then only encodes the values logged, mostly in binary, in a buffer of its
+    own. The output thread formats them and calls the output class, so the `Logger` must cope
+    with being called from a thread other than the one that logged. Messages are output in the
+    order each thread logged them. When a thread logs faster than they can be output, its
+    buffer fills up and further messages are dropped: the output class is told how many.
 */
 #pragma once
 
@@ -93,8 +103,10 @@
 #include <atomic>
 #include <cassert>
 #include <cstring>
+#include <ctime>
 #include <iostream>
 #include <mutex>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -174,16 +186,218 @@ public:
     }
 };
 
+#ifndef ENABLE_LOG_PERFORMANCE
+// How SimpleLogger encodes a message for the asynchronous output thread: a Header, then each
+// value logged, as a Tag and its binary representation. Values the output thread can't format
+// by itself are formatted by the logging thread and encoded as strings.
+struct AsyncLogRecord
+{
+    enum Tag : char
+    {
+        STRING,      // uint32_t length, then the characters
+        FILENAME,    // as STRING, for a filename that may not outlive the message
+        BOOLEAN,     // bool
+        CHARACTER,   // char
+        SIGNED,      // uint8_t size of the value logged, then int64_t
+        UNSIGNED,    // uint8_t size of the value logged, then uint64_t
+        FLOATING,    // double
+        POINTER,     // const void*
+        MANIPULATOR, // std::ios_base& (*)(std::ios_base&)
+    };
+
+    struct Header
+    {
+        std::time_t time;
+        const char* filename;
+        int line;
+        LogLevel level;
+    };
+
+    // Each value is appended at once, as that's what takes time.
+    template<typename T>
+    static void append(std::string& record, Tag tag, const T value)
+    {
+        char buffer[1 + sizeof(value)] = {tag};
+        std::memcpy(buffer + 1, &value, sizeof(value));
+        record.append(buffer, sizeof(buffer));
+    }
+
+    static void append(std::string& record, Tag tag, const char* data, size_t size)
+    {
+        append(record, tag, static_cast<uint32_t>(size));
+        record.append(data, size);
+    }
+
+    template<typename T>
+    static void appendInteger(std::string& record, const T value)
+    {
+        using Value = typename std::conditional<std::is_signed<T>::value, int64_t, uint64_t>::type;
+
+        char buffer[2 + sizeof(Value)] = {std::is_signed<T>::value ? SIGNED : UNSIGNED,
+                                          static_cast<char>(sizeof(T))};
+        const auto converted = static_cast<Value>(value);
+
+        std::memcpy(buffer + 2, &converted, sizeof(converted));
+        record.append(buffer, sizeof(buffer));
+    }
+}; // AsyncLogRecord
+#endif
+
 class SimpleLogger
 {
     LogLevel level;
 
 #ifndef ENABLE_LOG_PERFORMANCE
-    std::ostringstream ostr;
+    // Only while outputting synchronously.
+    std::optional<std::ostringstream> ostr;
     std::string t;
     std::string fname;
 
     std::string getTime();
+
+    // While outputting asynchronously, this message is encoded in the thread's mRecords,
+    // from mRecordStart. Messages logged while it's built, by the values logged, are encoded
+    // after it and removed once they're queued. mRecord saves looking up mRecords every time.
+    std::string* mRecord = nullptr;
+    size_t mRecordStart = 0;
+    bool mCopyFilename = false;
+    std::ios_base::fmtflags mFlags = std::ios_base::skipws | std::ios_base::dec;
+
+    static inline thread_local std::string mRecords;
+    static inline thread_local std::ostringstream mFormatStream;
+    static inline thread_local bool mFormatting = false;
+
+    static std::atomic<bool> asyncOutput;
+
+    // Whether this thread may still have messages queued for the output thread, which have to
+    // be output before its next ones, even once asynchronous output is disabled.
+    static bool queuedAsync();
+
+    friend class AsyncLogFormatter;
+
+    template<typename T>
+    void write(const T& value)
+    {
+        if (mRecord)
+        {
+            asyncValue(value);
+        }
+        else if (ostr)
+        {
+            *ostr << value;
+        }
+    }
+
+    template<typename T>
+    void asyncValue(const T& value)
+    {
+        using std::is_same;
+
+        if constexpr (is_same<T, bool>::value)
+        {
+            AsyncLogRecord::append(*mRecord, AsyncLogRecord::BOOLEAN, value);
+        }
+        else if constexpr (is_same<T, char>::value || is_same<T, signed char>::value
+                           || is_same<T, unsigned char>::value)
+        {
+            AsyncLogRecord::append(*mRecord, AsyncLogRecord::CHARACTER, static_cast<char>(value));
+        }
+        else if constexpr (std::is_integral<T>::value)
+        {
+            AsyncLogRecord::appendInteger(*mRecord, value);
+        }
+        else if constexpr (is_same<T, float>::value || is_same<T, double>::value)
+        {
+            AsyncLogRecord::append(*mRecord, AsyncLogRecord::FLOATING, static_cast<double>(value));
+        }
+        else if constexpr (is_same<T, std::string>::value || is_same<T, std::string_view>::value)
+        {
+            AsyncLogRecord::append(*mRecord, AsyncLogRecord::STRING, value.data(), value.size());
+        }
+        else if constexpr (std::is_array<T>::value
+                           && is_same<typename std::remove_extent<T>::type, char>::value)
+        {
+            AsyncLogRecord::append(*mRecord, AsyncLogRecord::STRING, value, std::strlen(value));
+        }
+        else if constexpr (std::is_pointer<T>::value)
+        {
+            asyncPointer(value);
+        }
+        else
+        {
+            asyncFormatted(value);
+        }
+    }
+
+    template<typename T>
+    void asyncPointer(T* value)
+    {
+        using std::is_same;
+        using Manipulator = std::ios_base& (*)(std::ios_base&);
+        using Pointee = typename std::remove_const<T>::type;
+
+        if constexpr (is_same<Pointee, char>::value)
+        {
+            AsyncLogRecord::append(*mRecord, AsyncLogRecord::STRING, value, std::strlen(value));
+        }
+        else if constexpr (is_same<T*, Manipulator>::value)
+        {
+            // Keep track of the flags, for values formatted here.
+            auto flags = mFormatStream.flags(mFlags);
+            value(mFormatStream);
+            mFlags = mFormatStream.flags(flags);
+
+            AsyncLogRecord::append(*mRecord, AsyncLogRecord::MANIPULATOR, value);
+        }
+        else if constexpr ((std::is_object<T>::value || std::is_void<T>::value)
+                           && !std::is_volatile<T>::value
+                           && !is_same<Pointee, signed char>::value
+                           && !is_same<Pointee, unsigned char>::value)
+        {
+            AsyncLogRecord::append(*mRecord,
+                                   AsyncLogRecord::POINTER,
+                                   static_cast<const void*>(value));
+        }
+        else
+        {
+            asyncFormatted(value);
+        }
+    }
+
+    // Values of other types are formatted as they would be if output synchronously,
+    // except that only the manipulators without arguments, like std::hex, apply.
+    template<typename T>
+    void asyncFormatted(const T& value)
+    {
+        if (mFormatting)
+        {
+            // Something logged while formatting a value.
+            std::ostringstream ostream;
+            ostream.flags(mFlags);
+            ostream << value;
+
+            auto text = ostream.str();
+            AsyncLogRecord::append(*mRecord, AsyncLogRecord::STRING, text.data(), text.size());
+            return;
+        }
+
+        struct Formatting
+        {
+            Formatting() { mFormatting = true; }
+            ~Formatting() { mFormatting = false; }
+        } formatting;
+
+        mFormatStream.str(std::string());
+        mFormatStream.clear();
+        mFormatStream.flags(mFlags);
+        mFormatStream << value;
+
+        auto text = mFormatStream.str();
+        AsyncLogRecord::append(*mRecord, AsyncLogRecord::STRING, text.data(), text.size());
+    }
+
+    // Hands this message to the output thread, or outputs it if it can't be queued.
+    void queue();
 #else
     using Buffer = std::array<char, LOGGER_CHUNKS_SIZE>;
     static inline thread_local Buffer mBuffer;
@@ -413,6 +627,17 @@ public:
             return;
         }
 
+        if (asyncOutput.load(std::memory_order_relaxed) || queuedAsync())
+        {
+            mRecord = &mRecords;
+            mRecordStart = mRecord->size();
+
+            AsyncLogRecord::Header header{std::time(nullptr), filename, line, ll};
+            mRecord->append(reinterpret_cast<const char*>(&header), sizeof(header));
+            return;
+        }
+
+        ostr.emplace();
         t = getTime();
         std::ostringstream oss;
         oss << filename;
@@ -468,8 +693,10 @@ public:
         }
 
 #else
-        if (logger)
-            logger->log(t.c_str(), level, fname.c_str(), ostr.str().c_str());
+        if (mRecord)
+            queue();
+        else if (logger && ostr)
+            logger->log(t.c_str(), level, fname.c_str(), ostr->str().c_str());
 #endif
     }
 
@@ -506,11 +733,11 @@ public:
 #else
         if (obj)
         {
-            ostr << obj;
+            write(obj);
         }
         else
         {
-            ostr << "(NULL)";
+            write("(NULL)");
         }
 #endif
         return *this;
@@ -523,7 +750,7 @@ public:
 #ifdef ENABLE_LOG_PERFORMANCE
         logValue(obj);
 #else
-        ostr << obj;
+        write(obj);
 #endif
         return *this;
     }
@@ -534,7 +761,7 @@ public:
 #ifdef ENABLE_LOG_PERFORMANCE
         logValue(obj);
 #else
-        ostr << obj;
+        write(obj);
 #endif
         return *this;
     }
@@ -545,7 +772,7 @@ public:
 #ifdef ENABLE_LOG_PERFORMANCE
         logValue(s.toUtf8().constData());
 #else
-        ostr << s.toUtf8().constData();
+        write(s.toUtf8().constData());
 #endif
         return *this;
     }
@@ -566,11 +793,11 @@ public:
 #else
         if (!ptr)
         {
-            ostr << "<empty unique ptr>";
+            write("<empty unique ptr>");
         }
         else
         {
-            ostr << *ptr.get();
+            write(*ptr.get());
         }
 #endif
         return *this;
@@ -591,11 +818,11 @@ public:
 #else
         if (!ptr)
         {
-            ostr << "<empty shared ptr>";
+            write("<empty shared ptr>");
         }
         else
         {
-            ostr << *ptr.get();
+            write(*ptr.get());
         }
 #endif
         return *this;
@@ -604,7 +831,14 @@ public:
     SimpleLogger& operator<<(const DirectMessage &obj)
     {
 #ifndef ENABLE_LOG_PERFORMANCE
-        ostr.write(obj.constChar(), static_cast<std::streamsize>(obj.size()));
+        if (mRecord)
+        {
+            AsyncLogRecord::append(*mRecord, AsyncLogRecord::STRING, obj.constChar(), obj.size());
+        }
+        else if (ostr)
+        {
+            ostr->write(obj.constChar(), static_cast<std::streamsize>(obj.size()));
+        }
 #else
         // careful using constChar() without taking size() into account: *this << obj.constChar(); ended up with 2MB+ lines from fetchnodes.
 
@@ -630,6 +864,22 @@ public:
         logger = logger_class;
     }
 
+#ifndef ENABLE_LOG_PERFORMANCE
+    // default size of the buffer of each thread that logs, while outputting asynchronously
+    static const size_t ASYNC_BUFFER_SIZE = 256 * 1024;
+
+    // Format messages and call the output class on a background thread, or stop doing so.
+    // Each thread that logs gets a buffer of `bufferSize` bytes, rounded up to a power of two.
+    // Stopping outputs what was queued before returning.
+    static void setAsyncOutput(bool enable, size_t bufferSize = ASYNC_BUFFER_SIZE);
+
+    // Wait until messages logged so far are output.
+    static void flushAsyncOutput();
+
+    // Messages dropped because their thread's buffer was full, since the process started.
+    static uint64_t droppedAsyncMessages();
+#endif
+
     // set the current log level. all logs which are higher than this level won't be handled
     static void setLogLevel(LogLevel ll)
     {
@@ -661,6 +911,10 @@ public:
     {
         if (logCurrentLevel < logLevel) return;
         SimpleLogger simpleLogger(logLevel, filename ? filename : "", line);
+#ifndef ENABLE_LOG_PERFORMANCE
+        // The filename belongs to the app.
+        simpleLogger.mCopyFilename = true;
+#endif
         if (message)
             simpleLogger << message;
     }
@@ -32,6 +32,7 @@
 #include "http.h"
 #include "json.h"
 #include "mediafileattribute.h"
+#include "metrics.h"
 #include "name_collision.h"
 #include "nodemanager.h"
 #include "pendingcontactrequest.h"
@@ -1951,6 +1952,12 @@ public:
     // DB access
     DbAccess* dbaccess = nullptr;
 
+    // keep a full-text index of nodes in the local cache, to speed up searches by text
+    bool nodeSearchIndex = false;
+
+    // commit writes to the local cache on a thread of its own
+    bool asyncDbWrites = false;
+
     // DbTable iface to handle "statecache" for logged in user (implemented at SqliteAccountState object)
     unique_ptr<DbTable> sctable;
 
@@ -1976,6 +1983,13 @@ public:
 
     void handleDbError(DBError error);
 
+    // set when writes to the DB cache were lost, from any thread
+    std::atomic<bool> mDbWritesLost{false};
+    bool mReloadedForLostDbWrites = false;
+
+    // drop the local state and load it again from the servers, mid-session
+    void reloadFromServers();
+
     // notify the app about a fatal error (ie. DB critical error like disk is full)
     void fatalError(ErrorReason errorReason);
 
@@ -2413,6 +2427,22 @@ public:
                  NodeManager::MissingParentNodes& missingParentNodes, handle &previousHandleForAlert, set<NodeHandle> *allParents,
                  Node *priorActionpacketDeletedNode, bool *firstHandleMatchesDelete);
 
+    // nodes from fetchnodes whose keys and attributes are decrypted in a batch
+    struct NodeDecryption
+    {
+        std::shared_ptr<Node> mNode;
+        Node::KeyDecryption mDecryption;
+        bool mPrepared = false;
+    };
+
+    vector<NodeDecryption> mNodeDecryptions;
+
+    static constexpr size_t NODE_DECRYPTION_BATCH = 2048;
+
+    // decrypt the batch on the worker threads and this one, then apply
+    // the keys and write the nodes to the DB in the order they were read
+    void flushNodeDecryptions();
+
     void readok(JSON*);
     void readokelement(JSON*);
     void readoutshares(JSON*);
@@ -2713,24 +2743,24 @@ public:
     // Keep track of high level operation counts and times, for performance analysis
     struct PerformanceStats
     {
-        CodeCounter::ScopeStats execFunction = { "MegaClient_exec" };
-        CodeCounter::ScopeStats transferslotDoio = { "TransferSlot_doio" };
-        CodeCounter::ScopeStats execdirectreads = { "execdirectreads" };
-        CodeCounter::ScopeStats transferComplete = { "transfer_complete" };
+        CodeCounter::ScopeStats execFunction = { "MegaClient_exec", "mega_client_exec_seconds" };
+        CodeCounter::ScopeStats transferslotDoio = { "TransferSlot_doio", "mega_transferslot_doio_seconds" };
+        CodeCounter::ScopeStats execdirectreads = { "execdirectreads", "mega_directreads_exec_seconds" };
+        CodeCounter::ScopeStats transferComplete = { "transfer_complete", "mega_transfer_complete_seconds" };
         CodeCounter::ScopeStats megaapiSendPendingTransfers = { "megaapi_sendtransfers" };
         CodeCounter::ScopeStats prepareWait = { "MegaClient_prepareWait" };
         CodeCounter::ScopeStats doWait = { "MegaClient_doWait" };
         CodeCounter::ScopeStats checkEvents = { "MegaClient_checkEvents" };
-        CodeCounter::ScopeStats applyKeys = { "MegaClient_applyKeys" };
-        CodeCounter::ScopeStats dispatchTransfers = { "dispatchTransfers" };
-        CodeCounter::ScopeStats csResponseProcessingTime = { "cs batch response processing" };
-        CodeCounter::ScopeStats csSuccessProcessingTime = { "cs batch received processing" };
-        CodeCounter::ScopeStats scProcessingTime = { "sc processing" };
+        CodeCounter::ScopeStats applyKeys = { "MegaClient_applyKeys", "mega_client_apply_keys_seconds" };
+        CodeCounter::ScopeStats dispatchTransfers = { "dispatchTransfers", "mega_transfer_dispatch_seconds" };
+        CodeCounter::ScopeStats csResponseProcessingTime = { "cs batch response processing", "mega_cs_response_processing_seconds" };
+        CodeCounter::ScopeStats csSuccessProcessingTime = { "cs batch received processing", "mega_cs_batch_processing_seconds" };
+        CodeCounter::ScopeStats scProcessingTime = { "sc processing", "mega_sc_processing_seconds" };
 #ifdef ENABLE_SYNC
-        CodeCounter::ScopeStats recursiveSyncTime = { "recursiveSync" };
-        CodeCounter::ScopeStats computeSyncTripletsTime = { "computeSyncTriplets" };
-        CodeCounter::ScopeStats inferSyncTripletsTime = { "inferSyncTriplets" };
-        CodeCounter::ScopeStats syncItem = { "syncItem" };
+        CodeCounter::ScopeStats recursiveSyncTime = { "recursiveSync", "mega_sync_recursive_seconds" };
+        CodeCounter::ScopeStats computeSyncTripletsTime = { "computeSyncTriplets", "mega_sync_triplets_seconds" };
+        CodeCounter::ScopeStats inferSyncTripletsTime = { "inferSyncTriplets", "mega_sync_infer_triplets_seconds" };
+        CodeCounter::ScopeStats syncItem = { "syncItem", "mega_sync_item_seconds" };
         CodeCounter::ScopeStats syncItemCheckMove = { "syncItemCheckMove" };
         CodeCounter::ScopeStats syncItemXXX = { "syncItemXXX" };
         CodeCounter::ScopeStats syncItemXXF = { "syncItemXXF" };
@@ -2740,10 +2770,17 @@ public:
         CodeCounter::ScopeStats syncItemCXF = { "syncItemCXF" };
         CodeCounter::ScopeStats syncItemCSX = { "syncItemCSX" };
         CodeCounter::ScopeStats syncItemCSF = { "syncItemCSF" };
-        CodeCounter::ScopeStats clientThreadActions = { "clientThreadActions" };
+        CodeCounter::ScopeStats clientThreadActions = { "clientThreadActions", "mega_sync_client_thread_actions_seconds" };
 #endif
         uint64_t transferStarts = 0, transferFinishes = 0;
         uint64_t transferTempErrors = 0, transferFails = 0;
+        metrics::Counter& transferStartsTotal = metrics::counter("mega_transfer_starts_total", "Transfers started");
+        metrics::Counter& transferFinishesTotal = metrics::counter("mega_transfer_finishes_total", "Transfers finished");
+        metrics::Counter& transferTempErrorsTotal = metrics::counter("mega_transfer_temp_errors_total", "Transfer attempts that failed temporarily");
+        metrics::Counter& transferFailsTotal = metrics::counter("mega_transfer_fails_total", "Transfers that failed");
+        // this client's part of the process-wide gauges
+        metrics::GaugeShare transferSlots{metrics::gauge("mega_transfer_slots", "Transfers in progress")};
+        metrics::GaugeShare transfers{metrics::gauge("mega_transfers", "Transfers queued or in progress")};
         uint64_t prepwaitImmediate = 0, prepwaitZero = 0, prepwaitHttpio = 0, prepwaitFsaccess = 0, nonzeroWait = 0;
         CodeCounter::DurationSum csRequestWaitTime;
         CodeCounter::DurationSum transfersActiveTime;
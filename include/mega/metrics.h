@@ -0,0 +1,202 @@
+/**
+ * @file mega/metrics.h
+ * @brief Counters, gauges and latency histograms that can be turned on at runtime
+ *
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef MEGA_METRICS_H
+#define MEGA_METRICS_H 1
+
+#include "types.h"
+
+#include <array>
+
+namespace mega {
+namespace metrics {
+
+// Metrics are process wide, shared by every client, and recorded only while enabled.
+// Recording is a few relaxed atomic additions, so they can be left on in production.
+// They're off by default.
+MEGA_API void setEnabled(bool enabled);
+
+inline bool enabled()
+{
+    return gEnabled.load(std::memory_order_relaxed);
+}
+
+class MEGA_API Counter
+{
+public:
+    void add(uint64_t n = 1)
+    {
+        if (enabled())
+            mValue.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const
+    {
+        return mValue.load(std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+        mValue.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> mValue{0};
+}; // Counter
+
+class MEGA_API Gauge
+{
+public:
+    void set(int64_t value)
+    {
+        if (enabled())
+            mValue.store(value, std::memory_order_relaxed);
+    }
+
+    // Unlike set(), applied while disabled too, so that the shares of a gauge always add up.
+    void add(int64_t delta)
+    {
+        mValue.fetch_add(delta, std::memory_order_relaxed);
+    }
+
+    int64_t value() const
+    {
+        return mValue.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> mValue{0};
+}; // Gauge
+
+// One contributor's part of a gauge that adds up several, such as the transfers of every client.
+// Its part is withdrawn when it goes away.
+class MEGA_API GaugeShare
+{
+public:
+    explicit GaugeShare(Gauge& gauge):
+        mGauge(gauge)
+    {}
+
+    ~GaugeShare()
+    {
+        set(0);
+    }
+
+    GaugeShare(const GaugeShare&) = delete;
+    GaugeShare& operator=(const GaugeShare&) = delete;
+
+    void set(int64_t value)
+    {
+        if (value != mValue)
+        {
+            mGauge.add(value - mValue);
+            mValue = value;
+        }
+    }
+
+private:
+    Gauge& mGauge;
+    int64_t mValue = 0;
+}; // GaugeShare
+
+// Durations in log-linear buckets, as HDR histograms do: each doubling, from 4ns to about
+// 37 minutes, is split in SUB_BUCKETS, so a bucket is never wider than a quarter of its values.
+class MEGA_API Histogram
+{
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 2;
+    static constexpr unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr unsigned BUCKETS = 160;
+
+    void record(std::chrono::nanoseconds elapsed);
+
+    uint64_t count() const;
+    std::chrono::nanoseconds sum() const;
+
+    // The end of the bucket holding the given quantile (0 to 1) of what was recorded.
+    std::chrono::nanoseconds quantile(double q) const;
+
+    // How many durations recorded were shorter than `limit`, give or take a bucket.
+    uint64_t countBelow(std::chrono::nanoseconds limit) const;
+
+    void reset();
+
+    // The bucket a duration falls in, and the shortest duration past that bucket.
+    static unsigned bucket(uint64_t nanoseconds);
+    static uint64_t bucketEnd(unsigned bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> mBuckets{};
+    std::atomic<uint64_t> mCount{0};
+    std::atomic<uint64_t> mSum{0};
+}; // Histogram
+
+// Every metric, by name. Metrics are created the first time they're asked for, and then
+// live as long as the process, so callers keep the references they get.
+class MEGA_API Registry
+{
+public:
+    static Registry& instance();
+
+    // Names should follow Prometheus conventions: mega_<what>_total for counters,
+    // mega_<what>_seconds for histograms.
+    Counter& counter(const string& name, const string& help);
+    Gauge& gauge(const string& name, const string& help);
+    Histogram& histogram(const string& name, const string& help);
+
+    // Everything recorded, in the Prometheus text exposition format.
+    string prometheus() const;
+
+    // Zeroes counters and histograms. Gauges are levels, which stay as they are.
+    void reset();
+
+private:
+    template<typename T>
+    struct Named
+    {
+        string help;
+        unique_ptr<T> metric;
+    };
+
+    template<typename T>
+    T& get(map<string, Named<T>>& metrics, const string& name, const string& help);
+
+    mutable mutex mMutex;
+
+    map<string, Named<Counter>> mCounters;
+    map<string, Named<Gauge>> mGauges;
+    map<string, Named<Histogram>> mHistograms;
+}; // Registry
+
+inline Counter& counter(const string& name, const string& help)
+{
+    return Registry::instance().counter(name, help);
+}
+
+inline Gauge& gauge(const string& name, const string& help)
+{
+    return Registry::instance().gauge(name, help);
+}
+
+} // metrics
+} // mega
+
+#endif
@@ -31,6 +31,7 @@
 #include "syncinternals/syncuploadthrottlingfile.h"
 
 #include <bitset>
+#include <limits>
 
 namespace mega {
 
@@ -152,7 +153,101 @@ private:
     NodeManager& mNodeManager;
     weak_ptr<Node> mNode;
 };
-typedef std::map<NodeHandle, NodeManagerNode>::iterator NodePosition;
+// Maps node handles to their NodeManagerNode (see NodeManager::mNodes).
+//
+// Entries are kept in fixed-size blocks and never move, so an iterator stays
+// valid until its own entry is erased, whatever is inserted meanwhile. Lookups
+// go through a flat, open-addressed table of 32-bit entry positions, which
+// takes much less memory per node than a std::map.
+class MEGA_API NodeIndex
+{
+public:
+    using value_type = std::pair<const NodeHandle, NodeManagerNode>;
+
+    class iterator
+    {
+    public:
+        iterator() = default;
+
+        value_type& operator*() const;
+        value_type* operator->() const;
+
+        iterator& operator++();
+
+        bool operator==(const iterator& rhs) const
+        {
+            return mPosition == rhs.mPosition;
+        }
+
+        bool operator!=(const iterator& rhs) const
+        {
+            return mPosition != rhs.mPosition;
+        }
+
+    private:
+        friend class NodeIndex;
+
+        iterator(const NodeIndex* index, uint32_t position);
+
+        const NodeIndex* mIndex = nullptr;
+        uint32_t mPosition = NPOS;
+    };
+
+    NodeIndex() = default;
+    ~NodeIndex();
+
+    NodeIndex(const NodeIndex&) = delete;
+    NodeIndex& operator=(const NodeIndex&) = delete;
+
+    iterator begin() const;
+    iterator end() const;
+
+    iterator find(NodeHandle handle) const;
+
+    // The node is only moved in if there's no entry for handle yet.
+    std::pair<iterator, bool> emplace(NodeHandle handle, NodeManagerNode&& node);
+
+    void erase(iterator it);
+    void clear();
+
+    bool empty() const;
+    size_t size() const;
+
+    // Bytes used by the entries, their blocks and the lookup table.
+    size_t memoryUsage() const;
+
+private:
+    static constexpr uint32_t BLOCK_SIZE = 1024;
+    static constexpr uint32_t NPOS = std::numeric_limits<uint32_t>::max();
+
+    struct Block
+    {
+        alignas(value_type) unsigned char mStorage[BLOCK_SIZE * sizeof(value_type)];
+        std::bitset<BLOCK_SIZE> mUsed;
+    };
+
+    value_type* entry(uint32_t position) const;
+    uint32_t homeSlot(NodeHandle handle) const;
+    uint32_t findSlot(NodeHandle handle) const;
+    uint32_t nextPosition(uint32_t position) const;
+    void insertSlot(uint32_t position);
+    void grow();
+
+    std::vector<std::unique_ptr<Block>> mBlocks;
+
+    // positions of erased entries, reused before allocating new ones
+    std::vector<uint32_t> mFreePositions;
+
+    // how many positions have ever been allocated
+    uint32_t mNumPositions = 0;
+
+    // open-addressed table of entry positions (NPOS when the slot is empty)
+    std::vector<uint32_t> mTable;
+
+    size_t mSize = 0;
+};
+
+typedef NodeIndex::iterator NodePosition;
 
 struct CommandChain
 {
@@ -252,6 +347,31 @@ struct MEGA_API Node : public NodeCore, FileFingerprint
     // try to resolve node key string
     bool applykey();
 
+    // applykey() in three steps, so that the expensive one can run on another thread:
+    // prepareKeyDecryption() finds the wrapping key on the client thread, decrypt()
+    // needs nothing else and applyKeyDecryption() stores the results on the client thread.
+    // The node must not change between the first step and the last one.
+    struct KeyDecryption
+    {
+        // decrypt the node key, then the attributes with it
+        void decrypt(SymmCipher& cipher);
+
+        byte mWrappingKey[SymmCipher::KEYLENGTH];
+        const char* mWrappedKey = nullptr;
+        const string* mAttrString = nullptr;
+        unsigned mKeyLength = 0;
+
+        bool mKeyDecrypted = false;
+        byte mKey[FILENODEKEYLENGTH];
+
+        bool mAttrsDecrypted = false;
+        AttrMap mAttrs;
+    };
+
+    // false if there is nothing to decrypt, or no suitable key yet
+    bool prepareKeyDecryption(KeyDecryption&);
+    bool applyKeyDecryption(KeyDecryption&);
+
     // Returns false if the share key can't correctly decrypt the key and the
     // attributes of the node. Otherwise, it returns true. There are cases in
     // which it's not possible to check if the key is valid (for example when
@@ -267,6 +387,9 @@ struct MEGA_API Node : public NodeCore, FileFingerprint
     // decrypt attribute string, set fileattrs and save fingerprint
     void setattr();
 
+    // set attributes decrypted from attrstring, and save fingerprint
+    void setattrs(AttrMap&&);
+
     // display name (UTF-8)
     const char* displayname(LogCondition log = LOG_CONDITION_NONE) const;
 
@@ -316,6 +439,9 @@ struct MEGA_API Node : public NodeCore, FileFingerprint
     // decrypt node attribute string
     static byte* decryptattr(SymmCipher*, const char*, size_t);
 
+    // decrypt node attribute string and parse it, with the name normalized
+    static bool decryptattrs(SymmCipher*, const string&, AttrMap&);
+
     // parse node attributes from an incoming buffer, this function must be called after call decryptattr
     // fingerprint output param is a raw fingerprint (i.e. without App prefixes)
     static void parseattr(byte* bufattr, AttrMap& attrs, m_off_t size, m_time_t& mtime, string& fileName,
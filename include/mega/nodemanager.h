@@ -462,6 +462,26 @@ public:
 
     uint64_t getNumNodesAtCacheLRU() const;
 
+    // Approximate heap bytes held by each part of the node cache
+    struct MemoryUsage
+    {
+        // mNodes: one entry per known node, loaded in RAM or not
+        size_t mIndex = 0;
+        // handles of the children of every folder
+        size_t mChildren = 0;
+        // Node objects in RAM, with their attributes, keys and shares
+        size_t mNodesInRam = 0;
+        size_t mCacheLRU = 0;
+        size_t mFingerprints = 0;
+
+        size_t total() const;
+    };
+
+    MemoryUsage getMemoryUsage();
+
+    // Logs getMemoryUsage(), including bytes per node
+    void reportMemoryUsage();
+
     // true when the filesystem has been initialized
     // i.e., when nodes have been fully loaded from a fetchnodes or from cache
     bool ready();
@@ -479,16 +499,22 @@ private:
 
     MegaClient& mClient;
 
-#if defined(DEBUG)
-    using MutexType = CheckableMutex<std::recursive_mutex>;
-#else // DEBUG
-    using MutexType = std::recursive_mutex;
-#endif // ! DEBUG
+    // Lookups of nodes already in RAM only need the mutex shared.
+    using MutexType = RecursiveSharedMutex;
 
     using LockGuard = std::lock_guard<MutexType>;
+    using SharedLockGuard = std::shared_lock<MutexType>;
 
     mutable MutexType mMutex;
 
+    // LRU touches made by readers holding mMutex shared, waiting to be applied
+    // by the next writer (see applyPendingCacheLRU)
+    std::mutex mPendingCacheLRUMutex;
+    std::vector<std::shared_ptr<Node>> mPendingCacheLRU;
+
+    // readers fall back to the exclusive lock when this many touches are pending
+    static constexpr size_t MAX_PENDING_CACHE_LRU = 16384;
+
     // interface to handle accesses to "nodes" table
     DBTableNodes* mTable = nullptr;
 
@@ -527,7 +553,7 @@ private:
     };
 
     // Stores nodes that have been loaded in RAM from DB (not necessarily all of them)
-    std::map<NodeHandle, NodeManagerNode> mNodes;
+    NodeIndex mNodes;
 
     uint64_t mCacheLRUMaxSize = std::numeric_limits<uint64_t>::max();
     std::list<std::shared_ptr<Node> > mCacheLRU;
@@ -538,6 +564,14 @@ private:
     sharedNode_vector mNodeNotify;
 
     shared_ptr<Node> getNodeInRAM(NodeHandle handle);
+
+    // Lookups usable while mMutex is held shared: they only succeed for nodes
+    // that are already in RAM and at the LRU, and queue their LRU touch
+    shared_ptr<Node> getNodeInCacheLRU_shared(NodeManagerNode& nodeManagerNode);
+    shared_ptr<Node> getNodeByHandle_shared(NodeHandle handle);
+    std::optional<sharedNode_list> getChildren_shared(const Node* parent, CancelToken cancelToken);
+    std::optional<sharedNode_vector> getNodesByFingerprint_shared(const FileFingerprint& fingerprint);
+    bool queueCacheLRU_shared(shared_ptr<Node> node);
     void saveNodeInRAM(std::shared_ptr<Node> node, bool isRootnode, MissingParentNodes& missingParentNodes);    // takes ownership
 
     sharedNode_vector getNodesWithSharesOrLink_internal(ShareType_t shareType);
@@ -581,8 +615,9 @@ private:
     sharedNode_vector getChildren_internal(const NodeSearchFilter& filter, int order, CancelToken cancelFlag, const NodeSearchPage& page);
     sharedNode_vector getRecentNodes_internal(const NodeSearchPage& page, m_time_t since);
 
-    // node temporary in memory, which will be removed upon write to DB
-    std::shared_ptr<Node> mNodeToWriteInDb;
+    // nodes temporary in memory, which will be removed upon write to DB
+    // (several while MegaClient decrypts a batch of them)
+    std::map<NodeHandle, std::shared_ptr<Node>> mNodesToWriteInDb;
 
     // Stores (or updates) the node in the DB. It also tries to decrypt it for the last time before storing it.
     void putNodeInDb(Node* node) const;
@@ -651,6 +686,7 @@ private:
     void initCompleted_internal();
     void insertNodeCacheLRU_internal(std::shared_ptr<Node> node);
     void unLoadNodeFromCacheLRU();
+    void applyPendingCacheLRU();
 };
 
 } // namespace
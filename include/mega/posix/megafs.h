@@ -208,6 +208,9 @@ class LinuxFileSystemAccess
 public:
     friend class LinuxDirNotify;
 
+    // Unit tests.
+    friend class FanotifyTest;
+
     ~LinuxFileSystemAccess();
 
     void addevents(Waiter* waiter, int flags) override;
@@ -232,6 +235,50 @@ private:
     // Tracks which nodes are associated with what inotify handle.
     WatchMap mWatches;
 
+#ifdef HAVE_FANOTIFY
+    // Key of mWatches entries for directories watched through fanotify.
+    static constexpr int FANOTIFY_WATCH = std::numeric_limits<int>::max();
+
+    // A filesystem being watched through fanotify.
+    struct FanotifyFilesystem
+    {
+        // For resolving the directory handles in events.
+        int mMountFd = -1;
+
+        // How many notifiers are watching this filesystem.
+        unsigned mNotifiers = 0;
+    }; // FanotifyFilesystem
+
+    // Starts watching the filesystem containing path, if we can.
+    // Yields the filesystem's fsid on success.
+    bool fanotifyWatch(const LocalPath& path, uint64_t& filesystem);
+
+    // Stops watching the filesystem once no notifier needs it anymore.
+    void fanotifyUnwatch(uint64_t filesystem);
+
+    // Read all pending fanotify events and queue them for processing.
+    int checkFanotifyEvents(PosixWaiter& waiter);
+
+    // Identifies a directory in fanotify events: its filesystem's fsid and its handle.
+    static string fanotifyKey(uint64_t filesystem, const struct file_handle& directory);
+
+    // The key of the directory at path, empty if it has no handle.
+    static string fanotifyKey(uint64_t filesystem, const LocalPath& path);
+
+    // Fanotify descriptor, if we have the privileges to watch whole filesystems.
+    int mFanotifyFd = -EINVAL;
+
+    // Filesystems being watched, by fsid.
+    map<uint64_t, FanotifyFilesystem> mFanotifyFilesystems;
+
+    // Directories watched through fanotify, by key, so that events elsewhere on their
+    // filesystems are dismissed without resolving their handles.
+    std::unordered_multimap<string, WatchMapIterator> mFanotifyWatches;
+
+    // Keys of the directories watched through fanotify.
+    std::unordered_map<const LocalNode*, string> mFanotifyWatchKeys;
+#endif // HAVE_FANOTIFY
+
 #endif // ENABLE_SYNC
 }; // LinuxFileSystemAccess
 
@@ -260,6 +307,16 @@ private:
 
     // Our position in our owner's mNotifiers list.
     list<DirNotify*>::iterator mNotifiersIt;
+
+#ifdef HAVE_FANOTIFY
+    // Whether our whole filesystem is watched through fanotify.
+    bool mFanotify = false;
+
+    // Which filesystem that is.
+    uint64_t mFanotifyFilesystem = 0;
+
+    friend class LinuxFileSystemAccess;
+#endif // HAVE_FANOTIFY
 }; // LinuxDirNotify
 
 #endif // ENABLE_SYNC
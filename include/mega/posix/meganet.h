@@ -169,7 +169,19 @@ protected:
     int checkevents(Waiter*) override;
     void closecurlevents(direction_t d);
     void processcurlevents(direction_t d);
+    void pausecurlevents(direction_t d);
+    void resumecurlevents(direction_t d);
     SockInfoMap curlsockets[3];
+#ifdef USE_EPOLL
+    // sockets added, changed or removed since addcurlevents() last ran
+    std::vector<curl_socket_t> changedcurlsockets[3];
+
+    // whether the sockets were unwatched while their requests are paused
+    bool arecurleventspaused[3];
+
+    // a removed socket's fd may already be in use by another direction
+    bool iscurlsocketwatched(curl_socket_t fd, direction_t d) const;
+#endif
     m_time_t curltimeoutreset[3];
     bool arerequestspaused[3];
     int numconnections[3];
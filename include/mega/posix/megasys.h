@@ -110,6 +110,20 @@
 
 #ifdef USE_INOTIFY
     #include <sys/inotify.h>
+
+    // Whole filesystems can be watched with fanotify when we're privileged enough.
+    #ifndef __ANDROID__
+        #include <sys/fanotify.h>
+
+        #ifdef FAN_REPORT_DFID_NAME
+            #define HAVE_FANOTIFY
+
+            // Linux 6.5: handles as fanotify reports them, even where they can't be opened.
+            #ifndef AT_HANDLE_FID
+                #define AT_HANDLE_FID AT_REMOVEDIR
+            #endif
+        #endif
+    #endif
 #endif
 
 #include <sys/select.h>
@@ -25,7 +25,11 @@
 #include "mega/waiter.h"
 #include <mutex>
 
-#ifndef USE_POLL
+#ifdef USE_EPOLL
+    #include <sys/epoll.h>
+#endif
+
+#if !defined(USE_POLL) && !defined(USE_EPOLL)
     #define MEGA_FD_ZERO FD_ZERO
     #define MEGA_FD_SET FD_SET
     #define MEGA_FD_ISSET FD_ISSET
@@ -54,7 +58,7 @@ struct PosixWaiter : public Waiter
     mega_fd_set_t rfds, wfds, efds;
     mega_fd_set_t ignorefds;
 
-#ifdef USE_POLL
+#if defined(USE_POLL) || defined(USE_EPOLL)
 
     static void clear_fdset(mega_fd_set_t *s)
     {
@@ -78,10 +82,24 @@ struct PosixWaiter : public Waiter
 
     void notify();
 
+#ifdef USE_EPOLL
+    // Keep waiting for events on fd until unwatch(fd). Unlike fds set in
+    // rfds/wfds for a single wait(), watched fds stay registered with epoll,
+    // so they add nothing to the cost of each wait(). When ready, they show
+    // up in rfds/wfds after wait() like any other.
+    void watch(int fd, bool read, bool write);
+    void unwatch(int fd);
+#endif
+
 protected:
     int m_pipe[2];
     std::mutex mMutex;
     bool alreadyNotified = false;
+
+#ifdef USE_EPOLL
+    int mEpoll = -1;
+    std::vector<epoll_event> mEpollEvents;
+#endif
 };
 } // namespace
 
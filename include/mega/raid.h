@@ -34,6 +34,26 @@ namespace mega {
     enum { RAIDSECTOR = 16 };
     enum { RAIDLINE = (EFFECTIVE_RAIDPARTS * RAIDSECTOR) };
 
+    // Kernels that assemble raid lines from their parts, one set per instruction set.
+    // The set used by downloads and the raid proxy is picked once, according to what the CPU supports.
+    struct MEGA_API RaidKernels
+    {
+        const char* name;
+
+        // Interleaves `lines` sectors from each data part (parts[1] to parts[5]) into dest.
+        // At most one of parts[0] to parts[5] may be null: a null data part is rebuilt from the others.
+        void (*combine)(byte* dest, const byte* const parts[RAIDPARTS], size_t lines);
+
+        // Rebuilds sector `missing` of `lines` consecutive, already interleaved raid lines
+        // from their parity sectors and the other data sectors of each line.
+        void (*recover)(byte* data, const byte* parity, unsigned missing, size_t lines);
+
+        // Every set usable on this CPU, the portable reference first and the preferred one last.
+        static const std::vector<const RaidKernels*>& available();
+
+        // The preferred set for this CPU.
+        static const RaidKernels& best();
+    };
 
     // Holds the latest download data received.   Raid-aware.   Suitable for file transfers, or direct streaming.
     // For non-raid files, supplies the received buffer back to the same connection for writing to file (having decrypted and mac'd it),
@@ -212,7 +232,6 @@ namespace mega {
         // take raid input part buffers and combine to form the asyncoutputbuffers
         void combineRaidParts(unsigned connectionNum);
         FilePiece* combineRaidParts(size_t partslen, size_t bufflen, m_off_t filepos, FilePiece& prevleftoverchunk);
-        void recoverSectorFromParity(byte* dest, byte* inputbufs[], unsigned offset);
         void combineLastRaidLine(byte* dest, size_t nbytes);
         void rollInputBuffers(size_t dataToDiscard);
         virtual void bufferWriteCompletedAction(FilePiece& r);
@@ -533,6 +533,38 @@ public:
     }
 };
 
+// How long a recursiveSync() pass may run while other syncs wait for their turn.
+// A pass that runs out of time leaves its unvisited subtrees flagged, so the next pass carries on
+// from where it stopped. That pass gets twice the time, so that a pass always completes eventually.
+class MEGA_API RecurseSlice
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr unsigned INITIAL_MS = 250;
+    static constexpr unsigned MAX_MS = 64 * INITIAL_MS;
+
+    // Starts a pass. Unsliced passes never have to yield.
+    void start(bool sliced, Clock::time_point now = Clock::now());
+
+    // Whether the pass must yield. Once it must, it stays that way until the pass is finished.
+    bool expired();
+    bool expired(Clock::time_point now);
+
+    // Ends the pass. Returns true if it yielded, and so must be carried on without waiting.
+    bool finish(bool completed);
+
+    unsigned sliceMs() const
+    {
+        return mSliceMs;
+    }
+
+private:
+    unsigned mSliceMs = INITIAL_MS;
+    Clock::time_point mDeadline = Clock::time_point::max();
+    bool mExpired = false;
+}; // RecurseSlice
+
 class MEGA_API Sync
 {
 public:
@@ -747,10 +779,16 @@ public:
     // Asynchronous scan request / result.
     std::shared_ptr<ScanService::ScanRequest> mActiveScanRequestGeneral;
 
-    // we can additionally be scanning one more yet-unscanned folder
-    // in order to always be progressing even when downloads are
-    // triggering rescans of their target folder
-    std::shared_ptr<ScanService::ScanRequest> mActiveScanRequestUnscanned;
+    // we can additionally be scanning yet-unscanned folders, one for each
+    // other scan thread, in order to always be progressing even when downloads
+    // are triggering rescans of their target folder (and to scan new syncs faster)
+    std::vector<std::shared_ptr<ScanService::ScanRequest>> mActiveScanRequestsUnscanned;
+
+    // A free slot in the above, or nullptr if they are all busy.
+    std::shared_ptr<ScanService::ScanRequest>* availableUnscannedScanSlot();
+
+    // Whether every slot in the above is busy.
+    bool unscannedScanSlotsBusy() const;
 
     static const int SCANNING_DELAY_DS;
     static const int EXTRA_SCANNING_DELAY_DS;
@@ -797,6 +835,9 @@ public:
     // timer for whole-sync rescan in case of notifications failing or not being available
     BackoffTimer syncscanbt;
 
+    // Limits how long a recursiveSync() pass may run before yielding to the other syncs.
+    RecurseSlice recurseSlice;
+
     shared_ptr<SyncThreadsafeState> threadSafeState;
 
 protected :
@@ -1296,13 +1337,14 @@ struct SyncStallInfo
 
     void setNoProgress();
 
-    /* Move all stalls from source, removing obsolete keys in source (no stalls entries) and removing keys not present in source */
-    void moveFromButKeepCountersAndClearObsoleteKeys(SyncStallInfo& source);
+    /* Move all stalls from source, removing obsolete keys in source (no stalls entries) and removing keys not present in source.
+       Syncs in unfinished are midway through a pass: their stalls stay in source, and their keys here are kept as they are. */
+    void moveFromButKeepCountersAndClearObsoleteKeys(SyncStallInfo& source, const set<handle>& unfinished = {});
 
 private:
-    void moveFromButKeepCounters(SyncStallInfo& other);
+    void moveFromButKeepCounters(SyncStallInfo& other, const set<handle>& unfinished);
 
-    void clearObsoleteKeys(SyncStallInfo& other);
+    void clearObsoleteKeys(SyncStallInfo& other, const set<handle>& unfinished);
 
 #ifndef NDEBUG
 public:
@@ -1900,7 +1942,7 @@ private:
     bool processRemovingSyncBySds(UnifiedSync& us, bool foundRootNode, vector<pair<handle, int>>& sdsBackups);
     void deregisterThenRemoveSyncBySds(UnifiedSync& us, std::function<void(MegaClient&, TransferDbCommitter&)> clientRemoveSdsEntryFunction);
     void processSyncConflicts();
-    void processSyncStalls();
+    void processSyncStalls(const set<handle>& yieldedSyncs);
 
     void syncLoop();
 
@@ -277,16 +277,33 @@ public:
     transfer_list::iterator begin(direction_t direction);
     transfer_list::iterator end(direction_t direction);
     bool getIterator(Transfer *transfer, transfer_list::iterator&, bool canHandleErasedElements = false);
+
+    // The transfers to start next, per category (see TransferCategory::index()), in priority order.
+    // Once continuefunction declines a transfer, it's taken to decline the rest of its category.
     std::array<vector<Transfer*>, 6> nexttransfers(std::function<bool(Transfer*)>& continuefunction,
 	                                               std::function<bool(direction_t)>& directionContinuefunction,
                                                    TransferDbCommitter& committer);
     Transfer *transferat(direction_t direction, unsigned int position);
 
+    // forget every transfer, in both directions
+    void clear();
+
     std::array<transfer_list, 2> transfers;
     MegaClient *client;
     uint64_t currentpriority;
 
 private:
+    // Transfers that aren't paused, by priority, per direction and size (see TransferCategory).
+    // They let nexttransfers() skip whole categories rather than walk every queued transfer.
+    typedef std::map<uint64_t, Transfer*> schedule_queue;
+    std::array<schedule_queue, 4> mSchedule;
+
+    schedule_queue& scheduleQueue(direction_t direction, filesizetype_t sizetype);
+
+    // Call whenever a transfer is added, removed, paused, resumed or its priority changes.
+    void schedule(Transfer *transfer);
+    void unschedule(Transfer *transfer);
+
     void prepareIncreasePriority(Transfer *transfer, transfer_list::iterator srcit, transfer_list::iterator dstit, TransferDbCommitter& committer);
     void prepareDecreasePriority(Transfer *transfer, transfer_list::iterator it, transfer_list::iterator dstit);
     bool isReady(Transfer *transfer);
@@ -70,6 +70,85 @@ struct TransferSlotStats
 
 class TransferDbCommitter;
 
+// Sizes the requests of an upload and decides how many of them run in parallel, from the round
+// trip time and the throughput measured while uploading.
+class MEGA_API UploadController
+{
+public:
+    // What was decided for the transfer, for telemetry
+    struct Decisions
+    {
+        unsigned mInitialConnections{};
+        unsigned mPeakConnections{};
+        unsigned mConnectionChanges{};
+        unsigned mRequests{};
+        m_off_t mMinRequestSize{};
+        m_off_t mMaxRequestSize{};
+        double mRttMs{};
+
+        std::string toString() const;
+    };
+
+    // Waiting a round trip for the reply to a request shouldn't take more than 1/RTT_FACTOR of it
+    static constexpr m_off_t RTT_FACTOR = 8;
+
+    // Each request keeps its connection busy for about this long
+    static constexpr dstime REQUEST_DS = 20;
+
+    static constexpr m_off_t MIN_REQUEST_SIZE = 1024 * 1024;
+    static constexpr m_off_t MAX_REQUEST_SIZE = 32 * 1024 * 1024;
+
+    static constexpr unsigned INITIAL_CONNECTIONS = 4;
+
+    // The number of connections is reconsidered once the speed reflects the last change
+    static constexpr dstime EVALUATION_DS = SpeedController::SPEED_MEAN_CIRCULAR_BUFFER_SIZE_SECONDS *
+                                            SpeedController::DS_PER_SECOND;
+
+    // Speed gain that justifies one more connection
+    static constexpr double MIN_CONNECTION_GAIN = 0.1;
+
+    // expectedSpeed is the typical speed of previous uploads, 0 if unknown
+    UploadController(m_off_t fileSize, unsigned maxConnections, m_off_t expectedSpeed, dstime now);
+
+    // How many connections should have a request in flight
+    unsigned connections() const
+    {
+        return mConnections;
+    }
+
+    // Size of the next request, starting at pos
+    m_off_t requestSize(m_off_t pos);
+
+    // A new connection took connectMs to be established
+    void onConnected(double connectMs);
+
+    // Current speed of the whole transfer
+    void onSpeed(m_off_t speed, dstime now);
+
+    const Decisions& decisions() const
+    {
+        return mDecisions;
+    }
+
+private:
+    void setConnections(unsigned connections);
+
+    const m_off_t mFileSize;
+    const unsigned mMaxConnections;
+    unsigned mConnections;
+
+    m_off_t mSpeed;
+    double mRttMs = 0;
+
+    // Connections are added one at a time while each one makes the upload faster
+    bool mProbing = true;
+    dstime mLastEvaluation;
+    m_off_t mSpeedBeforeChange = 0;
+    m_off_t mBestSpeed = 0;
+
+    Decisions mDecisions;
+};
+
 // active transfer
 struct MEGA_API TransferSlot
 {
@@ -197,6 +276,9 @@ struct MEGA_API TransferSlot
     // transfer stats
     stats::TransferSlotStats tsStats;
 
+    // request sizes and connections for uploads
+    std::unique_ptr<UploadController> mUploadController;
+
     TransferSlot(Transfer*);
     ~TransferSlot();
 
@@ -66,10 +66,12 @@ namespace mega {
 #include "mega/crypto/sodium.h"
 #include "mega/user_attribute_types.h"
 
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <string>
 #include <string_view>
 #include <thread>
@@ -920,30 +922,70 @@ enum NetworkActivityType : int
 
 //#define MEGA_MEASURE_CODE   // uncomment this to track time spent in major subsystems, and log it every 2 minutes, with extra control from megacli
 
+// See mega/metrics.h: only what the timers below need.
+namespace metrics
+{
+    class Histogram;
+
+    extern MEGA_API std::atomic<bool> gEnabled;
+
+    MEGA_API Histogram* histogram(const std::string& name, const std::string& help);
+    MEGA_API void record(Histogram& histogram, std::chrono::nanoseconds elapsed);
+}
+
 namespace CodeCounter
 {
     // Some classes that allow us to easily measure the number of times a block of code is called, and the sum of the time it takes.
     // Only enabled if MEGA_MEASURE_CODE is turned on.
     // Usage generally doesn't need to be protected by the macro as the classes and methods will be empty when not enabled.
+    //
+    // Stats given a metric name also feed a latency histogram of that name, in any build, while
+    // metrics are enabled at runtime.
 
     using namespace std::chrono;
 
     struct ScopeStats
     {
+        metrics::Histogram* histogram = nullptr;
+
 #ifdef MEGA_MEASURE_CODE
         uint64_t count = 0;
         uint64_t starts = 0;
         uint64_t finishes = 0;
         high_resolution_clock::duration timeSpent{};
         high_resolution_clock::duration longest{};
+        uint64_t items = 0; // optional, for throughput
         std::string name;
-        ScopeStats(std::string s) : name(std::move(s)) {}
+        ScopeStats(std::string s, const char* metric = nullptr) : name(std::move(s))
+        {
+            if (metric)
+                histogram = metrics::histogram(metric, "Time spent in " + name);
+        }
+
+        // for blocks timed by the caller, eg. on other threads under the caller's lock
+        inline void add(high_resolution_clock::duration d, uint64_t processedItems = 0)
+        {
+            if (histogram && metrics::gEnabled.load(std::memory_order_relaxed))
+                metrics::record(*histogram, d);
+
+            ++count;
+            ++starts;
+            ++finishes;
+            timeSpent += d;
+            if (d > longest) longest = d;
+            items += processedItems;
+        }
 
         inline string report(bool reset = false)
         {
             string s = " " + name + ": " + std::to_string(count) + " " +
                     std::to_string(duration_cast<milliseconds>(timeSpent).count()) + " " +
                     std::to_string(duration_cast<milliseconds>(longest).count());
+            if (items)
+            {
+                auto us = std::max<int64_t>(duration_cast<microseconds>(timeSpent).count(), 1);
+                s += " " + std::to_string(items) + " " + std::to_string(items * 1000000 / static_cast<uint64_t>(us)) + "/s";
+            }
             if (reset)
             {
                 count = 0;
@@ -951,11 +993,22 @@ namespace CodeCounter
                 finishes = 0;
                 timeSpent = high_resolution_clock::duration{};
                 longest = high_resolution_clock::duration{};
+                items = 0;
             }
             return s;
         }
 #else
-        ScopeStats(std::string) {}
+        ScopeStats(std::string s, const char* metric = nullptr)
+        {
+            if (metric)
+                histogram = metrics::histogram(metric, "Time spent in " + s);
+        }
+
+        inline void add(high_resolution_clock::duration d, uint64_t = 0)
+        {
+            if (histogram && metrics::gEnabled.load(std::memory_order_relaxed))
+                metrics::record(*histogram, d);
+        }
 #endif
     };
 
@@ -1011,11 +1064,34 @@ namespace CodeCounter
                 scope.timeSpent += diff;
                 if (diff > scope.longest) scope.longest = diff;
                 done = true;
+
+                if (scope.histogram && metrics::gEnabled.load(std::memory_order_relaxed))
+                    metrics::record(*scope.histogram, diff);
             }
         }
 #else
-        ScopeTimer(ScopeStats&) {}
-        void complete() {}
+        // Only reads the clock while metrics are enabled.
+        metrics::Histogram* histogram;
+        high_resolution_clock::time_point blockStart;
+
+        ScopeTimer(ScopeStats& sm)
+          : histogram(metrics::gEnabled.load(std::memory_order_relaxed) ? sm.histogram : nullptr)
+        {
+            if (histogram)
+                blockStart = high_resolution_clock::now();
+        }
+        ~ScopeTimer()
+        {
+            complete();
+        }
+        void complete()
+        {
+            if (histogram)
+            {
+                metrics::record(*histogram, high_resolution_clock::now() - blockStart);
+                histogram = nullptr;
+            }
+        }
 #endif
     };
 }
@@ -1541,6 +1617,122 @@ public:
     }
 }; // CheckableMutex<T, true>
 
+// A recursive mutex that can also be held by several readers at once.
+//
+// Exclusive ownership is recursive and the owner may also take the mutex
+// shared. A thread holding the mutex only shared must release it before
+// locking it exclusively: there is no upgrade, and trying will deadlock.
+class RecursiveSharedMutex
+{
+    // How many times the owner has locked the mutex (exclusive or shared.)
+    std::size_t mCount;
+
+    // Taken briefly by anyone acquiring mMutex so that a waiting writer
+    // holds off new readers instead of being starved by them.
+    std::mutex mGate;
+
+    // The underlying mutex.
+    std::shared_mutex mMutex;
+
+    // Who currently holds the mutex exclusively.
+    std::atomic<std::thread::id> mOwner;
+
+public:
+    RecursiveSharedMutex()
+      : mCount(0)
+      , mGate()
+      , mMutex()
+      , mOwner()
+    {
+    }
+
+    RecursiveSharedMutex(const RecursiveSharedMutex& other) = delete;
+
+    RecursiveSharedMutex& operator=(const RecursiveSharedMutex& rhs) = delete;
+
+    void lock()
+    {
+        auto id = std::this_thread::get_id();
+
+        if (mOwner.load(std::memory_order_relaxed) != id)
+        {
+            std::lock_guard<std::mutex> guard(mGate);
+
+            mMutex.lock();
+            mOwner.store(id, std::memory_order_relaxed);
+        }
+
+        ++mCount;
+    }
+
+    void lock_shared()
+    {
+        // The owner's shared locks are just one more level of recursion.
+        if (owns_lock())
+        {
+            ++mCount;
+            return;
+        }
+
+        std::lock_guard<std::mutex> guard(mGate);
+
+        mMutex.lock_shared();
+    }
+
+    bool owns_lock() const
+    {
+        return mOwner.load(std::memory_order_relaxed) == std::this_thread::get_id();
+    }
+
+    bool try_lock()
+    {
+        auto id = std::this_thread::get_id();
+
+        if (mOwner.load(std::memory_order_relaxed) != id)
+        {
+            if (!mMutex.try_lock())
+                return false;
+
+            mOwner.store(id, std::memory_order_relaxed);
+        }
+
+        ++mCount;
+
+        return true;
+    }
+
+    bool try_lock_shared()
+    {
+        if (owns_lock())
+        {
+            ++mCount;
+            return true;
+        }
+
+        return mMutex.try_lock_shared();
+    }
+
+    void unlock()
+    {
+        assert(mCount);
+        assert(owns_lock());
+
+        if (--mCount)
+            return;
+
+        mOwner.store(std::thread::id(), std::memory_order_relaxed);
+        mMutex.unlock();
+    }
+
+    void unlock_shared()
+    {
+        if (owns_lock())
+            return unlock();
+
+        mMutex.unlock_shared();
+    }
+}; // RecursiveSharedMutex
+
 } // detail
 
 // API supports user/node attributes up to 16KB. This constant is used to restrict clients sending larger values
@@ -1549,6 +1741,7 @@ static constexpr size_t MAX_FILE_ATTRIBUTE_SIZE = 16 * 1024 * 1024; // 16MB
 
 
 using detail::CheckableMutex;
+using detail::RecursiveSharedMutex;
 
 // For convenience.
 #ifdef USE_IOS
@@ -454,7 +454,7 @@ class chunkmac_map
 
     struct ChunkMAC
     {
-        // do not change the size or layout, it is directly serialized to db from whatever the binary format is for this compiler/platform
+        // do not change the size or layout, older versions serialized it to db from whatever the binary format is for this compiler/platform
         byte mac[SymmCipher::BLOCKSIZE];
 
         // For a partially completed chunk, offset is the number of bytes processed (from the start of the chunk)
@@ -469,13 +469,42 @@ class chunkmac_map
 
         // True when the chunk is not entirely processed.
         // Offset is only increased by downloads, so (!offset) should always be true for uploads.
-        bool notStarted() { return !finished && !offset; }
+        bool notStarted() const { return !finished && !offset; }
 
         // the very first record can be the macsmac calculation so far, from the start to some contiguous point
-        bool isMacsmacSoFar() { return finished && offset == unsigned(-1); }
+        bool isMacsmacSoFar() const { return finished && offset == unsigned(-1); }
     };
 
-    map<m_off_t, ChunkMAC> mMacMap;
+    // The entries, sorted by position, in a single array.
+    // Chunks are added near the end, where the transfer is making progress, and folded away from
+    // the front by updateMacsmacProgress(), so this is cheaper than a tree node per chunk.
+    class MacVector
+    {
+    public:
+        using value_type = std::pair<m_off_t, ChunkMAC>;
+        using iterator = vector<value_type>::iterator;
+        using const_iterator = vector<value_type>::const_iterator;
+
+        iterator begin() { return mEntries.begin(); }
+        iterator end() { return mEntries.end(); }
+        const_iterator begin() const { return mEntries.begin(); }
+        const_iterator end() const { return mEntries.end(); }
+
+        size_t size() const { return mEntries.size(); }
+        void clear() { mEntries.clear(); }
+        void swap(MacVector& other) { mEntries.swap(other.mEntries); }
+        void erase(iterator first, iterator last) { mEntries.erase(first, last); }
+
+        iterator find(m_off_t pos);
+
+        // Adds the entry if there's none. References to other entries don't survive that.
+        ChunkMAC& operator[](m_off_t pos);
+
+    private:
+        vector<value_type> mEntries;
+    };
+
+    MacVector mMacMap;
 
     // we collapse the leading consecutive entries, for large files.
     // this is the map key for how far that collapsing has progressed
@@ -483,6 +512,8 @@ class chunkmac_map
 
     m_off_t progresscontiguous{0};
 
+    bool unserializeCompact(const char*& ptr, const char* end);
+
 public:
     int64_t macsmac(SymmCipher *cipher);
     int64_t macsmac_gaps(SymmCipher *cipher, size_t g1, size_t g2, size_t g3, size_t g4);
@@ -503,6 +534,20 @@ public:
 
     void ctr_encrypt(m_off_t chunkid, SymmCipher *cipher, byte *chunkstart, unsigned chunksize, m_off_t startpos, int64_t ctriv, bool finishesChunk);
     void ctr_decrypt(m_off_t chunkid, SymmCipher *cipher, byte *chunkstart, unsigned chunksize, m_off_t startpos, int64_t ctriv, bool finishesChunk);
+
+    // a chunk, or what remains of it, for the overloads below
+    struct CtrChunk
+    {
+        m_off_t chunkid;
+        byte* chunkstart;
+        unsigned chunksize;
+        m_off_t startpos;
+    };
+
+    // same as above for several chunks, which are interleaved by SymmCipher::ctr_crypt_lanes()
+    // all the chunks are whole when encrypting, and decrypting finishes them
+    void ctr_encrypt(const vector<CtrChunk>& chunks, SymmCipher *cipher, int64_t ctriv, bool finishesChunk);
+    void ctr_decrypt(const vector<CtrChunk>& chunks, SymmCipher *cipher, int64_t ctriv);
     void setProgressContiguous(const m_off_t p);
     void swap(chunkmac_map& other);
 
@@ -609,33 +654,68 @@ bool CompareLocalFileMetaMacWithNode(FileAccess* fa, Node* node);
 // Maintains a small thread pool for executing independent operations such as encrypt/decrypt a block of data
 // The number of threads can be 0 (eg. for helper MegaApi that deals with public folder links) in which case something queued is
 // immediately executed synchronously on the caller's thread
+// Each thread has its own queue, so threads don't contend for a single lock. A task goes to the
+// queue of the thread chosen by its affinity (eg. the transfer it belongs to, so its data stays
+// in that core's cache), and idle threads steal from the others' queues.
 struct MegaClientAsyncQueue
 {
-    void push(std::function<void(SymmCipher&)> f, bool discardable);
+    using Task = std::function<void(SymmCipher&)>;
+
+    // tasks with the same non-null affinity run on the same thread, unless it's busy and another one steals them
+    void push(Task f, bool discardable, const void* affinity = nullptr);
+
+    // several tasks with a single wakeup; they are spread over the threads
+    void push(std::vector<Task>&& fs, bool discardable);
+
     void clearDiscardable();
 
+    // zero means tasks run synchronously on push()
+    size_t threadCount() const { return mThreads.size(); }
+
+    // which of the workers' queues tasks with this non-null affinity go to
+    static size_t affinityWorker(const void* affinity, size_t workers);
+
     MegaClientAsyncQueue(Waiter& w, unsigned threadCount);
     ~MegaClientAsyncQueue();
 
 private:
     Waiter& mWaiter;
-    std::mutex mMutex;
-    std::condition_variable mConditionVariable;
 
     struct Entry
     {
         bool discardable = false;
-        std::function<void(SymmCipher&)> f;
-        Entry(bool disc, std::function<void(SymmCipher&)>&& func)
-             : discardable(disc), f(func)
+        Task f;
+        Entry(bool disc, Task&& func)
+             : discardable(disc), f(std::move(func))
         {}
     };
 
-    std::deque<Entry> mQueue;
+    struct Worker
+    {
+        std::mutex mMutex;
+        std::deque<Entry> mQueue;
+    };
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
     std::vector<std::thread> mThreads;
     SymmCipher mZeroThreadsCipher;
 
-    void asyncThreadLoop();
+    // tasks queued in any of the workers
+    std::atomic<size_t> mPending{0};
+
+    // for workers without anything to do
+    std::mutex mIdleMutex;
+    std::condition_variable mIdleConditionVariable;
+    std::atomic<unsigned> mIdle{0};
+    bool mExiting = false;
+
+    // for tasks without affinity
+    std::atomic<unsigned> mNextWorker{0};
+
+    size_t workerFor(const void* affinity);
+    void wakeUp(size_t tasks);
+    bool take(size_t worker, Task& f);
+    void asyncThreadLoop(size_t worker);
 };
 
 template<class T>
@@ -1185,6 +1265,20 @@ bool likeCompare(const char* pattern,
                  const UChar32 esc = static_cast<UChar32>(ESCAPE_CHARACTER),
                  const bool stripAccents = true);
 
+/*
+ * Fold case (and optionally accents) of every character in a UTF-8 string.
+ *
+ * Characters are folded exactly as likeCompare(...) compares them, so if
+ * likeCompare matches a literal run of a pattern against a string, the folded
+ * run is a substring of the folded string.
+ *
+ * @param text the UTF-8 string to fold
+ * @param stripAccents True if accents should be stripped as well.
+ *
+ * @return the folded string
+ */
+std::string foldCaseAccent(const std::string& text, const bool stripAccents = true);
+
 // Get the current process ID
 unsigned long getCurrentPid();
 
@@ -316,14 +316,18 @@ public:
      * @param keepAliveInSeconds The amount of time (in seconds) the isolated process stays active
      * without receiving any requests.
      * @param extraArgs Additional arguments that will be passed directly to the isolated process.
+     * @param processCount The number of isolated processes to run. Each one processes one file
+     * at a time, so thumbnails and previews of several files are generated in parallel. The
+     * first process uses endpointName, the others endpointName followed by "_" and their index.
      *
      * @note The created instance sends a hello request every keepAliveInSeconds / 3 seconds to
-     * ensure the isolated process stays running.
+     * ensure the isolated processes stay running.
      */
     static MegaGfxProvider* createIsolatedInstance(const char* endpointName,
                                                    const char* executable,
                                                    unsigned int keepAliveInSeconds = 60,
-                                                   const MegaStringList* extraArgs = nullptr);
+                                                   const MegaStringList* extraArgs = nullptr,
+                                                   unsigned int processCount = 1);
 
     /**
     * @brief Create a graphics processor that use your implementations @see MegaGfxProcessor.
@@ -11068,6 +11072,49 @@ class MegaApi
          */
         bool removeGlobalListener(MegaGlobalListener* listener);
 
+        /**
+         * @brief Deliver events to the registered listeners on a thread of their own
+         *
+         * By default, listeners are called on the SDK thread, so a slow listener holds up
+         * the SDK. When enabled, the onRequest*, onTransfer* and onNodesUpdate callbacks of
+         * listeners registered with MegaApi::addListener, MegaApi::addRequestListener,
+         * MegaApi::addTransferListener and MegaApi::addGlobalListener are made on a
+         * dedicated thread instead, in the order the events happened:
+         * - The MegaRequest, MegaTransfer and MegaNodeList received are copies, which remain
+         * valid only during the callback, as usual.
+         * - A queued onRequestUpdate or onTransferUpdate is replaced by a newer one for the same
+         * request or transfer, so a listener that falls behind gets the latest state only.
+         * - Node updates that happen while the previous onNodesUpdate is waiting to be delivered
+         * are merged into it.
+         * - If many events are waiting, further updates are dropped: onRequestFinish and
+         * onTransferFinish are always delivered.
+         *
+         * Listeners passed to individual requests and transfers, and the other callbacks, are
+         * still called on the SDK thread.
+         *
+         * Once MegaApi::removeListener and the like return, the listener won't be called anymore,
+         * waiting for a callback in progress if need be. Don't remove a listener while holding a
+         * MegaApiLock, as the callback may be waiting for it.
+         *
+         * Events waiting to be delivered when this is disabled are still delivered from the
+         * dispatch thread.
+         *
+         * @param enable True to call listeners on a dispatch thread, false to call them on the SDK thread
+         */
+        void setAsyncListenerDispatch(bool enable);
+
+        /**
+         * @brief Get counters about the delivery of events with MegaApi::setAsyncListenerDispatch
+         *
+         * Includes how many events have been delivered, merged and dropped, how long they waited,
+         * and the number of calls and mean and max callback time of each listener.
+         *
+         * You take the ownership of the returned value. Use delete [] to free it.
+         *
+         * @return Readable statistics, or NULL if MegaApi::setAsyncListenerDispatch hasn't been enabled
+         */
+        char* getListenerDispatchStats();
+
         /**
          * @brief Get internal timestamp used by the SDK
          *
@@ -12953,6 +13000,56 @@ class MegaApi
          */
         static void setLogJSONContent(bool enable);
 
+        /**
+         * @brief Format and output log messages on a background thread
+         *
+         * When enabled, the thread that logs a message only stores what is logged, and
+         * MegaLogger::log is called later, from a background thread. This makes logging much
+         * cheaper for the SDK, especially at debug and verbose levels. Messages logged by the
+         * same thread are received in order.
+         *
+         * If a thread logs faster than messages can be output, some of its messages are dropped,
+         * and a warning reports how many.
+         *
+         * By default, messages are output synchronously. Disabling this outputs the pending
+         * messages before returning. This option is not available if the SDK is built with
+         * ENABLE_LOG_PERFORMANCE.
+         *
+         * @param enable True to output log messages on a background thread
+         */
+        static void setAsyncLogging(bool enable);
+
+        /**
+         * @brief Enable or disable the collection of performance metrics
+         *
+         * Metrics count events and record how long the main operations of the SDK take, such as
+         * processing server responses, transfers, syncs and database commits. They are shared by
+         * every MegaApi instance in the process and their overhead is low enough to keep them
+         * enabled in production.
+         *
+         * By default, metrics are disabled. Disabling them keeps what was already recorded.
+         *
+         * @param enable True to collect metrics, false to stop collecting them
+         *
+         * @see MegaApi::getMetrics
+         */
+        static void setMetricsEnabled(bool enable);
+
+        /**
+         * @brief Get the performance metrics collected so far
+         *
+         * The metrics are returned in the Prometheus text exposition format: counters, gauges and
+         * latency histograms, with durations in seconds.
+         *
+         * You take the ownership of the returned value. Use delete [] to free it.
+         *
+         * @param reset True to zero every metric after reading them
+         * @return Metrics collected since they were enabled or last reset
+         *
+         * @see MegaApi::setMetricsEnabled
+         */
+        static char* getMetrics(bool reset = false);
+
         /**
          * @brief Add a MegaLogger implementation to receive SDK logs
          *
@@ -18203,6 +18300,63 @@ class MegaApi
          */
         unsigned long long getNumNodesAtCacheLRU() const;
 
+        /**
+         * @brief Enable or disable the full-text search index of the local cache
+         *
+         * When enabled, the local cache keeps an index of node names, descriptions and tags,
+         * which speeds up searches by text (MegaApi::search) on large accounts at the cost
+         * of some extra disk space. If the SDK's SQLite lacks FTS5, searches work as usual
+         * without the index.
+         *
+         * The setting takes effect the next time the local cache is opened (i.e. when
+         * nodes are fetched). An existing cache is indexed when it's opened with the
+         * index enabled, and the index is removed when it's opened with it disabled.
+         *
+         * By default, the search index is disabled.
+         *
+         * @param enable True to enable the search index
+         */
+        void setNodeSearchIndexEnabled(bool enable);
+
+        /**
+         * @brief Check if the full-text search index of the local cache is enabled
+         *
+         * @see MegaApi::setNodeSearchIndexEnabled
+         *
+         * @return True if the search index is enabled
+         */
+        bool isNodeSearchIndexEnabled();
+
+        /**
+         * @brief Enable or disable asynchronous writes to the local cache
+         *
+         * When enabled, changes to nodes and to the rest of the local cache are committed to
+         * disk by a thread of their own, instead of by the SDK thread. Changes are coalesced
+         * per node, and committed in large batches, so bursts of changes (such as moving or
+         * removing a folder with many nodes) don't stall the SDK thread on disk I/O.
+         *
+         * Changes are committed shortly after the SDK considers them done, so an abrupt
+         * termination of the app may lose the latest ones. They are fetched again from the
+         * server the next time the app starts.
+         *
+         * The setting takes effect the next time the local cache is opened (i.e. when
+         * nodes are fetched). It has no effect on iOS.
+         *
+         * By default, asynchronous writes are disabled.
+         *
+         * @param enable True to enable asynchronous writes
+         */
+        void setAsyncDbWritesEnabled(bool enable);
+
+        /**
+         * @brief Check if asynchronous writes to the local cache are enabled
+         *
+         * @see MegaApi::setAsyncDbWritesEnabled
+         *
+         * @return True if asynchronous writes are enabled
+         */
+        bool isAsyncDbWritesEnabled();
+
         enum
         {
             ORDER_NONE = 0,
@@ -20805,6 +20959,33 @@ class MegaApi
          */
         int httpServerGetMaxOutputSize();
 
+        /**
+         * @brief Keep the data streamed by the HTTP proxy server in a local cache
+         *
+         * Ranges of files already fetched from MEGA are stored in the specified folder and,
+         * when a client requests them again (for example, when a media player seeks back),
+         * they are sent from there instead of being downloaded again. All the connections
+         * share the cache, so concurrent clients of the same file benefit too.
+         *
+         * When the cache reaches the maximum size, the files not being streamed that
+         * were used least recently are removed from it. The cache isn't kept between
+         * executions of the app.
+         *
+         * Data isn't sent from the cache to connections using TLS.
+         *
+         * The new value will be taken into account since the next request received by
+         * the HTTP proxy server. It's possible to call this function even before the
+         * server has been started.
+         *
+         * This feature is not available on Windows.
+         *
+         * @param localPath Existing local folder for the cache, or NULL to disable the cache
+         * @param maxSize Maximum size of the cache (in bytes). A number <= 0 disables the cache
+         * @return True if the setting was applied, false if the folder is not valid or the
+         * feature is not available
+         */
+        bool httpServerSetStreamingCache(const char* localPath, long long maxSize);
+
         /**
          * @brief Start an FTP server in specified port
          *
@@ -26371,6 +26552,46 @@ public:
      */
     virtual MegaFuseExecutorFlags* getSubsystemExecutorFlags() = 0;
 
+    /**
+     * @brief
+     * Query how large a block is fetched when serving a partial read.
+     *
+     * @return
+     * The size of each block, in bytes, or zero if partial reads are disabled.
+     */
+    virtual size_t getPartialReadBlockSize() const = 0;
+
+    /**
+     * @brief
+     * Query how many blocks are fetched ahead of a sequential reader.
+     *
+     * @return
+     * How many blocks are fetched ahead of a sequential reader.
+     */
+    virtual size_t getPartialReadAheadBlocks() const = 0;
+
+    /**
+     * @brief
+     * Specify how large a block should be fetched when serving a partial read.
+     *
+     * When partial reads are enabled, reading a file that has not been
+     * cached will fetch only the blocks containing the requested range
+     * rather than downloading the entire file first.
+     *
+     * @param size
+     * The size of each block, in bytes. Specify zero to disable partial reads.
+     */
+    virtual void setPartialReadBlockSize(size_t size) = 0;
+
+    /**
+     * @brief
+     * Specify how many blocks should be fetched ahead of a sequential reader.
+     *
+     * @param count
+     * How many blocks should be fetched ahead of a sequential reader.
+     */
+    virtual void setPartialReadAheadBlocks(size_t count) = 0;
+
     /**
      * @brief
      * Specify how long we should wait before uploading a modified file.
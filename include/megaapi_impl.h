@@ -105,6 +105,7 @@ class MegaWaiter: public PosixWaiter
 class MegaTCPServer;
 class MegaHTTPServer;
 class MegaFTPServer;
+class StreamingCache;
 #endif
 
 typedef std::vector<int8_t> MegaSmallIntVector;
@@ -1001,6 +1002,7 @@ class MegaNodePrivate : public MegaNode, public Cacheable
         bool isRemoved() override;
         bool hasChanged(uint64_t changeType) override;
         uint64_t getChanges() override;
+        void addChanges(uint64_t changes);
         bool hasThumbnail() override;
         bool hasPreview() override;
         bool isPublic() override;
@@ -2871,6 +2873,10 @@ class MegaNodeListPrivate : public MegaNodeList
         //This ones takes the ownership of the given node
         void addNode(std::unique_ptr<MegaNode> node);
 
+        // Appends the nodes of a later update, which replace older copies of the same node
+        // and inherit their changes.
+        void mergeUpdates(MegaNodeListPrivate&& newer);
+
 	protected:
 		MegaNode** list;
 		int s;
@@ -3161,6 +3167,133 @@ class TransferQueue
         void setAllCancelled(CancelToken t, int direction);
 };
 
+/**
+ * @brief Delivers request, transfer and node events to the app's listeners on a thread of its own
+ *
+ * Used when MegaApi::setAsyncListenerDispatch is enabled, so that a slow listener doesn't hold
+ * up the SDK thread. Events carry copies of their request, transfer or nodes and are delivered
+ * in the order they were posted, except that a queued update for the same request or transfer
+ * is replaced by a newer one, and node updates posted while the previous one is still queued
+ * are merged into it.
+ *
+ * Posting never waits for the app: past MAX_QUEUED_EVENTS, updates that can't be merged are dropped.
+ */
+class ListenerDispatcher
+{
+public:
+    enum
+    {
+        REQUEST_START,
+        REQUEST_UPDATE,
+        REQUEST_TEMPORARY_ERROR,
+        REQUEST_FINISH,
+        TRANSFER_START,
+        TRANSFER_UPDATE,
+        TRANSFER_TEMPORARY_ERROR,
+        TRANSFER_FINISH,
+        NODES_UPDATE,
+    };
+
+    static constexpr size_t MAX_QUEUED_EVENTS = 10000;
+
+    explicit ListenerDispatcher(MegaApi* api);
+
+    // Events still queued are discarded; one being delivered is completed.
+    ~ListenerDispatcher();
+
+    // Delivers the events still queued and stops the thread. Nothing posted afterwards is delivered.
+    void shutdown();
+
+    void postRequest(int type,
+                     const set<MegaRequestListener*>& requestListeners,
+                     const set<MegaListener*>& listeners,
+                     MegaRequestPrivate* request,
+                     const MegaErrorPrivate* e = nullptr);
+
+    void postTransfer(int type,
+                      const set<MegaTransferListener*>& transferListeners,
+                      const set<MegaListener*>& listeners,
+                      MegaTransferPrivate* transfer,
+                      const MegaErrorPrivate* e = nullptr);
+
+    void postNodes(const set<MegaGlobalListener*>& globalListeners,
+                   const set<MegaListener*>& listeners,
+                   unique_ptr<MegaNodeListPrivate> nodes);
+
+    // Once this returns, the listener won't be called again: if `wait`, a call in progress
+    // has returned as well, unless this is called from a callback.
+    void forget(const void* listener, bool wait);
+
+    // Human-readable counters and per-listener callback times.
+    string stats() const;
+
+private:
+    struct Event
+    {
+        int mType = 0;
+        int mTag = 0;
+        unique_ptr<MegaRequest> mRequest;
+        unique_ptr<MegaTransfer> mTransfer;
+        unique_ptr<MegaError> mError;
+        unique_ptr<MegaNodeListPrivate> mNodes;
+
+        // Listeners are cleared to nullptr when forgotten.
+        vector<MegaRequestListener*> mRequestListeners;
+        vector<MegaTransferListener*> mTransferListeners;
+        vector<MegaGlobalListener*> mGlobalListeners;
+        vector<MegaListener*> mListeners;
+
+        std::chrono::steady_clock::time_point mPosted;
+    };
+
+    struct ListenerStats
+    {
+        uint64_t mCalls = 0;
+        std::chrono::steady_clock::duration mTotal{};
+        std::chrono::steady_clock::duration mMax{};
+    };
+
+    void post(unique_ptr<Event> event, bool droppable);
+
+    // Replaces a queued update of the same type and tag, if any.
+    bool replaceUpdate(Event& event);
+
+    void deliver(Event& event);
+
+    // Notifies the listener unless it has been forgotten. Called without the mutex held.
+    template<typename Listener, typename Notify>
+    void call(Listener*& listener, Notify&& notify);
+
+    void loop();
+
+    MegaApi* mApi;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mQueued;
+    std::condition_variable mReturned;
+    std::list<unique_ptr<Event>> mEvents;
+
+    // Queued updates that newer ones for the same request or transfer replace, by type and tag.
+    map<std::pair<int, int>, Event*> mUpdates;
+
+    // What the dispatcher thread is delivering and the listener it is calling.
+    unique_ptr<Event> mCurrent;
+    const void* mCalling = nullptr;
+
+    bool mExit = false;
+    bool mShutdown = false;
+    bool mOverflowing = false;
+
+    uint64_t mPostedCount = 0;
+    uint64_t mDeliveredCount = 0;
+    uint64_t mMergedCount = 0;
+    uint64_t mDroppedCount = 0;
+    std::chrono::steady_clock::duration mMaxQueueDelay{};
+    std::map<const void*, ListenerStats> mListenerStats;
+
+    std::thread mThread;
+};
+
 #ifdef ENABLE_SYNC
 
 /**
@@ -3565,7 +3698,8 @@ public:
         createIsolatedInstance(const char* endpointName,
                                const char* executable,
                                unsigned int keepAliveInSeconds,
-                               const MegaStringList* extraArgs);
+                               const MegaStringList* extraArgs,
+                               unsigned int processCount);
 
     static std::unique_ptr<MegaGfxProviderPrivate> createExternalInstance(MegaGfxProcessor* processor);
 
@@ -3625,6 +3759,8 @@ class MegaApiImpl : public MegaApp
         bool removeTransferListener(MegaTransferListener* listener);
         bool removeScheduledCopyListener(MegaScheduledCopyListener* listener);
         bool removeGlobalListener(MegaGlobalListener* listener);
+        void setAsyncListenerDispatch(bool enable);
+        char* getListenerDispatchStats();
 
         //Utils
         long long getSDKtime();
@@ -3735,6 +3871,9 @@ class MegaApiImpl : public MegaApp
         static void removeLoggerClass(MegaLogger *megaLogger, bool singleExclusiveLogger);
         static void setLogToConsole(bool enable);
         static void setLogJSONContent(bool enable);
+        static void setAsyncLogging(bool enable);
+        static void setMetricsEnabled(bool enable);
+        static char* getMetrics(bool reset);
         static void log(int logLevel, const char* message, const char *filename = NULL, int line = -1);
         void setLoggingName(const char* loggingName);
 
@@ -4165,6 +4304,10 @@ class MegaApiImpl : public MegaApp
 
         void setLRUCacheSize(unsigned long long size);
         unsigned long long getNumNodesAtCacheLRU() const;
+        void setNodeSearchIndexEnabled(bool enable);
+        bool isNodeSearchIndexEnabled();
+        void setAsyncDbWritesEnabled(bool enable);
+        bool isAsyncDbWritesEnabled();
         unsigned long long getNumNodes();
         unsigned long long getAccurateNumNodes();
 
@@ -4395,6 +4538,7 @@ public:
         int httpServerGetMaxBufferSize();
         void httpServerSetMaxOutputSize(int outputSize);
         int httpServerGetMaxOutputSize();
+        bool httpServerSetStreamingCache(const char* localPath, long long maxSize);
 
         // permissions
         void httpServerEnableFileServer(bool enable);
@@ -4724,6 +4868,9 @@ public:
         bool httpServerOfflineAttributeEnabled;
         int httpServerRestrictedMode;
         bool httpServerSubtitlesSupportEnabled;
+#ifndef _WIN32
+        std::shared_ptr<StreamingCache> httpServerStreamingCache;
+#endif
         set<MegaTransferListener *> httpServerListeners;
 
         MegaFTPServer *ftpServer;
@@ -4755,6 +4902,13 @@ public:
 
         set<MegaGlobalListener *> globalListeners;
         set<MegaListener *> listeners;
+
+        // created by the first setAsyncListenerDispatch(true) and kept until destruction
+        unique_ptr<ListenerDispatcher> mListenerDispatcher;
+        std::atomic<bool> mAsyncListenerDispatch{false};
+        ListenerDispatcher* asyncListenerDispatcher() const;
+        void forgetListener(ListenerDispatcher* dispatcher, const void* listener);
+
         retryreason_t waitingRequest;
         mutable std::recursive_timed_mutex sdkMutex;
         using SdkMutexGuard = std::unique_lock<std::recursive_timed_mutex>;   // (equivalent to typedef)
@@ -5347,6 +5501,90 @@ protected:
     int duration;
 };
 
+#ifndef _WIN32
+// On-disk cache of the ranges of streamed files already fetched from MEGA, shared by all the
+// connections of an HTTP server. Files are keyed by node handle, as their content never changes.
+class StreamingCache: public std::enable_shared_from_this<StreamingCache>
+{
+public:
+    class File
+    {
+    public:
+        File(StreamingCache& cache, handle h, int fd, const LocalPath& path);
+        ~File();
+
+        // Bytes cached from offset on, up to len
+        m_off_t available(m_off_t offset, m_off_t len) const;
+
+        int descriptor() const
+        {
+            return mFd;
+        }
+
+    private:
+        friend class StreamingCache;
+
+        // Make room for len bytes about to be written at offset.
+        // False if they are cached already or there's no room.
+        bool reserve(m_off_t offset, m_off_t len);
+
+        // Record [start, end) as cached, returning how many bytes were new
+        m_off_t add(m_off_t start, m_off_t end);
+
+        StreamingCache& mCache;
+        const handle mHandle;
+        const int mFd;
+        const LocalPath mPath;
+
+        mutable std::mutex mMutex;
+        // Disjoint cached ranges: start -> end
+        std::map<m_off_t, m_off_t> mRanges;
+        // Bytes in mRanges
+        m_off_t mSize = 0;
+        // For LRU eviction
+        uint64_t mLastUse = 0;
+    };
+
+    // Files refer to their cache, so it must outlive them
+    StreamingCache(const LocalPath& directory, m_off_t maxSize);
+
+    // Get the cache file of a node, creating it if needed (nullptr on error)
+    std::shared_ptr<File> open(handle h);
+
+    // Store data fetched from MEGA. It's written on the loop's thread pool, so that the caller
+    // doesn't wait for the disk, and is available once written. Call from the loop's thread.
+    void store(uv_loop_t* loop, std::shared_ptr<File> file, m_off_t offset, std::string&& data);
+
+    m_off_t size() const;
+
+    const LocalPath& getDirectory() const
+    {
+        return mDirectory;
+    }
+
+    m_off_t getMaxSize() const
+    {
+        return mMaxSize;
+    }
+
+private:
+    struct Store;
+    static void onStored(uv_fs_t* req);
+
+    // Make room for len more bytes, evicting files not in use if needed
+    bool reserve(m_off_t len);
+    void release(m_off_t len);
+
+    const LocalPath mDirectory;
+    const m_off_t mMaxSize;
+
+    mutable std::mutex mMutex;
+    std::map<handle, std::shared_ptr<File>> mFiles;
+    m_off_t mSize = 0;
+    uint64_t mUseCounter = 0;
+};
+#endif
+
 class MegaTCPServer;
 class MegaTCPContext : public MegaTransferListener, public MegaRequestListener
 {
@@ -5563,6 +5801,22 @@ public:
     uv_mutex_t mutex_responses;
     std::list<std::string> responses;
 
+#ifndef _WIN32
+    // Streaming cache
+    struct CacheSend;
+    std::shared_ptr<StreamingCache> streamingCache;
+    std::shared_ptr<StreamingCache::File> cacheFile;
+    // Cached part of the requested range, sent before the buffered data
+    m_off_t cacheOffset;
+    m_off_t cacheRemaining;
+    // Ongoing send from the cache
+    CacheSend* cacheSend;
+    // File offset of the next byte received from the streaming transfer
+    m_off_t streamOffset;
+    // Data received from the streaming transfer and not stored in the cache yet, by file offset
+    std::deque<std::pair<m_off_t, std::string>> cacheStores;
+#endif
+
     virtual void onTransferStart(MegaApi*, MegaTransfer* httpTransfer);
     virtual bool
         onTransferData(MegaApi*, MegaTransfer* httpTransfer, char* buffer, size_t dataSize);
@@ -5608,6 +5862,18 @@ protected:
     static void sendNextBytes(MegaHTTPContext *httpctx);
     static int streamNode(MegaHTTPContext *httpctx);
 
+#ifndef _WIN32
+    // Streaming cache
+    std::shared_ptr<StreamingCache> streamingCache;
+
+    static void storeStreamedBytes(MegaHTTPContext* httpctx);
+    static void sendCachedBytes(MegaHTTPContext *httpctx);
+    static void onCacheSendfile(uv_fs_t* req);
+    static void onCacheRead(uv_fs_t* req);
+    static void onCacheWritten(uv_write_t* req, int status);
+    static void onCacheSent(MegaHTTPContext* httpctx, ssize_t result);
+#endif
+
     //Utility funcitons
     static std::string getHTTPMethodName(int httpmethod);
     static std::string getHTTPErrorString(int errorcode);
@@ -5641,6 +5907,9 @@ public:
     bool isOfflineAttributeEnabled();
     bool isSubtitlesSupportEnabled();
     void enableSubtitlesSupport(bool enable);
+#ifndef _WIN32
+    void setStreamingCache(std::shared_ptr<StreamingCache> cache);
+#endif
 
 };
 
@@ -6282,6 +6551,14 @@ public:
 
     MegaFuseExecutorFlags* getSubsystemExecutorFlags() override;
 
+    size_t getPartialReadBlockSize() const override;
+
+    size_t getPartialReadAheadBlocks() const override;
+
+    void setPartialReadBlockSize(size_t size) override;
+
+    void setPartialReadAheadBlocks(size_t count) override;
+
     void setFlushDelay(size_t seconds) override;
 
     void setLogLevel(int level) override;
@@ -6878,8 +6878,11 @@ CommandFetchNodes::CommandFetchNodes(MegaClient* client,
 
     // Parsing of chunk finished
     mFilters.emplace(">",
-                     [this](JSON*)
+                     [this, client](JSON*)
                      {
+                         // other threads may look at the nodes once the lock is released
+                         client->flushNodeDecryptions();
+
                          assert(mNodeTreeIsChanging.owns_lock());
                          mNodeTreeIsChanging.unlock();
                          return true;
@@ -6905,6 +6908,7 @@ CommandFetchNodes::CommandFetchNodes(MegaClient* client,
     // End of node array
     f = mFilters.emplace("{[f", [this, client](JSON *json)
     {
+        client->flushNodeDecryptions();
         client->mergenewshares(0);
         client->mNodeManager.checkOrphanNodes(mMissingParentNodes);
 
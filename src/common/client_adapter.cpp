@@ -1,8 +1,11 @@
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <sstream>
+#include <variant>
 
 #include <mega/common/client_adapter.h>
 #include <mega/common/error_or.h>
@@ -69,6 +72,41 @@ public:
     void completed(Error result);
 }; // ClientDownload
 
+class ClientPartialDownload
+{
+    // How many times should we retry a failed read before giving up?
+    static constexpr int MaxRetries = 5;
+
+    // Called when some of our content has been received.
+    void data(DirectRead::Data& data);
+
+    // Called when the read has encountered an error.
+    void failure(DirectRead::Failure& failure);
+
+    // Where are we accumulating the content we've received?
+    std::string mBuffer;
+
+    // Who do we call when we've completed?
+    PartialDownloadCallback mCallback;
+
+    // How much content are we expecting?
+    m_off_t mLength;
+
+public:
+    ClientPartialDownload(PartialDownloadCallback callback,
+                          m_off_t length);
+
+    // Begin the download.
+    static void begin(PartialDownloadCallback callback,
+                      MegaClient& client,
+                      Node& node,
+                      m_off_t offset,
+                      m_off_t length);
+
+    // Called by the client when something happens to our read.
+    void operator()(DirectRead::CallbackParam& param);
+}; // ClientPartialDownload
+
 class ClientNodeEvent
   : public NodeEvent
 {
@@ -796,6 +834,62 @@ NodeHandle ClientAdapter::parentHandle(NodeHandle handle) const
     return NodeHandle();
 }
 
+void ClientAdapter::partialDownload(PartialDownloadCallback callback,
+                                    NodeHandle handle,
+                                    m_off_t offset,
+                                    m_off_t length)
+{
+    // Sanity.
+    assert(callback);
+    assert(!handle.isUndef());
+    assert(offset >= 0);
+    assert(length > 0);
+
+    // Asks the client to read a range of the file's content.
+    auto download = [this](PartialDownloadCallback& callback,
+                           NodeHandle handle,
+                           m_off_t offset,
+                           m_off_t length,
+                           const Task& task) {
+        // Client's being torn down.
+        if (task.cancelled())
+            return callback(unexpected(API_EINCOMPLETE));
+
+        // Try and locate the node to be read.
+        auto node = mClient.nodeByHandle(handle);
+
+        // Node doesn't exist.
+        if (!node)
+            return callback(unexpected(API_ENOENT));
+
+        // Node's not a file.
+        if (node->type != FILENODE)
+            return callback(unexpected(API_EARGS));
+
+        // Range lies entirely beyond the end of the file.
+        if (offset >= node->size)
+            return callback(std::string());
+
+        // Clamp the range to the end of the file.
+        length = std::min(length, node->size - offset);
+
+        // Ask the client to read the range.
+        ClientPartialDownload::begin(std::move(callback),
+                                     mClient,
+                                     *node,
+                                     offset,
+                                     length);
+    }; // download
+
+    // Ask the client to read the range.
+    execute(std::bind(std::move(download),
+                      wrap(std::move(callback)),
+                      handle,
+                      offset,
+                      length,
+                      std::placeholders::_1));
+}
+
 accesslevel_t ClientAdapter::permissions(NodeHandle handle) const
 {
     // Make sure deinitialize(...) waits for this call to complete.
@@ -1126,6 +1220,125 @@ bool ClientDownload::begin(MegaClient& client)
     return false;
 }
 
+void ClientPartialDownload::data(DirectRead::Data& data)
+{
+    // Read's already completed or failed.
+    if (!mCallback)
+        return;
+
+    // Sanity.
+    assert(data.offset >= 0);
+    assert(data.len >= 0);
+
+    // Latch the data we've received.
+    mBuffer.append(reinterpret_cast<const char*>(data.buffer),
+                   static_cast<std::size_t>(data.len));
+
+    // Let the client know it should keep reading.
+    data.ret = true;
+
+    // We haven't received all of our content yet.
+    if (static_cast<m_off_t>(mBuffer.size()) < mLength)
+        return;
+
+    // Latch the callback so that we're considered complete.
+    auto callback = std::move(mCallback);
+
+    mCallback = nullptr;
+
+    // Transmit our content to the caller.
+    callback(std::move(mBuffer));
+}
+
+void ClientPartialDownload::failure(DirectRead::Failure& failure)
+{
+    // Read's already completed or failed.
+    if (!mCallback)
+    {
+        failure.ret = NEVER;
+        return;
+    }
+
+    // Read might succeed if we try again.
+    if (failure.retry <= MaxRetries
+        && failure.e != API_EINCOMPLETE
+        && !(failure.e == API_ETOOMANY && failure.e.hasExtraInfo()))
+    {
+        // Back off exponentially.
+        //
+        // Note that the read will resume from where it left off so any
+        // content we've already received remains valid.
+        failure.ret = failure.retry <= 1 ? 0 : dstime(1) << (failure.retry - 1);
+
+        return;
+    }
+
+    // Latch the callback so that we're considered complete.
+    auto callback = std::move(mCallback);
+
+    mCallback = nullptr;
+
+    // Don't retry the read.
+    failure.ret = NEVER;
+
+    // Let the caller know the read has failed.
+    callback(unexpected(failure.e));
+}
+
+ClientPartialDownload::ClientPartialDownload(PartialDownloadCallback callback,
+                                             m_off_t length)
+  : mBuffer()
+  , mCallback(std::move(callback))
+  , mLength(length)
+{
+    // Sanity.
+    assert(mCallback);
+    assert(mLength > 0);
+
+    // Make sure we have enough space for our content.
+    mBuffer.reserve(static_cast<std::size_t>(mLength));
+}
+
+void ClientPartialDownload::begin(PartialDownloadCallback callback,
+                                  MegaClient& client,
+                                  Node& node,
+                                  m_off_t offset,
+                                  m_off_t length)
+{
+    // The client requires that its callbacks be copyable.
+    auto download = std::make_shared<ClientPartialDownload>(std::move(callback),
+                                                            length);
+
+    // Forwards client events to our download.
+    auto wrapper = [download](DirectRead::CallbackParam& param) {
+        (*download)(param);
+    }; // wrapper
+
+    // Ask the client to read the range.
+    client.pread(&node, offset, length, std::move(wrapper));
+}
+
+void ClientPartialDownload::operator()(DirectRead::CallbackParam& param)
+{
+    std::visit(overloaded{[&](DirectRead::Data& data)
+                          {
+                              this->data(data);
+                          },
+                          [&](DirectRead::Failure& failure)
+                          {
+                              this->failure(failure);
+                          },
+                          [&](DirectRead::Revoke&)
+                          {
+                              // Reads are only revoked via application data.
+                          },
+                          [&](DirectRead::IsValid& isValid)
+                          {
+                              isValid.ret = !!mCallback;
+                          }},
+               param);
+}
+
 std::shared_ptr<Node> child(MegaClient& client,
                             NodeHandle parent,
                             const std::string& name)
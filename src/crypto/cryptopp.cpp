@@ -718,56 +718,136 @@ SymmCipher& SymmCipher::operator=(const SymmCipher& ref)
 // len must be < 2^31
 void SymmCipher::ctr_crypt(byte* data, unsigned len, m_off_t pos, ctr_iv ctriv, byte* mac, bool encrypt, bool initmac)
 {
-    assert(!(pos & (KEYLENGTH - 1)));
+    CtrLane lane{data, len, pos, mac, initmac};
 
-    byte ctr[BLOCKSIZE], tmp[BLOCKSIZE];
+    ctr_crypt_lanes(&lane, 1, ctriv, encrypt);
+}
 
-    MemAccess::set<int64_t>(ctr, static_cast<int64_t>(ctriv));
-    setint64(pos / BLOCKSIZE, ctr + sizeof ctriv);
+void SymmCipher::ctr_crypt_lanes(CtrLane* lanes, size_t count, ctr_iv ctriv, bool encrypt)
+{
+    // keystream blocks generated at once for each lane
+    const unsigned window = 64;
 
-    if (mac && initmac)
-    {
-        memcpy(mac, ctr, sizeof ctriv);
-        memcpy(mac + sizeof ctriv, ctr, sizeof ctriv);
-    }
+    byte ctrs[window * BLOCKSIZE];
+    byte macs[CTR_LANES * BLOCKSIZE];
 
-    while ((int)len > 0)
+    while (count)
     {
-        if (encrypt)
+        size_t group = std::min(count, CTR_LANES);
+        unsigned blocks[CTR_LANES];
+        unsigned maxblocks = 0;
+        bool anymac = false;
+
+        for (size_t i = 0; i < group; ++i)
         {
-            if(mac)
+            CtrLane& lane = lanes[i];
+
+            assert(!(lane.pos & (KEYLENGTH - 1)));
+
+            blocks[i] = (lane.len + BLOCKSIZE - 1) / BLOCKSIZE;
+            maxblocks = std::max(maxblocks, blocks[i]);
+
+            if (lane.mac)
             {
-                xorblock(data, mac);
-                ecb_encrypt(mac);
-            }
+                anymac = true;
 
-            ecb_encrypt(ctr, tmp);
-            xorblock(tmp, data);
+                if (lane.initmac)
+                {
+                    MemAccess::set<int64_t>(lane.mac, static_cast<int64_t>(ctriv));
+                    MemAccess::set<int64_t>(lane.mac + sizeof ctriv, static_cast<int64_t>(ctriv));
+                }
+            }
         }
-        else
+
+        // xor the keystream for blocks [first, first + window) of every lane
+        auto keystream = [&](unsigned first)
         {
-            ecb_encrypt(ctr, tmp);
-            xorblock(tmp, data);
+            for (size_t i = 0; i < group; ++i)
+            {
+                if (first >= blocks[i])
+                {
+                    continue;
+                }
+
+                unsigned n = std::min(window, blocks[i] - first);
+
+                MemAccess::set<int64_t>(ctrs, static_cast<int64_t>(ctriv));
+                setint64(lanes[i].pos / BLOCKSIZE + first, ctrs + sizeof ctriv);
+
+                for (unsigned j = 1; j < n; ++j)
+                {
+                    memcpy(ctrs + j * BLOCKSIZE, ctrs + (j - 1) * BLOCKSIZE, BLOCKSIZE);
+                    incblock(ctrs + j * BLOCKSIZE);
+                }
+
+                ecb_encrypt(ctrs, ctrs, n * BLOCKSIZE);
 
-            if (mac)
+                byte* data = lanes[i].data + first * BLOCKSIZE;
+                for (unsigned j = 0; j < n; ++j)
+                {
+                    xorblock(ctrs + j * BLOCKSIZE, data + j * BLOCKSIZE);
+                }
+            }
+        };
+
+        // one CBC-MAC step of every lane that has block b, on the plaintext
+        auto macstep = [&](unsigned b)
+        {
+            size_t n = 0;
+
+            for (size_t i = 0; i < group; ++i)
             {
-                if (len >= (unsigned)BLOCKSIZE)
+                if (!lanes[i].mac || b >= blocks[i])
+                {
+                    continue;
+                }
+
+                byte* mac = macs + n++ * BLOCKSIZE;
+                unsigned left = lanes[i].len - b * BLOCKSIZE;
+
+                memcpy(mac, lanes[i].mac, BLOCKSIZE);
+
+                if (encrypt || left >= (unsigned)BLOCKSIZE)
                 {
-                    xorblock(data, mac);
+                    xorblock(lanes[i].data + b * BLOCKSIZE, mac);
                 }
                 else
                 {
-                    xorblock(data, mac, static_cast<int>(len));
+                    xorblock(lanes[i].data + b * BLOCKSIZE, mac, static_cast<int>(left));
+                }
+            }
+
+            ecb_encrypt(macs, macs, n * BLOCKSIZE);
+
+            for (size_t i = 0, k = 0; i < group; ++i)
+            {
+                if (lanes[i].mac && b < blocks[i])
+                {
+                    memcpy(lanes[i].mac, macs + k++ * BLOCKSIZE, BLOCKSIZE);
                 }
+            }
+        };
 
-                ecb_encrypt(mac);
+        for (unsigned first = 0; first < maxblocks; first += window)
+        {
+            if (!encrypt)
+            {
+                keystream(first);
             }
-        }
 
-        len -= BLOCKSIZE;
-        data += BLOCKSIZE;
+            for (unsigned b = first; anymac && b < std::min(first + window, maxblocks); ++b)
+            {
+                macstep(b);
+            }
+
+            if (encrypt)
+            {
+                keystream(first);
+            }
+        }
 
-        incblock(ctr);
+        lanes += group;
+        count -= group;
     }
 }
 
@@ -21,13 +21,23 @@
 
 #include "mega.h"
 
+#include <condition_variable>
 #include <numeric>
+#include <thread>
 
 #ifdef USE_SQLITE
 namespace mega {
 
 static const char* NodeSearchFilterPtrStr = "NodeSearchFilterPtrStr";
 
+// Commits on the clients' threads, and those of the background writers. Both may be recorded from
+// several threads at once, which only the histograms allow.
+static metrics::Histogram& dbCommitSeconds =
+    metrics::Registry::instance().histogram("mega_db_commit_seconds", "Time spent in sqliteCommit");
+static metrics::Histogram& dbGroupCommitSeconds =
+    metrics::Registry::instance().histogram("mega_db_group_commit_seconds",
+                                            "Time spent in sqliteGroupCommit");
+
 SqliteDbAccess::SqliteDbAccess(const LocalPath& rootPath)
   : mRootPath(rootPath)
 {
@@ -143,25 +153,13 @@ static int
     return naturalsorting_compare(s1.c_str(), s2.c_str());
 }
 
-DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAccess, const string &name, const int flags, DBErrorCallback dBErrorCallBack)
+// The functions and collations used by the schema and queries of the 'nodes' table
+static bool createNodeFunctions(sqlite3* db)
 {
-    /**
-     * Deprecated columns (WARNING: do not use these names anymore for new columns):
-     * - size: file/folder size in Bytes (replaced by sizeVirtual, calculated from nodeCounter)
-     * - mimetype: node mimetype (replaced by mimetypeVirtual, calculated from node name)
-     */
-    sqlite3 *db = nullptr;
-    auto dbPath = databasePath(fsAccess, name, DB_VERSION);
-    if (!openDBAndCreateStatecache(&db, fsAccess, name, dbPath, flags))
-    {
-        return nullptr;
-    }
-
     if (sqlite3_create_function(db, u8"getmimetype", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC, 0, &SqliteAccountState::userGetMimetype, 0, 0) != SQLITE_OK)
     {
         LOG_err << "Data base error(sqlite3_create_function userGetMimetype): " << sqlite3_errmsg(db);
-        sqlite3_close(db);
-        return nullptr;
+        return false;
     }
 
     if (sqlite3_create_function(db,
@@ -175,8 +173,7 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
     {
         LOG_err << "Data base error(sqlite3_create_function getSizeFromNodeCounter): "
                 << sqlite3_errmsg(db);
-        sqlite3_close(db);
-        return nullptr;
+        return false;
     }
 
     if (sqlite3_create_collation(db,
@@ -187,6 +184,89 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
     {
         LOG_err << "Data base error(sqlite3_create_collation NATURALNOCASE): "
                 << sqlite3_errmsg(db);
+        return false;
+    }
+
+    if (sqlite3_create_function(db, "regexp", 2, SQLITE_ANY,0, &SqliteAccountState::userRegexp, 0, 0))
+    {
+        LOG_err << "Data base error(sqlite3_create_function userRegexp): " << sqlite3_errmsg(db);
+        return false;
+    }
+
+    if (sqlite3_create_function(db,
+                                "matchFilter",
+                                10,
+                                SQLITE_ANY,
+                                0,
+                                &SqliteAccountState::userMatchFilter,
+                                0,
+                                0))
+    {
+        LOG_err << "Data base error(sqlite3_create_function userMatchFilter): "
+                << sqlite3_errmsg(db);
+        return false;
+    }
+
+    if (sqlite3_create_function(db,
+                                "appendAncestor",
+                                2,
+                                SQLITE_ANY | SQLITE_DETERMINISTIC,
+                                0,
+                                &SqliteAccountState::userAppendAncestor,
+                                0,
+                                0))
+    {
+        LOG_err << "Data base error(sqlite3_create_function userAppendAncestor): "
+                << sqlite3_errmsg(db);
+        return false;
+    }
+
+    return true;
+}
+
+// A second connection to a database with nodes, for SqliteAccountState's asynchronous writer
+static sqlite3* openWriterConnection(const LocalPath& dbPath)
+{
+    // how long the writer waits for a checkpoint or the main connection's own writes
+    constexpr int BUSY_TIMEOUT_MS = 30000;
+
+    sqlite3* db = nullptr;
+    int result = sqlite3_open_v2(dbPath.toPath(false).c_str(),
+                                 &db,
+                                 SQLITE_OPEN_READWRITE | SQLITE_OPEN_FULLMUTEX,
+                                 nullptr);
+
+    if (result == SQLITE_OK && createNodeFunctions(db))
+    {
+        result = sqlite3_busy_timeout(db, BUSY_TIMEOUT_MS);
+        if (result == SQLITE_OK)
+        {
+            return db;
+        }
+    }
+
+    LOG_warn << "Unable to open a connection for asynchronous writes, writing synchronously: "
+             << (db ? sqlite3_errmsg(db) : std::to_string(result));
+    sqlite3_close(db);
+    return nullptr;
+}
+
+DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAccess, const string &name, const int flags, DBErrorCallback dBErrorCallBack)
+{
+    /**
+     * Deprecated columns (WARNING: do not use these names anymore for new columns):
+     * - size: file/folder size in Bytes (replaced by sizeVirtual, calculated from nodeCounter)
+     * - mimetype: node mimetype (replaced by mimetypeVirtual, calculated from node name)
+     */
+    sqlite3 *db = nullptr;
+    auto dbPath = databasePath(fsAccess, name, DB_VERSION);
+    if (!openDBAndCreateStatecache(&db, fsAccess, name, dbPath, flags))
+    {
+        return nullptr;
+    }
+
+    if (!createNodeFunctions(db))
+    {
         sqlite3_close(db);
         return nullptr;
     }
@@ -198,7 +278,8 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
                       "sizeVirtual int64 AS (getSizeFromNodeCounter(counter)) VIRTUAL,"
                       "share tinyint, fav tinyint, ctime int64, mtime int64 DEFAULT 0, "
                       "flags int64, counter BLOB NOT NULL, "
-                      "node BLOB NOT NULL, label tinyint DEFAULT 0, description text, tags text)";
+                      "node BLOB NOT NULL, label tinyint DEFAULT 0, description text, tags text, "
+                      "ancestry BLOB)";
 
     int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
     if (result)
@@ -227,6 +308,8 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
         {"sizeVirtual",
          "int64 AS (getSizeFromNodeCounter(counter)) VIRTUAL", NodeData::COMPONENT_NONE,
          nullptr                                                                                                                            },
+        // populated when indexes are created (see createNodeIndexes())
+        {"ancestry",        "BLOB",                            NodeData::COMPONENT_NONE,        nullptr                                     },
     };
 
     if (!addAndPopulateColumns(db, std::move(newCols)))
@@ -247,35 +330,36 @@ DbTable *SqliteDbAccess::openTableWithNodes(PrnGen &rng, FileSystemAccess &fsAcc
     }
 #endif
 
-    result = sqlite3_create_function(db, "regexp", 2, SQLITE_ANY,0, &SqliteAccountState::userRegexp, 0, 0);
-    if (result)
+    bool searchIndex = false;
+    if (flags & DB_OPEN_FLAG_SEARCH_INDEX)
     {
-        LOG_err << "Data base error(sqlite3_create_function userRegexp): " << sqlite3_errmsg(db);
+        searchIndex = createSearchIndex(db);
+    }
+    // drop any index left from a previous session, as it wouldn't be kept up to date
+    else if (sqlite3_exec(db, "DROP TABLE IF EXISTS nodesearch", nullptr, nullptr, nullptr))
+    {
+        LOG_err << "Data base error while dropping search index: " << sqlite3_errmsg(db);
         sqlite3_close(db);
         return nullptr;
     }
 
-    result = sqlite3_create_function(db,
-                                     "matchFilter",
-                                     10,
-                                     SQLITE_ANY,
-                                     0,
-                                     &SqliteAccountState::userMatchFilter,
-                                     0,
-                                     0);
-    if (result)
+    sqlite3* writerDb = nullptr;
+#if !(TARGET_OS_IPHONE)
+    // the writer relies on WAL, so that its commits don't block reads of the main connection
+    if (flags & DB_OPEN_FLAG_ASYNC_WRITES)
     {
-        LOG_err << "Data base error(sqlite3_create_function userMatchFilter): "
-                << sqlite3_errmsg(db);
-        sqlite3_close(db);
-        return nullptr;
+        writerDb = openWriterConnection(dbPath);
     }
+#endif /* ! TARGET_OS_IPHONE */
+
     return new SqliteAccountState(rng,
                                 db,
                                 fsAccess,
                                 dbPath,
                                 (flags & DB_OPEN_FLAG_TRANSACTED) > 0,
-                                std::move(dBErrorCallBack));
+                                std::move(dBErrorCallBack),
+                                searchIndex,
+                                writerDb);
 }
 
 bool SqliteDbAccess::probe(FileSystemAccess& fsAccess, const string& name) const
@@ -502,6 +586,73 @@ bool SqliteDbAccess::addColumn(sqlite3* db, const string& name, const string& ty
     return true;
 }
 
+bool SqliteDbAccess::createSearchIndex(sqlite3* db)
+{
+    if (sqlite3_create_function(db,
+                                "foldSearchText",
+                                1,
+                                SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                0,
+                                &SqliteAccountState::userFoldSearchText,
+                                0,
+                                0) != SQLITE_OK)
+    {
+        LOG_err << "Data base error(sqlite3_create_function userFoldSearchText): "
+                << sqlite3_errmsg(db);
+        return false;
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db,
+                           "SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = 'nodesearch'",
+                           -1,
+                           &stmt,
+                           nullptr) != SQLITE_OK)
+    {
+        LOG_err << "Db error while looking for search index: " << sqlite3_errmsg(db);
+        return false;
+    }
+
+    bool exists = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0;
+    sqlite3_finalize(stmt);
+
+    if (exists)
+    {
+        return true;
+    }
+
+    // SQLite might have been built without FTS5 or its trigram tokenizer: search without the index
+    // Text is folded before being indexed, so the tokenizer doesn't need to fold it again
+    if (sqlite3_exec(db,
+                     "CREATE VIRTUAL TABLE nodesearch USING fts5(name, description, tags, "
+                     "tokenize = 'trigram case_sensitive 1')",
+                     nullptr,
+                     nullptr,
+                     nullptr) != SQLITE_OK)
+    {
+        LOG_warn << "Search index not available: " << sqlite3_errmsg(db);
+        return false;
+    }
+
+    // index the nodes of databases created before the index was enabled
+    if (sqlite3_exec(db,
+                     "INSERT INTO nodesearch (rowid, name, description, tags) "
+                     "SELECT nodehandle, foldSearchText(name), foldSearchText(description), "
+                     "foldSearchText(tags) FROM nodes",
+                     nullptr,
+                     nullptr,
+                     nullptr) != SQLITE_OK)
+    {
+        LOG_err << "Db error while populating search index: " << sqlite3_errmsg(db);
+        sqlite3_exec(db, "DROP TABLE IF EXISTS nodesearch", nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    LOG_debug << "Search index created for " << sqlite3_changes(db) << " nodes";
+
+    return true;
+}
+
 bool SqliteDbAccess::migrateDataToColumns(sqlite3* db, vector<NewColumn>&& cols)
 {
     if (cols.empty()) return true;
@@ -635,197 +786,1438 @@ bool SqliteDbAccess::migrateDataToColumns(sqlite3* db, vector<NewColumn>&& cols)
 }
 
 
-SqliteDbTable::SqliteDbTable(PrnGen &rng, sqlite3* db, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack)
-  : DbTable(rng, checkAlwaysTransacted, dBErrorCallBack)
-  , db(db)
-  , dbfile(path)
-  , fsaccess(&fsAccess)
+namespace
 {
-}
 
-SqliteDbTable::~SqliteDbTable()
+// A row of the 'nodes' table, computed from a Node on the SDK thread, so that it can be written
+// later on another
+struct NodeRow
 {
-    resetCommitter();
+    explicit NodeRow(Node& node);
+
+    handle nodeHandle;
+    handle parentHandle;
+    std::string name;
+    std::string fingerprint;
+    std::string origFingerprint;
+    nodetype_t type;
+    int shareType;
+    bool fav;
+    m_time_t ctime;
+    m_time_t mtime;
+    uint64_t flags;
+    std::string counter;
+    std::string node;
+    int label;
+    std::optional<std::string> description;
+    std::optional<std::string> tags;
+};
 
-    if (!db)
-    {
-        return;
-    }
+NodeRow::NodeRow(Node& node)
+  : nodeHandle(node.nodehandle)
+  , parentHandle(node.parenthandle)
+  , name(node.displayname(Node::LOG_CONDITION_DISABLE_NO_KEY))
+  , type(node.type)
+  , shareType(node.getShareType())
+  , ctime(node.ctime)
+  , mtime(node.mtime)
+  , flags(node.getDBFlags())
+  , counter(node.getCounter().serialize())
+{
+    node.serialize(&this->node);
+    assert(this->node.size());
 
-    sqlite3_finalize(pStmt);
-    sqlite3_finalize(mDelStmt);
-    sqlite3_finalize(mPutStmt);
+    node.FileFingerprint::serialize(&fingerprint);
 
-    if (inTransaction())
+    attr_map::const_iterator attrIt = node.attrs.map.find(makeNameid("c0"));
+    if (attrIt != node.attrs.map.end())
     {
-        SqliteDbTable::abort(); // fully qualify virtual function
+       origFingerprint = attrIt->second;
     }
 
-    sqlite3_close(db);
-    LOG_debug << "Database closed " << dbfile;
-}
+    // node->attrstring has value => node is encrypted
+    nameid favId = AttrMap::string2nameid("fav");
+    auto favIt = node.attrs.map.find(favId);
+    fav = (favIt != node.attrs.map.end() && favIt->second == "1"); // test 'fav' attr value (only "1" is valid)
 
-bool SqliteDbTable::inTransaction() const
-{
-    return sqlite3_get_autocommit(db) == 0;
-}
+    static nameid labelId = AttrMap::string2nameid("lbl");
+    auto labelIt = node.attrs.map.find(labelId);
+    label = (labelIt == node.attrs.map.end()) ? LBL_UNKNOWN : std::atoi(labelIt->second.c_str());
 
-// set cursor to first record
-void SqliteDbTable::rewind()
-{
-    if (!db)
+    nameid descriptionId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
+    if (auto descriptionIt = node.attrs.map.find(descriptionId);
+        descriptionIt != node.attrs.map.end())
     {
-        return;
+        description = descriptionIt->second;
     }
 
-    int result = SQLITE_OK;
-
-    if (pStmt)
-    {
-        result = sqlite3_reset(pStmt);
-    }
-    else
+    nameid tagId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
+    if (auto tagIt = node.attrs.map.find(tagId); tagIt != node.attrs.map.end())
     {
-        result = sqlite3_prepare_v2(db, "SELECT id, content FROM statecache", -1, &pStmt, NULL);
+        tags = tagIt->second;
     }
-
-    errorHandler(result, "Rewind", false);
 }
 
-// retrieve next record through cursor
-bool SqliteDbTable::next(uint32_t* index, string* data)
+// The statements a connection writes with, prepared when first used
+struct WriteStatements
 {
-    if (!db)
-    {
-        return false;
-    }
-
-    if (!pStmt)
-    {
-        return false;
-    }
-
-    int rc = sqlite3_step(pStmt);
-
-    if (rc != SQLITE_ROW)
-    {
-        sqlite3_finalize(pStmt);
-        pStmt = NULL;
-
-        errorHandler(rc, "Get next record", false);
-
-        return false;
-    }
-
-    *index = static_cast<uint32_t>(sqlite3_column_int(pStmt, 0));
-
-    data->assign(static_cast<const char*>(sqlite3_column_blob(pStmt, 1)),
-                 static_cast<size_t>(sqlite3_column_bytes(pStmt, 1)));
+    sqlite3_stmt*& putRecord;
+    sqlite3_stmt*& delRecord;
+    sqlite3_stmt*& putNode;
+    sqlite3_stmt*& putSearchText;
+    sqlite3_stmt*& childAncestry;
+    sqlite3_stmt*& updateAncestry;
+    sqlite3_stmt*& updateCounter;
+    sqlite3_stmt*& updateCounterAndFlags;
+};
 
-    return true;
+bool failed(int sqlResult)
+{
+    return sqlResult != SQLITE_OK && sqlResult != SQLITE_ROW && sqlResult != SQLITE_DONE;
 }
 
-// retrieve record by index
-bool SqliteDbTable::get(uint32_t index, string* data)
+// The writes below are shared by the SDK thread's connection and the asynchronous writer's.
+// They return the result of the last SQLite call, so the caller can report it.
+
+int putRecord(sqlite3* db, sqlite3_stmt*& stmt, uint32_t index, const char* data, size_t len)
 {
-    if (!db)
+    int sqlResult = SQLITE_OK;
+    if (!stmt)
     {
-        return false;
+        sqlResult = sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO statecache (id, content) VALUES (?, ?)", -1, &stmt, nullptr);
     }
 
-    sqlite3_stmt *stmt = nullptr;
-    int rc;
-
-    rc = sqlite3_prepare_v2(db, "SELECT content FROM statecache WHERE id = ?", -1, &stmt, NULL);
-    if (rc == SQLITE_OK)
+    if (sqlResult == SQLITE_OK)
     {
-        rc = sqlite3_bind_int(stmt, 1, static_cast<int>(index));
-        if (rc == SQLITE_OK)
+        sqlResult = sqlite3_bind_int(stmt, 1, static_cast<int>(index));
+        if (sqlResult == SQLITE_OK)
         {
-            rc = sqlite3_step(stmt);
-            if (rc == SQLITE_ROW)
+            sqlResult = sqlite3_bind_blob(stmt, 2, data, static_cast<int>(len), SQLITE_STATIC);
+            if (sqlResult == SQLITE_OK)
             {
-                data->assign(static_cast<const char*>(sqlite3_column_blob(stmt, 0)),
-                             static_cast<size_t>(sqlite3_column_bytes(stmt, 0)));
+                sqlResult = sqlite3_step(stmt);
             }
         }
     }
 
-    errorHandler(rc, "Get record statecache", false);
-
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
 
-    return rc == SQLITE_ROW;
+    return sqlResult;
 }
 
-// add/update record by index
-bool SqliteDbTable::put(uint32_t index, char* data, unsigned len)
+int delRecord(sqlite3* db, sqlite3_stmt*& stmt, uint32_t index)
 {
-    if (!db)
-    {
-        return false;
-    }
-
-    // First bits at index are reserved for the type
-    assert((index & (DbTable::IDSPACING - 1)) != MegaClient::CACHEDNODE); // nodes must be stored in DbTableNodes ('nodes' table, not 'statecache' table)
-
-    checkTransaction();
-
     int sqlResult = SQLITE_OK;
-    if (!mPutStmt)
+    if (!stmt)
     {
-        sqlResult = sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO statecache (id, content) VALUES (?, ?)", -1, &mPutStmt, nullptr);
+        sqlResult = sqlite3_prepare_v2(db, "DELETE FROM statecache WHERE id = ?", -1, &stmt, nullptr);
     }
 
     if (sqlResult == SQLITE_OK)
     {
-        sqlResult = sqlite3_bind_int(mPutStmt, 1, static_cast<int>(index));
+        sqlResult = sqlite3_bind_int(stmt, 1, static_cast<int>(index));
         if (sqlResult == SQLITE_OK)
         {
-            sqlResult = sqlite3_bind_blob(mPutStmt, 2, data, static_cast<int>(len), SQLITE_STATIC);
-            if (sqlResult == SQLITE_OK)
-            {
-                sqlResult = sqlite3_step(mPutStmt);
-            }
+            sqlResult = sqlite3_step(stmt); // tipically SQLITE_DONE, but could be SQLITE_ROW if implementation returned removed row count
         }
     }
 
-    errorHandler(sqlResult, "Put record", false);
-
-    sqlite3_reset(mPutStmt);
+    sqlite3_reset(stmt);
 
-    return sqlResult == SQLITE_DONE;
+    return sqlResult;
 }
 
-
-// delete record by index
-bool SqliteDbTable::del(uint32_t index)
+// 'ancestry' tells whether to compute the node's ancestry from its parent's
+int putNodeRow(sqlite3* db, sqlite3_stmt*& stmt, const NodeRow& row, bool ancestry)
 {
-    if (!db)
+    int sqlResult = SQLITE_OK;
+    if (!stmt)
     {
-        return false;
+        sqlResult =
+            sqlite3_prepare_v2(db,
+                               "INSERT OR REPLACE INTO nodes (nodehandle, parenthandle, "
+                               "name, fingerprint, origFingerprint, type, share, fav, ctime, "
+                               "mtime, flags, counter, node, label, description, tags, ancestry) "
+                               "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, "
+                               "CASE WHEN ?17 THEN appendAncestor("
+                               "(SELECT ancestry FROM nodes WHERE nodehandle = ?2), ?2) END)",
+                               -1,
+                               &stmt,
+                               NULL);
     }
 
-    checkTransaction();
+    if (sqlResult != SQLITE_OK)
+    {
+        return sqlResult;
+    }
+
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(row.nodeHandle));
+    sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(row.parentHandle));
+    sqlite3_bind_text(stmt, 3, row.name.c_str(), static_cast<int>(row.name.length()), SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 4, row.fingerprint.data(), static_cast<int>(row.fingerprint.size()), SQLITE_STATIC);
+    sqlite3_bind_blob(stmt,
+                      5,
+                      row.origFingerprint.data(),
+                      static_cast<int>(row.origFingerprint.size()),
+                      SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 6, row.type);
+    sqlite3_bind_int(stmt, 7, row.shareType);
+    sqlite3_bind_int(stmt, 8, row.fav);
+    sqlite3_bind_int64(stmt, 9, row.ctime);
+    sqlite3_bind_int64(stmt, 10, row.mtime);
+    sqlite3_bind_int64(stmt, 11, static_cast<sqlite3_int64>(row.flags));
+    sqlite3_bind_blob(stmt, 12, row.counter.data(), static_cast<int>(row.counter.size()), SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 13, row.node.data(), static_cast<int>(row.node.size()), SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 14, row.label);
+
+    if (row.description)
+    {
+        sqlite3_bind_text(stmt,
+                          15,
+                          row.description->c_str(),
+                          static_cast<int>(row.description->length()),
+                          SQLITE_STATIC);
+    }
+    else
+    {
+        sqlite3_bind_null(stmt, 15);
+    }
+
+    if (row.tags)
+    {
+        sqlite3_bind_text(stmt, 16, row.tags->c_str(), static_cast<int>(row.tags->length()), SQLITE_STATIC);
+    }
+    else
+    {
+        sqlite3_bind_null(stmt, 16);
+    }
+
+    sqlite3_bind_int(stmt, 17, ancestry);
+
+    sqlResult = sqlite3_step(stmt);
+
+    sqlite3_reset(stmt);
+
+    return sqlResult;
+}
+
+// Add or replace the search index entry of a node
+int putSearchText(sqlite3* db, sqlite3_stmt*& stmt, const NodeRow& row)
+{
+    int sqlResult = SQLITE_OK;
+    if (!stmt)
+    {
+        sqlResult = sqlite3_prepare_v2(db,
+                                       "INSERT OR REPLACE INTO nodesearch (rowid, name, "
+                                       "description, tags) VALUES (?, ?, ?, ?)",
+                                       -1,
+                                       &stmt,
+                                       NULL);
+    }
+
+    if (sqlResult != SQLITE_OK)
+    {
+        return sqlResult;
+    }
+
+    // text is stored folded, the same way search patterns are before querying the index
+    std::string name = foldCaseAccent(row.name);
+    std::string description = row.description ? foldCaseAccent(*row.description) : std::string();
+    std::string tags = row.tags ? foldCaseAccent(*row.tags) : std::string();
+
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(row.nodeHandle));
+    sqlite3_bind_text(stmt, 2, name.c_str(), static_cast<int>(name.length()), SQLITE_STATIC);
+    sqlite3_bind_text(stmt,
+                      3,
+                      description.c_str(),
+                      static_cast<int>(description.length()),
+                      SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, tags.c_str(), static_cast<int>(tags.length()), SQLITE_STATIC);
+
+    sqlResult = sqlite3_step(stmt);
+
+    sqlite3_reset(stmt);
+
+    return sqlResult;
+}
+
+// Bring the ancestry of the nodes below a node up to date with the node's, which changes when the
+// node is moved, or added after them. Children have the same ancestry, up to date with the node's
+// previous one, so checking any of them tells whether there's something to update.
+// Nodes are removed along with those below them, so removals leave nothing to update.
+int updateDescendantsAncestry(sqlite3* db,
+                              sqlite3_stmt*& childStmt,
+                              sqlite3_stmt*& updateStmt,
+                              handle nodeHandle)
+{
+    int sqlResult = SQLITE_OK;
+    if (!childStmt)
+    {
+        sqlResult = sqlite3_prepare_v2(db,
+                                       "SELECT C.ancestry IS NOT "
+                                       "appendAncestor(P.ancestry, P.nodehandle) "
+                                       "FROM nodes AS P INNER JOIN nodes AS C "
+                                       "ON C.parenthandle = P.nodehandle "
+                                       "WHERE P.nodehandle = ? LIMIT 1",
+                                       -1,
+                                       &childStmt,
+                                       NULL);
+    }
+
+    if (sqlResult != SQLITE_OK)
+    {
+        return sqlResult;
+    }
+
+    sqlite3_bind_int64(childStmt, 1, static_cast<sqlite3_int64>(nodeHandle));
+
+    sqlResult = sqlite3_step(childStmt);
+    bool outdated = sqlResult == SQLITE_ROW && sqlite3_column_int(childStmt, 0);
+
+    sqlite3_reset(childStmt);
+
+    if (!outdated)
+    {
+        return sqlResult == SQLITE_ROW ? SQLITE_DONE : sqlResult;
+    }
+
+    sqlResult = SQLITE_OK;
+    if (!updateStmt)
+    {
+        // Until the last of a batch of moves is written, the tree might have a cycle through the
+        // node: the walk stops there, and the moves that break the cycle update what's below.
+        sqlResult = sqlite3_prepare_v2(db,
+                                       "WITH RECURSIVE below(nodehandle, ancestry) "
+                                       "AS (SELECT N.nodehandle, "
+                                       "appendAncestor(P.ancestry, P.nodehandle) "
+                                       "FROM nodes AS P INNER JOIN nodes AS N "
+                                       "ON N.parenthandle = P.nodehandle WHERE P.nodehandle = ?1 "
+                                       "UNION ALL "
+                                       "SELECT N.nodehandle, "
+                                       "appendAncestor(B.ancestry, B.nodehandle) "
+                                       "FROM below AS B INNER JOIN nodes AS N "
+                                       "ON N.parenthandle = B.nodehandle WHERE N.nodehandle != ?1) "
+                                       "UPDATE nodes SET ancestry = below.ancestry FROM below "
+                                       "WHERE nodes.nodehandle = below.nodehandle",
+                                       -1,
+                                       &updateStmt,
+                                       NULL);
+    }
+
+    if (sqlResult != SQLITE_OK)
+    {
+        return sqlResult;
+    }
+
+    sqlite3_bind_int64(updateStmt, 1, static_cast<sqlite3_int64>(nodeHandle));
+
+    sqlResult = sqlite3_step(updateStmt);
+
+    sqlite3_reset(updateStmt);
+
+    return sqlResult;
+}
+
+// Put a node's row, along with its search text and ancestry if they're maintained
+int putNode(sqlite3* db,
+            const WriteStatements& statements,
+            const NodeRow& row,
+            bool searchIndex,
+            bool ancestryIndex)
+{
+    int sqlResult = putNodeRow(db, statements.putNode, row, ancestryIndex);
+
+    if (sqlResult == SQLITE_DONE && searchIndex)
+    {
+        sqlResult = putSearchText(db, statements.putSearchText, row);
+    }
+
+    if (sqlResult == SQLITE_DONE && ancestryIndex)
+    {
+        sqlResult = updateDescendantsAncestry(db,
+                                              statements.childAncestry,
+                                              statements.updateAncestry,
+                                              row.nodeHandle);
+    }
+
+    return sqlResult;
+}
+
+int deleteNode(sqlite3* db, NodeHandle nodeHandle, bool searchIndex)
+{
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "DELETE FROM nodes WHERE nodehandle = %" PRId64, nodeHandle.as8byte());
+
+    int sqlResult = sqlite3_exec(db, buf, 0, 0, NULL);
+
+    if (sqlResult == SQLITE_OK && searchIndex)
+    {
+        snprintf(buf, sizeof(buf), "DELETE FROM nodesearch WHERE rowid = %" PRId64, nodeHandle.as8byte());
+        sqlResult = sqlite3_exec(db, buf, 0, 0, NULL);
+    }
+
+    return sqlResult;
+}
+
+int deleteNodes(sqlite3* db, bool searchIndex, std::atomic<bool>& ancestryIndex)
+{
+    int sqlResult = sqlite3_exec(db, "DELETE FROM nodes", 0, 0, NULL);
+
+    if (sqlResult == SQLITE_OK && searchIndex)
+    {
+        sqlResult = sqlite3_exec(db, "DELETE FROM nodesearch", 0, 0, NULL);
+    }
+
+    // nodes are going to be fetched again: rather than maintaining the ancestry of each of them
+    // as they're put, populate it at once when indexes are created
+    if (sqlResult == SQLITE_OK && ancestryIndex)
+    {
+        sqlResult = sqlite3_exec(db, "DROP INDEX IF EXISTS ancestryindex", 0, 0, NULL);
+        ancestryIndex = sqlResult != SQLITE_OK;
+    }
+
+    return sqlResult;
+}
+
+int updateCounter(sqlite3* db, sqlite3_stmt*& stmt, NodeHandle nodeHandle, const std::string& nodeCounterBlob)
+{
+    int sqlResult = SQLITE_OK;
+    if (!stmt)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?  WHERE nodehandle = ?", -1, &stmt, NULL);
+    }
+
+    if (sqlResult == SQLITE_OK)
+    {
+        if ((sqlResult = sqlite3_bind_blob(stmt, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
+        {
+            if ((sqlResult = sqlite3_bind_int64(
+                     stmt,
+                     2,
+                     static_cast<sqlite3_int64>(nodeHandle.as8byte()))) == SQLITE_OK)
+            {
+                sqlResult = sqlite3_step(stmt);
+            }
+        }
+    }
+
+    sqlite3_reset(stmt);
+
+    return sqlResult;
+}
+
+int updateCounterAndFlags(sqlite3* db,
+                          sqlite3_stmt*& stmt,
+                          NodeHandle nodeHandle,
+                          uint64_t flags,
+                          const std::string& nodeCounterBlob)
+{
+    int sqlResult = SQLITE_OK;
+    if (!stmt)
+    {
+        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?, flags = ? WHERE nodehandle = ?", -1, &stmt, NULL);
+    }
+
+    if (sqlResult == SQLITE_OK)
+    {
+        if ((sqlResult = sqlite3_bind_blob(stmt, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
+        {
+            if ((sqlResult = sqlite3_bind_int64(stmt,
+                                                2,
+                                                static_cast<sqlite3_int64>(flags))) == SQLITE_OK)
+            {
+                if ((sqlResult = sqlite3_bind_int64(
+                         stmt,
+                         3,
+                         static_cast<sqlite3_int64>(nodeHandle.as8byte()))) == SQLITE_OK)
+                {
+                    sqlResult = sqlite3_step(stmt);
+                }
+            }
+        }
+    }
+
+    sqlite3_reset(stmt);
+
+    return sqlResult;
+}
+
+void createNodeIndexes(sqlite3* db, std::atomic<bool>& ancestryIndex)
+{
+    // Create index for column that is not primary key (which already has an index by default)
+    std::string sql =
+        "CREATE INDEX IF NOT EXISTS parenthandleindex on nodes (parenthandle, type, name)";
+    int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (parenthandleindex): " << sqlite3_errmsg(db);
+    }
+
+    sql = "CREATE INDEX IF NOT EXISTS fingerprintindex on nodes (fingerprint)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (fingerprintindex): " << sqlite3_errmsg(db);
+    }
+
+#if defined( __ANDROID__) || defined(USE_IOS)
+    sql = "CREATE INDEX IF NOT EXISTS origFingerprintindex on nodes (origFingerprint)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (origFingerprintindex): " << sqlite3_errmsg(db);
+    }
+#endif
+
+    sql = "CREATE INDEX IF NOT EXISTS shareindex on nodes (share)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (shareindex): " << sqlite3_errmsg(db);
+    }
+
+    sql = "CREATE INDEX IF NOT EXISTS favindex on nodes (fav)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (favindex): " << sqlite3_errmsg(db);
+    }
+
+    sql = "CREATE INDEX IF NOT EXISTS ctimeindex on nodes (type, ctime DESC)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (ctimeindex): " << sqlite3_errmsg(db);
+    }
+
+    if (ancestryIndex)
+    {
+        return;
+    }
+
+    // Populate the ancestry of every node, walking down from those whose parent isn't known, and
+    // index it. From then on, it's kept up to date as nodes are put.
+    // Rows are updated in the order they're stored, which is much faster than in the tree's.
+    sql = "WITH RECURSIVE tree(id, nodehandle, ancestry) "
+          "AS (SELECT N.rowid, N.nodehandle, appendAncestor(NULL, N.parenthandle) FROM nodes AS N "
+          "WHERE NOT EXISTS (SELECT 1 FROM nodes AS P WHERE P.nodehandle = N.parenthandle) "
+          "UNION ALL "
+          "SELECT N.rowid, N.nodehandle, appendAncestor(T.ancestry, T.nodehandle) "
+          "FROM tree AS T INNER JOIN nodes AS N ON N.parenthandle = T.nodehandle) "
+          "UPDATE nodes SET ancestry = T.ancestry "
+          "FROM (SELECT id, ancestry FROM tree ORDER BY id) AS T "
+          "WHERE nodes.rowid = T.id";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while populating ancestry: " << sqlite3_errmsg(db);
+        return;
+    }
+
+    LOG_debug << "Ancestry populated for " << sqlite3_changes(db) << " nodes";
+
+    sql = "CREATE INDEX IF NOT EXISTS ancestryindex on nodes (ancestry)";
+    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if (result)
+    {
+        LOG_err << "Data base error while creating index (ancestryindex): " << sqlite3_errmsg(db);
+        return;
+    }
+
+    ancestryIndex = true;
+}
+
+} // namespace
+
+struct SqliteAccountState::PendingWrites
+{
+    // What's pending for a node: its new row, its removal, or a new counter (and flags)
+    struct NodeWrite
+    {
+        std::optional<NodeRow> row;
+        bool removed = false;
+        std::string counter;
+        std::optional<uint64_t> flags;
+    };
+
+    // truncate()/removeNodes() come before the writes below, as later ones discard earlier writes
+    bool truncateRecords = false;
+    bool removeAllNodes = false;
+
+    // ordered by primary key, which makes for cheaper updates of the tables' b-trees
+    std::map<uint32_t, std::optional<std::string>> records;
+    std::map<NodeHandle, NodeWrite> nodes;
+
+    bool createIndexes = false;
+
+    // writes that were asked for, before coalescing
+    uint64_t issued = 0;
+
+    size_t size() const
+    {
+        return records.size() + nodes.size() + truncateRecords + removeAllNodes + createIndexes;
+    }
+
+    bool empty() const
+    {
+        return !size();
+    }
+
+    void clear()
+    {
+        *this = PendingWrites();
+    }
+
+    void putRecord(uint32_t index, std::string&& content)
+    {
+        records[index] = std::move(content);
+        ++issued;
+    }
+
+    void delRecord(uint32_t index)
+    {
+        records[index].reset();
+        ++issued;
+    }
+
+    void truncate()
+    {
+        records.clear();
+        truncateRecords = true;
+        ++issued;
+    }
+
+    void putNode(NodeRow&& row)
+    {
+        auto& write = nodes[NodeHandle().set6byte(row.nodeHandle)];
+        write = NodeWrite();
+        write.row.emplace(std::move(row));
+        ++issued;
+    }
+
+    void removeNode(NodeHandle nodeHandle)
+    {
+        auto& write = nodes[nodeHandle];
+        write = NodeWrite();
+        write.removed = true;
+        ++issued;
+    }
+
+    void removeNodes()
+    {
+        nodes.clear();
+        removeAllNodes = true;
+        ++issued;
+    }
+
+    void updateCounter(NodeHandle nodeHandle, std::string&& counter, std::optional<uint64_t> flags)
+    {
+        setCounter(nodeHandle, std::move(counter), flags);
+        ++issued;
+    }
+
+    void setCounter(NodeHandle nodeHandle, std::string&& counter, std::optional<uint64_t> flags)
+    {
+        auto it = nodes.find(nodeHandle);
+        if (it == nodes.end())
+        {
+            // nothing to update once every node is removed
+            if (!removeAllNodes)
+            {
+                auto& write = nodes[nodeHandle];
+                write.counter = std::move(counter);
+                write.flags = flags;
+            }
+            return;
+        }
+
+        auto& write = it->second;
+        if (write.row)
+        {
+            write.row->counter = std::move(counter);
+            if (flags)
+            {
+                write.row->flags = *flags;
+            }
+        }
+        else if (!write.removed)
+        {
+            write.counter = std::move(counter);
+            if (flags)
+            {
+                write.flags = flags;
+            }
+        }
+    }
+
+    // Add the writes of a later transaction
+    void merge(PendingWrites&& later)
+    {
+        if (empty())
+        {
+            *this = std::move(later);
+            return;
+        }
+
+        if (later.truncateRecords)
+        {
+            records.clear();
+            truncateRecords = true;
+        }
+
+        for (auto& record : later.records)
+        {
+            records[record.first] = std::move(record.second);
+        }
+
+        if (later.removeAllNodes)
+        {
+            nodes.clear();
+            removeAllNodes = true;
+        }
+
+        for (auto& node : later.nodes)
+        {
+            auto& write = node.second;
+            if (write.row || write.removed)
+            {
+                nodes[node.first] = std::move(write);
+            }
+            else
+            {
+                setCounter(node.first, std::move(write.counter), write.flags);
+            }
+        }
+
+        createIndexes = createIndexes || later.createIndexes;
+        issued += later.issued;
+    }
+
+    // Whether these writes decide the content of a record
+    bool lookupRecord(uint32_t index, std::optional<std::string>& content) const
+    {
+        auto it = records.find(index);
+        if (it != records.end())
+        {
+            content = it->second;
+            return true;
+        }
+
+        return truncateRecords;
+    }
+
+    // Whether these writes decide the content of a node, being older than those already looked up
+    bool lookupNode(NodeHandle nodeHandle, PendingNode& node) const;
+
+    // Write to the DB, stopping at the first error
+    int apply(sqlite3* db,
+              const WriteStatements& statements,
+              bool searchIndex,
+              std::atomic<bool>& ancestryIndex,
+              const char*& operation,
+              bool withIndexes = true) const
+    {
+        int sqlResult = SQLITE_OK;
+
+        if (truncateRecords)
+        {
+            operation = "Truncate";
+            if (failed(sqlResult = sqlite3_exec(db, "DELETE FROM statecache", 0, 0, NULL)))
+            {
+                return sqlResult;
+            }
+        }
+
+        for (auto& record : records)
+        {
+            if (record.second)
+            {
+                operation = "Put record";
+                sqlResult = mega::putRecord(db,
+                                            statements.putRecord,
+                                            record.first,
+                                            record.second->data(),
+                                            record.second->size());
+            }
+            else
+            {
+                operation = "Delete record";
+                sqlResult = mega::delRecord(db, statements.delRecord, record.first);
+            }
+
+            if (failed(sqlResult))
+            {
+                return sqlResult;
+            }
+        }
+
+        if (removeAllNodes)
+        {
+            operation = "Delete nodes";
+            if (failed(sqlResult = deleteNodes(db, searchIndex, ancestryIndex)))
+            {
+                return sqlResult;
+            }
+        }
+
+        for (auto& node : nodes)
+        {
+            auto& write = node.second;
+            if (write.row)
+            {
+                operation = "Put node";
+                sqlResult = mega::putNode(db, statements, *write.row, searchIndex, ancestryIndex);
+            }
+            else if (write.removed)
+            {
+                operation = "Delete node";
+                sqlResult = deleteNode(db, node.first, searchIndex);
+            }
+            else if (write.flags)
+            {
+                operation = "Update counter and flags";
+                sqlResult = mega::updateCounterAndFlags(db,
+                                                        statements.updateCounterAndFlags,
+                                                        node.first,
+                                                        *write.flags,
+                                                        write.counter);
+            }
+            else
+            {
+                operation = "Update counter";
+                sqlResult = mega::updateCounter(db, statements.updateCounter, node.first, write.counter);
+            }
+
+            if (failed(sqlResult))
+            {
+                return sqlResult;
+            }
+        }
+
+        if (createIndexes && withIndexes)
+        {
+            createNodeIndexes(db, ancestryIndex);
+        }
+
+        return SQLITE_OK;
+    }
+}; // PendingWrites
+
+struct SqliteAccountState::PendingNode
+{
+    // whether the row below is all there is to know
+    bool decided = false;
+
+    // the node's row, if decided and the node wasn't removed
+    std::optional<NodeRow> row;
+
+    // newer than those in the row, or the DB
+    std::optional<std::string> counter;
+    std::optional<uint64_t> flags;
+
+    std::string nodeCounter() const
+    {
+        return counter ? *counter : row->counter;
+    }
+
+    uint64_t nodeFlags() const
+    {
+        return flags ? *flags : row->flags;
+    }
+}; // PendingNode
+
+bool SqliteAccountState::PendingWrites::lookupNode(NodeHandle nodeHandle, PendingNode& node) const
+{
+    auto it = nodes.find(nodeHandle);
+    if (it == nodes.end())
+    {
+        return node.decided = removeAllNodes;
+    }
+
+    auto& write = it->second;
+    if (!write.row && !write.removed)
+    {
+        if (!node.counter)
+        {
+            node.counter = write.counter;
+        }
+
+        if (!node.flags)
+        {
+            node.flags = write.flags;
+        }
+
+        return false;
+    }
+
+    node.row = write.row;
+    return node.decided = true;
+}
+
+class SqliteAccountState::StagedWritesOverlay
+{
+public:
+    StagedWritesOverlay(sqlite3* db, std::unique_lock<std::mutex>&& lock, bool ancestryIndex)
+      : ancestryIndex(ancestryIndex)
+      , mDb(db)
+      , mLock(std::move(lock))
+    {
+    }
+
+    ~StagedWritesOverlay()
+    {
+        sqlite3_exec(mDb, "ROLLBACK TO overlay", 0, 0, NULL);
+        sqlite3_exec(mDb, "RELEASE overlay", 0, 0, NULL);
+    }
+
+    // whether the ancestry column is maintained, with the staged writes
+    std::atomic<bool> ancestryIndex;
+
+private:
+    sqlite3* mDb;
+    // on the staged writes, until they're rolled back
+    std::unique_lock<std::mutex> mLock;
+}; // StagedWritesOverlay
+
+class SqliteAccountState::AsyncWriter
+{
+public:
+    AsyncWriter(sqlite3* db,
+                const LocalPath& dbfile,
+                bool searchIndex,
+                std::atomic<bool>& ancestryIndex)
+      : mDb(db)
+      , mDbFile(dbfile)
+      , mSearchIndex(searchIndex)
+      , mAncestryIndex(ancestryIndex)
+      , mThread(&AsyncWriter::loop, this)
+    {
+    }
+
+    // Commits what's pending
+    ~AsyncWriter()
+    {
+        stop(true);
+
+        sqlite3_finalize(mPutRecord);
+        sqlite3_finalize(mDelRecord);
+        sqlite3_finalize(mPutNode);
+        sqlite3_finalize(mPutSearchText);
+        sqlite3_finalize(mChildAncestry);
+        sqlite3_finalize(mUpdateAncestry);
+        sqlite3_finalize(mUpdateCounter);
+        sqlite3_finalize(mUpdateCounterAndFlags);
+
+        sqlite3_close(mDb);
+        LOG_debug << "Database writer closed " << mDbFile;
+    }
+
+    // Hand over the writes of a transaction, to be committed with any still pending
+    void push(PendingWrites&& writes)
+    {
+        if (writes.empty())
+        {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        // don't let pending writes pile up if the disk can't keep up
+        mCommitted.wait(lock,
+                        [this]()
+                        {
+                            return mPending.size() < MAX_PENDING_WRITES || mStopped;
+                        });
+
+        // once writes were lost, the cache is only written again when it's rewritten from scratch
+        if (mRecordsLost)
+        {
+            mRecordsLost = !writes.truncateRecords;
+            if (mRecordsLost)
+            {
+                writes.records.clear();
+            }
+        }
+
+        if (mNodesLost)
+        {
+            mNodesLost = !writes.removeAllNodes;
+            if (mNodesLost)
+            {
+                writes.nodes.clear();
+            }
+        }
+
+        if (writes.empty())
+        {
+            return;
+        }
+
+        mPending.merge(std::move(writes));
+        ++mPushes;
+        mPushed.notify_one();
+    }
+
+    // Wait until everything handed over so far is committed. Not what's handed over meanwhile,
+    // so that other threads can drain while writes keep coming.
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        auto pushes = mPushes;
+
+        ++mDraining;
+        mPushed.notify_one();
+
+        mCommitted.wait(lock,
+                        [this, pushes]()
+                        {
+                            return mCommittedPushes >= pushes || mStopped;
+                        });
+
+        --mDraining;
+    }
+
+    // Stop the thread, committing what's pending only if 'flush'
+    void stop(bool flush)
+    {
+        {
+            std::lock_guard<std::mutex> g(mMutex);
+
+            if (!flush)
+            {
+                mPending.clear();
+            }
+
+            mStop = true;
+        }
+
+        mPushed.notify_one();
+
+        if (mThread.joinable())
+        {
+            mThread.join();
+        }
+    }
+
+    // Call 'lookup' with the writes not committed yet, newest first, until they decide.
+    template<typename Lookup>
+    bool lookup(Lookup&& lookup) const
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+
+        return lookup(mPending) || (mCommitting && lookup(*mCommitting));
+    }
+
+    // The first error that lost writes since the last call, if any
+    int takeError(std::string& operation)
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+
+        operation = std::move(mErrorOperation);
+        return std::exchange(mError, SQLITE_OK);
+    }
+
+    AsyncWriteStats stats() const
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+
+        auto stats = mStats;
+        stats.queued = mPending.size() + (mCommitting ? mCommitting->size() : 0);
+        return stats;
+    }
+
+private:
+    // how long to let writes accumulate before a commit, unless there are plenty or someone waits
+    static constexpr std::chrono::milliseconds GROUP_COMMIT_DELAY{100};
+    static constexpr size_t GROUP_COMMIT_WRITES = 10000;
+
+    // push() blocks beyond this
+    static constexpr size_t MAX_PENDING_WRITES = 200000;
+
+    // a group commit that failed for a reason that may go away is retried, waiting twice as
+    // long each time
+    static constexpr unsigned MAX_COMMIT_RETRIES = 6;
+    static constexpr std::chrono::milliseconds FIRST_COMMIT_RETRY_DELAY{100};
+
+    static bool transient(int sqlResult)
+    {
+        switch (sqlResult & 0xff)
+        {
+            case SQLITE_BUSY:
+            case SQLITE_LOCKED:
+            case SQLITE_IOERR:
+            case SQLITE_FULL:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void loop()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        unsigned retries = 0;
+
+        for (;;)
+        {
+            mPushed.wait(lock,
+                         [this]()
+                         {
+                             return mStop || !mPending.empty();
+                         });
+
+            if (mPending.empty())
+            {
+                break;
+            }
+
+            mPushed.wait_for(lock,
+                             GROUP_COMMIT_DELAY,
+                             [this]()
+                             {
+                                 return mStop || mDraining ||
+                                        mPending.size() >= GROUP_COMMIT_WRITES;
+                             });
+
+            // mCommitting is only replaced with the lock held, so lookups can read it meanwhile
+            mCommitting.reset(new PendingWrites(std::move(mPending)));
+            mPending.clear();
+
+            auto pushes = mPushes;
+
+            lock.unlock();
+
+            auto started = std::chrono::steady_clock::now();
+
+            const char* operation = "";
+            int sqlResult = commit(*mCommitting, operation);
+
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - started);
+
+            dbGroupCommitSeconds.record(elapsed);
+
+            LOG_debug << "DB group commit of " << mCommitting->size() << " rows ("
+                      << mCommitting->issued << " writes) took " << elapsed.count() / 1000
+                      << " ms " << mDbFile;
+
+            lock.lock();
+
+            if (failed(sqlResult) && transient(sqlResult) && retries < MAX_COMMIT_RETRIES)
+            {
+                auto delay = FIRST_COMMIT_RETRY_DELAY * (1 << retries++);
+
+                LOG_warn << "DB group commit failed, retrying in " << delay.count() << " ms "
+                         << mDbFile;
+
+                // ahead of what was pushed meanwhile, which is written along with it
+                mCommitting->merge(std::move(mPending));
+                mPending = std::move(*mCommitting);
+                mCommitting.reset();
+
+                mPushed.wait_for(lock,
+                                 delay,
+                                 [this]()
+                                 {
+                                     return mStop;
+                                 });
+                continue;
+            }
+
+            retries = 0;
+
+            if (failed(sqlResult))
+            {
+                if (mError == SQLITE_OK)
+                {
+                    mError = sqlResult;
+                    mErrorOperation = operation;
+                }
+
+                lose();
+            }
+            else
+            {
+                ++mStats.commits;
+                mStats.writes += mCommitting->issued;
+                mStats.rows += mCommitting->size();
+                mStats.commitTime += elapsed;
+                mStats.maxCommitTime = std::max(mStats.maxCommitTime, elapsed);
+            }
+
+            mCommitting.reset();
+            mCommittedPushes = pushes;
+            mCommitted.notify_all();
+        }
+
+        mStopped = true;
+        mCommitted.notify_all();
+    }
+
+    // The writes being committed are lost, and those pending can't be written on top. Nothing
+    // is written until the cache is rewritten, and meanwhile it's emptied so that it's not
+    // loaded as it is. Unless emptying it is what failed.
+    void lose()
+    {
+        bool discarded = mCommitting->truncateRecords && mCommitting->removeAllNodes;
+
+        LOG_err << "DB writes lost, discarding the cache " << mDbFile;
+
+        mPending.clear();
+        mRecordsLost = true;
+        mNodesLost = true;
+
+        if (!discarded)
+        {
+            mPending.truncate();
+            mPending.removeNodes();
+        }
+    }
+
+    int commit(const PendingWrites& writes, const char*& operation)
+    {
+        WriteStatements statements{mPutRecord,
+                                   mDelRecord,
+                                   mPutNode,
+                                   mPutSearchText,
+                                   mChildAncestry,
+                                   mUpdateAncestry,
+                                   mUpdateCounter,
+                                   mUpdateCounterAndFlags};
+
+        operation = "Begin transaction";
+        int sqlResult = sqlite3_exec(mDb, "BEGIN", 0, 0, NULL);
+
+        if (!failed(sqlResult))
+        {
+            sqlResult = writes.apply(mDb, statements, mSearchIndex, mAncestryIndex, operation);
+        }
+
+        if (!failed(sqlResult))
+        {
+            operation = "Commit transaction";
+            sqlResult = sqlite3_exec(mDb, "COMMIT", 0, 0, NULL);
+        }
+
+        if (failed(sqlResult))
+        {
+            LOG_err << operation << " (group commit): " << mDbFile
+                    << " Error: " << sqlite3_errmsg(mDb);
+
+            if (!sqlite3_get_autocommit(mDb))
+            {
+                sqlite3_exec(mDb, "ROLLBACK", 0, 0, NULL);
+            }
+        }
+
+        return sqlResult;
+    }
+
+    // only used by the thread (and the destructor, once it's gone)
+    sqlite3* mDb;
+    LocalPath mDbFile;
+    const bool mSearchIndex;
+    // shared with the SDK thread, which reads it once writes are drained
+    std::atomic<bool>& mAncestryIndex;
+
+    sqlite3_stmt* mPutRecord = nullptr;
+    sqlite3_stmt* mDelRecord = nullptr;
+    sqlite3_stmt* mPutNode = nullptr;
+    sqlite3_stmt* mPutSearchText = nullptr;
+    sqlite3_stmt* mChildAncestry = nullptr;
+    sqlite3_stmt* mUpdateAncestry = nullptr;
+    sqlite3_stmt* mUpdateCounter = nullptr;
+    sqlite3_stmt* mUpdateCounterAndFlags = nullptr;
+
+    mutable std::mutex mMutex;
+    // writes were pushed, someone is waiting for them, or the thread should stop
+    std::condition_variable mPushed;
+    // a commit finished, or the thread stopped
+    std::condition_variable mCommitted;
+
+    PendingWrites mPending;
+    std::unique_ptr<PendingWrites> mCommitting;
+
+    // how many times writes were pushed, and how many of those are committed (or failed)
+    uint64_t mPushes = 0;
+    uint64_t mCommittedPushes = 0;
+
+    unsigned mDraining = 0;
+    bool mStop = false;
+    bool mStopped = false;
+
+    int mError = SQLITE_OK;
+    std::string mErrorOperation;
+
+    // writes were lost, so pushes are dropped until they truncate the records or remove the nodes
+    bool mRecordsLost = false;
+    bool mNodesLost = false;
+
+    AsyncWriteStats mStats;
+
+    std::thread mThread;
+}; // AsyncWriter
+
+SqliteDbTable::SqliteDbTable(PrnGen &rng, sqlite3* db, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack)
+  : DbTable(rng, checkAlwaysTransacted, dBErrorCallBack)
+  , db(db)
+  , dbfile(path)
+  , fsaccess(&fsAccess)
+{
+}
+
+SqliteDbTable::~SqliteDbTable()
+{
+    resetCommitter();
+
+    if (!db)
+    {
+        return;
+    }
+
+    sqlite3_finalize(pStmt);
+    sqlite3_finalize(mDelStmt);
+    sqlite3_finalize(mPutStmt);
+
+    if (inTransaction())
+    {
+        SqliteDbTable::abort(); // fully qualify virtual function
+    }
+
+    sqlite3_close(db);
+    LOG_debug << "Database closed " << dbfile;
+}
+
+bool SqliteDbTable::inTransaction() const
+{
+    return sqlite3_get_autocommit(db) == 0;
+}
+
+// set cursor to first record
+void SqliteDbTable::rewind()
+{
+    if (!db)
+    {
+        return;
+    }
+
+    int result = SQLITE_OK;
+
+    if (pStmt)
+    {
+        result = sqlite3_reset(pStmt);
+    }
+    else
+    {
+        result = sqlite3_prepare_v2(db, "SELECT id, content FROM statecache", -1, &pStmt, NULL);
+    }
+
+    errorHandler(result, "Rewind", false);
+}
+
+// retrieve next record through cursor
+bool SqliteDbTable::next(uint32_t* index, string* data)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    if (!pStmt)
+    {
+        return false;
+    }
+
+    int rc = sqlite3_step(pStmt);
+
+    if (rc != SQLITE_ROW)
+    {
+        sqlite3_finalize(pStmt);
+        pStmt = NULL;
+
+        errorHandler(rc, "Get next record", false);
+
+        return false;
+    }
+
+    *index = static_cast<uint32_t>(sqlite3_column_int(pStmt, 0));
+
+    data->assign(static_cast<const char*>(sqlite3_column_blob(pStmt, 1)),
+                 static_cast<size_t>(sqlite3_column_bytes(pStmt, 1)));
+
+    return true;
+}
+
+// retrieve record by index
+bool SqliteDbTable::get(uint32_t index, string* data)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    sqlite3_stmt *stmt = nullptr;
+    int rc;
+
+    rc = sqlite3_prepare_v2(db, "SELECT content FROM statecache WHERE id = ?", -1, &stmt, NULL);
+    if (rc == SQLITE_OK)
+    {
+        rc = sqlite3_bind_int(stmt, 1, static_cast<int>(index));
+        if (rc == SQLITE_OK)
+        {
+            rc = sqlite3_step(stmt);
+            if (rc == SQLITE_ROW)
+            {
+                data->assign(static_cast<const char*>(sqlite3_column_blob(stmt, 0)),
+                             static_cast<size_t>(sqlite3_column_bytes(stmt, 0)));
+            }
+        }
+    }
 
-    int sqlResult = SQLITE_OK;
-    if (!mDelStmt)
+    errorHandler(rc, "Get record statecache", false);
+
+    sqlite3_finalize(stmt);
+
+    return rc == SQLITE_ROW;
+}
+
+// add/update record by index
+bool SqliteDbTable::put(uint32_t index, char* data, unsigned len)
+{
+    if (!db)
     {
-        sqlResult = sqlite3_prepare_v2(db, "DELETE FROM statecache WHERE id = ?", -1, &mDelStmt, nullptr);
+        return false;
     }
 
-    if (sqlResult == SQLITE_OK)
+    // First bits at index are reserved for the type
+    assert((index & (DbTable::IDSPACING - 1)) != MegaClient::CACHEDNODE); // nodes must be stored in DbTableNodes ('nodes' table, not 'statecache' table)
+
+    checkTransaction();
+
+    int sqlResult = putRecord(db, mPutStmt, index, data, len);
+
+    errorHandler(sqlResult, "Put record", false);
+
+    return sqlResult == SQLITE_DONE;
+}
+
+
+// delete record by index
+bool SqliteDbTable::del(uint32_t index)
+{
+    if (!db)
     {
-        sqlResult = sqlite3_bind_int(mDelStmt, 1, static_cast<int>(index));
-        if (sqlResult == SQLITE_OK)
-        {
-            sqlResult = sqlite3_step(mDelStmt); // tipically SQLITE_DONE, but could be SQLITE_ROW if implementation returned removed row count
-        }
+        return false;
     }
 
-    errorHandler(sqlResult, "Delete record", false);
+    checkTransaction();
+
+    int sqlResult = delRecord(db, mDelStmt, index);
 
-    sqlite3_reset(mDelStmt);
+    errorHandler(sqlResult, "Delete record", false);
 
     return sqlResult == SQLITE_DONE || sqlResult == SQLITE_ROW;
 }
@@ -869,7 +2261,11 @@ void SqliteDbTable::commit()
 
     LOG_debug << "DB transaction COMMIT " << dbfile;
 
+    auto started = std::chrono::steady_clock::now();
+
     int rc = sqlite3_exec(db, "COMMIT", 0, 0, NULL);
+    dbCommitSeconds.record(std::chrono::steady_clock::now() - started);
+
     errorHandler(rc, "Commit transaction", false);
 }
 
@@ -1023,16 +2419,377 @@ void SqliteDbTable::errorHandler(int sqliteError, const string& operation, bool
     }
 }
 
-SqliteAccountState::SqliteAccountState(PrnGen &rng, sqlite3 *pdb, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack)
+SqliteAccountState::SqliteAccountState(PrnGen &rng, sqlite3 *pdb, FileSystemAccess &fsAccess, const LocalPath &path, const bool checkAlwaysTransacted, DBErrorCallback dBErrorCallBack, const bool searchIndex, sqlite3* writerDb)
     : SqliteDbTable(rng, pdb, fsAccess, path, checkAlwaysTransacted, dBErrorCallBack)
+    , mSearchIndex(searchIndex)
 {
+    // The ancestry index is used if it was created, and every node has its ancestry: versions
+    // that don't maintain it might have written to the database since.
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db,
+                           "SELECT COUNT(*) FROM sqlite_master "
+                           "WHERE type = 'index' AND name = 'ancestryindex'",
+                           -1,
+                           &stmt,
+                           nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0)
+    {
+        sqlite3_finalize(stmt);
+        stmt = nullptr;
+
+        if (sqlite3_prepare_v2(db,
+                               "SELECT NOT EXISTS (SELECT 1 FROM nodes WHERE ancestry IS NULL)",
+                               -1,
+                               &stmt,
+                               nullptr) == SQLITE_OK &&
+            sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            mAncestryIndex = sqlite3_column_int(stmt, 0) != 0;
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    if (writerDb)
+    {
+        LOG_debug << "Database writes are committed asynchronously " << path;
+        mAsyncWriter.reset(new AsyncWriter(writerDb, path, searchIndex, mAncestryIndex));
+    }
 }
 
 SqliteAccountState::~SqliteAccountState()
 {
+    // writes of a transaction left open are discarded, as its rollback would do
+    mStagedWrites.reset();
+    mAsyncWriter.reset();
+
     finalise();
 }
 
+void SqliteAccountState::rewind()
+{
+    // A scan from another thread than the open transaction's sees what's committed: the
+    // transaction's writes can't be kept applied for the duration of the scan.
+    flushWrites();
+
+    SqliteDbTable::rewind();
+}
+
+bool SqliteAccountState::get(uint32_t index, string* data)
+{
+    std::optional<std::string> content;
+    if (lookupPendingRecord(index, content))
+    {
+        if (content)
+        {
+            *data = std::move(*content);
+        }
+
+        return content.has_value();
+    }
+
+    return SqliteDbTable::get(index, data);
+}
+
+bool SqliteAccountState::put(uint32_t index, char* data, unsigned len)
+{
+    // nodes must be stored in DbTableNodes ('nodes' table, not 'statecache' table)
+    assert((index & (DbTable::IDSPACING - 1)) != MegaClient::CACHEDNODE);
+
+    if (!db)
+    {
+        return false;
+    }
+
+    checkTransaction();
+
+    if (queueWrite(
+            [index, data, len](PendingWrites& writes)
+            {
+                writes.putRecord(index, std::string(data, len));
+            }))
+    {
+        return true;
+    }
+
+    return SqliteDbTable::put(index, data, len);
+}
+
+bool SqliteAccountState::del(uint32_t index)
+{
+    if (!db)
+    {
+        return false;
+    }
+
+    checkTransaction();
+
+    if (queueWrite(
+            [index](PendingWrites& writes)
+            {
+                writes.delRecord(index);
+            }))
+    {
+        return true;
+    }
+
+    return SqliteDbTable::del(index);
+}
+
+void SqliteAccountState::truncate()
+{
+    if (!db)
+    {
+        return;
+    }
+
+    checkTransaction();
+
+    if (queueWrite(
+            [](PendingWrites& writes)
+            {
+                writes.truncate();
+            }))
+    {
+        return;
+    }
+
+    SqliteDbTable::truncate();
+}
+
+void SqliteAccountState::begin()
+{
+    if (!db || !mAsyncWriter)
+    {
+        SqliteDbTable::begin();
+        return;
+    }
+
+    std::lock_guard<std::mutex> g(mStagedWritesMutex);
+
+    assert(!mStagedWrites && !inTransaction());
+    LOG_debug << "DB transaction BEGIN (async) " << dbfile;
+    mStagedWrites.reset(new PendingWrites);
+    mTransactionThread = std::this_thread::get_id();
+}
+
+void SqliteAccountState::commit()
+{
+    std::unique_lock<std::mutex> lock(mStagedWritesMutex);
+
+    // not writing asynchronously, or the transaction was finished on this connection
+    if (!mStagedWrites)
+    {
+        lock.unlock();
+        SqliteDbTable::commit();
+        return;
+    }
+
+    LOG_debug << "DB transaction COMMIT (async) " << dbfile;
+    mAsyncWriter->push(std::move(*mStagedWrites));
+    mStagedWrites.reset();
+
+    lock.unlock();
+    reportAsyncErrors();
+}
+
+void SqliteAccountState::abort()
+{
+    std::unique_lock<std::mutex> lock(mStagedWritesMutex);
+
+    if (!mStagedWrites)
+    {
+        lock.unlock();
+        SqliteDbTable::abort();
+        return;
+    }
+
+    LOG_debug << "DB transaction ROLLBACK (async) " << dbfile;
+    mStagedWrites.reset();
+}
+
+bool SqliteAccountState::queueWrite(const std::function<void(PendingWrites&)>& write)
+{
+    if (!mAsyncWriter)
+    {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mStagedWritesMutex);
+
+    // a transaction that had to read its own writes is finished on this connection
+    if (inTransaction())
+    {
+        return false;
+    }
+
+    if (mStagedWrites)
+    {
+        write(*mStagedWrites);
+        return true;
+    }
+
+    // outside of a transaction, writes are committed on their own
+    PendingWrites writes;
+    write(writes);
+    mAsyncWriter->push(std::move(writes));
+
+    lock.unlock();
+    reportAsyncErrors();
+
+    return true;
+}
+
+auto SqliteAccountState::flushWrites() -> std::unique_ptr<StagedWritesOverlay>
+{
+    if (!mAsyncWriter)
+    {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> g(mStagedWritesMutex);
+
+        if (inTransaction())
+        {
+            return nullptr;
+        }
+    }
+
+    // Without the mutex, so that writes queued meanwhile don't wait for a whole group commit.
+    mAsyncWriter->drain();
+    reportAsyncErrors();
+
+    std::unique_lock<std::mutex> lock(mStagedWritesMutex);
+
+    if (!mStagedWrites || mStagedWrites->empty() || inTransaction())
+    {
+        return nullptr;
+    }
+
+    // Only this connection can see the writes of the open transaction before it's committed, so
+    // they're applied to it. Once nothing else is left to commit: the transaction may have been
+    // committed while draining, and a new one begun. With the mutex, so that nothing is pushed
+    // meanwhile, which is quick as nothing's left but those writes.
+    mAsyncWriter->drain();
+
+    WriteStatements statements{mPutStmt,
+                               mDelStmt,
+                               mStmtPutNode,
+                               mStmtPutSearchText,
+                               mStmtChildAncestry,
+                               mStmtUpdateAncestry,
+                               mStmtUpdateNode,
+                               mStmtUpdateNodeAndFlags};
+
+    const char* operation = "";
+
+    if (mTransactionThread == std::this_thread::get_id())
+    {
+        // From here on the transaction is written here, as if there was no writer.
+        LOG_debug << "DB transaction continues synchronously " << dbfile;
+
+        auto staged = std::move(mStagedWrites);
+
+        SqliteDbTable::begin();
+
+        // Its writes are still committed together.
+        int sqlResult = staged->apply(db, statements, mSearchIndex, mAncestryIndex, operation);
+        errorHandler(sqlResult, operation, false);
+
+        return nullptr;
+    }
+
+    // Another thread writes the transaction, and commits or aborts it. Its writes are applied
+    // for as long as the query takes, keeping that thread from writing meanwhile, and rolled back.
+    operation = "Begin overlay";
+    int sqlResult = sqlite3_exec(db, "SAVEPOINT overlay", 0, 0, NULL);
+    if (failed(sqlResult))
+    {
+        errorHandler(sqlResult, operation, false);
+        return nullptr;
+    }
+
+    std::unique_ptr<StagedWritesOverlay> overlay(
+        new StagedWritesOverlay(db, std::move(lock), mAncestryIndex));
+
+    // Indexes aren't worth creating for a query.
+    sqlResult = mStagedWrites->apply(db,
+                                     statements,
+                                     mSearchIndex,
+                                     overlay->ancestryIndex,
+                                     operation,
+                                     false);
+    errorHandler(sqlResult, operation, false);
+
+    return overlay;
+}
+
+bool SqliteAccountState::ancestryIndex(const StagedWritesOverlay* overlay) const
+{
+    return overlay ? overlay->ancestryIndex.load() : mAncestryIndex.load();
+}
+
+bool SqliteAccountState::lookupPendingRecord(uint32_t index, std::optional<std::string>& content)
+{
+    if (!mAsyncWriter)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> g(mStagedWritesMutex);
+
+    if (mStagedWrites && mStagedWrites->lookupRecord(index, content))
+    {
+        return true;
+    }
+
+    return mAsyncWriter->lookup(
+        [index, &content](const PendingWrites& writes)
+        {
+            return writes.lookupRecord(index, content);
+        });
+}
+
+bool SqliteAccountState::lookupPendingNode(NodeHandle nodeHandle, PendingNode& node)
+{
+    if (!mAsyncWriter)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> g(mStagedWritesMutex);
+
+    if (mStagedWrites && mStagedWrites->lookupNode(nodeHandle, node))
+    {
+        return true;
+    }
+
+    return mAsyncWriter->lookup(
+        [nodeHandle, &node](const PendingWrites& writes)
+        {
+            return writes.lookupNode(nodeHandle, node);
+        });
+}
+
+void SqliteAccountState::reportAsyncErrors()
+{
+    std::string operation;
+    if (int sqlResult = mAsyncWriter->takeError(operation))
+    {
+        errorHandler(sqlResult, operation, false);
+
+        if (mDBErrorCallBack)
+        {
+            mDBErrorCallBack(DBError::DB_ERROR_WRITES_LOST);
+        }
+    }
+}
+
+SqliteAccountState::AsyncWriteStats SqliteAccountState::asyncWriteStats() const
+{
+    return mAsyncWriter ? mAsyncWriter->stats() : AsyncWriteStats();
+}
+
 int SqliteAccountState::progressHandler(void *param)
 {
     CancelToken* cancelFlag = static_cast<CancelToken*>(param);
@@ -1083,11 +2840,17 @@ bool SqliteAccountState::remove(NodeHandle nodehandle)
 
     checkTransaction();
 
-    char buf[64];
+    if (queueWrite(
+            [nodehandle](PendingWrites& writes)
+            {
+                writes.removeNode(nodehandle);
+            }))
+    {
+        return true;
+    }
 
-    snprintf(buf, sizeof(buf), "DELETE FROM nodes WHERE nodehandle = %" PRId64, nodehandle.as8byte());
+    int sqlResult = deleteNode(db, nodehandle, mSearchIndex);
 
-    int sqlResult = sqlite3_exec(db, buf, 0, 0, NULL);
     errorHandler(sqlResult, "Delete node", false);
 
     return sqlResult == SQLITE_OK;
@@ -1097,12 +2860,22 @@ bool SqliteAccountState::removeNodes()
 {
     if (!db)
     {
-        return false;
+        return false;
+    }
+
+    checkTransaction();
+
+    if (queueWrite(
+            [](PendingWrites& writes)
+            {
+                writes.removeNodes();
+            }))
+    {
+        return true;
     }
 
-    checkTransaction();
+    int sqlResult = deleteNodes(db, mSearchIndex, mAncestryIndex);
 
-    int sqlResult = sqlite3_exec(db, "DELETE FROM nodes", 0, 0, NULL);
     errorHandler(sqlResult, "Delete nodes", false);
 
     return sqlResult == SQLITE_OK;
@@ -1117,30 +2890,18 @@ void SqliteAccountState::updateCounter(NodeHandle nodeHandle, const std::string&
 
     checkTransaction();
 
-    int sqlResult = SQLITE_OK;
-    if (!mStmtUpdateNode)
+    if (queueWrite(
+            [nodeHandle, &nodeCounterBlob](PendingWrites& writes)
+            {
+                writes.updateCounter(nodeHandle, std::string(nodeCounterBlob), std::nullopt);
+            }))
     {
-        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?  WHERE nodehandle = ?", -1, &mStmtUpdateNode, NULL);
+        return;
     }
 
-    if (sqlResult == SQLITE_OK)
-    {
-        if ((sqlResult = sqlite3_bind_blob(mStmtUpdateNode, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
-        {
-            if ((sqlResult = sqlite3_bind_int64(
-                     mStmtUpdateNode,
-                     2,
-                     static_cast<sqlite3_int64>(nodeHandle.as8byte()))) == SQLITE_OK)
-            {
-                sqlResult = sqlite3_step(mStmtUpdateNode);
-            }
-        }
-
-    }
+    int sqlResult = mega::updateCounter(db, mStmtUpdateNode, nodeHandle, nodeCounterBlob);
 
     errorHandler(sqlResult, "Update counter", false);
-
-    sqlite3_reset(mStmtUpdateNode);
 }
 
 void SqliteAccountState::updateCounterAndFlags(NodeHandle nodeHandle, uint64_t flags, const std::string& nodeCounterBlob)
@@ -1152,34 +2913,19 @@ void SqliteAccountState::updateCounterAndFlags(NodeHandle nodeHandle, uint64_t f
 
     checkTransaction();
 
-    int sqlResult = SQLITE_OK;
-    if (!mStmtUpdateNodeAndFlags)
+    if (queueWrite(
+            [nodeHandle, flags, &nodeCounterBlob](PendingWrites& writes)
+            {
+                writes.updateCounter(nodeHandle, std::string(nodeCounterBlob), flags);
+            }))
     {
-        sqlResult = sqlite3_prepare_v2(db, "UPDATE nodes SET counter = ?, flags = ? WHERE nodehandle = ?", -1, &mStmtUpdateNodeAndFlags, NULL);
+        return;
     }
 
-    if (sqlResult == SQLITE_OK)
-    {
-        if ((sqlResult = sqlite3_bind_blob(mStmtUpdateNodeAndFlags, 1, nodeCounterBlob.data(), static_cast<int>(nodeCounterBlob.size()), SQLITE_STATIC)) == SQLITE_OK)
-        {
-            if ((sqlResult = sqlite3_bind_int64(mStmtUpdateNodeAndFlags,
-                                                2,
-                                                static_cast<sqlite3_int64>(flags))) == SQLITE_OK)
-            {
-                if ((sqlResult = sqlite3_bind_int64(
-                         mStmtUpdateNodeAndFlags,
-                         3,
-                         static_cast<sqlite3_int64>(nodeHandle.as8byte()))) == SQLITE_OK)
-                {
-                    sqlResult = sqlite3_step(mStmtUpdateNodeAndFlags);
-                }
-            }
-        }
-    }
+    int sqlResult =
+        mega::updateCounterAndFlags(db, mStmtUpdateNodeAndFlags, nodeHandle, flags, nodeCounterBlob);
 
     errorHandler(sqlResult, "Update counter and flags", false);
-
-    sqlite3_reset(mStmtUpdateNodeAndFlags);
 }
 
 void SqliteAccountState::createIndexes()
@@ -1189,55 +2935,29 @@ void SqliteAccountState::createIndexes()
         return;
     }
 
-    // Create index for column that is not primary key (which already has an index by default)
-    std::string sql =
-        "CREATE INDEX IF NOT EXISTS parenthandleindex on nodes (parenthandle, type, name)";
-    int result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
-    {
-        LOG_err << "Data base error while creating index (parenthandleindex): " << sqlite3_errmsg(db);
-    }
-
-    sql = "CREATE INDEX IF NOT EXISTS fingerprintindex on nodes (fingerprint)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
-    {
-        LOG_err << "Data base error while creating index (fingerprintindex): " << sqlite3_errmsg(db);
-    }
-
-#if defined( __ANDROID__) || defined(USE_IOS)
-    sql = "CREATE INDEX IF NOT EXISTS origFingerprintindex on nodes (origFingerprint)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
-    {
-        LOG_err << "Data base error while creating index (origFingerprintindex): " << sqlite3_errmsg(db);
-    }
-#endif
-
-    sql = "CREATE INDEX IF NOT EXISTS shareindex on nodes (share)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
-    {
-        LOG_err << "Data base error while creating index (shareindex): " << sqlite3_errmsg(db);
-    }
-
-    sql = "CREATE INDEX IF NOT EXISTS favindex on nodes (fav)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
+    // the writer's connection creates them once it's done with what's pending
+    if (queueWrite(
+            [](PendingWrites& writes)
+            {
+                writes.createIndexes = true;
+            }))
     {
-        LOG_err << "Data base error while creating index (favindex): " << sqlite3_errmsg(db);
+        return;
     }
 
-    sql = "CREATE INDEX IF NOT EXISTS ctimeindex on nodes (type, ctime DESC)";
-    result = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
-    if (result)
-    {
-        LOG_err << "Data base error while creating index (ctimeindex): " << sqlite3_errmsg(db);
-    }
+    createNodeIndexes(db, mAncestryIndex);
 }
 
 void SqliteAccountState::remove()
 {
+    // the database is going away: nothing pending is worth committing
+    if (mAsyncWriter)
+    {
+        mStagedWrites.reset();
+        mAsyncWriter->stop(false);
+        mAsyncWriter.reset();
+    }
+
     finalise();
 
     SqliteDbTable::remove();
@@ -1248,6 +2968,15 @@ void SqliteAccountState::finalise()
     sqlite3_finalize(mStmtPutNode);
     mStmtPutNode = nullptr;
 
+    sqlite3_finalize(mStmtPutSearchText);
+    mStmtPutSearchText = nullptr;
+
+    sqlite3_finalize(mStmtChildAncestry);
+    mStmtChildAncestry = nullptr;
+
+    sqlite3_finalize(mStmtUpdateAncestry);
+    mStmtUpdateAncestry = nullptr;
+
     sqlite3_finalize(mStmtUpdateNode);
     mStmtUpdateNode = nullptr;
 
@@ -1278,9 +3007,18 @@ void SqliteAccountState::finalise()
     }
     mStmtSearchNodes.clear();
 
+    for (auto& s : mStmtSearchNodesByAncestry)
+    {
+        sqlite3_finalize(s.second);
+    }
+    mStmtSearchNodesByAncestry.clear();
+
     sqlite3_finalize(mStmtNodeTagsBelow);
     mStmtNodeTagsBelow = nullptr;
 
+    sqlite3_finalize(mStmtNodeTagsBelowByAncestry);
+    mStmtNodeTagsBelowByAncestry = nullptr;
+
     sqlite3_finalize(mStmtNodesByFp);
     mStmtNodesByFp = nullptr;
 
@@ -1296,6 +3034,9 @@ void SqliteAccountState::finalise()
     sqlite3_finalize(mStmtIsAncestor);
     mStmtIsAncestor = nullptr;
 
+    sqlite3_finalize(mStmtIsAncestorByAncestry);
+    mStmtIsAncestorByAncestry = nullptr;
+
     sqlite3_finalize(mStmtNumChild);
     mStmtNumChild = nullptr;
 
@@ -1315,112 +3056,30 @@ bool SqliteAccountState::put(Node *node)
 
     checkTransaction();
 
-    int sqlResult = SQLITE_OK;
-    if (!mStmtPutNode)
-    {
-        sqlResult =
-            sqlite3_prepare_v2(db,
-                               "INSERT OR REPLACE INTO nodes (nodehandle, parenthandle, "
-                               "name, fingerprint, origFingerprint, type, share, fav, ctime, "
-                               "mtime, flags, counter, node, label, description, tags) "
-                               "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
-                               -1,
-                               &mStmtPutNode,
-                               NULL);
-    }
+    NodeRow row(*node);
 
-    if (sqlResult == SQLITE_OK)
+    if (queueWrite(
+            [&row](PendingWrites& writes)
+            {
+                writes.putNode(std::move(row));
+            }))
     {
-        string nodeSerialized;
-        node->serialize(&nodeSerialized);
-        assert(nodeSerialized.size());
-
-        sqlite3_bind_int64(mStmtPutNode, 1, static_cast<sqlite3_int64>(node->nodehandle));
-        sqlite3_bind_int64(mStmtPutNode, 2, static_cast<sqlite3_int64>(node->parenthandle));
-
-        std::string name = node->displayname(Node::LOG_CONDITION_DISABLE_NO_KEY);
-        sqlite3_bind_text(mStmtPutNode, 3, name.c_str(), static_cast<int>(name.length()), SQLITE_STATIC);
-
-        string fp;
-        node->FileFingerprint::serialize(&fp);
-        sqlite3_bind_blob(mStmtPutNode, 4, fp.data(), static_cast<int>(fp.size()), SQLITE_STATIC);
-
-        std::string origFingerprint;
-        attr_map::const_iterator attrIt = node->attrs.map.find(makeNameid("c0"));
-        if (attrIt != node->attrs.map.end())
-        {
-           origFingerprint = attrIt->second;
-        }
-        sqlite3_bind_blob(mStmtPutNode, 5, origFingerprint.data(), static_cast<int>(origFingerprint.size()), SQLITE_STATIC);
-
-        sqlite3_bind_int(mStmtPutNode, 6, node->type);
-
-        int shareType = node->getShareType();
-        sqlite3_bind_int(mStmtPutNode, 7, shareType);
-
-        // node->attrstring has value => node is encrypted
-        nameid favId = AttrMap::string2nameid("fav");
-        auto favIt = node->attrs.map.find(favId);
-        bool fav = (favIt != node->attrs.map.end() && favIt->second == "1"); // test 'fav' attr value (only "1" is valid)
-        sqlite3_bind_int(mStmtPutNode, 8, fav);
-        sqlite3_bind_int64(mStmtPutNode, 9, node->ctime);
-        sqlite3_bind_int64(mStmtPutNode, 10, node->mtime);
-        sqlite3_bind_int64(mStmtPutNode, 11, static_cast<sqlite3_int64>(node->getDBFlags()));
-        std::string nodeCountersBlob = node->getCounter().serialize();
-        sqlite3_bind_blob(mStmtPutNode,
-                          12,
-                          nodeCountersBlob.data(),
-                          static_cast<int>(nodeCountersBlob.size()),
-                          SQLITE_STATIC);
-        sqlite3_bind_blob(mStmtPutNode,
-                          13,
-                          nodeSerialized.data(),
-                          static_cast<int>(nodeSerialized.size()),
-                          SQLITE_STATIC);
-
-        static nameid labelId = AttrMap::string2nameid("lbl");
-        auto labelIt = node->attrs.map.find(labelId);
-        int label = (labelIt == node->attrs.map.end()) ? LBL_UNKNOWN : std::atoi(labelIt->second.c_str());
-        sqlite3_bind_int(mStmtPutNode, 14, label);
-
-        nameid descriptionId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_DESCRIPTION);
-        if (auto descriptionIt = node->attrs.map.find(descriptionId);
-            descriptionIt != node->attrs.map.end())
-        {
-            const std::string& description = descriptionIt->second;
-            sqlite3_bind_text(mStmtPutNode,
-                              15,
-                              description.c_str(),
-                              static_cast<int>(description.length()),
-                              SQLITE_STATIC);
-        }
-        else
-        {
-            sqlite3_bind_null(mStmtPutNode, 15);
-        }
+        return true;
+    }
 
-        nameid tagId = AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS);
-        if (auto tagIt = node->attrs.map.find(tagId); tagIt != node->attrs.map.end())
-        {
-            const std::string& tag = tagIt->second;
-            sqlite3_bind_text(mStmtPutNode,
-                              16,
-                              tag.c_str(),
-                              static_cast<int>(tag.length()),
-                              SQLITE_STATIC);
-        }
-        else
-        {
-            sqlite3_bind_null(mStmtPutNode, 16);
-        }
+    WriteStatements statements{mPutStmt,
+                               mDelStmt,
+                               mStmtPutNode,
+                               mStmtPutSearchText,
+                               mStmtChildAncestry,
+                               mStmtUpdateAncestry,
+                               mStmtUpdateNode,
+                               mStmtUpdateNodeAndFlags};
 
-        sqlResult = sqlite3_step(mStmtPutNode);
-    }
+    int sqlResult = putNode(db, statements, row, mSearchIndex, mAncestryIndex);
 
     errorHandler(sqlResult, "Put node", false);
 
-    sqlite3_reset(mStmtPutNode);
-
     return sqlResult == SQLITE_DONE;
 }
 
@@ -1434,6 +3093,19 @@ bool SqliteAccountState::getNode(NodeHandle nodehandle, NodeSerialized &nodeSeri
 
     nodeSerialized.mNode.clear();
 
+    PendingNode pending;
+    if (lookupPendingNode(nodehandle, pending))
+    {
+        if (!pending.row)
+        {
+            return false;
+        }
+
+        nodeSerialized.mNodeCounter = pending.nodeCounter();
+        nodeSerialized.mNode = pending.row->node;
+        return true;
+    }
+
     int sqlResult = SQLITE_OK;
     if (!mStmtGetNode)
     {
@@ -1462,6 +3134,11 @@ bool SqliteAccountState::getNode(NodeHandle nodehandle, NodeSerialized &nodeSeri
                     nodeSerialized.mNode.assign(static_cast<const char*>(dataNodeSerialized),
                                                 static_cast<size_t>(sizeNodeSerialized));
                     success = true;
+
+                    if (pending.counter)
+                    {
+                        nodeSerialized.mNodeCounter = *pending.counter;
+                    }
                 }
             }
         }
@@ -1485,6 +3162,8 @@ bool SqliteAccountState::getNodesByOrigFingerprint(const std::string &fingerprin
         return false;
     }
 
+    auto overlay = flushWrites();
+
     int sqlResult = SQLITE_OK;
     if (!mStmtNodeByOrigFp)
     {
@@ -1514,6 +3193,8 @@ bool SqliteAccountState::getRootNodes(std::vector<std::pair<NodeHandle, NodeSeri
         return false;
     }
 
+    auto overlay = flushWrites();
+
     sqlite3_stmt *stmt = nullptr;
     bool result = false;
     int sqlResult = sqlite3_prepare_v2(db, "SELECT nodehandle, counter, node FROM nodes WHERE type >= ? AND type <= ?", -1, &stmt, NULL);
@@ -1542,6 +3223,8 @@ bool SqliteAccountState::getNodesWithSharesOrLink(std::vector<std::pair<NodeHand
         return false;
     }
 
+    auto overlay = flushWrites();
+
     sqlite3_stmt *stmt = nullptr;
     bool result = false;
     int sqlResult = sqlite3_prepare_v2(
@@ -1580,6 +3263,8 @@ uint64_t SqliteAccountState::getNumberOfChildren(NodeHandle parentHandle)
         return false;
     }
 
+    auto overlay = flushWrites();
+
     uint64_t numChildren = 0;
     int sqlResult = SQLITE_OK;
     if (!mStmtNumChildren)
@@ -1689,6 +3374,65 @@ int bindPointer(int& sqlResult, sqlite3_stmt* stmt, int index, void* ptr, const
     }
     return sqlResult;
 }
+
+// FTS5 query requiring every literal run of a likeCompare() pattern to appear in a column
+// Runs shorter than a trigram can't be looked up, so they're left to matchFilter
+std::string searchIndexTerm(const std::string& column, const std::string& pattern)
+{
+    std::string term;
+    std::string run;
+    bool escaped = false;
+
+    auto addRun = [&column, &term, &run]()
+    {
+        auto folded = foldCaseAccent(run);
+        run.clear();
+
+        // count characters, not UTF-8 continuation bytes
+        auto length = std::count_if(folded.begin(),
+                                    folded.end(),
+                                    [](char c)
+                                    {
+                                        return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+                                    });
+        if (length < 3)
+            return;
+
+        std::string phrase;
+        for (auto c : folded)
+        {
+            if (c == '"')
+                phrase.push_back('"');
+            phrase.push_back(c);
+        }
+
+        if (!term.empty())
+            term += " AND ";
+        term += column + " : \"" + phrase + "\"";
+    };
+
+    for (auto c : pattern)
+    {
+        if (!escaped && (c == WILDCARD_MATCH_ALL || c == WILDCARD_MATCH_ONE))
+        {
+            addRun();
+            continue;
+        }
+
+        if (!escaped && c == ESCAPE_CHARACTER)
+        {
+            escaped = true;
+            continue;
+        }
+
+        run.push_back(c);
+        escaped = false;
+    }
+
+    addRun();
+
+    return term;
+}
 }
 
 bool SqliteAccountState::getChildren(const mega::NodeSearchFilter& filter,
@@ -1700,6 +3444,8 @@ bool SqliteAccountState::getChildren(const mega::NodeSearchFilter& filter,
     if (!db)
         return false;
 
+    auto overlay = flushWrites();
+
     if (cancelFlag.exists())
         sqlite3_progress_handler(db,
                                  NUM_VIRTUAL_MACHINE_INSTRUCTIONS,
@@ -1783,9 +3529,17 @@ auto SqliteAccountState::getNodeTagsBelow(CancelToken cancelToken,
     if (!db)
         return failed("Invalid database");
 
+    auto overlay = flushWrites();
+
     // Transmit to global error handler on return.
     auto result = SQLITE_OK;
 
+    // Nodes below a particular node can be found by their ancestry.
+    auto byAncestry = ancestryIndex(overlay.get()) && !handle.isUndef();
+
+    // The statement we'll be using.
+    auto& stmt = byAncestry ? mStmtNodeTagsBelowByAncestry : mStmtNodeTagsBelow;
+
     // Transmits our result to the global error handler on return.
     auto cleanup = makeScopedDestructor(
         [&]()
@@ -1795,7 +3549,7 @@ auto SqliteAccountState::getNodeTagsBelow(CancelToken cancelToken,
             // Transmit result to global error handler.
             errorHandler(result, "Get node tags below", true);
             // Make sure our statement's in a reusable state.
-            sqlite3_reset(mStmtNodeTagsBelow);
+            sqlite3_reset(stmt);
         }); // cleanup
 
     // Caller wants to be able to abort the query.
@@ -1808,7 +3562,47 @@ auto SqliteAccountState::getNodeTagsBelow(CancelToken cancelToken,
     }
 
     // Statement needs to be instantiated.
-    if (!mStmtNodeTagsBelow)
+    if (!stmt && byAncestry)
+    {
+        // This query retrieves all the tags below a particular node by
+        // looking up the range of the ancestry index its descendants are
+        // in: their ancestry starts with the node's, followed by its handle.
+        //
+        // Like the query below, it doesn't descend down file version
+        // chains: every node below a file is flagged as a version.
+        static const std::string tagsBelow =
+            "select n.tags "
+            "  from nodes as n "
+            " where n.nodehandle = ?2 "
+            "   and n.type != 0 "
+            " union all "
+            "select n.tags "
+            "  from nodes as p "
+            " inner join nodes as n "
+            "    on n.ancestry >= appendAncestor(p.ancestry, p.nodehandle) "
+            "   and n.ancestry < appendAncestor(appendAncestor(p.ancestry, p.nodehandle), "
+            + std::to_string(0xFFFFFFFFFFFFLL) + ") "
+            " where p.nodehandle = ?2 "
+            "   and p.type != 0 "
+            "   and n.flags & " + std::to_string(1 << Node::FLAGS_IS_VERSION) + " = 0";
+
+        auto query = "select distinct "
+                     "       tags "
+                     "  from (" + tagsBelow + ") "
+                     " where tags is not null "
+                     "   and tags != '' "
+                     "   and (?3 = 0 or tags regexp ?4)";
+
+        // Try and instantiate our statement.
+        result = sqlite3_prepare_v2(db, query.c_str(), -1, &stmt, nullptr);
+
+        // Couldn't instantiate statement.
+        if (result != SQLITE_OK)
+            return failed("Couldn't prepare query");
+    }
+
+    // Statement needs to be instantiated.
+    if (!stmt)
     {
         // This query retrieves all the tags below some particular node or
         // below all root nodes in the user's account by performing a
@@ -1855,7 +3649,7 @@ auto SqliteAccountState::getNodeTagsBelow(CancelToken cancelToken,
                      "   and (?3 = 0 or tags regexp ?4)";
 
         // Try and instantiate our statement.
-        result = sqlite3_prepare_v2(db, query, -1, &mStmtNodeTagsBelow, nullptr);
+        result = sqlite3_prepare_v2(db, query, -1, &stmt, nullptr);
 
         // Couldn't instantiate statement.
         if (result != SQLITE_OK)
@@ -1872,14 +3666,14 @@ auto SqliteAccountState::getNodeTagsBelow(CancelToken cancelToken,
     }; // ParameterIndex
 
     // Let the query know if we have a search root.
-    result = sqlite3_bind_int64(mStmtNodeTagsBelow, PARAM_HAS_NODE_HANDLE, !handle.isUndef());
+    result = sqlite3_bind_int64(stmt, PARAM_HAS_NODE_HANDLE, !handle.isUndef());
 
     // Couldn't bind parameter.
     if (result != API_OK)
         return couldntBindParameter(PARAM_HAS_NODE_HANDLE);
 
     // Let the query know which node we're searching below.
-    result = sqlite3_bind_int64(mStmtNodeTagsBelow,
+    result = sqlite3_bind_int64(stmt,
                                 PARAM_NODE_HANDLE,
                                 static_cast<std::int64_t>(handle.as8byte()));
 
@@ -1891,14 +3685,14 @@ auto SqliteAccountState::getNodeTagsBelow(CancelToken cancelToken,
     auto effectivePattern = ensureAsteriskSurround(pattern);
 
     // Let the query know if the caller's provided a pattern.
-    result = sqlite3_bind_int(mStmtNodeTagsBelow, PARAM_HAS_PATTERN, !pattern.empty());
+    result = sqlite3_bind_int(stmt, PARAM_HAS_PATTERN, !pattern.empty());
 
     // Couldn't bind parameter.
     if (result != API_OK)
         return couldntBindParameter(PARAM_HAS_PATTERN);
 
     // Let the query know what the pattern is.
-    result = sqlite3_bind_text(mStmtNodeTagsBelow,
+    result = sqlite3_bind_text(stmt,
                                PARAM_PATTERN,
                                effectivePattern.c_str(),
                                static_cast<int>(effectivePattern.size()),
@@ -1914,17 +3708,17 @@ auto SqliteAccountState::getNodeTagsBelow(CancelToken cancelToken,
     while (result != SQLITE_DONE)
     {
         // Try and retrieve a row from the database.
-        result = sqlite3_step(mStmtNodeTagsBelow);
+        result = sqlite3_step(stmt);
 
         // Couldn't get a row from the database.
         if (result != SQLITE_DONE && result != SQLITE_ROW)
             return failed("Couldn't retrieve row from database");
 
         // Get our hands on this node's delimited list of tags.
-        auto* data = reinterpret_cast<const char*>(sqlite3_column_blob(mStmtNodeTagsBelow, 0));
+        auto* data = reinterpret_cast<const char*>(sqlite3_column_blob(stmt, 0));
 
         // How large is the node's delimited list of tags?
-        auto size = static_cast<std::size_t>(sqlite3_column_bytes(mStmtNodeTagsBelow, 0));
+        auto size = static_cast<std::size_t>(sqlite3_column_bytes(stmt, 0));
 
         // Delimited list of tags is null or empty.
         if (!data || !size)
@@ -1962,16 +3756,23 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
     if (!db)
         return false;
 
+    auto overlay = flushWrites();
+
     if (cancelFlag.exists())
         sqlite3_progress_handler(db,
                                  NUM_VIRTUAL_MACHINE_INSTRUCTIONS,
                                  SqliteAccountState::progressHandler,
                                  static_cast<void*>(&cancelFlag));
 
+    // Nodes below the ancestors are found by ranges of the ancestry index, if there is one,
+    // unless those below sensitive nodes are left out, which takes walking down the tree
+    const bool byAncestry = ancestryIndex(overlay.get()) &&
+                            filter.bySensitivity() != NodeSearchFilter::BoolFilter::onlyTrue;
+
     // There are multiple criteria used in ORDER BY clause.
     // For every order type a new statement is created
     size_t cacheId = OrderByClause::getId(order);
-    sqlite3_stmt*& stmt = mStmtSearchNodes[cacheId];
+    sqlite3_stmt*& stmt = (byAncestry ? mStmtSearchNodesByAncestry : mStmtSearchNodes)[cacheId];
 
     static const QueryTagId idVerFlag{1};
     static const QueryTagId idName{2};
@@ -1984,6 +3785,7 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
     static const QueryTagId idSensFlag{9};
     static const QueryTagId idIncShares{10};
     static const QueryTagId idFilter{11};
+    static const QueryTagId idSearchIndex{12};
 
     int sqlResult = SQLITE_OK;
     if (!stmt)
@@ -1994,6 +3796,8 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
         static const std::string onlyTrueStr =
             std::to_string(static_cast<int>(NodeSearchFilter::BoolFilter::onlyTrue));
         static const std::string filenodeStr = std::to_string(FILENODE);
+        // above any handle, as the last byte of an ancestry range
+        static const std::string lastHandleStr = std::to_string(0xFFFFFFFFFFFFLL);
 
         // Columns for the SELECT
         static const std::vector<std::string> columnsForNodeAndFiltersVec = {"nodehandle",
@@ -2067,11 +3871,30 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
                 " AND (P.flags & " + idSensFlag + ") = 0) "
                 "AND P.type != " + filenodeStr + "))";
 
-        static const std::string whereClause =
+        // Same as above, by ranges of ancestry: every node below a file is a version
+        static const std::string nodesByAncestryCTE =
+            "nodesCTE(" + columnsForNodeAndFilters + ") \n"
+            "AS (SELECT " + columnsForNodeAndFiltersPrefixN + " \n"
+                "FROM ancestors AS A \n"
+                "INNER JOIN nodes AS P ON P.nodehandle = A.nodehandle \n"
+                "INNER JOIN nodes AS N \n"
+                "ON N.ancestry >= appendAncestor(P.ancestry, P.nodehandle) \n"
+                "AND N.ancestry < "
+                "appendAncestor(appendAncestor(P.ancestry, P.nodehandle), " + lastHandleStr + ") \n"
+                "WHERE (N.flags & " + idVerFlag + " = 0 OR N.parenthandle = P.nodehandle))";
+
+        static const std::string matchFilterClause =
             "matchFilter("s + idFilter +
             ", flags, type, ctime, mtime, mimetypeVirtual, name, description, tags, fav)";
 
-        static const std::string nodesAfterFilters =
+        // With the search index, text criteria first narrow down candidates by index look-ups
+        // (nodes without a name are always candidates, as matchFilter accepts them by name)
+        const std::string whereClause = !mSearchIndex ? matchFilterClause :
+            "("s + idSearchIndex + " IS NULL OR name IS NULL OR nodehandle IN "
+            "(SELECT rowid FROM nodesearch WHERE nodesearch MATCH " + idSearchIndex + ")) AND " +
+            matchFilterClause;
+
+        const std::string nodesAfterFilters =
             "nodesAfterFilters (" + columnsForNodeAndOrderBy + ") \n"
             "AS (SELECT " + columnsForNodeAndOrderBy + " \n"
                 "FROM nodesOfShares \n"
@@ -2088,7 +3911,7 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
             "WITH \n\n" +
             ancestors + ", \n\n" +
             nodesOfShares + ", \n\n" +
-            nodesCTE + ", \n\n" +
+            (byAncestry ? nodesByAncestryCTE : nodesCTE) + ", \n\n" +
             nodesAfterFilters + "\n\n" +
             "SELECT " + columnsForNodeAndOrderBy + " \n"
             "FROM nodesAfterFilters GROUP BY nodehandle\n" // Avoid duplicates after union of nodesOfShares and nodesCTE
@@ -2120,6 +3943,12 @@ bool SqliteAccountState::searchNodes(const NodeSearchFilter& filter,
     bindValue(sqlResult, stmt, idSens, filter.bySensitivity(), sqlite3_bind_int);
     bindValue(sqlResult, stmt, idSensFlag, senstivityFlag, sqlite3_bind_int64);
 
+    const std::string searchText = mSearchIndex ? searchIndexQuery(filter) : std::string();
+    if (mSearchIndex && searchText.empty() && sqlResult == SQLITE_OK)
+        sqlResult = sqlite3_bind_null(stmt, idSearchIndex);
+    else if (mSearchIndex)
+        bindText(sqlResult, stmt, idSearchIndex, searchText);
+
     const bool result = (sqlResult == SQLITE_OK) && processSqlQueryNodes(stmt, nodes);
 
     // unregister the handler (no-op if not registered)
@@ -2139,6 +3968,8 @@ bool SqliteAccountState::getNodesByFingerprint(const std::string &fingerprint, s
         return false;
     }
 
+    auto overlay = flushWrites();
+
     int sqlResult = SQLITE_OK;
     if (!mStmtNodesByFp)
     {
@@ -2172,6 +4003,8 @@ bool SqliteAccountState::getNodeByFingerprint(const std::string &fingerprint, me
         return false;
     }
 
+    auto overlay = flushWrites();
+
     int sqlResult = SQLITE_OK;
     if (!mStmtNodeByFp)
     {
@@ -2212,6 +4045,8 @@ bool SqliteAccountState::getRecentNodes(const NodeSearchPage& page,
         return false;
     }
 
+    auto overlay = flushWrites();
+
     constexpr uint64_t excludeFlags =
         (1 << Node::FLAGS_IS_VERSION | 1 << Node::FLAGS_IS_IN_RUBBISH);
     static const std::string filenode = std::to_string(FILENODE);
@@ -2256,6 +4091,8 @@ bool SqliteAccountState::getFavouritesHandles(NodeHandle node, uint32_t count, s
         return false;
     }
 
+    auto overlay = flushWrites();
+
     int sqlResult = SQLITE_OK;
     if (!mStmtFavourites)
     {
@@ -2302,6 +4139,8 @@ bool SqliteAccountState::childNodeByNameType(NodeHandle parentHandle, const std:
         return success;
     }
 
+    auto overlay = flushWrites();
+
     std::string sqlQuery = "SELECT nodehandle, counter, node FROM nodes WHERE parenthandle = ? AND name = ? AND type = ? limit 1";
 
     int sqlResult = SQLITE_OK;
@@ -2351,6 +4190,20 @@ bool SqliteAccountState::getNodeSizeTypeAndFlags(NodeHandle node, m_off_t& size,
         return false;
     }
 
+    PendingNode pending;
+    if (lookupPendingNode(node, pending))
+    {
+        if (!pending.row)
+        {
+            return false;
+        }
+
+        nodeType = pending.row->type;
+        size = NodeCounter(pending.nodeCounter()).storage;
+        oldFlags = pending.nodeFlags();
+        return true;
+    }
+
     int sqlResult = SQLITE_OK;
     if (!mStmtTypeAndSizeNode)
     {
@@ -2372,8 +4225,10 @@ bool SqliteAccountState::getNodeSizeTypeAndFlags(NodeHandle node, m_off_t& size,
             if ((sqlResult = sqlite3_step(mStmtTypeAndSizeNode)) == SQLITE_ROW)
             {
                nodeType = (nodetype_t)sqlite3_column_int(mStmtTypeAndSizeNode, 0);
-               size = sqlite3_column_int64(mStmtTypeAndSizeNode, 1);
-               oldFlags = static_cast<uint64_t>(sqlite3_column_int64(mStmtTypeAndSizeNode, 2));
+               size = pending.counter ? NodeCounter(*pending.counter).storage
+                                      : sqlite3_column_int64(mStmtTypeAndSizeNode, 1);
+               oldFlags = pending.flags ? *pending.flags
+                                        : static_cast<uint64_t>(sqlite3_column_int64(mStmtTypeAndSizeNode, 2));
             }
         }
     }
@@ -2396,7 +4251,20 @@ bool SqliteAccountState::isAncestor(NodeHandle node, NodeHandle ancestor, Cancel
         return result;
     }
 
-    std::string sqlQuery = "WITH nodesCTE(nodehandle, parenthandle) "
+    auto overlay = flushWrites();
+
+    // With the ancestry index, two look-ups: whether the node's ancestry starts with the
+    // ancestor's followed by its handle (just its handle, if the ancestor isn't known).
+    // Otherwise, walk up from the node.
+    const bool byAncestry = ancestryIndex(overlay.get());
+    sqlite3_stmt*& stmt = byAncestry ? mStmtIsAncestorByAncestry : mStmtIsAncestor;
+
+    std::string sqlQuery = byAncestry ?
+        "WITH prefix(ancestry) "
+            "AS (SELECT appendAncestor((SELECT ancestry FROM nodes WHERE nodehandle = ?2), ?2)) "
+            "SELECT 1 FROM nodes AS N, prefix AS P WHERE N.nodehandle = ?1 "
+            "AND substr(N.ancestry, 1, length(P.ancestry)) = P.ancestry" :
+        "WITH nodesCTE(nodehandle, parenthandle) "
             "AS (SELECT nodehandle, parenthandle FROM nodes WHERE nodehandle = ? "
             "UNION ALL SELECT A.nodehandle, A.parenthandle FROM nodes AS A INNER JOIN nodesCTE "
             "AS E ON (A.nodehandle = E.parenthandle)) "
@@ -2408,24 +4276,24 @@ bool SqliteAccountState::isAncestor(NodeHandle node, NodeHandle ancestor, Cancel
     }
 
     int sqlResult = SQLITE_OK;
-    if (!mStmtIsAncestor)
+    if (!stmt)
     {
-        sqlResult = sqlite3_prepare_v2(db, sqlQuery.c_str(), -1, &mStmtIsAncestor, NULL);
+        sqlResult = sqlite3_prepare_v2(db, sqlQuery.c_str(), -1, &stmt, NULL);
     }
 
     if (sqlResult == SQLITE_OK)
     {
-        if ((sqlResult = sqlite3_bind_int64(mStmtIsAncestor,
+        if ((sqlResult = sqlite3_bind_int64(stmt,
                                             1,
                                             static_cast<sqlite3_int64>(node.as8byte()))) ==
             SQLITE_OK)
         {
-            if ((sqlResult = sqlite3_bind_int64(mStmtIsAncestor,
+            if ((sqlResult = sqlite3_bind_int64(stmt,
                                                 2,
                                                 static_cast<sqlite3_int64>(ancestor.as8byte()))) ==
                 SQLITE_OK)
             {
-                if ((sqlResult = sqlite3_step(mStmtIsAncestor)) == SQLITE_ROW)
+                if ((sqlResult = sqlite3_step(stmt)) == SQLITE_ROW)
                 {
                     result = true;
                 }
@@ -2441,7 +4309,7 @@ bool SqliteAccountState::isAncestor(NodeHandle node, NodeHandle ancestor, Cancel
         errorHandler(sqlResult, "Is ancestor", true);
     }
 
-    sqlite3_reset(mStmtIsAncestor);
+    sqlite3_reset(stmt);
 
     return result;
 }
@@ -2454,6 +4322,8 @@ uint64_t SqliteAccountState::getNumberOfNodes()
         return count;
     }
 
+    auto overlay = flushWrites();
+
     sqlite3_stmt *stmt = nullptr;
     int sqlResult = sqlite3_prepare_v2(db, "SELECT count(*) FROM nodes", -1, &stmt, NULL);
     if (sqlResult == SQLITE_OK)
@@ -2482,6 +4352,8 @@ uint64_t SqliteAccountState::getNumberOfChildrenByType(NodeHandle parentHandle,
         return count;
     }
 
+    auto overlay = flushWrites();
+
     int sqlResult = SQLITE_OK;
     if (!mStmtNumChild)
     {
@@ -2576,6 +4448,93 @@ void SqliteAccountState::userGetMimetype(sqlite3_context* context, int argc, sql
     sqlite3_result_int(context, result);
 }
 
+void SqliteAccountState::userFoldSearchText(sqlite3_context* context, int argc, sqlite3_value** argv)
+{
+    if (argc != 1)
+    {
+        LOG_err << "Invalid parameters for userFoldSearchText";
+        assert(false);
+        sqlite3_result_null(context);
+        return;
+    }
+
+    auto text = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+    if (!text)
+    {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    std::string folded = foldCaseAccent(text);
+    sqlite3_result_text(context,
+                        folded.c_str(),
+                        static_cast<int>(folded.size()),
+                        SQLITE_TRANSIENT);
+}
+
+void SqliteAccountState::userAppendAncestor(sqlite3_context* context, int argc, sqlite3_value** argv)
+{
+    if (argc != 2)
+    {
+        LOG_err << "Invalid parameters for userAppendAncestor";
+        assert(false);
+        sqlite3_result_null(context);
+        return;
+    }
+
+    std::string ancestry;
+    if (auto blob = sqlite3_value_blob(argv[0]))
+    {
+        ancestry.assign(static_cast<const char*>(blob),
+                        static_cast<size_t>(sqlite3_value_bytes(argv[0])));
+    }
+
+    auto h = static_cast<handle>(sqlite3_value_int64(argv[1]));
+    if (sqlite3_value_type(argv[1]) != SQLITE_NULL && h != UNDEF)
+    {
+        // big-endian, so that ancestries sort (and can be looked up by ranges) by prefix
+        for (int shift = 40; shift >= 0; shift -= 8)
+        {
+            ancestry.push_back(static_cast<char>(h >> shift));
+        }
+    }
+
+    sqlite3_result_blob(context,
+                        ancestry.data(),
+                        static_cast<int>(ancestry.size()),
+                        SQLITE_TRANSIENT);
+}
+
+std::string SqliteAccountState::searchIndexQuery(const NodeSearchFilter& filter)
+{
+    std::vector<std::string> terms;
+    bool unindexed = false;
+
+    auto addTerm = [&terms, &unindexed](bool present, const char* column, const std::string& text)
+    {
+        if (!present)
+            return;
+
+        auto term = searchIndexTerm(column, text);
+        if (term.empty())
+            unindexed = true;
+        else
+            terms.emplace_back("(" + term + ")");
+    };
+
+    addTerm(filter.hasName(), "name", filter.byName());
+    addTerm(filter.hasDescription(), "description", filter.byDescription());
+    addTerm(filter.hasTag(), "tags", filter.byTag());
+
+    // When criteria are ORed, one the index can't narrow down may match any node
+    if (terms.empty() || (unindexed && !filter.useAndForTextQuery()))
+        return {};
+
+    return joinStrings(terms.begin(),
+                       terms.end(),
+                       filter.useAndForTextQuery() ? " AND " : " OR ");
+}
+
 void SqliteAccountState::userMatchFilter(sqlite3_context* context, int argc, sqlite3_value** argv)
 {
     bool result = false;
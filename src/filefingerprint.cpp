@@ -29,6 +29,85 @@ namespace
 {
 constexpr int MAXFULL = 8192;
 
+// Threads that help FileFingerprint::genfingerprints(), started the first time they're needed and
+// kept until the process exits, so scanning a directory doesn't create and join threads.
+class FingerprintHelpers
+{
+public:
+    using Task = std::function<void()>;
+
+    ~FingerprintHelpers()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            mExiting = true;
+        }
+
+        mNotifier.notify_all();
+
+        for (auto& thread: mThreads)
+        {
+            thread.join();
+        }
+    }
+
+    // Queues `count` copies of task, to run on up to `count` threads at once.
+    void queue(const Task& task, unsigned count)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+
+            while (mThreads.size() < count)
+            {
+                mThreads.emplace_back(&FingerprintHelpers::loop, this);
+            }
+
+            mTasks.insert(mTasks.end(), count, task);
+        }
+
+        mNotifier.notify_all();
+    }
+
+    static FingerprintHelpers& instance()
+    {
+        static FingerprintHelpers helpers;
+        return helpers;
+    }
+
+private:
+    void loop()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+
+        while (true)
+        {
+            mNotifier.wait(lock,
+                           [this]()
+                           {
+                               return mExiting || !mTasks.empty();
+                           });
+
+            if (mExiting)
+            {
+                return;
+            }
+
+            auto task = std::move(mTasks.front());
+            mTasks.pop_front();
+
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mNotifier;
+    std::deque<Task> mTasks;
+    std::vector<std::thread> mThreads;
+    bool mExiting = false;
+}; // FingerprintHelpers
+
 } // anonymous
 
 namespace mega {
@@ -241,6 +320,81 @@ bool FileFingerprint::genfingerprint(FileAccess* fa, bool ignoremtime)
     return changed;
 }
 
+size_t FileFingerprint::genfingerprints(const std::vector<FileFingerprint*>& fingerprints,
+                                        const std::function<std::unique_ptr<InputStreamAccess>(size_t)>& open,
+                                        unsigned threads)
+{
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> generated{0};
+
+    auto worker = [&]()
+    {
+        for (size_t i; (i = next++) < fingerprints.size(); )
+        {
+            if (auto stream = open(i))
+            {
+                fingerprints[i]->genfingerprint(stream.get(), fingerprints[i]->mtime);
+                ++generated;
+            }
+        }
+    };
+
+    threads = static_cast<unsigned>(std::min<size_t>(std::max(threads, 1u), fingerprints.size()));
+
+    if (threads < 2)
+    {
+        worker();
+        return generated;
+    }
+
+    // Helpers that start after the calling thread is done find nothing to do, and don't touch
+    // this call's state: only those that are running when it's done are waited for.
+    struct Helping
+    {
+        std::mutex mutex;
+        std::condition_variable notifier;
+        unsigned running = 0;
+        bool done = false;
+    };
+
+    auto helping = std::make_shared<Helping>();
+    auto helperWork = &worker;
+
+    FingerprintHelpers::instance().queue(
+        [helping, helperWork]()
+        {
+            {
+                std::lock_guard<std::mutex> guard(helping->mutex);
+
+                if (helping->done)
+                    return;
+
+                ++helping->running;
+            }
+
+            (*helperWork)();
+
+            std::lock_guard<std::mutex> guard(helping->mutex);
+
+            if (!--helping->running)
+                helping->notifier.notify_all();
+        },
+        threads - 1);
+
+    // the calling thread is one of the workers
+    worker();
+
+    std::unique_lock<std::mutex> lock(helping->mutex);
+    helping->done = true;
+    helping->notifier.wait(lock,
+                           [&helping]()
+                           {
+                               return !helping->running;
+                           });
+
+    return generated;
+}
+
 bool FileFingerprint::genfingerprint(InputStreamAccess *is, m_time_t cmtime, bool ignoremtime)
 {
     bool changed = false;
@@ -389,6 +389,76 @@ int compareUtf(const LocalPath& s1, bool unescaping1, const LocalPath& s2, bool
                               caseInsensitive ? Utils::toUpper : detail::identity);
 }
 
+CollationKey::CollationKey(const string& name, bool unescaping, bool caseInsensitive)
+  : mName(&name)
+  , mUnescaping(unescaping)
+  , mCaseInsensitive(caseInsensitive)
+{
+    // Whether an escape is decoded depends on what it's compared with.
+    if (unescaping && name.find(static_cast<char>(detail::escapeChar)) != string::npos)
+    {
+        mExact = true;
+        return;
+    }
+
+    auto it = unicodeCodepointIterator(name);
+
+#ifdef _WIN32
+    auto start = detail::skipPrefix(it);
+
+    mCopied = start != it;
+    it = start;
+#endif // _WIN32
+
+    mCopied = mCopied || caseInsensitive;
+
+    if (mCopied)
+    {
+        mFolded.reserve(name.size());
+    }
+
+    while (!it.end())
+    {
+        auto c = it.get();
+
+        // Not valid UTF-8.
+        if (c < 0)
+        {
+            mFolded.clear();
+            mExact = true;
+            return;
+        }
+
+        if (!mCopied)
+        {
+            continue;
+        }
+
+        utf8proc_uint8_t encoded[4];
+        auto length = utf8proc_encode_char(caseInsensitive ? Utils::toUpper(c) : c, encoded);
+
+        mFolded.append(reinterpret_cast<const char*>(encoded), static_cast<size_t>(length));
+    }
+}
+
+int CollationKey::compare(const CollationKey& other) const
+{
+    assert(mCaseInsensitive == other.mCaseInsensitive);
+
+    if (mExact || other.mExact)
+    {
+        return compareUtf(*mName, mUnescaping, *other.mName, other.mUnescaping, mCaseInsensitive);
+    }
+
+    // Otherwise, compareUtf() amounts to comparing the folded code points.
+    return folded().compare(other.folded());
+}
+
+std::string_view CollationKey::folded() const
+{
+    return mCopied ? std::string_view(mFolded) : std::string_view(*mName);
+}
+
 RemotePath::RemotePath(const string& path)
   : mPath(path)
 {
@@ -1655,7 +1725,9 @@ bool isNetworkFilesystem(FileSystemType type)
 
 std::atomic<size_t> ScanService::mNumServices(0);
 std::unique_ptr<ScanService::Worker> ScanService::mWorker;
+size_t ScanService::mNumThreads = ScanService::DEFAULT_THREADS;
 std::mutex ScanService::mWorkerLock;
+std::mutex ScanService::mStatsLock;
 
 ScanService::ScanService()
 {
@@ -1665,7 +1737,7 @@ ScanService::ScanService()
 
     if (++mNumServices == 1)
     {
-        mWorker.reset(new Worker());
+        mWorker.reset(new Worker(mNumThreads));
     }
 }
 
@@ -1684,11 +1756,45 @@ auto ScanService::queueScan(LocalPath targetPath, handle expectedFsid, bool foll
     auto request = std::make_shared<ScanRequest>(std::move(waiter), followSymlinks, targetPath, expectedFsid, std::move(priorScanChildren));
 
     // Queue request for processing.
-    mWorker->queue(request);
+    {
+        std::lock_guard<std::mutex> lock(mWorkerLock);
+        mWorker->queue(request);
+    }
 
     return request;
 }
 
+size_t ScanService::numThreads()
+{
+    std::lock_guard<std::mutex> lock(mWorkerLock);
+    return mNumThreads;
+}
+
+void ScanService::setNumThreads(size_t numThreads)
+{
+    numThreads = std::clamp<size_t>(numThreads, 1, MAX_THREADS);
+
+    // Destroyed outside the lock, as it waits for the scans queued to it.
+    std::unique_ptr<Worker> previous;
+
+    {
+        std::lock_guard<std::mutex> lock(mWorkerLock);
+
+        if (numThreads == mNumThreads)
+            return;
+
+        LOG_debug << "ScanService threads: " << mNumThreads << " -> " << numThreads;
+
+        mNumThreads = numThreads;
+
+        if (mWorker)
+        {
+            previous = std::move(mWorker);
+            mWorker.reset(new Worker(numThreads));
+        }
+    }
+}
+
 ScanService::ScanRequest::ScanRequest(shared_ptr<Waiter> waiter,
     bool followSymLinks,
     LocalPath targetPath,
@@ -1807,9 +1913,12 @@ void ScanService::Worker::loop()
 
         if (result == SCAN_SUCCESS)
         {
+            auto elapsed = duration_cast<microseconds>(scanEnd - scanStart).count();
+
             LOG_verbose << "Directory scan complete for: " << request->mTargetPath
                 << " entries: " << request->mResults.size()
-                << " taking " << duration_cast<milliseconds>(scanEnd - scanStart).count() << "ms"
+                << " taking " << elapsed / 1000 << "ms"
+                << " (" << (request->mResults.size() * 1000000 / static_cast<size_t>(std::max<decltype(elapsed)>(elapsed, 1))) << " entries/s)"
                 << " fingerprinted: " << nFingerprinted;
         }
         else
@@ -1822,13 +1931,12 @@ void ScanService::Worker::loop()
     }
 }
 
-// Really we only have one worker despite the vector of threads - maybe we should just have one
-// regardless of multiple clients too - there is only one filesystem after all (but not singleton!!)
+// One worker, shared by all clients - there is only one filesystem after all (but not singleton!!)
 CodeCounter::ScopeStats ScanService::syncScanTime = { "folderScan" };
 
 auto ScanService::Worker::scan(ScanRequestPtr request, unsigned& nFingerprinted) -> ScanResult
 {
-    CodeCounter::ScopeTimer rst(syncScanTime);
+    auto started = std::chrono::high_resolution_clock::now();
 
     auto result = mFsAccess->directoryScan(request->mTargetPath,
         request->mExpectedFsid,
@@ -1840,6 +1948,14 @@ auto ScanService::Worker::scan(ScanRequestPtr request, unsigned& nFingerprinted)
     // No need to keep this data around anymore.
     request->mKnown.clear();
 
+    {
+        // Several threads may be scanning.
+        std::lock_guard<std::mutex> lock(mStatsLock);
+
+        syncScanTime.add(std::chrono::high_resolution_clock::now() - started,
+                         request->mResults.size());
+    }
+
     return result;
 }
 
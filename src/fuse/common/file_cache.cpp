@@ -29,6 +29,10 @@ static LocalPath cachePath(const Client& client);
 
 static void ensureCachePathExists(Client& client, const LocalPath& path);
 
+static LocalPath partialCachePath(const LocalPath& cachePath);
+
+static void removeFiles(Client& client, LocalPath path);
+
 ErrorOr<FileInfoRef> FileCache::create(const FileExtension& extension,
                                        const LocalPath& path,
                                        InodeID id,
@@ -155,11 +159,16 @@ FileCache::FileCache(platform::ServiceContext& context)
   , mInfoByID()
   , mRemoved()
   , mCachePath(cachePath(context.client()))
+  , mPartialPath(partialCachePath(mCachePath))
   , mContext(context)
 {
     FUSEDebug1("File Cache constructed");
 
     ensureCachePathExists(client(), mCachePath);
+    ensureCachePathExists(client(), mPartialPath);
+
+    // Content fetched by partial reads never outlives the cache.
+    removeFiles(client(), mPartialPath);
 }
 
 FileCache::~FileCache()
@@ -411,6 +420,15 @@ LocalPath FileCache::path(const FileExtension& extension, InodeID id) const
     return path;
 }
 
+LocalPath FileCache::partialPath(InodeID id) const
+{
+    auto path = mPartialPath;
+
+    path.appendWithSeparator(LocalPath::fromRelativePath(toFileName(id)), false);
+
+    return path;
+}
+
 void FileCache::remove(const FileExtension& extension, InodeID id)
 {
     // Sanity.
@@ -444,6 +462,43 @@ LocalPath cachePath(const Client& client)
     return path;
 }
 
+LocalPath partialCachePath(const LocalPath& cachePath)
+{
+    auto path = cachePath;
+
+    path.appendWithSeparator(LocalPath::fromRelativePath("partial"), false);
+
+    return path;
+}
+
+void removeFiles(Client& client, LocalPath path)
+{
+    auto& fsAccess = client.fsAccess();
+    auto dirAccess = fsAccess.newdiraccess();
+
+    // Try and open the directory for iteration.
+    if (!dirAccess->dopen(&path, nullptr, false))
+        return;
+
+    LocalPath name;
+    nodetype_t type;
+
+    // Iterate over each file in the directory.
+    while (dirAccess->dnext(path, name, false, &type))
+    {
+        // Entry isn't a file.
+        if (type != FILENODE)
+            continue;
+
+        LocalPath filePath{path};
+        filePath.appendWithSeparator(name, true);
+
+        // Try and remove the file.
+        if (!fsAccess.unlinklocal(filePath))
+            FUSEWarningF("Couldn't remove stale file: %s", filePath.toPath(false).c_str());
+    }
+}
+
 void ensureCachePathExists(Client& client, const LocalPath& path)
 {
     auto& fsAccess = client.fsAccess();
@@ -15,11 +15,14 @@
 #include <mega/fuse/platform/mount.h>
 #include <mega/fuse/platform/service_context.h>
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <condition_variable>
 #include <future>
+#include <memory>
 #include <utility>
+#include <vector>
 
 namespace mega
 {
@@ -100,6 +103,93 @@ public:
     Error result() const;
 }; // FlushContext
 
+class FileIOContext::PartialContext
+  : public std::enable_shared_from_this<PartialContext>
+{
+    // Describes the state of an individual block.
+    enum BlockState : std::uint8_t
+    {
+        // Block's content hasn't been fetched.
+        BS_ABSENT,
+        // Block's content is being fetched.
+        BS_PENDING,
+        // Block's content is present on disk.
+        BS_PRESENT
+    }; // BlockState
+
+    // Describes a contiguous run of blocks: [begin, end)
+    using BlockRange = std::pair<std::size_t, std::size_t>;
+    using BlockRangeVector = std::vector<BlockRange>;
+
+    // Which block contains the specified offset?
+    std::size_t block(m_off_t offset) const;
+
+    // Mark absent blocks in [begin, end) as pending.
+    //
+    // Each contiguous run of blocks marked pending is added to ranges.
+    void claim(BlockRangeVector& ranges,
+               std::size_t begin,
+               std::size_t end);
+
+    // Ask the client to fetch the specified runs of blocks.
+    void fetch(const BlockRangeVector& ranges);
+
+    // Called when a run of blocks has been fetched from the cloud.
+    void fetched(BlockRange range, ErrorOr<std::string> result);
+
+    // Where does the specified block begin?
+    m_off_t offset(std::size_t block) const;
+
+    // How large is each block?
+    const m_off_t mBlockSize;
+
+    // The state of each block in the file.
+    std::vector<BlockState> mBlocks;
+
+    // Signalled when a run of blocks has been fetched.
+    std::condition_variable mCV;
+
+    // The client we'll use to fetch content from the cloud.
+    Client& mClient;
+
+    // How we manipulate the file containing fetched blocks.
+    FileAccessSharedPtr mFileAccess;
+
+    // Where is the file containing fetched blocks?
+    const LocalPath mFilePath;
+
+    // What node's content are we fetching?
+    const NodeHandle mHandle;
+
+    // The block immediately following the last block read.
+    std::size_t mNextBlock;
+
+    // Serializes access to instance members.
+    std::mutex mLock;
+
+    // How many blocks should we fetch ahead of a sequential reader?
+    const std::size_t mReadAheadBlocks;
+
+    // How large is the file's content?
+    const m_off_t mSize;
+
+public:
+    PartialContext(Client& client,
+                   FileAccessSharedPtr fileAccess,
+                   LocalPath filePath,
+                   NodeHandle handle,
+                   const ServiceFlags& flags,
+                   m_off_t size);
+
+    ~PartialContext();
+
+    // What node's content is this context fetching?
+    NodeHandle handle() const;
+
+    // Read data from the file, fetching it from the cloud as necessary.
+    ErrorOr<std::string> read(m_off_t offset, unsigned int size);
+}; // PartialContext
+
 ErrorOr<FileAccessSharedPtr> FileIOContext::create()
 {
     // Sanity.
@@ -387,6 +477,12 @@ auto FileIOContext::open([[maybe_unused]] FileIOContextLock& lock, const Mount&
     // Inode has no local file.
     if (!mFileInfo)
     {
+        // Any content fetched by partial reads will be superseded.
+        {
+            std::lock_guard<std::mutex> guard(mPartialLock);
+            mPartialContext.reset();
+        }
+
         // Don't download a file just to truncate it.
         if (!hint)
             return create();
@@ -446,6 +542,63 @@ auto FileIOContext::open(FileIOContextSharedLock& shared,
     return result;
 }
 
+auto FileIOContext::partialContext([[maybe_unused]] FileIOContextSharedLock& lock)
+  -> PartialContextPtr
+{
+    // Sanity.
+    assert(lock.owns_lock());
+
+    // What flags is the service using?
+    auto flags = mFileCache.mContext.serviceFlags();
+
+    // Partial reads have been disabled.
+    if (!flags.mPartialReadBlockSize)
+        return nullptr;
+
+    // File has local content.
+    if (mFileInfo || !mFileAccess.expired())
+        return nullptr;
+
+    // What node does this file represent?
+    auto handle = mFile->handle();
+
+    // File has no content in the cloud.
+    if (handle.isUndef() || mFile->removed())
+        return nullptr;
+
+    // Make sure no one else is touching our partial context.
+    std::lock_guard<std::mutex> guard(mPartialLock);
+
+    // Context exists and describes the file's current content.
+    if (mPartialContext && mPartialContext->handle() == handle)
+        return mPartialContext;
+
+    // Convenience.
+    auto& client = mFileCache.client();
+
+    // Where should we store the content we fetch?
+    auto path = mFileCache.partialPath(mFile->id());
+
+    FileAccessSharedPtr fileAccess = client.fsAccess().newfileaccess(false);
+
+    // Couldn't create a file to contain the content we fetch.
+    //
+    // The caller will fall back to downloading the entire file.
+    if (!fileAccess->fopen(path, true, true, FSLogging::logOnError))
+        return nullptr;
+
+    // Instantiate a new context.
+    mPartialContext = std::make_shared<PartialContext>(client,
+                                                       std::move(fileAccess),
+                                                       std::move(path),
+                                                       handle,
+                                                       flags,
+                                                       mFile->info().mSize);
+
+    // Return context to caller.
+    return mPartialContext;
+}
+
 FileIOContext::FileIOContext(FileCache& cache,
                              FileInodeRef file,
                              FileInfoRef info,
@@ -459,6 +612,8 @@ FileIOContext::FileIOContext(FileCache& cache,
   , mFlushContext()
   , mFlushLock()
   , mFlushNeeded(modified)
+  , mPartialContext()
+  , mPartialLock()
   , mPeriodicFlushTask()
   , mReferences(0u)
 {
@@ -608,6 +763,10 @@ ErrorOr<std::string> FileIOContext::read(const Mount& mount,
     // Make sure nothing else is touching this file.
     FileIOContextSharedLock guard(*this);
 
+    // Serve the read by fetching only the content we need.
+    if (auto context = partialContext(guard))
+        return context->read(offset, size);
+
     // Make sure the file's present and open.
     auto result = open(guard, mount);
 
@@ -1012,6 +1171,237 @@ Error FileIOContext::FlushContext::result() const
     return mUpload->result();
 }
 
+std::size_t FileIOContext::PartialContext::block(m_off_t offset) const
+{
+    return static_cast<std::size_t>(offset / mBlockSize);
+}
+
+void FileIOContext::PartialContext::claim(BlockRangeVector& ranges,
+                                          std::size_t begin,
+                                          std::size_t end)
+{
+    // Sanity.
+    assert(begin <= end);
+    assert(end <= mBlocks.size());
+
+    while (begin < end)
+    {
+        // Skip blocks that are present or being fetched.
+        if (mBlocks[begin] != BS_ABSENT)
+        {
+            ++begin;
+            continue;
+        }
+
+        // Find the end of this run of absent blocks.
+        auto last = begin;
+
+        while (last < end && mBlocks[last] == BS_ABSENT)
+            mBlocks[last++] = BS_PENDING;
+
+        // Remember that this run needs to be fetched.
+        ranges.emplace_back(begin, last);
+
+        begin = last;
+    }
+}
+
+void FileIOContext::PartialContext::fetch(const BlockRangeVector& ranges)
+{
+    for (auto& range : ranges)
+    {
+        // Convenience.
+        auto begin = offset(range.first);
+        auto end = std::min(offset(range.second), mSize);
+
+        // Called when the run's content has been fetched.
+        auto fetched = std::bind(&PartialContext::fetched,
+                                 shared_from_this(),
+                                 range,
+                                 std::placeholders::_1);
+
+        // Ask the client to fetch the run's content.
+        mClient.partialDownload(std::move(fetched),
+                                mHandle,
+                                begin,
+                                end - begin);
+    }
+}
+
+void FileIOContext::PartialContext::fetched(BlockRange range,
+                                            ErrorOr<std::string> result)
+{
+    // Make sure no one else is touching our blocks.
+    std::lock_guard<std::mutex> guard(mLock);
+
+    // Assume we couldn't fetch the run's content.
+    auto state = BS_ABSENT;
+
+    // Convenience.
+    auto begin = offset(range.first);
+    auto end = std::min(offset(range.second), mSize);
+
+    if (!result)
+    {
+        FUSEWarningF("Couldn't fetch content of %s: %d",
+                     toNodeHandle(mHandle).c_str(),
+                     static_cast<int>(result.error()));
+    }
+    else if (static_cast<m_off_t>(result->size()) != end - begin)
+    {
+        FUSEWarningF("Fetched content of %s has an unexpected size: %zu",
+                     toNodeHandle(mHandle).c_str(),
+                     result->size());
+    }
+    else if (!mFileAccess->fwrite(reinterpret_cast<const byte*>(result->data()),
+                                  static_cast<unsigned int>(result->size()),
+                                  begin))
+    {
+        FUSEWarningF("Couldn't store fetched content of %s",
+                     toNodeHandle(mHandle).c_str());
+    }
+    else
+    {
+        // Run's content is now present on disk.
+        state = BS_PRESENT;
+    }
+
+    // Update the state of each block in the run.
+    std::fill(mBlocks.begin() + static_cast<std::ptrdiff_t>(range.first),
+              mBlocks.begin() + static_cast<std::ptrdiff_t>(range.second),
+              state);
+
+    // Let any waiting readers know the run's been fetched.
+    mCV.notify_all();
+}
+
+m_off_t FileIOContext::PartialContext::offset(std::size_t block) const
+{
+    return static_cast<m_off_t>(block) * mBlockSize;
+}
+
+FileIOContext::PartialContext::PartialContext(Client& client,
+                                              FileAccessSharedPtr fileAccess,
+                                              LocalPath filePath,
+                                              NodeHandle handle,
+                                              const ServiceFlags& flags,
+                                              m_off_t size)
+  : enable_shared_from_this()
+  , mBlockSize(static_cast<m_off_t>(flags.mPartialReadBlockSize))
+  , mBlocks()
+  , mCV()
+  , mClient(client)
+  , mFileAccess(std::move(fileAccess))
+  , mFilePath(std::move(filePath))
+  , mHandle(handle)
+  , mNextBlock(0u)
+  , mLock()
+  , mReadAheadBlocks(flags.mPartialReadAheadBlocks)
+  , mSize(size)
+{
+    // Sanity.
+    assert(mBlockSize > 0);
+    assert(mFileAccess);
+    assert(!mFilePath.empty());
+    assert(!mHandle.isUndef());
+    assert(mSize >= 0);
+
+    // Initially, no blocks are present.
+    mBlocks.resize(block(mSize + mBlockSize - 1), BS_ABSENT);
+
+    FUSEDebugF("Partial context constructed: %s",
+               toNodeHandle(mHandle).c_str());
+}
+
+FileIOContext::PartialContext::~PartialContext()
+{
+    // Close the file so that it can be removed.
+    mFileAccess.reset();
+
+    // Content fetched by partial reads is never retained.
+    if (!mClient.fsAccess().unlinklocal(mFilePath))
+        FUSEWarningF("Couldn't remove partial content: %s",
+                     mFilePath.toPath(false).c_str());
+
+    FUSEDebugF("Partial context destroyed: %s",
+               toNodeHandle(mHandle).c_str());
+}
+
+NodeHandle FileIOContext::PartialContext::handle() const
+{
+    return mHandle;
+}
+
+ErrorOr<std::string> FileIOContext::PartialContext::read(m_off_t offset,
+                                                         unsigned int size)
+{
+    // Clamp offset.
+    offset = std::min(offset, mSize);
+
+    // Clamp size.
+    size = static_cast<unsigned int>(std::min<m_off_t>(mSize - offset, size));
+
+    // No data available for reading.
+    if (!size)
+        return std::string();
+
+    // What blocks contain the data we need to read?
+    auto begin = block(offset);
+    auto end = block(offset + size - 1) + 1;
+
+    // Make sure no one else is touching our blocks.
+    std::unique_lock<std::mutex> lock(mLock);
+
+    BlockRangeVector ranges;
+
+    // Make sure the blocks we need are being fetched.
+    claim(ranges, begin, end);
+
+    // Reader appears to be sequential so fetch a few blocks ahead.
+    if (begin == mNextBlock || begin + 1 == mNextBlock)
+        claim(ranges, end, std::min(end + mReadAheadBlocks, mBlocks.size()));
+
+    mNextBlock = end;
+
+    // Fetch any blocks we've claimed.
+    //
+    // The lock is released as the client may call us back immediately.
+    if (!ranges.empty())
+    {
+        lock.unlock();
+        fetch(ranges);
+        lock.lock();
+    }
+
+    // Convenience.
+    auto first = mBlocks.begin() + static_cast<std::ptrdiff_t>(begin);
+    auto last = mBlocks.begin() + static_cast<std::ptrdiff_t>(end);
+
+    // Wait for our blocks to be fetched.
+    mCV.wait(lock, [&]() {
+        return std::none_of(first, last, [](BlockState state) {
+            return state == BS_PENDING;
+        });
+    });
+
+    // Couldn't fetch one or more of our blocks.
+    if (std::any_of(first, last, [](BlockState state) { return state != BS_PRESENT; }))
+        return unexpected(API_EREAD);
+
+    std::string buffer;
+
+    // Couldn't read the data from disk.
+    if (!mFileAccess->fread(&buffer,
+                            size,
+                            0,
+                            offset,
+                            FSLogging::logOnError))
+        return unexpected(API_EREAD);
+
+    // Return data to caller.
+    return buffer;
+}
+
 } // fuse
 } // mega
 
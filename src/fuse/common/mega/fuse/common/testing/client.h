@@ -16,6 +16,7 @@
 #include <mega/fuse/common/mount_flags_forward.h>
 #include <mega/fuse/common/mount_info_forward.h>
 #include <mega/fuse/common/mount_result_forward.h>
+#include <mega/fuse/common/service_flags_forward.h>
 #include <mega/fuse/common/service_forward.h>
 #include <mega/fuse/common/testing/client_forward.h>
 #include <mega/fuse/common/testing/cloud_path_forward.h>
@@ -260,6 +261,12 @@ public:
     // Retrieve the handle of the root node.
     virtual NodeHandle rootHandle() const = 0;
 
+    // Update the service's flags.
+    void serviceFlags(const ServiceFlags& flags);
+
+    // Retrieve the service's flags.
+    ServiceFlags serviceFlags() const;
+
     // Retrieve this user's session token.
     virtual std::string sessionToken() const = 0;
 
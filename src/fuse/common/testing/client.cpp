@@ -571,6 +571,16 @@ Error Client::replace(CloudPath source,
     return client().replace(sourceHandle, targetHandle);
 }
 
+void Client::serviceFlags(const ServiceFlags& flags)
+{
+    service().serviceFlags(flags);
+}
+
+ServiceFlags Client::serviceFlags() const
+{
+    return service().serviceFlags();
+}
+
 ErrorOr<StorageInfo> Client::storageInfo()
 {
     return client().storageInfo();
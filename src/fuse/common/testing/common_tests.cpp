@@ -6,6 +6,7 @@
 #include <mega/fuse/common/mount_event_type.h>
 #include <mega/fuse/common/mount_info.h>
 #include <mega/fuse/common/mount_result.h>
+#include <mega/fuse/common/service_flags.h>
 #include <mega/fuse/common/testing/client.h>
 #include <mega/fuse/common/testing/cloud_path.h>
 #include <mega/fuse/common/testing/file.h>
@@ -14,6 +15,7 @@
 #include <mega/fuse/common/testing/test_base.h>
 #include <mega/fuse/common/testing/utility.h>
 #include <mega/fuse/platform/platform.h>
+#include <mega/scoped_helpers.h>
 
 #include "megafs.h"
 
@@ -364,6 +366,33 @@ TEST_F(FUSECommonTests, file_cache_load)
     std::filebuf x;
 }
 
+TEST_F(FUSECommonTests, partial_read_does_not_cache)
+{
+    // Latch the service's current flags so we can restore them later.
+    auto flags = ClientW()->serviceFlags();
+
+    // Make sure the flags are restored even if the test fails.
+    auto restore = makeScopedDestructor([&]() {
+        ClientW()->serviceFlags(flags);
+    });
+
+    // Enable partial reads.
+    auto partialFlags = flags;
+
+    partialFlags.mPartialReadAheadBlocks = 1;
+    partialFlags.mPartialReadBlockSize = 2;
+
+    ClientW()->serviceFlags(partialFlags);
+
+    ASSERT_FALSE(ClientW()->isCached(MountPathW() / "sf0"));
+
+    // Read the file's content in its entirety.
+    ASSERT_EQ(readFile(MountPathW() / "sf0"), "sf0");
+
+    // The file's content should not have been added to the cache.
+    ASSERT_FALSE(ClientW()->isCached(MountPathW() / "sf0"));
+}
+
 TEST_F(FUSECommonTests, reload)
 {
     // Create a new client so not to interfere with future tests.
@@ -140,44 +140,38 @@ std::vector<GfxDimension> GfxProc::getJobDimensions(GfxJob *job)
 
 void GfxProc::loop()
 {
-    GfxJob *job = NULL;
-    while (!finished)
+    for (;;)
     {
-        waiter.init(NEVER);
-        waiter.wait();
-        while ((job = requests.pop()) != nullptr)
+        GfxJob *job = NULL;
+
         {
-            if (finished)
+            std::unique_lock<std::mutex> g(requestsMutex);
+            requestsPushed.wait(g, [this, &job]()
             {
-                delete job;
-                break;
-            }
-
-            LOG_debug << "Processing media file: " << job->h;
+                return finished || (job = requests.pop()) != nullptr;
+            });
+        }
 
-            auto images = generateImages(job->localfilename, getJobDimensions(job));
-            for (auto& image : images)
+        if (finished)
+        {
+            // the destructor discards what is left
+            if (job)
             {
-                job->images.push_back(image.empty() ? nullptr : new string(std::move(image)));
+                requests.push(job);
             }
-
-            responses.push(job);
-            client->waiter->notify();
+            break;
         }
-    }
 
-    while ((job = requests.pop()) != nullptr)
-    {
-        delete job;
-    }
+        LOG_debug << "Processing media file: " << job->h;
 
-    while ((job = responses.pop()) != nullptr)
-    {
-        for (unsigned i = 0; i < job->imagetypes.size(); i++)
+        auto images = generateImages(job->localfilename, getJobDimensions(job));
+        for (auto& image : images)
         {
-            delete job->images[i];
+            job->images.push_back(image.empty() ? nullptr : new string(std::move(image)));
         }
-        delete job;
+
+        responses.push(job);
+        client->waiter->notify();
     }
 }
 
@@ -240,6 +234,7 @@ int GfxProc::checkevents(Waiter *)
             needexec = true;
         }
         delete job;
+        --mPendingJobs;
     }
 
     return needexec ? Waiter::NEEDEXEC : 0;
@@ -358,20 +353,35 @@ int GfxProc::gendimensionsputfa(const LocalPath& localfilename, NodeOrUploadHand
         return 0;
     }
 
-    requests.push(job);
-    waiter.notify();
+    {
+        std::lock_guard<std::mutex> g(requestsMutex);
+        requests.push(job);
+    }
+    requestsPushed.notify_one();
+
+    LOG_debug << "Media files pending: " << ++mPendingJobs;
+
     return generatingAttrs;
 }
 
 std::vector<std::string> GfxProc::generateImages(const LocalPath& localfilepath, const std::vector<GfxDimension>& dimensions)
 {
-    std::lock_guard<std::mutex> g(mutex);
+    // providers with a concurrency are thread safe
+    std::unique_lock<std::mutex> g(mutex, std::defer_lock);
+    if (mConcurrency == 1)
+    {
+        g.lock();
+    }
     return mGfxProvider->generateImages(localfilepath, dimensions);
 }
 
 std::string GfxProc::generateOneImage(const LocalPath& localfilepath, const GfxDimension& dimension)
 {
-    std::lock_guard<std::mutex> g(mutex);
+    std::unique_lock<std::mutex> g(mutex, std::defer_lock);
+    if (mConcurrency == 1)
+    {
+        g.lock();
+    }
     auto images = mGfxProvider->generateImages(localfilepath, std::vector<GfxDimension>{ dimension });
     return images[0];
 }
@@ -410,22 +420,49 @@ bool GfxProc::savefa(const LocalPath& localfilepath,
 GfxProc::GfxProc(std::unique_ptr<IGfxProvider> middleware)
     : mGfxProvider(std::move(middleware))
 {
+    if (mGfxProvider)
+    {
+        mConcurrency = std::max<size_t>(1, mGfxProvider->concurrency());
+    }
 }
 
 void GfxProc::startProcessingThread()
 {
-    thread.start(threadEntryPoint, this);
+    for (size_t i = 0; i < mConcurrency; ++i)
+    {
+        threads.emplace_back(new THREAD_CLASS);
+        threads.back()->start(threadEntryPoint, this);
+    }
     threadstarted = true;
 }
 
 GfxProc::~GfxProc()
 {
-    finished = true;
-    waiter.notify();
+    {
+        std::lock_guard<std::mutex> g(requestsMutex);
+        finished = true;
+    }
+    requestsPushed.notify_all();
+
     assert(threadstarted);
-    if (threadstarted)
+    for (auto& thread : threads)
+    {
+        thread->join();
+    }
+
+    GfxJob *job = NULL;
+    while ((job = requests.pop()) != nullptr)
+    {
+        delete job;
+    }
+
+    while ((job = responses.pop()) != nullptr)
     {
-        thread.join();
+        for (unsigned i = 0; i < job->images.size(); i++)
+        {
+            delete job->images[i];
+        }
+        delete job;
     }
 }
 
@@ -441,6 +478,12 @@ void GfxJobQueue::push(GfxJob *job)
     mutex.unlock();
 }
 
+size_t GfxJobQueue::size()
+{
+    std::lock_guard<std::mutex> g(mutex);
+    return jobs.size();
+}
+
 GfxJob *GfxJobQueue::pop()
 {
     mutex.lock();
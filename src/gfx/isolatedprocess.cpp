@@ -85,14 +85,55 @@ const char* GfxProviderIsolatedProcess::Formats::videoformats() const
     return (mIsValid && !mVideoformats.empty()) ? mVideoformats.c_str() : nullptr;
 }
 
+GfxProcessPool::GfxProcessPool(size_t size)
+    : mBusy(std::max<size_t>(1, size))
+{
+}
+
+std::pair<size_t, ScopedDestructor> GfxProcessPool::acquire()
+{
+    std::unique_lock<std::mutex> l(mMutex);
+
+    for (;;)
+    {
+        for (size_t i = 0; i < mBusy.size(); ++i)
+        {
+            auto index = (mNext + i) % mBusy.size();
+            if (!mBusy[index])
+            {
+                mBusy[index] = true;
+                mNext = index + 1;
+                return {index, makeScopedDestructor([this, index]() { release(index); })};
+            }
+        }
+
+        mReleased.wait(l);
+    }
+}
+
+void GfxProcessPool::release(size_t index)
+{
+    {
+        std::lock_guard<std::mutex> l(mMutex);
+        mBusy[index] = false;
+    }
+
+    mReleased.notify_one();
+}
+
 std::unique_ptr<GfxProviderIsolatedProcess>
-    GfxProviderIsolatedProcess::create(const GfxIsolatedProcess::Params& params)
+    GfxProviderIsolatedProcess::create(const GfxIsolatedProcess::Params& params, size_t processCount)
 {
     if (!params.isValid())
         return nullptr;
 
-    auto process = std::make_unique<GfxIsolatedProcess>(params);
-    return std::make_unique<GfxProviderIsolatedProcess>(std::move(process));
+    std::vector<std::unique_ptr<GfxIsolatedProcess>> processes;
+    for (size_t i = 0; i < std::max<size_t>(1, processCount); ++i)
+    {
+        processes.emplace_back(std::make_unique<GfxIsolatedProcess>(params.forPoolMember(i)));
+    }
+
+    return std::make_unique<GfxProviderIsolatedProcess>(std::move(processes));
 }
 
 void GfxProviderIsolatedProcess::Formats::setOnce(const std::string& formats, const std::string& videoformats)
@@ -106,10 +147,22 @@ void GfxProviderIsolatedProcess::Formats::setOnce(const std::string& formats, co
 }
 
 GfxProviderIsolatedProcess::GfxProviderIsolatedProcess(std::unique_ptr<GfxIsolatedProcess> process)
-    : mProcess(std::move(process))
-    , mEndpointName(mProcess->endpointName())
+    : mPool(1)
+{
+    assert(process);
+    mProcesses.emplace_back(std::move(process));
+    mEndpointNames.emplace_back(mProcesses.back()->endpointName());
+}
+
+GfxProviderIsolatedProcess::GfxProviderIsolatedProcess(std::vector<std::unique_ptr<GfxIsolatedProcess>> processes)
+    : mProcesses(std::move(processes))
+    , mPool(mProcesses.size())
 {
-    assert(mProcess);
+    assert(!mProcesses.empty());
+    for (auto& process : mProcesses)
+    {
+        mEndpointNames.emplace_back(process->endpointName());
+    }
 }
 
 std::vector<std::string> GfxProviderIsolatedProcess::generateImages(
@@ -119,12 +172,19 @@ std::vector<std::string> GfxProviderIsolatedProcess::generateImages(
     // default return
     std::vector<std::string> images(dimensions.size());
 
-    auto gfxclient = GfxClient::create(mEndpointName);
+    // all the dimensions are done in one request, so the file is decoded only once
+    auto process = mPool.acquire();
+    auto gfxclient = GfxClient::create(mEndpointNames[process.first]);
     gfxclient.runGfxTask(localfilepath.toPath(false), dimensions, images);
 
     return images;
 }
 
+size_t GfxProviderIsolatedProcess::concurrency()
+{
+    return mProcesses.size();
+}
+
 const char* GfxProviderIsolatedProcess::supportedformats()
 {
     return getformats(&Formats::formats);
@@ -145,7 +205,7 @@ const char* GfxProviderIsolatedProcess::getformats(const char* (Formats::*format
 
     // do fetching
     std::string formats, videoformats;
-    if (!GfxClient::create(mEndpointName).runSupportFormats(formats, videoformats))
+    if (!GfxClient::create(mEndpointNames.front()).runSupportFormats(formats, videoformats))
     {
         return nullptr;
     }
@@ -361,6 +421,18 @@ std::vector<std::string> GfxIsolatedProcess::Params::toArgs() const
     return commandArgs;
 }
 
+GfxIsolatedProcess::Params GfxIsolatedProcess::Params::forPoolMember(size_t index) const
+{
+    Params params{*this};
+
+    if (index)
+    {
+        params.endpointName += "_" + std::to_string(index);
+    }
+
+    return params;
+}
+
 // We divide keepAliveInSeconds by three to set up mBeater so that it allows at least two
 // beats within the keep-alive period.
 GfxIsolatedProcess::GfxIsolatedProcess(const Params& params):
@@ -634,30 +634,25 @@ bool EncryptByChunks::encrypt(m_off_t pos, m_off_t npos, string& urlSuffix)
     m_off_t finalpos = npos;
     m_off_t endpos = ChunkedHash::chunkceil(startpos, finalpos);
     m_off_t chunksize = endpos - startpos;
+    vector<chunkmac_map::CtrChunk> chunks;
     while (chunksize)
     {
         buf = nextbuffer(unsigned(chunksize));
         if (!buf) return false;
 
-        // The chunk is fully encrypted but finished==false for now,
-        // we only set finished after confirmation of the chunk uploading.
-        macs->ctr_encrypt(startpos,
-                          key,
-                          buf,
-                          unsigned(chunksize),
-                          startpos,
-                          static_cast<int64_t>(ctriv),
-                          false);
+        chunks.push_back({startpos, buf, unsigned(chunksize), startpos});
 
-        LOG_debug << "Encrypted chunk: " << startpos << " - " << endpos << "   Size: " << chunksize;
-
-        updateCRC(buf, unsigned(chunksize), unsigned(startpos - pos));
+        if (!keepsBuffers() || chunks.size() == SymmCipher::CTR_LANES)
+        {
+            encryptChunks(chunks, pos);
+        }
 
         startpos = endpos;
         endpos = ChunkedHash::chunkceil(startpos, finalpos);
         chunksize = endpos - startpos;
     }
     assert(endpos == finalpos);
+    encryptChunks(chunks, pos);
     buf = nextbuffer(0);   // last call in case caller does buffer post-processing (such as write to file as we go)
 
     ostringstream s;
@@ -667,6 +662,27 @@ bool EncryptByChunks::encrypt(m_off_t pos, m_off_t npos, string& urlSuffix)
     return !!buf;
 }
 
+void EncryptByChunks::encryptChunks(vector<chunkmac_map::CtrChunk>& chunks, m_off_t pos)
+{
+    if (chunks.empty())
+    {
+        return;
+    }
+
+    // The chunks are fully encrypted but finished==false for now,
+    // we only set finished after confirmation of the chunk uploading.
+    macs->ctr_encrypt(chunks, key, static_cast<int64_t>(ctriv), false);
+
+    for (auto& c : chunks)
+    {
+        LOG_debug << "Encrypted chunk: " << c.startpos << " - " << c.startpos + c.chunksize << "   Size: " << c.chunksize;
+
+        updateCRC(c.chunkstart, c.chunksize, unsigned(c.startpos - pos));
+    }
+
+    chunks.clear();
+}
+
 
 EncryptBufferByChunks::EncryptBufferByChunks(byte* b, SymmCipher* k, chunkmac_map* m, uint64_t iv)
     : EncryptByChunks(k, m, iv)
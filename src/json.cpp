@@ -27,19 +27,200 @@
 #include "mega/logging.h"
 #include "mega/mega_utf8proc.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MEGA_JSON_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MEGA_JSON_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Block loads may read past the end of the buffer, though never past the aligned block
+// holding its terminator, which is what keeps them from touching an unmapped page.
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 8)
+#define MEGA_JSON_BLOCK_LOADS __attribute__((no_sanitize("address", "thread")))
+#elif defined(_MSC_VER) && defined(__SANITIZE_ADDRESS__)
+#define MEGA_JSON_BLOCK_LOADS __declspec(no_sanitize_address)
+#else
+#define MEGA_JSON_BLOCK_LOADS
+#endif
+
 namespace mega {
 
 std::atomic<bool> gLogJSONRequests{false};
 
 #define JSON_verbose if (gLogJSONRequests) LOG_verbose
 
+namespace
+{
+
+const char* stringEndScalar(const char* p)
+{
+    for (;; ++p)
+    {
+        if (*p == '"' || !*p)
+            return p;
+
+        if (*p == '\\' && !*++p)
+            return p;
+    }
+}
+
+unsigned lowestBit(uint64_t mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+
+    if (_BitScanForward(&index, static_cast<unsigned long>(mask)))
+        return static_cast<unsigned>(index);
+
+    _BitScanForward(&index, static_cast<unsigned long>(mask >> 32));
+    return static_cast<unsigned>(index) + 32;
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+// Classifies a whole aligned block at a time: Ops::specials() has SCALE bits set
+// for each quote, backslash or null character in the block.
+template<typename Ops>
+MEGA_JSON_BLOCK_LOADS
+const char* stringEndBlocks(const char* p)
+{
+    for (;;)
+    {
+        auto offset = static_cast<unsigned>(reinterpret_cast<uintptr_t>(p) % Ops::WIDTH);
+        auto* block = p - offset;
+        auto mask = Ops::specials(block) >> (offset * Ops::SCALE);
+
+        while (!mask)
+        {
+            block += Ops::WIDTH;
+            offset = 0;
+            mask = Ops::specials(block);
+        }
+
+        p = block + offset + lowestBit(mask) / Ops::SCALE;
+
+        if (*p != '\\')
+            return p;
+
+        // Escaped character: carry on after it.
+        if (!*++p)
+            return p;
+
+        ++p;
+    }
+}
+
+#if MEGA_JSON_SSE2
+struct SSE2Ops
+{
+    static const unsigned WIDTH = 16;
+    static const unsigned SCALE = 1;
+
+    MEGA_JSON_BLOCK_LOADS
+    static uint64_t specials(const char* block)
+    {
+        auto v = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+
+        auto found = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                               _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                                  _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+
+        return static_cast<unsigned>(_mm_movemask_epi8(found));
+    }
+};
+#endif // MEGA_JSON_SSE2
+
+#if MEGA_JSON_NEON
+struct NEONOps
+{
+    static const unsigned WIDTH = 16;
+
+    // There's no movemask: narrowing the comparison leaves four bits per byte.
+    static const unsigned SCALE = 4;
+
+    MEGA_JSON_BLOCK_LOADS
+    static uint64_t specials(const char* block)
+    {
+        auto v = vld1q_u8(reinterpret_cast<const uint8_t*>(block));
+
+        auto found = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')),
+                                       vceqq_u8(v, vdupq_n_u8('\\'))),
+                              vceqq_u8(v, vdupq_n_u8(0)));
+
+        auto narrowed = vshrn_n_u16(vreinterpretq_u16_u8(found), 4);
+
+        return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+    }
+};
+#endif // MEGA_JSON_NEON
+
+const JSONKernels scalarKernels = {
+    "scalar",
+    stringEndScalar
+};
+
+#if MEGA_JSON_SSE2
+const JSONKernels sse2Kernels = {
+    "sse2",
+    stringEndBlocks<SSE2Ops>
+};
+#endif // MEGA_JSON_SSE2
+
+#if MEGA_JSON_NEON
+const JSONKernels neonKernels = {
+    "neon",
+    stringEndBlocks<NEONOps>
+};
+#endif // MEGA_JSON_NEON
+
+bool isnumberchar(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == 'e' || c == 'E' || c == '.';
+}
+
+} // namespace
+
+const std::vector<const JSONKernels*>& JSONKernels::available()
+{
+    static const std::vector<const JSONKernels*> kernels = []() {
+        std::vector<const JSONKernels*> result = {&scalarKernels};
+
+#if MEGA_JSON_SSE2
+        result.emplace_back(&sse2Kernels);
+#endif // MEGA_JSON_SSE2
+
+#if MEGA_JSON_NEON
+        result.emplace_back(&neonKernels);
+#endif // MEGA_JSON_NEON
+
+        return result;
+    }();
+
+    return kernels;
+}
+
+const JSONKernels& JSONKernels::best()
+{
+    static const JSONKernels& kernels = *available().back();
+
+    return kernels;
+}
+
 // store array or object in string s
 // reposition after object
 bool JSON::storeobject(string* s)
 {
     int openobject[2] = { 0 };
     const char* ptr;
-    bool escaped = false;
 
     while (*(const signed char*)pos > 0 && *pos <= ' ')
     {
@@ -74,13 +255,7 @@ bool JSON::storeobject(string* s)
         }
         else if (*ptr == '"')
         {
-            ptr++;
-
-            while (*ptr && (escaped || *ptr != '"'))
-            {
-                escaped = *ptr == '\\' && !escaped;
-                ptr++;
-            }
+            ptr = JSONKernels::best().stringEnd(ptr + 1);
 
             if (!*ptr)
             {
@@ -1445,28 +1620,20 @@ bool JSONSplitter::isStarting()
 
 int JSONSplitter::strEnd()
 {
-    const char* ptr = mPos;
-    while ((ptr = strchr(ptr + 1, '"')) != nullptr)
-    {
-        const char *e = ptr;
-        while (*(--e) == '\\')
-        {
-            // noop
-        }
+    const char* ptr = JSONKernels::best().stringEnd(mPos + 1);
 
-        if ((ptr - e) & 1)
-        {
-            return int(ptr + 1 - mPos);
-        }
+    if (!*ptr)
+    {
+        return -1;
     }
 
-    return -1;
+    return int(ptr + 1 - mPos);
 }
 
 int JSONSplitter::numEnd()
 {
     const char* ptr = mPos;
-    while (*ptr && strchr("0123456789-+eE.", *ptr))
+    while (isnumberchar(*ptr))
     {
         ptr++;
     }
@@ -24,7 +24,12 @@
 
 #include "mega/logging.h"
 
+#include "mega/metrics.h"
+
+#include <algorithm>
+#include <condition_variable>
 #include <ctime>
+#include <thread>
 
 namespace mega {
 
@@ -38,10 +43,9 @@ std::atomic<LogLevel> SimpleLogger::logCurrentLevel{logInfo};
 long long SimpleLogger::maxPayloadLogSize  = 10240;
 
 #ifndef ENABLE_LOG_PERFORMANCE
-std::string SimpleLogger::getTime()
+static std::string formatTime(time_t currentTime)
 {
     char ts[50];
-    time_t currentTime = std::time(NULL);
     std::tm tm{};
 
 #ifdef WIN32
@@ -54,6 +58,682 @@ std::string SimpleLogger::getTime()
 
     return {};
 }
+
+std::string SimpleLogger::getTime()
+{
+    return formatTime(std::time(NULL));
+}
+
+std::atomic<bool> SimpleLogger::asyncOutput{false};
+
+// Formats messages encoded by SimpleLogger as they would have been formatted
+// synchronously, and calls the output class.
+class AsyncLogFormatter
+{
+public:
+    void output(const char* record, size_t size);
+
+private:
+    template<typename T>
+    static T read(const char*& data)
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(value));
+        data += sizeof(value);
+        return value;
+    }
+
+    std::ostringstream mMessage;
+    std::string mSource;
+
+    // The last time formatted, as it rarely changes.
+    time_t mTime = -1;
+    std::string mTimeText;
+};
+
+void AsyncLogFormatter::output(const char* record, size_t size)
+{
+    const auto end = record + size;
+    const auto header = read<AsyncLogRecord::Header>(record);
+
+    // Header::filename may be gone if it was copied.
+    std::optional<std::string_view> filename;
+
+    mMessage.str(std::string());
+    mMessage.clear();
+    mMessage.flags(std::ios_base::skipws | std::ios_base::dec);
+
+    while (record < end)
+    {
+        const auto tag = read<AsyncLogRecord::Tag>(record);
+
+        switch (tag)
+        {
+            case AsyncLogRecord::STRING:
+            case AsyncLogRecord::FILENAME:
+            {
+                const auto length = read<uint32_t>(record);
+
+                if (tag == AsyncLogRecord::STRING)
+                    mMessage.write(record, static_cast<std::streamsize>(length));
+                else
+                    filename = std::string_view(record, length);
+
+                record += length;
+                break;
+            }
+            case AsyncLogRecord::BOOLEAN:
+                mMessage << read<bool>(record);
+                break;
+            case AsyncLogRecord::CHARACTER:
+                mMessage << read<char>(record);
+                break;
+            case AsyncLogRecord::SIGNED:
+            {
+                const auto width = read<uint8_t>(record);
+                const auto value = read<int64_t>(record);
+
+                if (width == sizeof(short))
+                    mMessage << static_cast<short>(value);
+                else if (width == sizeof(int))
+                    mMessage << static_cast<int>(value);
+                else
+                    mMessage << static_cast<long long>(value);
+                break;
+            }
+            case AsyncLogRecord::UNSIGNED:
+            {
+                const auto width = read<uint8_t>(record);
+                const auto value = read<uint64_t>(record);
+
+                if (width == sizeof(unsigned short))
+                    mMessage << static_cast<unsigned short>(value);
+                else if (width == sizeof(unsigned))
+                    mMessage << static_cast<unsigned>(value);
+                else
+                    mMessage << static_cast<unsigned long long>(value);
+                break;
+            }
+            case AsyncLogRecord::FLOATING:
+                mMessage << read<double>(record);
+                break;
+            case AsyncLogRecord::POINTER:
+                mMessage << read<const void*>(record);
+                break;
+            case AsyncLogRecord::MANIPULATOR:
+                read<std::ios_base& (*)(std::ios_base&)>(record)(mMessage);
+                break;
+            default:
+                assert(!"Unknown log record tag");
+                return;
+        }
+    }
+
+    if (!filename)
+        filename = header.filename;
+
+    mSource.assign(filename->data(), filename->size());
+
+    if (header.line >= 0)
+    {
+        mSource += ':';
+        mSource += std::to_string(header.line);
+    }
+
+    if (header.time != mTime)
+    {
+        mTime = header.time;
+        mTimeText = formatTime(mTime);
+    }
+
+    if (auto logger = SimpleLogger::logger)
+    {
+        logger->log(mTimeText.c_str(), header.level, mSource.c_str(), mMessage.str().c_str());
+    }
+}
+
+namespace {
+
+// The messages a thread logged, on their way to the output thread. Only that thread adds to
+// the ring and only the output thread takes from it, so neither of them needs a lock.
+class LogRing
+{
+public:
+    explicit LogRing(size_t capacity)
+      : mData(new char[capacity])
+      , mCapacity(capacity)
+    {
+        assert(capacity && !(capacity & (capacity - 1)));
+    }
+
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+    size_t used() const
+    {
+        return static_cast<size_t>(mHead.load(std::memory_order_acquire)
+                                   - mTail.load(std::memory_order_acquire));
+    }
+
+    // False, and counted as dropped, if there's no room for the record.
+    bool push(const char* record, size_t size)
+    {
+        auto head = mHead.load(std::memory_order_relaxed);
+        const auto tail = mTail.load(std::memory_order_acquire);
+        const auto dropped = mDropped.load(std::memory_order_relaxed);
+
+        // So that the output thread knows where messages are missing.
+        if (dropped != mMarked)
+        {
+            auto marker = reserve(head, tail, sizeof(dropped));
+
+            if (!marker)
+                return drop();
+
+            std::memcpy(marker, &DROPPED, sizeof(DROPPED));
+            std::memcpy(marker + sizeof(DROPPED), &dropped, sizeof(dropped));
+        }
+
+        auto data = reserve(head, tail, size);
+
+        if (!data)
+            return drop();
+
+        const auto length = static_cast<uint32_t>(size);
+
+        std::memcpy(data, &length, sizeof(length));
+        std::memcpy(data + sizeof(length), record, size);
+
+        mMarked = dropped;
+        mHead.store(head, std::memory_order_release);
+
+        return true;
+    }
+
+    // Calls consume(record, size) for every record, oldest first, and frees their space.
+    // Where messages were dropped, calls dropped(count), with how many were dropped so far.
+    template<typename Consumer, typename Dropped>
+    void pop(Consumer&& consume, Dropped&& dropped)
+    {
+        auto tail = mTail.load(std::memory_order_relaxed);
+        const auto head = mHead.load(std::memory_order_acquire);
+
+        while (tail != head)
+        {
+            const auto offset = static_cast<size_t>(tail) & (mCapacity - 1);
+            const auto data = mData.get() + offset;
+
+            uint32_t length;
+            std::memcpy(&length, data, sizeof(length));
+
+            if (length == SKIPPED)
+            {
+                tail += mCapacity - offset;
+            }
+            else if (length == DROPPED)
+            {
+                uint64_t count;
+                std::memcpy(&count, data + sizeof(length), sizeof(count));
+
+                dropped(count);
+                tail += padded(sizeof(count));
+            }
+            else
+            {
+                consume(data + sizeof(length), static_cast<size_t>(length));
+                tail += padded(length);
+            }
+
+            mTail.store(tail, std::memory_order_release);
+        }
+    }
+
+    uint64_t dropped() const
+    {
+        return mDropped.load(std::memory_order_relaxed);
+    }
+
+    // Drops reported by the output thread.
+    uint64_t mReported = 0;
+
+    // Set when the thread that logs in this ring exits.
+    std::atomic<bool> mClosed{false};
+
+    // Set when the output thread stops, so that the thread gets a new ring if it's restarted.
+    std::atomic<bool> mRetired{false};
+
+    // Set by the thread that logs while it may push, so that stop() knows when it's done.
+    std::atomic<bool> mPushing{false};
+
+    // Once retired, waits for stop() to output what's left, so that the thread's next messages
+    // come after.
+    void awaitRetirement() const
+    {
+        while (mRetired.load(std::memory_order_acquire) && used())
+            std::this_thread::yield();
+    }
+
+private:
+    // Instead of a record's length, for the end of the ring and for where messages were dropped.
+    static constexpr uint32_t SKIPPED = UINT32_MAX;
+    static constexpr uint32_t DROPPED = UINT32_MAX - 1;
+
+    // Records are stored whole, after their length, and padded so that
+    // a length always fits before the end of the ring.
+    static size_t padded(size_t size)
+    {
+        return (sizeof(uint32_t) + size + 7) & ~size_t(7);
+    }
+
+    // Where to write `size` bytes and their length, advancing `head` past them,
+    // or nullptr if there's no room.
+    char* reserve(uint64_t& head, uint64_t tail, size_t size)
+    {
+        const auto needed = padded(size);
+        auto offset = static_cast<size_t>(head) & (mCapacity - 1);
+        const auto skipped = mCapacity - offset < needed ? mCapacity - offset : 0;
+
+        if (head + skipped + needed - tail > mCapacity)
+            return nullptr;
+
+        if (skipped)
+        {
+            std::memcpy(mData.get() + offset, &SKIPPED, sizeof(SKIPPED));
+            offset = 0;
+        }
+
+        head += skipped + needed;
+
+        return mData.get() + offset;
+    }
+
+    bool drop()
+    {
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    std::unique_ptr<char[]> mData;
+    const size_t mCapacity;
+
+    std::atomic<uint64_t> mHead{0};
+    std::atomic<uint64_t> mTail{0};
+    std::atomic<uint64_t> mDropped{0};
+
+    // Drops the output thread knows the place of, only used by the thread that logs.
+    uint64_t mMarked = 0;
+}; // LogRing
+
+// The ring of the current thread, if it's logged asynchronously.
+struct LogProducer
+{
+    ~LogProducer()
+    {
+        if (ring)
+            ring->mClosed.store(true, std::memory_order_release);
+    }
+
+    std::shared_ptr<LogRing> ring;
+}; // LogProducer
+
+thread_local LogProducer tLogProducer;
+
+// Drains every thread's ring, then sleeps for a while, unless a thread's ring
+// fills up or someone is waiting for messages to be output.
+class AsyncLogOutput
+{
+public:
+    ~AsyncLogOutput()
+    {
+        stop();
+    }
+
+    void start(size_t bufferSize);
+    void stop();
+    void flush();
+
+    // False if the caller should output the record itself: it's too large to be queued,
+    // or the output thread isn't running. Either way, it's returned once what the thread
+    // queued before is output. Records dropped because the ring is full count as queued.
+    bool push(const char* record, size_t size);
+
+    uint64_t dropped() const
+    {
+        return mDropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr auto INTERVAL = std::chrono::milliseconds(20);
+
+    void run();
+    void output(LogRing& ring);
+    void reportDropped(LogRing& ring, uint64_t dropped);
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mFlushed;
+    std::thread mThread;
+
+    std::vector<std::shared_ptr<LogRing>> mRings;
+    size_t mBufferSize = SimpleLogger::ASYNC_BUFFER_SIZE;
+
+    bool mStop = false;
+    bool mWakeRequested = false;
+    uint64_t mFlushRequested = 0;
+    uint64_t mFlushCompleted = 0;
+
+    std::atomic<uint64_t> mDropped{0};
+
+    // Only used by the output thread.
+    AsyncLogFormatter mFormatter;
+}; // AsyncLogOutput
+
+AsyncLogOutput gAsyncLogOutput;
+
+void AsyncLogOutput::start(size_t bufferSize)
+{
+    std::lock_guard<std::mutex> guard(mMutex);
+
+    // A power of two, and no less than a page.
+    mBufferSize = 4096;
+
+    while (mBufferSize < bufferSize)
+        mBufferSize <<= 1;
+
+    if (mThread.joinable())
+        return;
+
+    mStop = false;
+    mThread = std::thread([this]() { run(); });
+}
+
+void AsyncLogOutput::stop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if (!mThread.joinable())
+        return;
+
+    mStop = true;
+
+    // Threads output their messages themselves from now on, after those they queued.
+    for (auto& ring : mRings)
+        ring->mRetired = true;
+
+    mWake.notify_one();
+
+    lock.unlock();
+    mThread.join();
+    lock.lock();
+
+    // What was pushed while the output thread made its last pass.
+    const auto disabled = SimpleLogger::mThreadLocalLoggingDisabled;
+    SimpleLogger::mThreadLocalLoggingDisabled = true;
+
+    for (auto& ring : mRings)
+    {
+        while (ring->mPushing.load())
+            std::this_thread::yield();
+
+        output(*ring);
+    }
+
+    SimpleLogger::mThreadLocalLoggingDisabled = disabled;
+
+    mFlushCompleted = mFlushRequested;
+    mRings.clear();
+}
+
+void AsyncLogOutput::flush()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    if (!mThread.joinable() || mThread.get_id() == std::this_thread::get_id())
+        return;
+
+    const auto flush = ++mFlushRequested;
+    mWake.notify_one();
+
+    mFlushed.wait(lock, [&]() { return mFlushCompleted >= flush || mStop; });
+}
+
+bool AsyncLogOutput::push(const char* record, size_t size)
+{
+    auto& ring = tLogProducer.ring;
+
+    if (ring)
+    {
+        // Before checking whether it's retired: either stop() sees us pushing and waits for
+        // us, or we see the ring retired.
+        ring->mPushing.store(true);
+
+        if (ring->mRetired.load())
+        {
+            ring->mPushing.store(false, std::memory_order_release);
+            ring->awaitRetirement();
+            ring.reset();
+        }
+    }
+
+    if (!ring)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        if (!mThread.joinable() || mStop)
+            return false;
+
+        ring = std::make_shared<LogRing>(mBufferSize);
+        ring->mPushing.store(true);
+        mRings.emplace_back(ring);
+    }
+
+    if (size > ring->capacity() / 8)
+    {
+        ring->mPushing.store(false, std::memory_order_release);
+
+        // Output by the caller, after what this thread queued before.
+        if (ring->used())
+            flush();
+
+        ring->awaitRetirement();
+
+        return false;
+    }
+
+    const auto half = ring->capacity() / 2;
+    const auto used = ring->used();
+    const auto pushed = ring->push(record, size);
+
+    // Before waiting for anything, as stop() may be waiting for us.
+    ring->mPushing.store(false, std::memory_order_release);
+
+    if (!pushed)
+    {
+        static auto& dropped = metrics::counter("mega_log_dropped_total",
+                                                "Log messages dropped as the buffer of the thread "
+                                                "that logged them was full");
+
+        mDropped.fetch_add(1, std::memory_order_relaxed);
+        dropped.add();
+    }
+    else if (used <= half && ring->used() > half)
+    {
+        // Don't wait for the output thread to wake up by itself.
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        mWakeRequested = true;
+        mWake.notify_one();
+    }
+
+    return true;
+}
+
+void AsyncLogOutput::run()
+{
+    // The output class may log: that would only fill this thread's ring.
+    SimpleLogger::mThreadLocalLoggingDisabled = true;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    for (;;)
+    {
+        const auto flush = mFlushRequested;
+        const auto stop = mStop;
+        auto rings = mRings;
+
+        mWakeRequested = false;
+
+        lock.unlock();
+
+        for (auto& ring : rings)
+        {
+            // Checked first, as nothing can be logged in it afterwards.
+            const auto closed = ring->mClosed.load(std::memory_order_acquire);
+
+            output(*ring);
+
+            // Only keep those to forget.
+            if (!closed)
+                ring.reset();
+        }
+
+        lock.lock();
+
+        // Forget the rings of threads that have exited.
+        for (auto& ring : rings)
+        {
+            if (ring)
+                mRings.erase(std::find(mRings.begin(), mRings.end(), ring));
+        }
+
+        mFlushCompleted = flush;
+        mFlushed.notify_all();
+
+        if (stop)
+            break;
+
+        mWake.wait_for(lock, INTERVAL, [this]()
+        {
+            return mStop || mWakeRequested || mFlushRequested != mFlushCompleted;
+        });
+    }
+}
+
+void AsyncLogOutput::output(LogRing& ring)
+{
+    ring.pop([this](const char* record, size_t size)
+    {
+        mFormatter.output(record, size);
+    },
+    [this, &ring](uint64_t dropped)
+    {
+        reportDropped(ring, dropped);
+    });
+
+    // Those dropped since the last message.
+    const auto dropped = ring.dropped();
+
+    if (!ring.used())
+        reportDropped(ring, dropped);
+}
+
+void AsyncLogOutput::reportDropped(LogRing& ring, uint64_t dropped)
+{
+    if (dropped <= ring.mReported)
+        return;
+
+    const auto count = dropped - ring.mReported;
+    ring.mReported = dropped;
+
+    if (SimpleLogger::getLogLevel() < logWarning)
+        return;
+
+    std::string record;
+
+    AsyncLogRecord::Header header{std::time(nullptr),
+                                  log_file_leafname(__FILE__),
+                                  __LINE__,
+                                  logWarning};
+    record.append(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    AsyncLogRecord::appendInteger(record, count);
+
+    const char text[] =
+        " log messages were dropped: the buffer of the thread that logged them was full";
+    AsyncLogRecord::append(record, AsyncLogRecord::STRING, text, sizeof(text) - 1);
+
+    mFormatter.output(record.data(), record.size());
+}
+
+} // namespace
+
+void SimpleLogger::queue()
+{
+    auto& records = *mRecord;
+
+    if (mCopyFilename)
+    {
+        AsyncLogRecord::Header header;
+        std::memcpy(&header, records.data() + mRecordStart, sizeof(header));
+
+        AsyncLogRecord::append(records,
+                               AsyncLogRecord::FILENAME,
+                               header.filename,
+                               std::strlen(header.filename));
+    }
+
+    const auto record = records.data() + mRecordStart;
+    const auto size = records.size() - mRecordStart;
+
+    // Even once it's disabled, as it waits for what this thread queued to be output.
+    if (!gAsyncLogOutput.push(record, size))
+    {
+        AsyncLogFormatter().output(record, size);
+    }
+    else if (level == logFatal)
+    {
+        // Out before anything else happens.
+        gAsyncLogOutput.flush();
+    }
+
+    records.resize(mRecordStart);
+
+    // Don't hold on to what a very long message needed.
+    if (!mRecordStart && records.capacity() > LOGGER_CHUNKS_SIZE * 64)
+        std::string().swap(records);
+}
+
+bool SimpleLogger::queuedAsync()
+{
+    return tLogProducer.ring != nullptr;
+}
+
+void SimpleLogger::setAsyncOutput(bool enable, size_t bufferSize)
+{
+    if (enable)
+    {
+        gAsyncLogOutput.start(bufferSize);
+        asyncOutput = true;
+    }
+    else
+    {
+        // Messages being logged are output by their thread from now on.
+        asyncOutput = false;
+        gAsyncLogOutput.stop();
+    }
+}
+
+void SimpleLogger::flushAsyncOutput()
+{
+    gAsyncLogOutput.flush();
+}
+
+uint64_t SimpleLogger::droppedAsyncMessages()
+{
+    return gAsyncLogOutput.dropped();
+}
 #endif
 
 std::ostream& operator<< (std::ostream& ostr, const std::error_code &value)
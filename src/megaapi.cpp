@@ -2189,6 +2189,21 @@ void MegaApi::setLogJSONContent(bool enable)
     MegaApiImpl::setLogJSONContent(enable);
 }
 
+void MegaApi::setAsyncLogging(bool enable)
+{
+    MegaApiImpl::setAsyncLogging(enable);
+}
+
+void MegaApi::setMetricsEnabled(bool enable)
+{
+    MegaApiImpl::setMetricsEnabled(enable);
+}
+
+char* MegaApi::getMetrics(bool reset)
+{
+    return MegaApiImpl::getMetrics(reset);
+}
+
 void MegaApi::addLoggerObject(MegaLogger *megaLogger, bool singleExclusiveLogger)
 {
     MegaApiImpl::addLoggerClass(megaLogger, singleExclusiveLogger);
@@ -4544,6 +4559,16 @@ bool MegaApi::removeGlobalListener(MegaGlobalListener* listener)
     return pImpl->removeGlobalListener(listener);
 }
 
+void MegaApi::setAsyncListenerDispatch(bool enable)
+{
+    pImpl->setAsyncListenerDispatch(enable);
+}
+
+char* MegaApi::getListenerDispatchStats()
+{
+    return pImpl->getListenerDispatchStats();
+}
+
 MegaError *MegaApi::checkAccessErrorExtended(MegaNode *node, int level)
 {
     return pImpl->checkAccessErrorExtended(node, level);
@@ -4684,6 +4709,26 @@ unsigned long long MegaApi::getNumNodesAtCacheLRU() const
     return pImpl->getNumNodesAtCacheLRU();
 }
 
+void MegaApi::setNodeSearchIndexEnabled(bool enable)
+{
+    pImpl->setNodeSearchIndexEnabled(enable);
+}
+
+bool MegaApi::isNodeSearchIndexEnabled()
+{
+    return pImpl->isNodeSearchIndexEnabled();
+}
+
+void MegaApi::setAsyncDbWritesEnabled(bool enable)
+{
+    pImpl->setAsyncDbWritesEnabled(enable);
+}
+
+bool MegaApi::isAsyncDbWritesEnabled()
+{
+    return pImpl->isAsyncDbWritesEnabled();
+}
+
 int MegaApi::isWaiting()
 {
     return pImpl->isWaiting();
@@ -4891,6 +4936,11 @@ int MegaApi::httpServerGetMaxOutputSize()
     return pImpl->httpServerGetMaxOutputSize();
 }
 
+bool MegaApi::httpServerSetStreamingCache(const char* localPath, long long maxSize)
+{
+    return pImpl->httpServerSetStreamingCache(localPath, maxSize);
+}
+
 //FTP Server:
 bool MegaApi::ftpServerStart(bool localOnly, int port, int dataportBegin, int dataPortEnd, bool useTLS, const char * certificatepath, const char * keypath)
 {
@@ -8211,12 +8261,14 @@ MegaGfxProvider::~MegaGfxProvider() = default;
 MegaGfxProvider* MegaGfxProvider::createIsolatedInstance(const char* endpointName,
                                                          const char* executable,
                                                          unsigned int keepAliveInSeconds,
-                                                         const MegaStringList* extraArgs)
+                                                         const MegaStringList* extraArgs,
+                                                         unsigned int processCount)
 {
     auto provider = MegaGfxProviderPrivate::createIsolatedInstance(endpointName,
                                                                    executable,
                                                                    keepAliveInSeconds,
-                                                                   extraArgs);
+                                                                   extraArgs,
+                                                                   processCount);
 
     return provider.release();
 }
@@ -53,7 +53,9 @@
 #ifndef _LARGEFILE64_SOURCE
     #define _LARGEFILE64_SOURCE
 #endif
+#include <fcntl.h>
 #include <signal.h>
+#include <unistd.h>
 #endif
 
 
@@ -1077,6 +1079,11 @@ uint64_t MegaNodePrivate::getChanges()
     return changed;
 }
 
+void MegaNodePrivate::addChanges(uint64_t changes)
+{
+    changed |= changes;
+}
+
 MegaHandle MegaNodePrivate::getOwner() const
 {
     return owner;
@@ -5929,6 +5936,44 @@ void MegaNodeListPrivate::addNode(std::unique_ptr<MegaNode> node)
     }
 }
 
+void MegaNodeListPrivate::mergeUpdates(MegaNodeListPrivate&& newer)
+{
+    std::map<MegaHandle, MegaNodePrivate*> latest;
+    for (int i = 0; i < newer.s; ++i)
+    {
+        latest[newer.list[i]->getHandle()] = static_cast<MegaNodePrivate*>(newer.list[i]);
+    }
+
+    MegaNode** merged = new MegaNode*[static_cast<size_t>(s + newer.s)];
+    int count = 0;
+
+    for (int i = 0; i < s; ++i)
+    {
+        auto it = latest.find(list[i]->getHandle());
+        if (it == latest.end())
+        {
+            merged[count++] = list[i];
+            continue;
+        }
+
+        it->second->addChanges(list[i]->getChanges());
+        delete list[i];
+    }
+
+    for (int i = 0; i < newer.s; ++i)
+    {
+        merged[count++] = newer.list[i];
+    }
+
+    delete [] list;
+    delete [] newer.list;
+    newer.list = NULL;
+    newer.s = 0;
+
+    list = merged;
+    s = count;
+}
+
 void MegaNodeListPrivate::addNode(MegaNode *node)
 {
     MegaNode** copyList = list;
@@ -6829,7 +6874,8 @@ std::unique_ptr<MegaGfxProviderPrivate>
     MegaGfxProviderPrivate::createIsolatedInstance([[maybe_unused]] const char* endpointName,
                                                    [[maybe_unused]] const char* executable,
                                                    [[maybe_unused]] unsigned int keepAliveInSeconds,
-                                                   [[maybe_unused]] const MegaStringList* extraArgs)
+                                                   [[maybe_unused]] const MegaStringList* extraArgs,
+                                                   [[maybe_unused]] unsigned int processCount)
 {
 #ifdef ENABLE_ISOLATED_GFX
     if (!endpointName || !executable)
@@ -6840,7 +6886,7 @@ std::unique_ptr<MegaGfxProviderPrivate>
                                       std::string{executable},
                                       std::chrono::seconds{keepAliveInSeconds},
                                       args ? args->getVector() : string_vector{}};
-    auto provider = GfxProviderIsolatedProcess::create(params);
+    auto provider = GfxProviderIsolatedProcess::create(params, processCount);
     return std::make_unique<MegaGfxProviderPrivate>(std::move(provider));
 #else
     return nullptr;
@@ -6996,6 +7042,8 @@ MegaApiImpl::~MegaApiImpl()
     thread.join();
     assert(client == nullptr);
 
+    mListenerDispatcher.reset();
+
     delete mTimezones;
 
     assert(requestMap.empty());
@@ -7318,6 +7366,31 @@ void MegaApiImpl::setLogJSONContent(bool enable)
     gLogJSONRequests = enable;
 }
 
+void MegaApiImpl::setAsyncLogging([[maybe_unused]] bool enable)
+{
+#ifndef ENABLE_LOG_PERFORMANCE
+    SimpleLogger::setAsyncOutput(enable);
+#endif
+}
+
+void MegaApiImpl::setMetricsEnabled(bool enable)
+{
+    metrics::setEnabled(enable);
+}
+
+char* MegaApiImpl::getMetrics(bool reset)
+{
+    auto& registry = metrics::Registry::instance();
+    auto text = registry.prometheus();
+
+    if (reset)
+    {
+        registry.reset();
+    }
+
+    return MegaApi::strdup(text.c_str());
+}
+
 void MegaApiImpl::log(int logLevel, const char *message, const char *filename, int line)
 {
     SimpleLogger::postLog(LogLevel(logLevel), message, filename, line);
@@ -7978,7 +8051,22 @@ void MegaApiImpl::loop()
         }
     }
 
+    // Deliver what the listeners are still owed, such as the finish of aborted requests and
+    // transfers, while there's a client. Without the SDK mutex: they may want it.
     SdkMutexGuard g(sdkMutex);
+    auto dispatcher = mListenerDispatcher.get();
+    g.unlock();
+
+    if (dispatcher)
+    {
+        dispatcher->shutdown();
+    }
+
+    g.lock();
+
+    // Anything else is delivered on this thread.
+    mAsyncListenerDispatch = false;
+
     delete client;
     client = nullptr;
 }
@@ -11064,6 +11152,9 @@ bool MegaApiImpl::httpServerStart(bool localOnly, int port, bool useTLS, const c
     httpServer->enableFolderServer(httpServerEnableFolders);
     httpServer->setRestrictedMode(httpServerRestrictedMode);
     httpServer->enableSubtitlesSupport(httpServerRestrictedMode != 0);
+#ifndef _WIN32
+    httpServer->setStreamingCache(httpServerStreamingCache);
+#endif
 
     bool result = httpServer->start(port, localOnly);
     if (!result)
@@ -11249,6 +11340,37 @@ int MegaApiImpl::httpServerGetMaxOutputSize()
     }
 }
 
+bool MegaApiImpl::httpServerSetStreamingCache([[maybe_unused]] const char* localPath,
+                                              [[maybe_unused]] long long maxSize)
+{
+#ifdef _WIN32
+    LOG_err << "The streaming cache is not supported on this platform";
+    return false;
+#else
+    std::shared_ptr<StreamingCache> cache;
+
+    if (localPath && maxSize > 0)
+    {
+        auto directory = LocalPath::fromAbsolutePath(localPath);
+        if (!fsAccess->newfileaccess()->isfolder(directory))
+        {
+            LOG_err << "Invalid folder for the streaming cache: " << directory;
+            return false;
+        }
+
+        cache = std::make_shared<StreamingCache>(directory, maxSize);
+    }
+
+    SdkMutexGuard g(sdkMutex);
+    httpServerStreamingCache = cache;
+    if (httpServer)
+    {
+        httpServer->setStreamingCache(cache);
+    }
+    return true;
+#endif
+}
+
 void MegaApiImpl::httpServerEnableFileServer(bool enable)
 {
     SdkMutexGuard g(sdkMutex);
@@ -15924,6 +16046,17 @@ void MegaApiImpl::nodes_updated(sharedNode_vector* nodes, int count)
         return;
     }
 
+    if (auto dispatcher = asyncListenerDispatcher())
+    {
+        unique_ptr<MegaNodeListPrivate> nodeList;
+        if (nodes != NULL)
+        {
+            nodeList.reset(new MegaNodeListPrivate(*nodes));
+        }
+        dispatcher->postNodes(globalListeners, listeners, std::move(nodeList));
+        return;
+    }
+
     MegaNodeList *nodeList = NULL;
     if (nodes != NULL)
     {
@@ -17120,13 +17253,59 @@ void MegaApiImpl::addGlobalListener(MegaGlobalListener* listener)
     globalListeners.insert(listener);
 }
 
+void MegaApiImpl::setAsyncListenerDispatch(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+
+    if (enable && !mListenerDispatcher)
+    {
+        mListenerDispatcher = std::make_unique<ListenerDispatcher>(api);
+    }
+
+    mAsyncListenerDispatch = enable;
+}
+
+char* MegaApiImpl::getListenerDispatchStats()
+{
+    SdkMutexGuard g(sdkMutex);
+
+    if (!mListenerDispatcher)
+    {
+        return nullptr;
+    }
+
+    return MegaApi::strdup(mListenerDispatcher->stats().c_str());
+}
+
+ListenerDispatcher* MegaApiImpl::asyncListenerDispatcher() const
+{
+    return mAsyncListenerDispatch ? mListenerDispatcher.get() : nullptr;
+}
+
+void MegaApiImpl::forgetListener(ListenerDispatcher* dispatcher, const void* listener)
+{
+    if (!dispatcher)
+    {
+        return;
+    }
+
+    // The SDK thread can't wait for a listener, which may be waiting for the SDK mutex.
+    dispatcher->forget(listener, threadId != std::this_thread::get_id());
+}
+
 bool MegaApiImpl::removeListener(MegaListener* listener)
 {
     if(!listener) return false;
 
     SdkMutexGuard g(sdkMutex);
 
-    return listeners.erase(listener) > 0;
+    auto removed = listeners.erase(listener) > 0;
+    auto dispatcher = mListenerDispatcher.get();
+
+    g.unlock();
+    forgetListener(dispatcher, listener);
+
+    return removed;
 }
 
 bool MegaApiImpl::removeRequestListener(MegaRequestListener* listener)
@@ -17149,6 +17328,11 @@ bool MegaApiImpl::removeRequestListener(MegaRequestListener* listener)
 
     requestQueue.removeListener(listener);
 
+    auto dispatcher = mListenerDispatcher.get();
+
+    g.unlock();
+    forgetListener(dispatcher, listener);
+
     return removed;
 }
 
@@ -17172,6 +17356,11 @@ bool MegaApiImpl::removeTransferListener(MegaTransferListener* listener)
 
     transferQueue.removeListener(listener);
 
+    auto dispatcher = mListenerDispatcher.get();
+
+    g.unlock();
+    forgetListener(dispatcher, listener);
+
     return removed;
 }
 
@@ -17204,21 +17393,34 @@ bool MegaApiImpl::removeGlobalListener(MegaGlobalListener* listener)
 
     SdkMutexGuard g(sdkMutex);
 
-    return globalListeners.erase(listener) > 0;
+    auto removed = globalListeners.erase(listener) > 0;
+    auto dispatcher = mListenerDispatcher.get();
+
+    g.unlock();
+    forgetListener(dispatcher, listener);
+
+    return removed;
 }
 
 void MegaApiImpl::fireOnRequestStart(MegaRequestPrivate *request)
 {
     assert(threadId == std::this_thread::get_id());
     LOG_info << client->clientname << "Request (" << request->getRequestString() << ") starting";
-    for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+    if (auto dispatcher = asyncListenerDispatcher())
     {
-        (*it++)->onRequestStart(api, request);
+        dispatcher->postRequest(ListenerDispatcher::REQUEST_START, requestListeners, listeners, request);
     }
-
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    else
     {
-        (*it++)->onRequestStart(api, request);
+        for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+        {
+            (*it++)->onRequestStart(api, request);
+        }
+
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onRequestStart(api, request);
+        }
     }
 
     MegaRequestListener* listener = request->getListener();
@@ -17260,14 +17462,21 @@ void MegaApiImpl::fireOnRequestFinish(MegaRequestPrivate* request,
         LOG_info << (client ? client->clientname : "") << "Request (" << request->getRequestString() << ") finished";
     }
 
-    for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+    if (auto dispatcher = asyncListenerDispatcher())
     {
-        (*it++)->onRequestFinish(api, request, e.get());
+        dispatcher->postRequest(ListenerDispatcher::REQUEST_FINISH, requestListeners, listeners, request, e.get());
     }
-
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    else
     {
-        (*it++)->onRequestFinish(api, request, e.get());
+        for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+        {
+            (*it++)->onRequestFinish(api, request, e.get());
+        }
+
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onRequestFinish(api, request, e.get());
+        }
     }
 
     MegaRequestListener* listener = request->getListener();
@@ -17285,14 +17494,21 @@ void MegaApiImpl::fireOnRequestUpdate(MegaRequestPrivate *request)
 {
     assert(threadId == std::this_thread::get_id());
 
-    for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+    if (auto dispatcher = asyncListenerDispatcher())
     {
-        (*it++)->onRequestUpdate(api, request);
+        dispatcher->postRequest(ListenerDispatcher::REQUEST_UPDATE, requestListeners, listeners, request);
     }
-
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    else
     {
-        (*it++)->onRequestUpdate(api, request);
+        for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+        {
+            (*it++)->onRequestUpdate(api, request);
+        }
+
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onRequestUpdate(api, request);
+        }
     }
 
     MegaRequestListener* listener = request->getListener();
@@ -17308,14 +17524,21 @@ void MegaApiImpl::fireOnRequestTemporaryError(MegaRequestPrivate *request, uniqu
 
     request->setNumRetry(request->getNumRetry() + 1);
 
-    for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+    if (auto dispatcher = asyncListenerDispatcher())
     {
-        (*it++)->onRequestTemporaryError(api, request, e.get());
+        dispatcher->postRequest(ListenerDispatcher::REQUEST_TEMPORARY_ERROR, requestListeners, listeners, request, e.get());
     }
-
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    else
     {
-        (*it++)->onRequestTemporaryError(api, request, e.get());
+        for(set<MegaRequestListener *>::iterator it = requestListeners.begin(); it != requestListeners.end() ;)
+        {
+            (*it++)->onRequestTemporaryError(api, request, e.get());
+        }
+
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onRequestTemporaryError(api, request, e.get());
+        }
     }
 
     MegaRequestListener* listener = request->getListener();
@@ -17331,14 +17554,21 @@ void MegaApiImpl::fireOnTransferStart(MegaTransferPrivate *transfer)
     notificationNumber++;
     transfer->setNotificationNumber(notificationNumber);
 
-    for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+    if (auto dispatcher = asyncListenerDispatcher())
     {
-        (*it++)->onTransferStart(api, transfer);
+        dispatcher->postTransfer(ListenerDispatcher::TRANSFER_START, transferListeners, listeners, transfer);
     }
-
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    else
     {
-        (*it++)->onTransferStart(api, transfer);
+        for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+        {
+            (*it++)->onTransferStart(api, transfer);
+        }
+
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onTransferStart(api, transfer);
+        }
     }
 
     MegaTransferListener* listener = transfer->getListener();
@@ -17399,14 +17629,21 @@ void MegaApiImpl::fireOnTransferFinish(MegaTransferPrivate *transfer, unique_ptr
         transfer->setStage(fileRemoved);
     }
 
-    for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+    if (auto dispatcher = asyncListenerDispatcher())
     {
-        (*it++)->onTransferFinish(api, transfer, e.get());
+        dispatcher->postTransfer(ListenerDispatcher::TRANSFER_FINISH, transferListeners, listeners, transfer, e.get());
     }
-
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    else
     {
-        (*it++)->onTransferFinish(api, transfer, e.get());
+        for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+        {
+            (*it++)->onTransferFinish(api, transfer, e.get());
+        }
+
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onTransferFinish(api, transfer, e.get());
+        }
     }
 
     MegaTransferListener* listener = transfer->getListener();
@@ -17432,14 +17669,21 @@ void MegaApiImpl::fireOnTransferTemporaryError(MegaTransferPrivate *transfer, un
 
     transfer->setNumRetry(transfer->getNumRetry() + 1);
 
-    for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+    if (auto dispatcher = asyncListenerDispatcher())
     {
-        (*it++)->onTransferTemporaryError(api, transfer, e.get());
+        dispatcher->postTransfer(ListenerDispatcher::TRANSFER_TEMPORARY_ERROR, transferListeners, listeners, transfer, e.get());
     }
-
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    else
     {
-        (*it++)->onTransferTemporaryError(api, transfer, e.get());
+        for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+        {
+            (*it++)->onTransferTemporaryError(api, transfer, e.get());
+        }
+
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onTransferTemporaryError(api, transfer, e.get());
+        }
     }
 
     MegaTransferListener* listener = transfer->getListener();
@@ -17460,14 +17704,21 @@ void MegaApiImpl::fireOnTransferUpdate(MegaTransferPrivate *transfer)
     notificationNumber++;
     transfer->setNotificationNumber(notificationNumber);
 
-    for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+    if (auto dispatcher = asyncListenerDispatcher())
     {
-        (*it++)->onTransferUpdate(api, transfer);
+        dispatcher->postTransfer(ListenerDispatcher::TRANSFER_UPDATE, transferListeners, listeners, transfer);
     }
-
-    for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+    else
     {
-        (*it++)->onTransferUpdate(api, transfer);
+        for(set<MegaTransferListener *>::iterator it = transferListeners.begin(); it != transferListeners.end() ;)
+        {
+            (*it++)->onTransferUpdate(api, transfer);
+        }
+
+        for(set<MegaListener *>::iterator it = listeners.begin(); it != listeners.end() ;)
+        {
+            (*it++)->onTransferUpdate(api, transfer);
+        }
     }
 
     MegaTransferListener* listener = transfer->getListener();
@@ -26305,6 +26556,30 @@ unsigned long long MegaApiImpl::getNumNodesAtCacheLRU() const
     return client->mNodeManager.getNumNodesAtCacheLRU();
 }
 
+void MegaApiImpl::setNodeSearchIndexEnabled(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->nodeSearchIndex = enable;
+}
+
+bool MegaApiImpl::isNodeSearchIndexEnabled()
+{
+    SdkMutexGuard g(sdkMutex);
+    return client->nodeSearchIndex;
+}
+
+void MegaApiImpl::setAsyncDbWritesEnabled(bool enable)
+{
+    SdkMutexGuard g(sdkMutex);
+    client->asyncDbWrites = enable;
+}
+
+bool MegaApiImpl::isAsyncDbWritesEnabled()
+{
+    SdkMutexGuard g(sdkMutex);
+    return client->asyncDbWrites;
+}
+
 bool MegaApiImpl::isSyncStalled()
 {
     // no need to lock sdkMutex for these simple flags
@@ -28799,6 +29074,455 @@ void TransferQueue::setAllCancelled(CancelToken cancelled, int direction)
     }
 }
 
+ListenerDispatcher::ListenerDispatcher(MegaApi* api)
+  : mApi(api)
+{
+    mThread = std::thread([this]()
+    {
+        loop();
+    });
+}
+
+ListenerDispatcher::~ListenerDispatcher()
+{
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mExit = true;
+        mUpdates.clear();
+        mEvents.clear();
+    }
+
+    mQueued.notify_all();
+
+    if (mThread.joinable())
+    {
+        mThread.join();
+    }
+}
+
+void ListenerDispatcher::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mShutdown = true;
+    }
+
+    mQueued.notify_all();
+
+    if (mThread.joinable())
+    {
+        mThread.join();
+    }
+}
+
+void ListenerDispatcher::postRequest(int type,
+                                     const set<MegaRequestListener*>& requestListeners,
+                                     const set<MegaListener*>& listeners,
+                                     MegaRequestPrivate* request,
+                                     const MegaErrorPrivate* e)
+{
+    if (requestListeners.empty() && listeners.empty())
+    {
+        return;
+    }
+
+    // Copied here, as the request changes or is gone by the time the event is delivered.
+    auto event = std::make_unique<Event>();
+    event->mType = type;
+    event->mTag = request->getTag();
+    event->mRequest.reset(request->copy());
+    event->mError.reset(e ? e->copy() : nullptr);
+    event->mRequestListeners.assign(requestListeners.begin(), requestListeners.end());
+    event->mListeners.assign(listeners.begin(), listeners.end());
+
+    post(std::move(event), type == REQUEST_UPDATE);
+}
+
+void ListenerDispatcher::postTransfer(int type,
+                                      const set<MegaTransferListener*>& transferListeners,
+                                      const set<MegaListener*>& listeners,
+                                      MegaTransferPrivate* transfer,
+                                      const MegaErrorPrivate* e)
+{
+    if (transferListeners.empty() && listeners.empty())
+    {
+        return;
+    }
+
+    auto event = std::make_unique<Event>();
+    event->mType = type;
+    event->mTag = transfer->getTag();
+    event->mTransfer.reset(transfer->copy());
+    event->mError.reset(e ? e->copy() : nullptr);
+    event->mTransferListeners.assign(transferListeners.begin(), transferListeners.end());
+    event->mListeners.assign(listeners.begin(), listeners.end());
+
+    post(std::move(event), type == TRANSFER_UPDATE);
+}
+
+void ListenerDispatcher::postNodes(const set<MegaGlobalListener*>& globalListeners,
+                                   const set<MegaListener*>& listeners,
+                                   unique_ptr<MegaNodeListPrivate> nodes)
+{
+    if (globalListeners.empty() && listeners.empty())
+    {
+        return;
+    }
+
+    auto event = std::make_unique<Event>();
+    event->mType = NODES_UPDATE;
+    event->mNodes = std::move(nodes);
+    event->mGlobalListeners.assign(globalListeners.begin(), globalListeners.end());
+    event->mListeners.assign(listeners.begin(), listeners.end());
+
+    post(std::move(event), false);
+}
+
+void ListenerDispatcher::post(unique_ptr<Event> event, bool droppable)
+{
+    event->mPosted = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> g(mMutex);
+
+    ++mPostedCount;
+
+    if (replaceUpdate(*event))
+    {
+        ++mMergedCount;
+        return;
+    }
+
+    if (mEvents.size() >= MAX_QUEUED_EVENTS)
+    {
+        if (!mOverflowing)
+        {
+            LOG_warn << "Listeners are falling behind: " << mEvents.size() << " events queued";
+            mOverflowing = true;
+        }
+
+        // Only updates: the next one, or the finish, brings the app up to date.
+        if (droppable)
+        {
+            ++mDroppedCount;
+            return;
+        }
+    }
+
+    if (event->mType == REQUEST_UPDATE || event->mType == TRANSFER_UPDATE)
+    {
+        mUpdates[std::make_pair(event->mType, event->mTag)] = event.get();
+    }
+
+    mEvents.emplace_back(std::move(event));
+    mQueued.notify_one();
+}
+
+bool ListenerDispatcher::replaceUpdate(Event& event)
+{
+    switch (event.mType)
+    {
+        case NODES_UPDATE:
+        {
+            // A null list means every node should be reloaded, which nothing can be merged into.
+            if (mEvents.empty() || !event.mNodes)
+            {
+                return false;
+            }
+
+            Event& last = *mEvents.back();
+
+            if (last.mType != NODES_UPDATE
+                || !last.mNodes
+                || last.mGlobalListeners != event.mGlobalListeners
+                || last.mListeners != event.mListeners)
+            {
+                return false;
+            }
+
+            last.mNodes->mergeUpdates(std::move(*event.mNodes));
+            return true;
+        }
+
+        case REQUEST_UPDATE:
+        case TRANSFER_UPDATE:
+        {
+            auto it = mUpdates.find(std::make_pair(event.mType, event.mTag));
+            if (it == mUpdates.end())
+            {
+                return false;
+            }
+
+            // The queued update keeps its place, with the latest state.
+            Event& queued = *it->second;
+            queued.mRequest = std::move(event.mRequest);
+            queued.mTransfer = std::move(event.mTransfer);
+            queued.mRequestListeners = std::move(event.mRequestListeners);
+            queued.mTransferListeners = std::move(event.mTransferListeners);
+            queued.mListeners = std::move(event.mListeners);
+            return true;
+        }
+
+        case REQUEST_TEMPORARY_ERROR:
+        case REQUEST_FINISH:
+            // Later updates mustn't overtake this event.
+            mUpdates.erase(std::make_pair(static_cast<int>(REQUEST_UPDATE), event.mTag));
+            return false;
+
+        case TRANSFER_TEMPORARY_ERROR:
+        case TRANSFER_FINISH:
+            mUpdates.erase(std::make_pair(static_cast<int>(TRANSFER_UPDATE), event.mTag));
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+void ListenerDispatcher::forget(const void* listener, bool wait)
+{
+    auto clear = [listener](Event& event)
+    {
+        auto clearIn = [listener](auto& listeners)
+        {
+            for (auto& l : listeners)
+            {
+                if (l == listener)
+                {
+                    l = nullptr;
+                }
+            }
+        };
+
+        clearIn(event.mRequestListeners);
+        clearIn(event.mTransferListeners);
+        clearIn(event.mGlobalListeners);
+        clearIn(event.mListeners);
+    };
+
+    std::unique_lock<std::mutex> g(mMutex);
+
+    for (auto& event : mEvents)
+    {
+        clear(*event);
+    }
+
+    if (mCurrent)
+    {
+        clear(*mCurrent);
+    }
+
+    // A listener removing itself, or another one, from a callback can't wait.
+    if (wait && std::this_thread::get_id() != mThread.get_id())
+    {
+        mReturned.wait(g, [this, listener]() { return mCalling != listener; });
+    }
+
+    mListenerStats.erase(listener);
+}
+
+string ListenerDispatcher::stats() const
+{
+    using std::chrono::duration;
+    using std::chrono::duration_cast;
+
+    std::lock_guard<std::mutex> g(mMutex);
+
+    std::ostringstream oss;
+
+    oss << "Events posted: " << mPostedCount
+        << ", delivered: " << mDeliveredCount
+        << ", merged: " << mMergedCount
+        << ", dropped: " << mDroppedCount
+        << ", queued: " << mEvents.size()
+        << ", max queue delay: " << duration<double, std::milli>(mMaxQueueDelay).count() << " ms"
+        << std::endl;
+
+    for (auto& entry : mListenerStats)
+    {
+        auto& stats = entry.second;
+
+        oss << "Listener " << entry.first
+            << ": calls: " << stats.mCalls
+            << ", mean: " << duration<double, std::micro>(stats.mTotal).count() / static_cast<double>(stats.mCalls) << " us"
+            << ", max: " << duration<double, std::micro>(stats.mMax).count() << " us"
+            << std::endl;
+    }
+
+    return oss.str();
+}
+
+template<typename Listener, typename Notify>
+void ListenerDispatcher::call(Listener*& listener, Notify&& notify)
+{
+    Listener* target;
+
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+
+        target = listener;
+        if (!target)
+        {
+            return;
+        }
+
+        mCalling = target;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+
+    notify(target);
+
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+
+        mCalling = nullptr;
+
+        auto& stats = mListenerStats[target];
+        ++stats.mCalls;
+        stats.mTotal += elapsed;
+        stats.mMax = std::max(stats.mMax, elapsed);
+    }
+
+    mReturned.notify_all();
+}
+
+void ListenerDispatcher::deliver(Event& event)
+{
+    auto* request = event.mRequest.get();
+    auto* transfer = event.mTransfer.get();
+    auto* nodes = event.mNodes.get();
+    auto* e = event.mError.get();
+
+    // The listeners of the kind of event first, then the MegaListeners, as the SDK thread does.
+    auto notifyAll = [this](auto& listeners, auto&& notify)
+    {
+        for (auto& listener : listeners)
+        {
+            call(listener, notify);
+        }
+    };
+
+    switch (event.mType)
+    {
+        case REQUEST_START:
+        {
+            auto notify = [&](auto* l) { l->onRequestStart(mApi, request); };
+            notifyAll(event.mRequestListeners, notify);
+            notifyAll(event.mListeners, notify);
+            break;
+        }
+
+        case REQUEST_UPDATE:
+        {
+            auto notify = [&](auto* l) { l->onRequestUpdate(mApi, request); };
+            notifyAll(event.mRequestListeners, notify);
+            notifyAll(event.mListeners, notify);
+            break;
+        }
+
+        case REQUEST_TEMPORARY_ERROR:
+        {
+            auto notify = [&](auto* l) { l->onRequestTemporaryError(mApi, request, e); };
+            notifyAll(event.mRequestListeners, notify);
+            notifyAll(event.mListeners, notify);
+            break;
+        }
+
+        case REQUEST_FINISH:
+        {
+            auto notify = [&](auto* l) { l->onRequestFinish(mApi, request, e); };
+            notifyAll(event.mRequestListeners, notify);
+            notifyAll(event.mListeners, notify);
+            break;
+        }
+
+        case TRANSFER_START:
+        {
+            auto notify = [&](auto* l) { l->onTransferStart(mApi, transfer); };
+            notifyAll(event.mTransferListeners, notify);
+            notifyAll(event.mListeners, notify);
+            break;
+        }
+
+        case TRANSFER_UPDATE:
+        {
+            auto notify = [&](auto* l) { l->onTransferUpdate(mApi, transfer); };
+            notifyAll(event.mTransferListeners, notify);
+            notifyAll(event.mListeners, notify);
+            break;
+        }
+
+        case TRANSFER_TEMPORARY_ERROR:
+        {
+            auto notify = [&](auto* l) { l->onTransferTemporaryError(mApi, transfer, e); };
+            notifyAll(event.mTransferListeners, notify);
+            notifyAll(event.mListeners, notify);
+            break;
+        }
+
+        case TRANSFER_FINISH:
+        {
+            auto notify = [&](auto* l) { l->onTransferFinish(mApi, transfer, e); };
+            notifyAll(event.mTransferListeners, notify);
+            notifyAll(event.mListeners, notify);
+            break;
+        }
+
+        case NODES_UPDATE:
+        {
+            auto notify = [&](auto* l) { l->onNodesUpdate(mApi, nodes); };
+            notifyAll(event.mGlobalListeners, notify);
+            notifyAll(event.mListeners, notify);
+            break;
+        }
+
+        default:
+            assert(false);
+    }
+}
+
+void ListenerDispatcher::loop()
+{
+    std::unique_lock<std::mutex> g(mMutex);
+
+    for (;;)
+    {
+        mQueued.wait(g, [this]() { return mExit || mShutdown || !mEvents.empty(); });
+
+        // When shutting down, once everything queued has been delivered.
+        if (mExit || mEvents.empty())
+        {
+            return;
+        }
+
+        mCurrent = std::move(mEvents.front());
+        mEvents.pop_front();
+
+        auto it = mUpdates.find(std::make_pair(mCurrent->mType, mCurrent->mTag));
+        if (it != mUpdates.end() && it->second == mCurrent.get())
+        {
+            mUpdates.erase(it);
+        }
+
+        if (mOverflowing && mEvents.size() < MAX_QUEUED_EVENTS / 2)
+        {
+            LOG_info << "Listeners caught up: " << mEvents.size() << " events queued";
+            mOverflowing = false;
+        }
+
+        mMaxQueueDelay = std::max(mMaxQueueDelay, std::chrono::steady_clock::now() - mCurrent->mPosted);
+
+        g.unlock();
+        deliver(*mCurrent);
+        g.lock();
+
+        mCurrent.reset();
+        ++mDeliveredCount;
+    }
+}
+
 RequestQueue::RequestQueue()
 {
 }
@@ -32674,6 +33398,241 @@ std::string StreamingBuffer::bufferStatus() const
     return bufferState;
 }
 
+#ifndef _WIN32
+StreamingCache::File::File(StreamingCache& cache, handle h, int fd, const LocalPath& path):
+    mCache(cache),
+    mHandle(h),
+    mFd(fd),
+    mPath(path)
+{}
+
+StreamingCache::File::~File()
+{
+    close(mFd);
+    unlink(mPath.toPath(false).c_str());
+}
+
+m_off_t StreamingCache::File::available(m_off_t offset, m_off_t len) const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+
+    auto i = mRanges.upper_bound(offset);
+    if (i == mRanges.begin())
+    {
+        return 0;
+    }
+
+    --i;
+    return std::max<m_off_t>(0, std::min(len, i->second - offset));
+}
+
+bool StreamingCache::File::reserve(m_off_t offset, m_off_t len)
+{
+    if (!len || available(offset, len) == len)
+    {
+        return false;
+    }
+
+    if (!mCache.reserve(len))
+    {
+        LOG_verbose << "[StreamingCache] Cache full, not storing " << len << " bytes of "
+                    << toNodeHandle(mHandle);
+        return false;
+    }
+
+    return true;
+}
+
+m_off_t StreamingCache::File::add(m_off_t start, m_off_t end)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+
+    auto i = mRanges.upper_bound(start);
+    if (i != mRanges.begin() && std::prev(i)->second >= start)
+    {
+        --i;
+    }
+
+    // Merge with the ranges overlapping or touching [start, end)
+    m_off_t overlap = 0;
+    m_off_t mergedStart = start;
+    m_off_t mergedEnd = end;
+
+    while (i != mRanges.end() && i->first <= end)
+    {
+        overlap += std::max<m_off_t>(0, std::min(end, i->second) - std::max(start, i->first));
+        mergedStart = std::min(mergedStart, i->first);
+        mergedEnd = std::max(mergedEnd, i->second);
+        i = mRanges.erase(i);
+    }
+
+    mRanges.emplace(mergedStart, mergedEnd);
+
+    auto added = end - start - overlap;
+    mSize += added;
+    return added;
+}
+
+StreamingCache::StreamingCache(const LocalPath& directory, m_off_t maxSize):
+    mDirectory(directory),
+    mMaxSize(maxSize)
+{}
+
+std::shared_ptr<StreamingCache::File> StreamingCache::open(handle h)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+
+    auto& file = mFiles[h];
+    if (!file)
+    {
+        auto path = mDirectory;
+        path.appendWithSeparator(LocalPath::fromRelativePath(toNodeHandle(h) + ".stream"), false);
+
+        int fd = ::open(path.toPath(false).c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0)
+        {
+            LOG_warn << "[StreamingCache] Unable to create " << path << ": " << errno;
+            mFiles.erase(h);
+            return nullptr;
+        }
+
+        file = std::make_shared<File>(*this, h, fd, path);
+    }
+
+    file->mLastUse = ++mUseCounter;
+    return file;
+}
+
+struct StreamingCache::Store
+{
+    uv_fs_t fsreq;
+    std::shared_ptr<StreamingCache> cache;
+    std::shared_ptr<File> file;
+    m_off_t offset;
+    std::string data;
+};
+
+void StreamingCache::store(uv_loop_t* loop,
+                           std::shared_ptr<File> file,
+                           m_off_t offset,
+                           std::string&& data)
+{
+    auto len = static_cast<m_off_t>(data.size());
+    if (!file->reserve(offset, len))
+    {
+        return;
+    }
+
+    // The cache and the file are kept until the data is written
+    auto* store = new Store{{}, shared_from_this(), std::move(file), offset, std::move(data)};
+    store->fsreq.data = store;
+
+    uv_buf_t buf = uv_buf_init(&store->data[0], static_cast<unsigned>(store->data.size()));
+
+    if (int err = uv_fs_write(loop,
+                              &store->fsreq,
+                              store->file->descriptor(),
+                              &buf,
+                              1,
+                              offset,
+                              onStored))
+    {
+        store->fsreq.result = err;
+        onStored(&store->fsreq);
+    }
+}
+
+void StreamingCache::onStored(uv_fs_t* req)
+{
+    std::unique_ptr<Store> store{static_cast<Store*>(req->data)};
+    auto result = req->result;
+    uv_fs_req_cleanup(req);
+
+    auto& file = *store->file;
+    auto len = static_cast<m_off_t>(store->data.size());
+
+    if (result != len)
+    {
+        LOG_warn << "[StreamingCache] Unable to write to " << file.mPath << ": " << result;
+        store->cache->release(len);
+        return;
+    }
+
+    // Only what wasn't cached yet takes up more space
+    auto added = file.add(store->offset, store->offset + len);
+    store->cache->release(len - added);
+}
+
+m_off_t StreamingCache::size() const
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    return mSize;
+}
+
+bool StreamingCache::reserve(m_off_t len)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+
+    while (mSize + len > mMaxSize)
+    {
+        // Least recently used file that no connection is using
+        auto victim = mFiles.end();
+        for (auto i = mFiles.begin(); i != mFiles.end(); ++i)
+        {
+            if (i->second.use_count() == 1 &&
+                (victim == mFiles.end() || i->second->mLastUse < victim->second->mLastUse))
+            {
+                victim = i;
+            }
+        }
+
+        if (victim == mFiles.end())
+        {
+            return false;
+        }
+
+        LOG_debug << "[StreamingCache] Evicting " << toNodeHandle(victim->first)
+                  << " size: " << victim->second->mSize;
+        mSize -= victim->second->mSize;
+        mFiles.erase(victim);
+    }
+
+    mSize += len;
+    return true;
+}
+
+void StreamingCache::release(m_off_t len)
+{
+    std::lock_guard<std::mutex> g(mMutex);
+    mSize -= len;
+}
+
+struct MegaHTTPContext::CacheSend
+{
+    CacheSend(MegaHTTPContext* context, size_t length):
+        httpctx(context),
+        cache(context->streamingCache),
+        file(context->cacheFile),
+        len(length)
+    {
+        fsreq.data = this;
+        writereq.data = this;
+    }
+
+    uv_fs_t fsreq;
+    uv_write_t writereq;
+
+    // Null once the connection is gone
+    MegaHTTPContext* httpctx;
+    std::shared_ptr<StreamingCache> cache;
+    std::shared_ptr<StreamingCache::File> file;
+
+    // Copy of the data, when the socket can't take it right away
+    std::unique_ptr<char[]> buffer;
+    size_t len;
+};
+#endif
+
 // http_parser settings
 http_parser_settings MegaTCPServer::parsercfg;
 
@@ -33730,13 +34689,21 @@ void MegaHTTPServer::processWriteFinished(MegaTCPContext* tcpctx, int status)
         if (httpctx->streamingBuffer.availableSpace() >= DirectReadSlot::MAX_DELIVERY_CHUNK)
         {
             httpctx->pause = false;
-            m_off_t start = httpctx->rangeStart + httpctx->rangeWritten +
-                            static_cast<m_off_t>(httpctx->streamingBuffer.availableData());
-            m_off_t len = httpctx->rangeEnd - httpctx->rangeStart - httpctx->rangeWritten -
-                          static_cast<m_off_t>(httpctx->streamingBuffer.availableData());
+            // Bytes of the range that aren't streamed again: those sent, those in the buffer
+            // and, with a streaming cache, those still to be sent from it
+            m_off_t delivered = httpctx->rangeWritten +
+                                static_cast<m_off_t>(httpctx->streamingBuffer.availableData());
+#ifndef _WIN32
+            delivered += httpctx->cacheRemaining;
+#endif
+            m_off_t start = httpctx->rangeStart + delivered;
+            m_off_t len = httpctx->rangeEnd - httpctx->rangeStart - delivered;
 
             LOG_debug << httpctx->getLogName() << "[Streaming] Resuming streaming from " << start
                       << " len: " << len << " " << httpctx->streamingBuffer.bufferStatus();
+#ifndef _WIN32
+            httpctx->streamOffset = start;
+#endif
             httpctx->megaApi->startStreaming(httpctx->node, start, len, httpctx);
         }
     }
@@ -33761,6 +34728,15 @@ void MegaHTTPServer::processOnAsyncEventClose(MegaTCPContext* tcpctx)
         httpctx->megaApi->fireOnStreamingFinish(httpctx->transfer.release(), std::make_unique<MegaErrorPrivate>(httpctx->resultCode)); // transfer will be deleted in fireOnStreamingFinish
     }
 
+#ifndef _WIN32
+    // closing doesn't wait for filesystem requests, so let it complete on its own
+    if (httpctx->cacheSend)
+    {
+        httpctx->cacheSend->httpctx = nullptr;
+        httpctx->cacheSend = nullptr;
+    }
+#endif
+
     delete httpctx->node;
     httpctx->node = NULL;
 }
@@ -35415,6 +36391,21 @@ int MegaHTTPServer::streamNode(MegaHTTPContext *httpctx)
     httpctx->streamingBuffer.setFileSize(totalSize);
     httpctx->streamingBuffer.setDuration(httpctx->node->getDuration());
 
+#ifndef _WIN32
+    MegaHTTPServer* httpServer = static_cast<MegaHTTPServer*>(httpctx->server);
+
+    // data of the previous request goes to its own file
+    storeStreamedBytes(httpctx);
+
+    // sendfile() can't go through TLS
+    httpctx->streamingCache = std::atomic_load(&httpServer->streamingCache);
+    httpctx->cacheFile.reset();
+    if (httpctx->streamingCache && !httpServer->useTLS && httpctx->parser.method != HTTP_HEAD)
+    {
+        httpctx->cacheFile = httpctx->streamingCache->open(node->getHandle());
+    }
+#endif
+
     string resstr = response.str();
     if (httpctx->parser.method != HTTP_HEAD)
     {
@@ -35437,6 +36428,27 @@ int MegaHTTPServer::streamNode(MegaHTTPContext *httpctx)
     if (start || len)
     {
         httpctx->streamingBuffer.reset(!httpctx->lastBufferLen, resstr.size());
+
+#ifndef _WIN32
+        // Send what's cached from the start of the range, and only stream the rest
+        if (httpctx->cacheFile)
+        {
+            httpctx->cacheOffset = start;
+            httpctx->cacheRemaining = httpctx->cacheFile->available(start, len);
+
+            if (httpctx->cacheRemaining)
+            {
+                LOG_debug << httpctx->getLogName() << "[Streaming] " << httpctx->cacheRemaining
+                          << " bytes available in the streaming cache";
+                start += httpctx->cacheRemaining;
+                len -= httpctx->cacheRemaining;
+            }
+
+            httpctx->streamOffset = start;
+        }
+
+        if (len)
+#endif
         httpctx->megaApi->startStreaming(node, start, len, httpctx);
     }
     else
@@ -35502,6 +36514,10 @@ void MegaHTTPServer::processAsyncEvent(MegaTCPContext* tcpctx)
         return;
     }
 
+#ifndef _WIN32
+    storeStreamedBytes(httpctx);
+#endif
+
     if (httpctx->failed)
     {
         LOG_warn << httpctx->getLogName() << "Streaming transfer failed. Closing connection.";
@@ -35559,6 +36575,22 @@ void MegaHTTPServer::sendNextBytes(MegaHTTPContext *httpctx)
         return;
     }
 
+#ifndef _WIN32
+    if (httpctx->cacheSend)
+    {
+        LOG_verbose << httpctx->getLogName()
+                    << "[Streaming] Skipping write due to another ongoing write from the cache";
+        return;
+    }
+
+    // The cached part of the range goes first
+    if (httpctx->cacheRemaining)
+    {
+        sendCachedBytes(httpctx);
+        return;
+    }
+#endif
+
     uv_mutex_lock(&httpctx->mutex);
     if (httpctx->lastBufferLen)
     {
@@ -35621,6 +36653,206 @@ void MegaHTTPServer::sendNextBytes(MegaHTTPContext *httpctx)
 #endif
 }
 
+#ifndef _WIN32
+void MegaHTTPServer::storeStreamedBytes(MegaHTTPContext* httpctx)
+{
+    std::deque<std::pair<m_off_t, std::string>> stores;
+
+    uv_mutex_lock(&httpctx->mutex);
+    stores.swap(httpctx->cacheStores);
+    uv_mutex_unlock(&httpctx->mutex);
+
+    for (auto& store: stores)
+    {
+        httpctx->streamingCache->store(httpctx->tcphandle.loop,
+                                       httpctx->cacheFile,
+                                       store.first,
+                                       std::move(store.second));
+    }
+}
+
+void MegaHTTPServer::sendCachedBytes(MegaHTTPContext* httpctx)
+{
+    uv_os_fd_t socket;
+    if (int err = uv_fileno((uv_handle_t*)&httpctx->tcphandle, &socket))
+    {
+        onCacheSent(httpctx, err);
+        return;
+    }
+
+    auto len = std::min<m_off_t>(httpctx->cacheRemaining,
+                                 httpctx->streamingBuffer.getMaxOutputSize());
+
+    LOG_verbose << httpctx->getLogName() << "Writing " << len << " bytes from the streaming cache";
+
+    auto* send = new MegaHTTPContext::CacheSend(httpctx, static_cast<size_t>(len));
+    httpctx->cacheSend = send;
+
+    // Straight from the page cache to the socket, without copying through the buffer
+    if (int err = uv_fs_sendfile(httpctx->tcphandle.loop,
+                                 &send->fsreq,
+                                 socket,
+                                 send->file->descriptor(),
+                                 httpctx->cacheOffset,
+                                 send->len,
+                                 onCacheSendfile))
+    {
+        httpctx->cacheSend = nullptr;
+        delete send;
+        onCacheSent(httpctx, err);
+    }
+}
+
+void MegaHTTPServer::onCacheSendfile(uv_fs_t* req)
+{
+    auto* send = static_cast<MegaHTTPContext::CacheSend*>(req->data);
+    auto result = req->result;
+    uv_fs_req_cleanup(req);
+
+    MegaHTTPContext* httpctx = send->httpctx;
+    if (!httpctx || httpctx->finished)
+    {
+        if (httpctx)
+        {
+            httpctx->cacheSend = nullptr;
+        }
+
+        delete send;
+        return;
+    }
+
+    if (result == UV_EAGAIN)
+    {
+        // The socket is full: copy the data so that libuv writes it once there's room
+        send->buffer.reset(new char[send->len]);
+        uv_buf_t buf = uv_buf_init(send->buffer.get(), static_cast<unsigned>(send->len));
+
+        int err = uv_fs_read(httpctx->tcphandle.loop,
+                             &send->fsreq,
+                             send->file->descriptor(),
+                             &buf,
+                             1,
+                             httpctx->cacheOffset,
+                             onCacheRead);
+        if (!err)
+        {
+            return;
+        }
+
+        result = err;
+    }
+
+    httpctx->cacheSend = nullptr;
+    delete send;
+    onCacheSent(httpctx, result);
+}
+
+void MegaHTTPServer::onCacheRead(uv_fs_t* req)
+{
+    auto* send = static_cast<MegaHTTPContext::CacheSend*>(req->data);
+    auto result = req->result;
+    uv_fs_req_cleanup(req);
+
+    MegaHTTPContext* httpctx = send->httpctx;
+    if (!httpctx || httpctx->finished)
+    {
+        if (httpctx)
+        {
+            httpctx->cacheSend = nullptr;
+        }
+
+        delete send;
+        return;
+    }
+
+    if (result > 0)
+    {
+        send->len = static_cast<size_t>(result);
+        uv_buf_t buf = uv_buf_init(send->buffer.get(), static_cast<unsigned>(send->len));
+
+        int err = uv_write(&send->writereq,
+                           (uv_stream_t*)&httpctx->tcphandle,
+                           &buf,
+                           1,
+                           onCacheWritten);
+        if (!err)
+        {
+            return;
+        }
+
+        result = err;
+    }
+
+    httpctx->cacheSend = nullptr;
+    delete send;
+    onCacheSent(httpctx, result);
+}
+
+void MegaHTTPServer::onCacheWritten(uv_write_t* req, int status)
+{
+    auto* send = static_cast<MegaHTTPContext::CacheSend*>(req->data);
+
+    MegaHTTPContext* httpctx = send->httpctx;
+    if (!httpctx || httpctx->finished)
+    {
+        if (httpctx)
+        {
+            httpctx->cacheSend = nullptr;
+        }
+
+        delete send;
+        return;
+    }
+
+    ssize_t result = status < 0 ? status : static_cast<ssize_t>(send->len);
+
+    httpctx->cacheSend = nullptr;
+    delete send;
+    onCacheSent(httpctx, result);
+}
+
+void MegaHTTPServer::onCacheSent(MegaHTTPContext* httpctx, ssize_t result)
+{
+    // Nothing sent means the cache file is shorter than it should be
+    if (result <= 0)
+    {
+        LOG_warn << httpctx->getLogName()
+                 << "Finishing request. Write from the streaming cache failed: " << result;
+        closeConnection(httpctx);
+        return;
+    }
+
+    auto sent = static_cast<m_off_t>(result);
+
+    httpctx->bytesWritten += sent;
+    httpctx->rangeWritten += sent;
+    httpctx->cacheOffset += sent;
+    httpctx->cacheRemaining -= sent;
+
+    LOG_verbose << httpctx->getLogName() << "Bytes written from the streaming cache: " << sent
+                << " Remaining: " << (httpctx->size - httpctx->bytesWritten);
+
+    if (httpctx->size == httpctx->bytesWritten)
+    {
+        LOG_debug << httpctx->getLogName() << "Finishing request. All data sent";
+        if (httpctx->resultCode == API_EINTERNAL)
+        {
+            httpctx->resultCode = API_OK;
+        }
+
+        closeConnection(httpctx);
+        return;
+    }
+
+    sendNextBytes(httpctx);
+}
+
+void MegaHTTPServer::setStreamingCache(std::shared_ptr<StreamingCache> cache)
+{
+    std::atomic_store(&streamingCache, std::move(cache));
+}
+#endif
+
 std::atomic_uint32_t MegaHTTPContext::nextId{0u};
 
 MegaHTTPContext::MegaHTTPContext():
@@ -35647,6 +36879,12 @@ MegaHTTPContext::MegaHTTPContext():
     overwrite = true; //GVFS-DAV via command line does not include this header (assumed true)
     lastBuffer = NULL;
     lastBufferLen = 0;
+#ifndef _WIN32
+    cacheOffset = 0;
+    cacheRemaining = 0;
+    cacheSend = nullptr;
+    streamOffset = 0;
+#endif
 
     // Mutex to protect the data buffer
     uv_mutex_init(&mutex_responses);
@@ -35702,6 +36940,15 @@ bool MegaHTTPContext::onTransferData(MegaApi*,
         pause = true;
     }
     streamingBuffer.append(buffer, dataSize);
+#ifndef _WIN32
+    // so that later requests for this range, from this or other clients, don't download it
+    // again; it's written from the server's thread, so that this one doesn't wait for the disk
+    if (cacheFile)
+    {
+        cacheStores.emplace_back(streamOffset, std::string(buffer, dataSize));
+    }
+    streamOffset += static_cast<m_off_t>(dataSize);
+#endif
     uv_mutex_unlock(&mutex);
 
     // notify the HTTP server
@@ -40587,6 +41834,26 @@ MegaFuseExecutorFlags* MegaFuseFlagsPrivate::getSubsystemExecutorFlags()
     return &mSubsystemExecutorFlags;
 }
 
+size_t MegaFuseFlagsPrivate::getPartialReadBlockSize() const
+{
+    return mFlags.mPartialReadBlockSize;
+}
+
+size_t MegaFuseFlagsPrivate::getPartialReadAheadBlocks() const
+{
+    return mFlags.mPartialReadAheadBlocks;
+}
+
+void MegaFuseFlagsPrivate::setPartialReadBlockSize(size_t size)
+{
+    mFlags.mPartialReadBlockSize = size;
+}
+
+void MegaFuseFlagsPrivate::setPartialReadAheadBlocks(size_t count)
+{
+    mFlags.mPartialReadAheadBlocks = count;
+}
+
 void MegaFuseFlagsPrivate::setFlushDelay(size_t seconds)
 {
     mFlags.mFlushDelay = std::chrono::seconds(seconds);
@@ -1662,6 +1662,7 @@ void MegaClient::activateoverquota(dstime timeleft, bool isPaywall)
                 t->slot->retrying = true;
                 app->transfer_failed(t, API_EOVERQUOTA, timeleft);
                 ++performanceStats.transferTempErrors;
+                performanceStats.transferTempErrorsTotal.add();
             }
         }
     }
@@ -1682,6 +1683,7 @@ void MegaClient::activateoverquota(dstime timeleft, bool isPaywall)
                     t->slot->retrying = true;
                     app->transfer_failed(t, isPaywall ? API_EPAYWALL : API_EOVERQUOTA, 0);
                     ++performanceStats.transferTempErrors;
+                    performanceStats.transferTempErrorsTotal.add();
                 }
             }
         }
@@ -2226,6 +2228,14 @@ void MegaClient::exec()
         }
     }
 
+    // the DB cache was emptied as writes to it were lost: rewrite it, once per session
+    if (mDbWritesLost.exchange(false) && sctable && !mReloadedForLostDbWrites)
+    {
+        LOG_warn << "DB writes were lost - reloading local state";
+        mReloadedForLostDbWrites = true;
+        reloadFromServers();
+    }
+
     bool first = true;
     do
     {
@@ -3081,23 +3091,9 @@ void MegaClient::exec()
                                                      NetworkActivityType::REQUEST_RECEIVED,
                                                      e);
 
-                        // Stop the sc channel to prevent the reception of multiple
+                        // Stopping the sc channel prevents the reception of multiple
                         // API_ETOOMANY errors causing multiple consecutive reloads
-                        scsn.stopScsn();
-
-                        app->reloading();
-                        int creqtag = reqtag;
-                        reqtag = fetchnodestag; // associate with ongoing request, if any
-                        fetchingnodes = false;
-                        fetchnodestag = 0;
-
-                        // reloading mid-session so we definitely go to the servers
-                        // the node tree will be replaced when the reply arrives
-                        // actionpacketsCurrent will be reset at that time
-                        // nocache = true so that we get to an equal or later SCSN
-                        // right away.  The ir:1 mechanism is not reliable for this
-                        fetchnodes(true, false, true);
-                        reqtag = creqtag;
+                        reloadFromServers();
                     }
                     else if (e == API_EAGAIN || e == API_ERATELIMIT)
                     {
@@ -3977,6 +3973,9 @@ bool MegaClient::abortbackoff(bool includexfers)
 // activate enough queued transfers as necessary to keep the system busy - but not too busy
 void MegaClient::dispatchTransfers()
 {
+    performanceStats.transferSlots.set(static_cast<int64_t>(tslots.size()));
+    performanceStats.transfers.set(static_cast<int64_t>(multi_transfers[GET].size() + multi_transfers[PUT].size()));
+
     if (CancelToken::haveAnyCancelsOccurredSince(lastKnownCancelCount))
     {
         // first deal with the possibility of cancelled transfers
@@ -4609,6 +4608,7 @@ void MegaClient::dispatchTransfers()
                     app->transfer_update(nexttransfer);
 
                     performanceStats.transferStarts += 1;
+                    performanceStats.transferStartsTotal.add();
                 }
                 else if (openfinished)
                 {
@@ -4705,8 +4705,7 @@ void MegaClient::freeq(direction_t d)
         delete transferPtr.second;
     }
     multi_transfers[d].clear();
-    transferlist.transfers[GET].clear();
-    transferlist.transfers[PUT].clear();
+    transferlist.clear();
 }
 
 bool MegaClient::isFetchingNodesPendingCS()
@@ -5087,6 +5086,8 @@ void MegaClient::locallogout(bool removecaches, [[maybe_unused]] bool keepSyncsC
     mKeyManager.reset();
 
     mLastErrorDetected = REASON_ERROR_NO_ERROR;
+    mDbWritesLost = false;
+    mReloadedForLostDbWrites = false;
 
     mReqHashcashEasiness = 0;
     mReqHashcashToken.clear();
@@ -10312,10 +10313,13 @@ int MegaClient::readnodes(JSON* j, int notify, putsource_t source, vector<NewNod
         if (e != 1)
         {
             LOG_err << "Parsing error in readnodes: " << e;
+            mNodeDecryptions.clear();
             return 0;
         }
     }
 
+    flushNodeDecryptions();
+
     mergenewshares(notify != 0);
     mNodeManager.checkOrphanNodes(missingParentNodes);
 
@@ -10622,19 +10626,35 @@ int MegaClient::readnode(JSON* j,
                 }
             }
 
-            if (applykeys)
+            if (applykeys && !notify && mAsyncQueue.threadCount())
             {
-                n->applykey();
-            }
+                // decrypted with the rest of the batch, then saved in DB
+                mNodeDecryptions.emplace_back();
+                auto& decryption = mNodeDecryptions.back();
+                decryption.mPrepared = n->prepareKeyDecryption(decryption.mDecryption);
+                decryption.mNode = std::move(n);
 
-            if (notify)
-            {
-                // node is save in DB at notifypurge
-                mNodeManager.notifyNode(n);
+                if (mNodeDecryptions.size() >= NODE_DECRYPTION_BATCH)
+                {
+                    flushNodeDecryptions();
+                }
             }
-            else // Only need to save in DB if node is not notified
+            else
             {
-                mNodeManager.saveNodeInDb(n.get());
+                if (applykeys)
+                {
+                    n->applykey();
+                }
+
+                if (notify)
+                {
+                    // node is save in DB at notifypurge
+                    mNodeManager.notifyNode(n);
+                }
+                else // Only need to save in DB if node is not notified
+                {
+                    mNodeManager.saveNodeInDb(n.get());
+                }
             }
 
             n = nullptr;    // ownership is taken by NodeManager upon addNode()
@@ -10644,6 +10664,7 @@ int MegaClient::readnode(JSON* j,
             {
                 if (useralerts.isHandleInAlertsAsRemoved(h) && ISUNDEF(previousHandleForAlert))
                 {
+                    flushNodeDecryptions();
                     useralerts.setNewNodeAlertToUpdateNodeAlert(nodebyhandle(ph).get());
                     useralerts.removeNodeAlerts(nodebyhandle(h).get());
                     previousHandleForAlert = h;
@@ -10652,6 +10673,7 @@ int MegaClient::readnode(JSON* j,
                 {
                     if (previousHandleForAlert == ph)
                     {
+                        flushNodeDecryptions();
                         useralerts.removeNodeAlerts(nodebyhandle(h).get());
                         previousHandleForAlert = h;
                     }
@@ -10666,6 +10688,74 @@ int MegaClient::readnode(JSON* j,
     return 0;
 }
 
+void MegaClient::flushNodeDecryptions()
+{
+    if (mNodeDecryptions.empty())
+    {
+        return;
+    }
+
+    auto& batch = mNodeDecryptions;
+
+    // one slice per worker thread, plus the first one for this thread
+    size_t slices = std::min(mAsyncQueue.threadCount() + 1, batch.size());
+    size_t sliceSize = (batch.size() + slices - 1) / slices;
+    slices = (batch.size() + sliceSize - 1) / sliceSize;
+
+    auto decryptSlice = [&batch, sliceSize](size_t slice, SymmCipher& cipher)
+    {
+        size_t end = std::min(batch.size(), (slice + 1) * sliceSize);
+        for (size_t i = slice * sliceSize; i < end; ++i)
+        {
+            if (batch[i].mPrepared)
+            {
+                batch[i].mDecryption.decrypt(cipher);
+            }
+        }
+    };
+
+    std::mutex pendingMutex;
+    std::condition_variable pendingCV;
+    size_t pending = slices - 1;
+
+    vector<MegaClientAsyncQueue::Task> tasks;
+    for (size_t slice = 1; slice < slices; ++slice)
+    {
+        tasks.emplace_back([&, slice](SymmCipher& cipher)
+        {
+            decryptSlice(slice, cipher);
+
+            std::lock_guard<std::mutex> g(pendingMutex);
+            if (!--pending)
+            {
+                pendingCV.notify_one();
+            }
+        });
+    }
+    mAsyncQueue.push(std::move(tasks), false);
+
+    decryptSlice(0, tmpnodecipher);
+
+    {
+        std::unique_lock<std::mutex> g(pendingMutex);
+        pendingCV.wait(g, [&pending]() { return !pending; });
+    }
+
+    for (auto& decryption : batch)
+    {
+        auto node = std::move(decryption.mNode);
+
+        if (decryption.mPrepared)
+        {
+            node->applyKeyDecryption(decryption.mDecryption);
+        }
+
+        mNodeManager.saveNodeInDb(node.get());
+    }
+
+    batch.clear();
+}
+
 // decrypt and set encrypted sharekey
 void MegaClient::setkey(SymmCipher* c, const char* newKeyB64)
 {
@@ -12042,7 +12132,9 @@ void MegaClient::opensctable()
             int recycleDBVersion = (DbAccess::LEGACY_DB_VERSION == DbAccess::LAST_DB_VERSION_WITHOUT_NOD || DbAccess::LEGACY_DB_VERSION == DbAccess::LAST_DB_VERSION_WITHOUT_SRW) ?
                                             DB_OPEN_FLAG_RECYCLE :
                                             0;
-            sctable.reset(dbaccess->openTableWithNodes(rng, *fsaccess, dbname, recycleDBVersion, [this](DBError error)
+            int dbFlags = recycleDBVersion | (nodeSearchIndex ? DB_OPEN_FLAG_SEARCH_INDEX : 0) |
+                          (asyncDbWrites ? DB_OPEN_FLAG_ASYNC_WRITES : 0);
+            sctable.reset(dbaccess->openTableWithNodes(rng, *fsaccess, dbname, dbFlags, [this](DBError error)
             {
                 handleDbError(error);
             }));
@@ -15235,6 +15327,25 @@ string MegaClient::getTransferDBName()
     return dbname;
 }
 
+void MegaClient::reloadFromServers()
+{
+    scsn.stopScsn();
+
+    app->reloading();
+    int creqtag = reqtag;
+    reqtag = fetchnodestag; // associate with ongoing request, if any
+    fetchingnodes = false;
+    fetchnodestag = 0;
+
+    // reloading mid-session so we definitely go to the servers
+    // the node tree will be replaced when the reply arrives
+    // actionpacketsCurrent will be reset at that time
+    // nocache = true so that we get to an equal or later SCSN
+    // right away.  The ir:1 mechanism is not reliable for this
+    fetchnodes(true, false, true);
+    reqtag = creqtag;
+}
+
 void MegaClient::handleDbError(DBError error)
 {
     std::string reason;
@@ -15356,6 +15467,12 @@ void MegaClient::handleDbError(DBError error)
             sendevent(99471, reason.c_str(), 0);
             fatalError(ErrorReason::REASON_ERROR_DB_INDEX_OVERFLOW);
             return;
+        case DBError::DB_ERROR_WRITES_LOST:
+            // The error that lost them was handled already. Maybe reported by another thread,
+            // so the cache is reloaded by exec().
+            mDbWritesLost = true;
+            waiter->notify();
+            return;
         default:
             reason = "DB error: Unknown";
             sendevent(800025, reason.c_str(), 0);
@@ -16750,6 +16867,7 @@ void MegaClient::purgenodesusersabortsc(bool keepOwnUser)
         delete hdrns.begin()->second;
     }
 
+    mNodeDecryptions.clear();
     mNodeManager.cleanNodes();
 
 #ifdef ENABLE_SYNC
@@ -0,0 +1,271 @@
+/**
+ * @file metrics.cpp
+ * @brief Counters, gauges and latency histograms that can be turned on at runtime
+ *
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include "mega/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace mega {
+namespace metrics {
+
+std::atomic<bool> gEnabled{false};
+
+void setEnabled(bool enabled)
+{
+    gEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+Histogram* histogram(const string& name, const string& help)
+{
+    return &Registry::instance().histogram(name, help);
+}
+
+void record(Histogram& histogram, std::chrono::nanoseconds elapsed)
+{
+    histogram.record(elapsed);
+}
+
+namespace {
+
+unsigned highestBit(uint64_t value)
+{
+    assert(value);
+
+#if defined(__GNUC__) || defined(__clang__)
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    unsigned index = 0;
+    while (value >>= 1)
+        ++index;
+    return index;
+#endif
+}
+
+double seconds(uint64_t nanoseconds)
+{
+    return static_cast<double>(nanoseconds) / 1e9;
+}
+
+} // namespace
+
+void Histogram::record(std::chrono::nanoseconds elapsed)
+{
+    if (!enabled())
+        return;
+
+    auto nanoseconds = static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(elapsed.count(), 0));
+
+    mBuckets[bucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mSum.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::count() const
+{
+    return mCount.load(std::memory_order_relaxed);
+}
+
+std::chrono::nanoseconds Histogram::sum() const
+{
+    return std::chrono::nanoseconds(mSum.load(std::memory_order_relaxed));
+}
+
+std::chrono::nanoseconds Histogram::quantile(double q) const
+{
+    auto total = count();
+
+    if (!total)
+        return std::chrono::nanoseconds(0);
+
+    auto wanted = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(total))));
+    uint64_t seen = 0;
+
+    for (unsigned i = 0; i < BUCKETS; ++i)
+    {
+        seen += mBuckets[i].load(std::memory_order_relaxed);
+
+        if (seen >= wanted)
+            return std::chrono::nanoseconds(bucketEnd(i));
+    }
+
+    // Buckets were added to since the count was read.
+    return std::chrono::nanoseconds(bucketEnd(BUCKETS - 1));
+}
+
+uint64_t Histogram::countBelow(std::chrono::nanoseconds limit) const
+{
+    uint64_t result = 0;
+
+    for (unsigned i = 0; i < BUCKETS && static_cast<int64_t>(bucketEnd(i)) <= limit.count(); ++i)
+        result += mBuckets[i].load(std::memory_order_relaxed);
+
+    return result;
+}
+
+void Histogram::reset()
+{
+    for (auto& bucket : mBuckets)
+        bucket.store(0, std::memory_order_relaxed);
+
+    mCount.store(0, std::memory_order_relaxed);
+    mSum.store(0, std::memory_order_relaxed);
+}
+
+unsigned Histogram::bucket(uint64_t nanoseconds)
+{
+    // Exact, for the smallest values.
+    if (nanoseconds < SUB_BUCKETS)
+        return static_cast<unsigned>(nanoseconds);
+
+    // Otherwise, which doubling, and which part of it.
+    auto shift = highestBit(nanoseconds) - SUB_BUCKET_BITS;
+    auto index = (shift + 1) * SUB_BUCKETS + static_cast<unsigned>((nanoseconds >> shift) & (SUB_BUCKETS - 1));
+
+    return std::min(index, BUCKETS - 1);
+}
+
+uint64_t Histogram::bucketEnd(unsigned bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket + 1;
+
+    auto shift = bucket / SUB_BUCKETS - 1;
+    auto part = bucket % SUB_BUCKETS;
+
+    return static_cast<uint64_t>(SUB_BUCKETS + part + 1) << shift;
+}
+
+Registry& Registry::instance()
+{
+    static Registry registry;
+    return registry;
+}
+
+template<typename T>
+T& Registry::get(map<string, Named<T>>& metrics, const string& name, const string& help)
+{
+    lock_guard<mutex> guard(mMutex);
+
+    auto& named = metrics[name];
+
+    if (!named.metric)
+    {
+        assert(!mCounters.count(name) + !mGauges.count(name) + !mHistograms.count(name) == 2);
+
+        named.help = help;
+        named.metric.reset(new T);
+    }
+
+    return *named.metric;
+}
+
+Counter& Registry::counter(const string& name, const string& help)
+{
+    return get(mCounters, name, help);
+}
+
+Gauge& Registry::gauge(const string& name, const string& help)
+{
+    return get(mGauges, name, help);
+}
+
+Histogram& Registry::histogram(const string& name, const string& help)
+{
+    return get(mHistograms, name, help);
+}
+
+string Registry::prometheus() const
+{
+    lock_guard<mutex> guard(mMutex);
+
+    std::ostringstream ostream;
+
+    auto header = [&ostream](const string& name, const string& help, const char* type)
+    {
+        ostream << "# HELP " << name << " " << help << "\n"
+                << "# TYPE " << name << " " << type << "\n";
+    };
+
+    for (auto& entry : mCounters)
+    {
+        header(entry.first, entry.second.help, "counter");
+        ostream << entry.first << " " << entry.second.metric->value() << "\n";
+    }
+
+    for (auto& entry : mGauges)
+    {
+        header(entry.first, entry.second.help, "gauge");
+        ostream << entry.first << " " << entry.second.metric->value() << "\n";
+    }
+
+    for (auto& entry : mHistograms)
+    {
+        auto& histogram = *entry.second.metric;
+
+        header(entry.first, entry.second.help, "histogram");
+
+        // Cumulative counts every fourfold, from about a microsecond to about 18 minutes:
+        // powers of two are bucket boundaries, so these are exact.
+        uint64_t cumulative = 0;
+
+        for (unsigned power = 10; power <= 40; power += 2)
+        {
+            auto limit = uint64_t(1) << power;
+
+            cumulative = std::max(cumulative, histogram.countBelow(std::chrono::nanoseconds(limit)));
+
+            ostream << entry.first << "_bucket{le=\"" << seconds(limit) << "\"} " << cumulative << "\n";
+        }
+
+        // Read last, so that it's at least the count of any bucket above.
+        auto count = histogram.count();
+
+        ostream << entry.first << "_bucket{le=\"+Inf\"} " << std::max(count, cumulative) << "\n"
+                << entry.first << "_sum " << seconds(static_cast<uint64_t>(histogram.sum().count())) << "\n"
+                << entry.first << "_count " << std::max(count, cumulative) << "\n";
+    }
+
+    return ostream.str();
+}
+
+void Registry::reset()
+{
+    lock_guard<mutex> guard(mMutex);
+
+    for (auto& entry : mCounters)
+        entry.second.metric->reset();
+
+    for (auto& entry : mHistograms)
+        entry.second.metric->reset();
+}
+
+} // metrics
+} // mega
@@ -791,10 +791,27 @@ SymmCipher* Node::nodecipher()
     return client->getRecycledTemporaryNodeCipher(&nodekeydata);
 }
 
+// decrypt attributes and normalize the name
+bool Node::decryptattrs(SymmCipher* cipher, const string& attrstring, AttrMap& attrs)
+{
+    std::unique_ptr<byte[]> buf(decryptattr(cipher, attrstring.c_str(), attrstring.size()));
+    if (!buf)
+    {
+        return false;
+    }
+
+    attrs.fromjson(reinterpret_cast<char*>(buf.get()) + 5);
+
+    auto it = attrs.map.find('n');
+    if (it != std::end(attrs.map))
+        LocalPath::utf8_normalize(&it->second);
+
+    return true;
+}
+
 // decrypt attributes and build attribute hash
 void Node::setattr()
 {
-    byte* buf;
     SymmCipher* cipher;
 
     if (!attrstring)
@@ -808,19 +825,19 @@ void Node::setattr()
         return;
     }
 
-    buf = decryptattr(cipher, attrstring->c_str(), attrstring->size());
-    if (!buf)
+    AttrMap newAttrs;
+    if (!decryptattrs(cipher, *attrstring, newAttrs))
     {
         return;
     }
 
-    AttrMap oldAttrs(attrs);
-    attrs.map.clear();
-    attrs.fromjson(reinterpret_cast<char*>(buf) + 5);
+    setattrs(std::move(newAttrs));
+}
 
-    auto it = attrs.map.find('n');
-    if (it != std::end(attrs.map))
-        LocalPath::utf8_normalize(&it->second);
+void Node::setattrs(AttrMap&& newAttrs)
+{
+    AttrMap oldAttrs(std::move(attrs));
+    attrs = std::move(newAttrs);
 
     changed.name = attrs.hasDifferentValue('n', oldAttrs.map);
     changed.favourite = attrs.hasDifferentValue(AttrMap::string2nameid("fav"), oldAttrs.map);
@@ -837,8 +854,6 @@ void Node::setattr()
 
     setfingerprint();
 
-    delete[] buf;
-
     attrstring.reset();
 }
 
@@ -1142,6 +1157,21 @@ int Node::hasfileattribute(const string *fileattrstring, fatype t)
 
 // attempt to apply node key - sets nodekey to a raw key if successful
 bool Node::applykey()
+{
+    KeyDecryption decryption;
+
+    if (!prepareKeyDecryption(decryption))
+    {
+        return false;
+    }
+
+    decryption.decrypt(*client->getRecycledTemporaryNodeCipher(decryption.mWrappingKey));
+
+    return applyKeyDecryption(decryption);
+}
+
+// locate the node key meant for us and the key that wraps it
+bool Node::prepareKeyDecryption(KeyDecryption& decryption)
 {
     if (type > FOLDERNODE)
     {
@@ -1237,15 +1267,63 @@ bool Node::applykey()
         }
     }
 
-    byte key[FILENODEKEYLENGTH];
-    unsigned keylength = (type == FILENODE) ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH;
+    decryption.mKeyLength = (type == FILENODE) ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH;
+    decryption.mAttrString = attrstring.get();
+
+    // RSA needs the private key, so it's done here
+    const char* end = k;
+    while (*end && *end != '"' && *end != '/')
+    {
+        end++;
+    }
+
+    if (end - k > 4 * FILENODEKEYLENGTH / 3 + 1)
+    {
+        decryption.mKeyDecrypted = client->decryptkey(k, decryption.mKey, static_cast<int>(decryption.mKeyLength), sc, 0, nodehandle);
+    }
+    else
+    {
+        decryption.mWrappedKey = k;
+    }
+
+    memcpy(decryption.mWrappingKey, sc->key, sizeof decryption.mWrappingKey);
 
-    if (client->decryptkey(k, key, static_cast<int>(keylength), sc, 0, nodehandle))
+    return true;
+}
+
+void Node::KeyDecryption::decrypt(SymmCipher& cipher)
+{
+    if (mWrappedKey)
+    {
+        if (Base64::atob(mWrappedKey, mKey, static_cast<int>(mKeyLength)) != static_cast<int>(mKeyLength))
+        {
+            LOG_warn << "Corrupt or invalid symmetric node key";
+            return;
+        }
+
+        cipher.setkey(mWrappingKey);
+        cipher.ecb_decrypt(mKey, mKeyLength);
+        mKeyDecrypted = true;
+    }
+
+    if (mKeyDecrypted && mAttrString)
+    {
+        cipher.setkey(mKey, mKeyLength == FILENODEKEYLENGTH ? FILENODE : FOLDERNODE);
+        mAttrsDecrypted = decryptattrs(&cipher, *mAttrString, mAttrs);
+    }
+}
+
+bool Node::applyKeyDecryption(KeyDecryption& decryption)
+{
+    if (decryption.mKeyDecrypted)
     {
         std::string undecryptedKey = nodekeydata;
         client->mAppliedKeyNodeCount++;
-        nodekeydata.assign((const char*)key, keylength);
-        setattr();
+        nodekeydata.assign((const char*)decryption.mKey, decryption.mKeyLength);
+        if (decryption.mAttrsDecrypted)
+        {
+            setattrs(std::move(decryption.mAttrs));
+        }
         if (attrstring)
         {
             if (foreignkey)
@@ -2533,10 +2611,9 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
     {
         availableScanSlot = &sync->mActiveScanRequestGeneral;
     }
-    else if (neverScanned &&
-            (!sync->mActiveScanRequestUnscanned || sync->mActiveScanRequestUnscanned->completed()))
+    else if (neverScanned)
     {
-        availableScanSlot = &sync->mActiveScanRequestUnscanned;
+        availableScanSlot = sync->availableUnscannedScanSlot();
     }
 
     if (!ourScanRequest && availableScanSlot)
@@ -2613,14 +2690,17 @@ bool LocalNode::processBackgroundFolderScan(SyncRow& row, SyncPath& fullPath)
             rare().scanRequest = ourScanRequest;
             *availableScanSlot = ourScanRequest;
 
-            LOG_verbose << sync->syncname << "Issuing Directory scan request for : " << fullPath.localPath << (availableScanSlot == &sync->mActiveScanRequestUnscanned ? " (in unscanned slot)" : "");
+            LOG_verbose << sync->syncname << "Issuing Directory scan request for : " << fullPath.localPath << (availableScanSlot != &sync->mActiveScanRequestGeneral ? " (in unscanned slot)" : "");
         }
     }
     else if (ourScanRequest &&
              ourScanRequest->completed())
     {
         if (ourScanRequest == sync->mActiveScanRequestGeneral) sync->mActiveScanRequestGeneral.reset();
-        if (ourScanRequest == sync->mActiveScanRequestUnscanned) sync->mActiveScanRequestUnscanned.reset();
+        for (auto& slot : sync->mActiveScanRequestsUnscanned)
+        {
+            if (ourScanRequest == slot) slot.reset();
+        }
 
         scanInProgress = false;
 
@@ -4051,4 +4131,213 @@ NodeHandle NodeManagerNode::getNodeHandle() const
     return mNodeHandle;
 }
 
+NodeIndex::iterator::iterator(const NodeIndex* index, uint32_t position)
+    : mIndex(index)
+    , mPosition(position)
+{
+}
+
+NodeIndex::value_type& NodeIndex::iterator::operator*() const
+{
+    return *mIndex->entry(mPosition);
+}
+
+NodeIndex::value_type* NodeIndex::iterator::operator->() const
+{
+    return mIndex->entry(mPosition);
+}
+
+NodeIndex::iterator& NodeIndex::iterator::operator++()
+{
+    mPosition = mIndex->nextPosition(mPosition + 1);
+    return *this;
+}
+
+NodeIndex::~NodeIndex()
+{
+    clear();
+}
+
+NodeIndex::iterator NodeIndex::begin() const
+{
+    return iterator(this, nextPosition(0));
+}
+
+NodeIndex::iterator NodeIndex::end() const
+{
+    return iterator(this, NPOS);
+}
+
+NodeIndex::iterator NodeIndex::find(NodeHandle handle) const
+{
+    uint32_t slot = findSlot(handle);
+    return iterator(this, slot == NPOS ? NPOS : mTable[slot]);
+}
+
+std::pair<NodeIndex::iterator, bool> NodeIndex::emplace(NodeHandle handle, NodeManagerNode&& node)
+{
+    auto it = find(handle);
+    if (it != end())
+    {
+        return std::make_pair(it, false);
+    }
+
+    // keep the table at most 70% full, so probe sequences stay short
+    if ((mSize + 1) * 10 > mTable.size() * 7)
+    {
+        grow();
+    }
+
+    uint32_t position;
+    if (!mFreePositions.empty())
+    {
+        position = mFreePositions.back();
+        mFreePositions.pop_back();
+    }
+    else
+    {
+        position = mNumPositions++;
+        if (position / BLOCK_SIZE == mBlocks.size())
+        {
+            mBlocks.emplace_back(std::make_unique<Block>());
+        }
+    }
+
+    new (entry(position)) value_type(handle, std::move(node));
+    mBlocks[position / BLOCK_SIZE]->mUsed.set(position % BLOCK_SIZE);
+    insertSlot(position);
+    ++mSize;
+
+    return std::make_pair(iterator(this, position), true);
+}
+
+void NodeIndex::erase(iterator it)
+{
+    assert(it.mIndex == this && it != end());
+
+    uint32_t slot = findSlot(it->first);
+    assert(slot != NPOS && mTable[slot] == it.mPosition);
+
+    // backward shift deletion: move up any later entry of the probe sequence
+    // that would become unreachable once this slot is empty
+    uint32_t mask = static_cast<uint32_t>(mTable.size() - 1);
+    for (uint32_t next = (slot + 1) & mask; mTable[next] != NPOS; next = (next + 1) & mask)
+    {
+        uint32_t home = homeSlot(entry(mTable[next])->first);
+        bool reachable = slot <= next ? (home > slot && home <= next)
+                                      : (home > slot || home <= next);
+        if (!reachable)
+        {
+            mTable[slot] = mTable[next];
+            slot = next;
+        }
+    }
+    mTable[slot] = NPOS;
+
+    entry(it.mPosition)->~value_type();
+    mBlocks[it.mPosition / BLOCK_SIZE]->mUsed.reset(it.mPosition % BLOCK_SIZE);
+    mFreePositions.push_back(it.mPosition);
+    --mSize;
+}
+
+void NodeIndex::clear()
+{
+    for (auto it = begin(); it != end(); ++it)
+    {
+        it->~value_type();
+    }
+
+    mBlocks.clear();
+    mFreePositions.clear();
+    mNumPositions = 0;
+    mTable.clear();
+    mSize = 0;
+}
+
+bool NodeIndex::empty() const
+{
+    return !mSize;
+}
+
+size_t NodeIndex::size() const
+{
+    return mSize;
+}
+
+size_t NodeIndex::memoryUsage() const
+{
+    return mBlocks.size() * sizeof(Block)
+           + mFreePositions.capacity() * sizeof(uint32_t)
+           + mTable.capacity() * sizeof(uint32_t);
+}
+
+NodeIndex::value_type* NodeIndex::entry(uint32_t position) const
+{
+    assert(position < mNumPositions);
+    auto* storage = mBlocks[position / BLOCK_SIZE]->mStorage;
+    return std::launder(reinterpret_cast<value_type*>(storage) + position % BLOCK_SIZE);
+}
+
+uint32_t NodeIndex::homeSlot(NodeHandle handle) const
+{
+    // handles are random already, multiply them only to spread the high bits
+    uint64_t hash = handle.as8byte() * 0x9E3779B97F4A7C15ull;
+    return static_cast<uint32_t>(hash >> 32) & static_cast<uint32_t>(mTable.size() - 1);
+}
+
+uint32_t NodeIndex::findSlot(NodeHandle handle) const
+{
+    if (mTable.empty())
+    {
+        return NPOS;
+    }
+
+    uint32_t mask = static_cast<uint32_t>(mTable.size() - 1);
+    for (uint32_t slot = homeSlot(handle); mTable[slot] != NPOS; slot = (slot + 1) & mask)
+    {
+        if (entry(mTable[slot])->first == handle)
+        {
+            return slot;
+        }
+    }
+
+    return NPOS;
+}
+
+uint32_t NodeIndex::nextPosition(uint32_t position) const
+{
+    for (; position < mNumPositions; ++position)
+    {
+        if (mBlocks[position / BLOCK_SIZE]->mUsed.test(position % BLOCK_SIZE))
+        {
+            return position;
+        }
+    }
+
+    return NPOS;
+}
+
+void NodeIndex::insertSlot(uint32_t position)
+{
+    uint32_t mask = static_cast<uint32_t>(mTable.size() - 1);
+    uint32_t slot = homeSlot(entry(position)->first);
+
+    while (mTable[slot] != NPOS)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    mTable[slot] = position;
+}
+
+void NodeIndex::grow()
+{
+    mTable.assign(std::max<size_t>(mTable.size() * 2, 64), NPOS);
+
+    for (uint32_t position = nextPosition(0); position != NPOS; position = nextPosition(position + 1))
+    {
+        insertSlot(position);
+    }
+}
+
 } // namespace
@@ -285,7 +285,7 @@ bool NodeManager::addNode_internal(std::shared_ptr<Node> node, bool notify, bool
 {
     assert(mMutex.owns_lock());
     // ownership of 'node' is taken by NodeManager::mNodes if node is kept in memory,
-    // and by NodeManager::mNodeToWriteInDB if node is only written to DB. In the latter,
+    // and by NodeManager::mNodesToWriteInDb if node is only written to DB. In the latter,
     // the 'node' is deleted upon saveNodeInDb()
 
     // 'isFetching' is true only when CommandFetchNodes is in flight and/or it has been received,
@@ -314,8 +314,8 @@ bool NodeManager::addNode_internal(std::shared_ptr<Node> node, bool notify, bool
     else
     {
         // still keep it in memory temporary, until saveNodeInDb()
-        assert(!mNodeToWriteInDb);
-        mNodeToWriteInDb = node;
+        assert(!mNodesToWriteInDb.count(node->nodeHandle()));
+        mNodesToWriteInDb.emplace(node->nodeHandle(), node);
 
         // when keepNodeInMemory is true, NodeManager::addChild is called by Node::setParent (from NodeManager::saveNodeInRAM)
         auto pair = mNodes.emplace(node->nodeHandle(), NodeManagerNode(*this, node->nodeHandle()));
@@ -369,10 +369,31 @@ void NodeManager::reportNullRootNodes(const size_t rootNodesSize)
 
 std::shared_ptr<Node> NodeManager::getNodeByHandle(NodeHandle handle)
 {
+    {
+        SharedLockGuard g(mMutex);
+
+        if (auto node = getNodeByHandle_shared(handle))
+        {
+            return node;
+        }
+    }
+
     LockGuard g(mMutex);
     return getNodeByHandle_internal(handle);
 }
 
+std::shared_ptr<Node> NodeManager::getNodeByHandle_shared(NodeHandle handle)
+{
+    auto itNode = mNodes.find(handle);
+
+    if (itNode == mNodes.end())
+    {
+        return nullptr;
+    }
+
+    return getNodeInCacheLRU_shared(itNode->second);
+}
+
 std::shared_ptr<Node> NodeManager::getNodeByHandle_internal(NodeHandle handle)
 {
     assert(mMutex.owns_lock());
@@ -386,7 +407,9 @@ std::shared_ptr<Node> NodeManager::getNodeByHandle_internal(NodeHandle handle)
     std::shared_ptr<Node> node = getNodeInRAM(handle);
     if (!node)
     {
-        node = getNodeFromDataBase(handle);
+        // nodes whose keys are decrypted in a batch wait a bit longer to be written
+        auto it = mNodesToWriteInDb.find(handle);
+        node = it != mNodesToWriteInDb.end() ? it->second : getNodeFromDataBase(handle);
     }
 
     return node;
@@ -396,10 +419,59 @@ sharedNode_list NodeManager::getChildren(const Node* parent,
                                          CancelToken cancelToken,
                                          bool includeVersions)
 {
+    {
+        SharedLockGuard g(mMutex);
+
+        if (auto children = getChildren_shared(parent, cancelToken))
+        {
+            return std::move(*children);
+        }
+    }
+
     LockGuard g(mMutex);
     return getChildren_internal(parent, cancelToken, includeVersions);
 }
 
+std::optional<sharedNode_list> NodeManager::getChildren_shared(const Node* parent,
+                                                               CancelToken cancelToken)
+{
+    sharedNode_list childrenList;
+    if (!parent || !mTable || mNodes.empty())
+    {
+        return childrenList;
+    }
+
+    // otherwise, some children would have to be loaded from DB
+    if (!parent->mNodePosition->second.mAllChildrenHandleLoaded)
+    {
+        return std::nullopt;
+    }
+
+    if (!parent->mNodePosition->second.mChildren)
+    {
+        return childrenList;
+    }
+
+    for (const auto& child : *parent->mNodePosition->second.mChildren)
+    {
+        if (cancelToken.isCancelled())
+        {
+            childrenList.clear();
+            return childrenList;
+        }
+
+        shared_ptr<Node> node = child.second ? getNodeInCacheLRU_shared(*child.second) : nullptr;
+        if (!node)
+        {
+            return std::nullopt;
+        }
+
+        childrenList.push_back(std::move(node));
+    }
+
+    return childrenList;
+}
+
 sharedNode_list NodeManager::getChildren_internal(const Node* parent,
                                                   CancelToken cancelToken,
                                                   bool includeVersions)
@@ -802,10 +874,44 @@ sharedNode_vector NodeManager::getNodesWithLinks()
 
 sharedNode_vector NodeManager::getNodesByFingerprint(const FileFingerprint& fingerprint)
 {
+    {
+        SharedLockGuard g(mMutex);
+
+        if (auto nodes = getNodesByFingerprint_shared(fingerprint))
+        {
+            return std::move(*nodes);
+        }
+    }
+
     LockGuard g(mMutex);
     return getNodesByFingerprint_internal(fingerprint);
 }
 
+std::optional<sharedNode_vector> NodeManager::getNodesByFingerprint_shared(const FileFingerprint& fingerprint)
+{
+    // otherwise, the DB would have to be looked up
+    if (!mTable || mNodes.empty() || !mFingerPrints.allFingerprintsAreLoaded(&fingerprint))
+    {
+        return std::nullopt;
+    }
+
+    sharedNode_vector nodes;
+    auto p = mFingerPrints.equal_range(&fingerprint);
+    for (auto it = p.first; it != p.second; ++it)
+    {
+        const auto node = static_cast<const Node*>(*it);
+        std::shared_ptr<Node> sharedNode = getNodeInCacheLRU_shared(node->mNodePosition->second);
+        if (!sharedNode)
+        {
+            return std::nullopt;
+        }
+
+        nodes.push_back(std::move(sharedNode));
+    }
+
+    return nodes;
+}
+
 sharedNode_vector NodeManager::getNodesByFingerprint_internal(const FileFingerprint& fingerprint)
 {
     assert(mMutex.owns_lock());
@@ -900,6 +1006,20 @@ sharedNode_vector NodeManager::getNodesByOrigFingerprint_internal(const std::str
 
 std::shared_ptr<Node> NodeManager::getNodeByFingerprint(FileFingerprint &fingerprint)
 {
+    {
+        SharedLockGuard g(mMutex);
+
+        auto it = mTable ? mFingerPrints.find(&fingerprint) : mFingerPrints.end();
+        if (it != mFingerPrints.end())
+        {
+            const auto n = static_cast<const Node*>(*it);
+            if (auto node = getNodeInCacheLRU_shared(n->mNodePosition->second))
+            {
+                return node;
+            }
+        }
+    }
+
     LockGuard g(mMutex);
     return getNodeByFingerprint_internal(fingerprint);
 }
@@ -1368,8 +1488,17 @@ void NodeManager::cleanNodes_internal()
     mFingerPrints.clear();
     mNodes.clear();
     mCacheLRU.clear();
+
+    // Touches not replayed yet would keep their nodes alive past the logout.
+    std::vector<std::shared_ptr<Node>> pending;
+    {
+        std::lock_guard<std::mutex> g(mPendingCacheLRUMutex);
+        pending.swap(mPendingCacheLRU);
+    }
+    pending.clear();
+
     mNodesInRam = 0;
-    mNodeToWriteInDb.reset();
+    mNodesToWriteInDb.clear();
     mNodeNotify.clear();
 
     rootnodes.clear();
@@ -1613,6 +1742,37 @@ shared_ptr<Node> NodeManager::getNodeInRAM(NodeHandle handle)
     return nullptr;
 }
 
+shared_ptr<Node> NodeManager::getNodeInCacheLRU_shared(NodeManagerNode& nodeManagerNode)
+{
+    // nodes out of the LRU have to be inserted again and get their fingerprint
+    // back, which needs the mutex held exclusively
+    if (nodeManagerNode.mLRUPosition == invalidCacheLRUPos())
+    {
+        return nullptr;
+    }
+
+    shared_ptr<Node> node = nodeManagerNode.getNodeInRam(false);
+    if (!node || !queueCacheLRU_shared(node))
+    {
+        return nullptr;
+    }
+
+    return node;
+}
+
+bool NodeManager::queueCacheLRU_shared(shared_ptr<Node> node)
+{
+    std::lock_guard<std::mutex> g(mPendingCacheLRUMutex);
+
+    if (mPendingCacheLRU.size() >= MAX_PENDING_CACHE_LRU)
+    {
+        return false;
+    }
+
+    mPendingCacheLRU.push_back(std::move(node));
+    return true;
+}
+
 void NodeManager::saveNodeInRAM(std::shared_ptr<Node> node, bool isRootnode, MissingParentNodes& missingParentNodes)
 {
     assert(mMutex.owns_lock());
@@ -1658,7 +1818,7 @@ void NodeManager::saveNodeInRAM(std::shared_ptr<Node> node, bool isRootnode, Mis
 
 bool NodeManager::isRootNode(NodeHandle h) const
 {
-    LockGuard g(mMutex);
+    SharedLockGuard g(mMutex);
 
     return rootnodes.isRootNode(h);
 }
@@ -1678,17 +1838,17 @@ int NodeManager::getNumVersions(NodeHandle nodeHandle)
 
 NodeHandle NodeManager::getRootNodeFiles() const
 {
-    LockGuard g(mMutex);
+    SharedLockGuard g(mMutex);
     return rootnodes.files;
 }
 NodeHandle NodeManager::getRootNodeVault() const
 {
-    LockGuard g(mMutex);
+    SharedLockGuard g(mMutex);
     return rootnodes.vault;
 }
 NodeHandle NodeManager::getRootNodeRubbish() const
 {
-    LockGuard g(mMutex);
+    SharedLockGuard g(mMutex);
     return rootnodes.rubbish;
 }
 void NodeManager::setRootNodeFiles(NodeHandle h)
@@ -1799,6 +1959,7 @@ void NodeManager::setCacheLRUMaxSize(uint64_t cacheLRUMaxSize)
 uint64_t NodeManager::getNumNodesAtCacheLRU() const
 {
     LockGuard g(mMutex);
+    const_cast<NodeManager*>(this)->applyPendingCacheLRU();
     return mCacheLRU.size();
 }
 
@@ -1827,6 +1988,11 @@ void NodeManager::initCompleted_internal()
 
     mTable->createIndexes();
     mInitialized = true;
+
+    if (SimpleLogger::getLogLevel() >= logDebug)
+    {
+        reportMemoryUsage();
+    }
 }
 
 bool NodeManager::ready()
@@ -1856,6 +2022,8 @@ void NodeManager::insertNodeCacheLRU_internal(std::shared_ptr<Node> node)
 void NodeManager::unLoadNodeFromCacheLRU()
 {
     assert(mMutex.owns_lock() && "Mutex should be locked by this thread");
+    applyPendingCacheLRU();
+
     while (mCacheLRU.size() > mCacheLRUMaxSize)
     {
         std::shared_ptr<Node> node = mCacheLRU.back();
@@ -1865,6 +2033,34 @@ void NodeManager::unLoadNodeFromCacheLRU()
     }
 }
 
+void NodeManager::applyPendingCacheLRU()
+{
+    assert(mMutex.owns_lock() && "Mutex should be locked by this thread");
+
+    std::vector<std::shared_ptr<Node>> pending;
+    {
+        std::lock_guard<std::mutex> g(mPendingCacheLRUMutex);
+        pending.swap(mPendingCacheLRU);
+    }
+
+    // Replay the touches in the order they were made. Nodes removed or unloaded
+    // from the LRU meanwhile are skipped: that happened after their lookup.
+    for (auto& node : pending)
+    {
+        auto itNode = mNodes.find(node->nodeHandle());
+        if (itNode == mNodes.end() || itNode->second.getNodeInRam(false) != node)
+        {
+            continue;
+        }
+
+        auto position = itNode->second.mLRUPosition;
+        if (position != invalidCacheLRUPos())
+        {
+            mCacheLRU.splice(mCacheLRU.begin(), mCacheLRU, position);
+        }
+    }
+}
+
 NodeCounter NodeManager::getCounterOfRootNodes()
 {
     LockGuard g(mMutex);
@@ -1956,7 +2152,7 @@ FingerprintPosition NodeManager::insertFingerprint_internal(Node *node)
 
     // if node is not to be kept in memory, don't save the pointer in the set
     // since it will be invalid once node is written to DB
-    if (node->type == FILENODE && mNodeToWriteInDb.get() != node)
+    if (node->type == FILENODE && !mNodesToWriteInDb.count(node->nodeHandle()))
     {
         return mFingerPrints.insert(node);
     }
@@ -2046,11 +2242,12 @@ void NodeManager::saveNodeInDb_internal(Node *node)
 
     putNodeInDb(node);
 
-    if (mNodeToWriteInDb)   // not to be kept in memory
+    auto it = mNodesToWriteInDb.find(node->nodeHandle());
+    if (it != mNodesToWriteInDb.end())   // not to be kept in memory
     {
-        assert(mNodeToWriteInDb.get() == node);
-        assert(mNodeToWriteInDb.use_count() == 2);
-        mNodeToWriteInDb.reset();
+        assert(it->second.get() == node);
+        assert(it->second.use_count() == 2);
+        mNodesToWriteInDb.erase(it);
     }
 }
 
@@ -2060,6 +2257,110 @@ uint64_t NodeManager::getNumberNodesInRam() const
     return mNodesInRam;
 }
 
+namespace
+{
+
+// per node bookkeeping of std::map/std::set (color and three links) and std::list
+constexpr size_t TREE_NODE_OVERHEAD = sizeof(int) + 3 * sizeof(void*);
+constexpr size_t LIST_NODE_OVERHEAD = 2 * sizeof(void*);
+
+size_t heapBytes(const std::string& s)
+{
+    // short strings fit in the object itself
+    return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+}
+
+size_t heapBytes(const Node& node)
+{
+    // Nodes are created with new, so their shared_ptr has a separate control block
+    size_t bytes = sizeof(Node) + 3 * sizeof(void*);
+
+    bytes += heapBytes(node.fileattrstring) + heapBytes(node.nodekey());
+
+    if (node.attrstring)
+    {
+        bytes += sizeof(std::string) + heapBytes(*node.attrstring);
+    }
+
+    for (const auto& attr : node.attrs.map)
+    {
+        bytes += TREE_NODE_OVERHEAD + sizeof(attr) + heapBytes(attr.second);
+    }
+
+    if (node.outshares)
+    {
+        bytes += node.outshares->size() * (TREE_NODE_OVERHEAD + sizeof(share_map::value_type) + sizeof(Share));
+    }
+
+    if (node.pendingshares)
+    {
+        bytes += node.pendingshares->size() * (TREE_NODE_OVERHEAD + sizeof(share_map::value_type) + sizeof(Share));
+    }
+
+    if (node.plink)
+    {
+        bytes += sizeof(PublicLink);
+    }
+
+    return bytes;
+}
+
+} // namespace
+
+size_t NodeManager::MemoryUsage::total() const
+{
+    return mIndex + mChildren + mNodesInRam + mCacheLRU + mFingerprints;
+}
+
+NodeManager::MemoryUsage NodeManager::getMemoryUsage()
+{
+    LockGuard g(mMutex);
+
+    MemoryUsage usage;
+    usage.mIndex = mNodes.memoryUsage();
+
+    for (auto& it : mNodes)
+    {
+        if (const auto& children = it.second.mChildren)
+        {
+            usage.mChildren += sizeof(*children)
+                               + children->size() * (TREE_NODE_OVERHEAD + sizeof(std::pair<NodeHandle, NodeManagerNode*>));
+        }
+
+        if (shared_ptr<Node> node = it.second.getNodeInRam(false))
+        {
+            usage.mNodesInRam += heapBytes(*node);
+        }
+    }
+
+    usage.mCacheLRU = mCacheLRU.size() * (LIST_NODE_OVERHEAD + sizeof(std::shared_ptr<Node>));
+    usage.mFingerprints = mFingerPrints.size() * (TREE_NODE_OVERHEAD + sizeof(FileFingerprint*));
+
+    return usage;
+}
+
+void NodeManager::reportMemoryUsage()
+{
+    MemoryUsage usage = getMemoryUsage();
+
+    uint64_t numNodes = getNodeCount();
+    uint64_t numNodesInRam = getNumberNodesInRam();
+
+    auto perNode = [](size_t bytes, uint64_t nodes)
+    {
+        return nodes ? bytes / nodes : 0;
+    };
+
+    LOG_debug << "Node cache memory usage (bytes, bytes per node):"
+              << " index " << usage.mIndex << ", " << perNode(usage.mIndex, numNodes)
+              << " children " << usage.mChildren << ", " << perNode(usage.mChildren, numNodes)
+              << " nodes in RAM " << usage.mNodesInRam << ", " << perNode(usage.mNodesInRam, numNodesInRam)
+              << " LRU " << usage.mCacheLRU
+              << " fingerprints " << usage.mFingerprints
+              << " total " << usage.total()
+              << " (" << numNodes << " nodes, " << numNodesInRam << " in RAM)";
+}
+
 void NodeManager::addChild(NodeHandle parent, NodeHandle child, Node* node)
 {
     LockGuard g(mMutex);
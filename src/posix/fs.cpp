@@ -56,9 +56,15 @@ extern jclass fileWrapper;
 #include <linux/magic.h>
 #endif /* ! __ANDROID__ */
 
+#include <sys/syscall.h>
 #include <sys/sysmacros.h>
 #include <sys/vfs.h>
 
+// statx(...) is available from glibc 2.28.
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 28))
+#define HAVE_STATX
+#endif
+
 #ifndef FUSEBLK_SUPER_MAGIC
 #define FUSEBLK_SUPER_MAGIC 0x65735546ul
 #endif /* ! FUSEBLK_SUPER_MAGIC */
@@ -835,6 +841,23 @@ PosixFileSystemAccess::PosixFileSystemAccess()
 
 bool LinuxFileSystemAccess::initFilesystemNotificationSystem()
 {
+#ifdef HAVE_FANOTIFY
+    // Watching whole filesystems costs the same however many directories they have. They see
+    // every change there, not just those in our syncs: their events mustn't overflow the queue.
+    mFanotifyFd = fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_UNLIMITED_QUEUE
+                                    | FAN_CLOEXEC | FAN_NONBLOCK,
+                                O_RDONLY | O_LARGEFILE);
+
+    if (mFanotifyFd < 0)
+    {
+        // Usually we're not privileged enough: watch each directory instead.
+        LOG_debug << "Unable to use fanotify, using inotify. Error: " << errno;
+
+        mFanotifyFd = -errno;
+    }
+#endif // HAVE_FANOTIFY
+
+    // Also used for filesystems fanotify can't watch.
     mNotifyFd = inotify_init1(IN_NONBLOCK);
 
     if (mNotifyFd < 0)
@@ -842,6 +865,75 @@ bool LinuxFileSystemAccess::initFilesystemNotificationSystem()
 
     return true;
 }
+
+#ifdef HAVE_FANOTIFY
+
+// What we watch whole filesystems for: the same as we ask inotify for.
+static constexpr uint64_t FANOTIFY_EVENTS = FAN_ATTRIB | FAN_CLOSE_WRITE | FAN_CREATE | FAN_DELETE
+                                            | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_ONDIR;
+
+bool LinuxFileSystemAccess::fanotifyWatch(const LocalPath& path, uint64_t& filesystem)
+{
+    if (mFanotifyFd < 0)
+        return false;
+
+    auto pathStr = path.toPath(false);
+
+    struct statfs metadata;
+
+    if (statfs(pathStr.c_str(), &metadata))
+        return false;
+
+    static_assert(sizeof(metadata.f_fsid) == sizeof(filesystem), "Unexpected fsid size");
+    memcpy(&filesystem, &metadata.f_fsid, sizeof(filesystem));
+
+    auto& watched = mFanotifyFilesystems[filesystem];
+
+    if (watched.mNotifiers)
+        return ++watched.mNotifiers, true;
+
+    // Events report the directory by handle, resolved relative to this.
+    watched.mMountFd = open(pathStr.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (watched.mMountFd < 0
+        || fanotify_mark(mFanotifyFd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, FANOTIFY_EVENTS, AT_FDCWD, pathStr.c_str()))
+    {
+        // For instance, the filesystem can't encode file handles.
+        LOG_warn << "Unable to watch filesystem with fanotify, using inotify: " << path
+                 << ". Error: " << errno;
+
+        if (watched.mMountFd >= 0)
+            close(watched.mMountFd);
+
+        mFanotifyFilesystems.erase(filesystem);
+        return false;
+    }
+
+    LOG_debug << "Watching filesystem with fanotify: " << path;
+
+    watched.mNotifiers = 1;
+    return true;
+}
+
+void LinuxFileSystemAccess::fanotifyUnwatch(uint64_t filesystem)
+{
+    auto it = mFanotifyFilesystems.find(filesystem);
+
+    if (it == mFanotifyFilesystems.end() || --it->second.mNotifiers)
+        return;
+
+    fanotify_mark(mFanotifyFd,
+                  FAN_MARK_REMOVE | FAN_MARK_FILESYSTEM,
+                  FANOTIFY_EVENTS,
+                  it->second.mMountFd,
+                  nullptr);
+
+    close(it->second.mMountFd);
+    mFanotifyFilesystems.erase(it);
+}
+
+#endif // HAVE_FANOTIFY
+
 #endif // ENABLE_SYNC
 
 LinuxFileSystemAccess::~LinuxFileSystemAccess()
@@ -855,6 +947,14 @@ LinuxFileSystemAccess::~LinuxFileSystemAccess()
     if (mNotifyFd >= 0)
         close(mNotifyFd);
 
+#ifdef HAVE_FANOTIFY
+    for (auto& filesystem : mFanotifyFilesystems)
+        close(filesystem.second.mMountFd);
+
+    if (mFanotifyFd >= 0)
+        close(mFanotifyFd);
+#endif // HAVE_FANOTIFY
+
 #endif // ENABLE_SYNC
 }
 
@@ -895,11 +995,21 @@ void LinuxFileSystemAccess::addevents([[maybe_unused]] Waiter* waiter, int /*fla
 {
 #ifdef ENABLE_SYNC
 
+    auto w = static_cast<PosixWaiter*>(waiter);
+
+#ifdef HAVE_FANOTIFY
+    if (mFanotifyFd >= 0)
+    {
+        MEGA_FD_SET(mFanotifyFd, &w->rfds);
+        MEGA_FD_SET(mFanotifyFd, &w->ignorefds);
+
+        w->bumpmaxfd(mFanotifyFd);
+    }
+#endif // HAVE_FANOTIFY
+
     if (mNotifyFd < 0)
         return;
 
-    auto w = static_cast<PosixWaiter*>(waiter);
-
     MEGA_FD_SET(mNotifyFd, &w->rfds);
     MEGA_FD_SET(mNotifyFd, &w->ignorefds);
 
@@ -915,6 +1025,12 @@ int LinuxFileSystemAccess::checkevents([[maybe_unused]] Waiter* waiter)
 
 #ifdef ENABLE_SYNC
 
+    auto* w = static_cast<PosixWaiter*>(waiter);
+
+#ifdef HAVE_FANOTIFY
+    result |= checkFanotifyEvents(*w);
+#endif // HAVE_FANOTIFY
+
     if (mNotifyFd < 0)
         return result;
 
@@ -924,8 +1040,6 @@ int LinuxFileSystemAccess::checkevents([[maybe_unused]] Waiter* waiter)
             ++notifier->mErrorCount;
     };
 
-    auto* w = static_cast<PosixWaiter*>(waiter);
-
     if (!MEGA_FD_ISSET(mNotifyFd, &w->rfds))
         return result;
 
@@ -1027,6 +1141,130 @@ int LinuxFileSystemAccess::checkevents([[maybe_unused]] Waiter* waiter)
     return result;
 }
 
+#if defined(ENABLE_SYNC) && defined(HAVE_FANOTIFY)
+
+int LinuxFileSystemAccess::checkFanotifyEvents(PosixWaiter& waiter)
+{
+    int result = 0;
+
+    if (mFanotifyFd < 0 || !MEGA_FD_ISSET(mFanotifyFd, &waiter.rfds))
+        return result;
+
+    alignas(fanotify_event_metadata) char buf[16384];
+    ssize_t length;
+
+    while ((length = read(mFanotifyFd, buf, sizeof(buf))) > 0)
+    {
+        auto* event = reinterpret_cast<fanotify_event_metadata*>(buf);
+
+        for ( ; FAN_EVENT_OK(event, length); event = FAN_EVENT_NEXT(event, length))
+        {
+            if ((event->mask & FAN_Q_OVERFLOW))
+            {
+                LOG_err << "fanotify FAN_Q_OVERFLOW";
+
+                // Make the syncs watched through fanotify perform a rescan.
+                for (auto* notifier : mNotifiers)
+                {
+                    if (static_cast<LinuxDirNotify*>(notifier)->mFanotify)
+                        ++notifier->mErrorCount;
+                }
+
+                continue;
+            }
+
+            // We asked for the directory's handle and the entry's name.
+            auto* info = reinterpret_cast<fanotify_event_info_fid*>(event + 1);
+
+            if (event->event_len < sizeof(*event) + sizeof(*info)
+                || info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME)
+                continue;
+
+            auto* directory = reinterpret_cast<struct file_handle*>(info->handle);
+            auto* name = reinterpret_cast<const char*>(directory->f_handle + directory->handle_bytes);
+
+            // Events on a directory itself, such as FAN_ATTRIB, report it as "." in itself.
+            if (!strcmp(name, "."))
+                name = "";
+
+            uint64_t filesystem;
+            memcpy(&filesystem, &info->fsid, sizeof(filesystem));
+
+            // Most events are for directories we don't watch.
+            auto associated = mFanotifyWatches.equal_range(fanotifyKey(filesystem, *directory));
+
+            if (associated.first == associated.second)
+                continue;
+
+            LOG_verbose << "Filesystem notification:"
+                << " event " << name << ": " << std::hex << event->mask;
+
+            for (auto i = associated.first; i != associated.second; ++i)
+            {
+                auto& node = *i->second->second.first;
+                auto& notifier = static_cast<LinuxDirNotify&>(*node.sync->dirnotify);
+
+                LOG_debug << "Filesystem notification:"
+                    << " Root: "
+                    << node.localname
+                    << " Path: "
+                    << name;
+
+                notifier.notify(notifier.fsEventq,
+                                &node,
+                                Notification::NEEDS_PARENT_SCAN,
+                                LocalPath::fromPlatformEncodedRelative(name));
+
+                // As for inotify, we may not have been able to list the directory before.
+                if ((event->mask & (FAN_ATTRIB | FAN_ONDIR)) == (FAN_ATTRIB | FAN_ONDIR))
+                    notifier.notify(notifier.fsEventq,
+                                    &node,
+                                    Notification::FOLDER_NEEDS_SELF_SCAN,
+                                    LocalPath::fromPlatformEncodedRelative(name));
+
+                result |= Waiter::NEEDEXEC;
+            }
+        }
+    }
+
+    return result;
+}
+
+string LinuxFileSystemAccess::fanotifyKey(uint64_t filesystem, const struct file_handle& directory)
+{
+    string key(reinterpret_cast<const char*>(&filesystem), sizeof(filesystem));
+
+    key.append(reinterpret_cast<const char*>(&directory.handle_type), sizeof(directory.handle_type));
+    key.append(reinterpret_cast<const char*>(directory.f_handle), directory.handle_bytes);
+
+    return key;
+}
+
+string LinuxFileSystemAccess::fanotifyKey(uint64_t filesystem, const LocalPath& path)
+{
+    // Large enough for any handle.
+    union
+    {
+        struct file_handle directory;
+        char storage[sizeof(struct file_handle) + MAX_HANDLE_SZ];
+    } buffer;
+
+    buffer.directory.handle_bytes = MAX_HANDLE_SZ;
+
+    auto pathStr = path.toPath(false);
+    int mountId;
+
+    // Events carry the handles meant for identifying files, when the kernel tells them apart.
+    if (name_to_handle_at(AT_FDCWD, pathStr.c_str(), &buffer.directory, &mountId, AT_HANDLE_FID)
+        && (errno != EINVAL
+            || name_to_handle_at(AT_FDCWD, pathStr.c_str(), &buffer.directory, &mountId, 0)))
+        return string();
+
+    return fanotifyKey(filesystem, buffer.directory);
+}
+
+#endif // ENABLE_SYNC && HAVE_FANOTIFY
+
 #endif //  __linux__
 
 
@@ -1667,6 +1905,14 @@ LinuxDirNotify::LinuxDirNotify(LinuxFileSystemAccess& owner,
     // Assume our owner couldn't initialize.
     setFailed(-owner.mNotifyFd, "Unable to create filesystem monitor.");
 
+#ifdef HAVE_FANOTIFY
+    // No need to watch each directory if we can watch the whole filesystem.
+    mFanotify = owner.fanotifyWatch(rootPath, mFanotifyFilesystem);
+
+    if (mFanotify)
+        setFailed(0, "");
+#endif // HAVE_FANOTIFY
+
     // Did our owner initialize correctly?
     if (owner.mNotifyFd >= 0)
         setFailed(0, "");
@@ -1674,6 +1920,11 @@ LinuxDirNotify::LinuxDirNotify(LinuxFileSystemAccess& owner,
 
 LinuxDirNotify::~LinuxDirNotify()
 {
+#ifdef HAVE_FANOTIFY
+    if (mFanotify)
+        mOwner.fanotifyUnwatch(mFanotifyFilesystem);
+#endif // HAVE_FANOTIFY
+
     // Remove ourselves from our owner's list of notiifers.
     mOwner.mNotifiers.erase(mNotifiersIt);
 }
@@ -1692,6 +1943,27 @@ AddWatchResult LinuxDirNotify::addWatch(LocalNode& node,
     // Convenience.
     auto& watches = mOwner.mWatches;
 
+#ifdef HAVE_FANOTIFY
+    // The filesystem's already watched: just remember who to notify.
+    if (mFanotify)
+    {
+        auto key = LinuxFileSystemAccess::fanotifyKey(mFanotifyFilesystem, path);
+
+        if (!key.empty())
+        {
+            auto entry = watches.emplace(LinuxFileSystemAccess::FANOTIFY_WATCH, WatchEntry(&node, fsid));
+
+            mOwner.mFanotifyWatches.emplace(key, entry);
+            mOwner.mFanotifyWatchKeys.emplace(&node, std::move(key));
+
+            return make_pair(entry, WR_SUCCESS);
+        }
+
+        // We couldn't tell its events apart: watch it with inotify.
+        LOG_warn << "Unable to get the handle of " << path << ", using inotify. Error: " << errno;
+    }
+#endif // HAVE_FANOTIFY
+
     auto handle =
         inotify_add_watch(mOwner.mNotifyFd,
                           path.toPath(false).c_str(),
@@ -1727,6 +1999,29 @@ void LinuxDirNotify::removeWatch(WatchMapIterator entry)
     auto handle = entry->first;
     assert(handle >= 0);
 
+#ifdef HAVE_FANOTIFY
+    if (handle == LinuxFileSystemAccess::FANOTIFY_WATCH)
+    {
+        auto key = mOwner.mFanotifyWatchKeys.find(entry->second.first);
+        assert(key != mOwner.mFanotifyWatchKeys.end());
+
+        auto associated = mOwner.mFanotifyWatches.equal_range(key->second);
+
+        for (auto i = associated.first; i != associated.second; ++i)
+        {
+            if (i->second == entry)
+            {
+                mOwner.mFanotifyWatches.erase(i);
+                break;
+            }
+        }
+
+        mOwner.mFanotifyWatchKeys.erase(key);
+        watches.erase(entry);
+        return;
+    }
+#endif // HAVE_FANOTIFY
+
     watches.erase(entry); // Removes first instance
 
     if (watches.find(handle) != watches.end())
@@ -1834,6 +2129,137 @@ private:
     m_off_t mSize;
 }; // UnixStreamAccess
 
+// How many files directoryScan(...) reads at once when fingerprinting.
+static constexpr unsigned FINGERPRINT_THREADS = 4;
+
+// Retrieves what directoryScan(...) needs to know about name, relative to directory.
+static int statAt(int directory, const char* name, bool followSymLink, struct stat& metadata)
+{
+#ifdef HAVE_STATX
+    // Network filesystems must still revalidate what they have cached, as stat(...) does:
+    // a stale size or mtime would hide changes made on another machine.
+    int flags = followSymLink ? 0 : AT_SYMLINK_NOFOLLOW;
+    unsigned mask = STATX_TYPE | STATX_MODE | STATX_INO | STATX_SIZE | STATX_MTIME;
+
+    struct statx extended;
+
+    if (!statx(directory, name, flags, mask, &extended))
+    {
+        metadata = {};
+        metadata.st_dev = makedev(extended.stx_dev_major, extended.stx_dev_minor);
+        metadata.st_ino = static_cast<ino_t>(extended.stx_ino);
+        metadata.st_mode = extended.stx_mode;
+        metadata.st_size = static_cast<off_t>(extended.stx_size);
+        metadata.st_mtime = static_cast<time_t>(extended.stx_mtime.tv_sec);
+        return 0;
+    }
+
+    // Kernel predates statx(...).
+    if (errno != ENOSYS)
+        return -1;
+#endif // HAVE_STATX
+
+    return fstatat(directory, name, &metadata, followSymLink ? 0 : AT_SYMLINK_NOFOLLOW);
+}
+
+// Enumerates a directory's entries for directoryScan(...).
+class DirectoryReader
+{
+public:
+    explicit DirectoryReader(const char* path)
+    {
+#ifdef __linux__
+        mDescriptor = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#else // __linux__
+        mDirectory = opendir(path);
+        mDescriptor = mDirectory ? dirfd(mDirectory) : -1;
+#endif // ! __linux__
+    }
+
+    MEGA_DISABLE_COPY_MOVE(DirectoryReader);
+
+    ~DirectoryReader()
+    {
+#ifdef __linux__
+        if (mDescriptor >= 0)
+            close(mDescriptor);
+#else // __linux__
+        if (mDirectory)
+            closedir(mDirectory);
+#endif // ! __linux__
+    }
+
+    operator bool() const
+    {
+        return mDescriptor >= 0;
+    }
+
+    // For looking up entries relative to this directory.
+    int descriptor() const
+    {
+        return mDescriptor;
+    }
+
+    // Name of the next entry, nullptr when there are no more.
+    const char* next(handle& inode)
+    {
+#ifdef __linux__
+        // Layout of the records returned by getdents64(...).
+        struct Record
+        {
+            uint64_t d_ino;
+            int64_t d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[1];
+        }; // Record
+
+        if (mOffset == mLength)
+        {
+            // Much larger batches than readdir(...) asks for.
+            mBuffer.resize(BATCH_SIZE);
+
+            auto length = syscall(SYS_getdents64, mDescriptor, mBuffer.data(), mBuffer.size());
+
+            if (length <= 0)
+                return nullptr;
+
+            mLength = static_cast<size_t>(length);
+            mOffset = 0;
+        }
+
+        auto* record = reinterpret_cast<Record*>(&mBuffer[mOffset]);
+
+        mOffset += record->d_reclen;
+        inode = static_cast<handle>(record->d_ino);
+
+        return record->d_name;
+#else // __linux__
+        auto* entry = readdir(mDirectory);
+
+        if (!entry)
+            return nullptr;
+
+        inode = static_cast<handle>(entry->d_ino);
+
+        return entry->d_name;
+#endif // ! __linux__
+    }
+
+private:
+    int mDescriptor = -1;
+
+#ifdef __linux__
+    static constexpr size_t BATCH_SIZE = 256 * 1024;
+
+    std::vector<char> mBuffer;
+    size_t mOffset = 0;
+    size_t mLength = 0;
+#else // __linux__
+    DIR* mDirectory = nullptr;
+#endif // ! __linux__
+}; // DirectoryReader
+
 ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
                                                 handle expectedFsid,
                                                 map<LocalPath, FSNode>& known,
@@ -1854,8 +2280,8 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
     };
 
     // So we don't duplicate link chasing logic.
-    auto stat = [&](const char* path, struct stat& metadata, bool* followSymLinkHere = nullptr) {
-        auto result = !lstat(path, &metadata);
+    auto stat = [&](int directory, const char* path, struct stat& metadata, bool* followSymLinkHere = nullptr) {
+        auto result = !statAt(directory, path, false, metadata);
 
         if (!result) return false;
 
@@ -1863,7 +2289,7 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
         if (!followSymLink || !S_ISLNK(metadata.st_mode))
             return result;
 
-        return !::stat(path, &metadata);
+        return !statAt(directory, path, true, metadata);
     };
 
     // Where we store file information.
@@ -1871,7 +2297,7 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
 
     // Try and get information about the scan target.
     bool scanTarget_followSymLink = true; // Follow symlink for the parent directory, so we retrieve the stats of the path that the symlinks points to
-    if (!stat(targetPath.toPath(false).c_str(), metadata, &scanTarget_followSymLink))
+    if (!stat(AT_FDCWD, targetPath.toPath(false).c_str(), metadata, &scanTarget_followSymLink))
     {
         LOG_warn << "Failed to directoryScan: "
                  << "Unable to stat(...) scan target: "
@@ -1905,7 +2331,7 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
     }
 
     // Try and open the directory for iteration.
-    auto directory = opendir(targetPath.toPath(false).c_str());
+    DirectoryReader directory(targetPath.toPath(false).c_str());
 
     if (!directory)
     {
@@ -1921,24 +2347,31 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
     // What device is this directory on?
     auto device = metadata.st_dev;
 
+    // Files we couldn't reuse a fingerprint for, and their absolute paths.
+    std::vector<std::pair<size_t, LocalPath>> unfingerprinted;
+
+    // Known entries by fsid, built when a name lookup first misses.
+    std::unordered_map<handle, FSNode*> knownByFsid;
+    bool knownByFsidBuilt = false;
+
     // Iterate over the directory's children.
-    auto entry = readdir(directory);
     auto path = targetPath;
+    handle inode;
 
-    for ( ; entry; entry = readdir(directory))
+    while (auto name = directory.next(inode))
     {
         // Skip special hardlinks.
-        if (!strcmp(entry->d_name, "."))
+        if (!strcmp(name, "."))
             continue;
 
-        if (!strcmp(entry->d_name, ".."))
+        if (!strcmp(name, ".."))
             continue;
 
         // Push a new scan record.
         auto& result = (results.emplace_back(), results.back());
 
-        result.fsid = (handle)entry->d_ino;
-        result.localname = LocalPath::fromPlatformEncodedRelative(entry->d_name);
+        result.fsid = inode;
+        result.localname = LocalPath::fromPlatformEncodedRelative(name);
 
         // Compute this entry's absolute name.
         LocalPath newpath{path};
@@ -1946,7 +2379,8 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
         newpath.appendWithSeparator(result.localname, false);
 
         // Try and get information about this entry.
-        if (!stat(newpath.toPath(false).c_str(), metadata))
+        // Relative to the directory, so the kernel needn't walk the whole path again.
+        if (!stat(directory.descriptor(), name, metadata))
         {
             LOG_warn << "directoryScan: "
                      << "Unable to stat(...) file: " << newpath << ". Error code was: " << errno;
@@ -2036,27 +2470,59 @@ ScanResult PosixFileSystemAccess::directoryScan(const LocalPath& targetPath,
             continue;
         }
 
+        // Maybe we know this file by another name (it was renamed, or it's a hard link.)
+        if (!knownByFsidBuilt)
+        {
+            for (auto& k : known)
+            {
+                if (k.second.fsid != UNDEF)
+                    knownByFsid.emplace(k.second.fsid, &k.second);
+            }
+
+            knownByFsidBuilt = true;
+        }
+
+        auto byFsid = knownByFsid.find(result.fsid);
+
+        if (byFsid != knownByFsid.end()
+            && reuse(result, *byFsid->second)
+            && byFsid->second->fingerprint.isvalid)
+        {
+            result.fingerprint = byFsid->second->fingerprint;
+            continue;
+        }
+
+        // Fingerprint the file once we're done iterating.
+        unfingerprinted.emplace_back(results.size() - 1, std::move(newpath));
+    }
+
+    // Read the files that need fingerprinting concurrently.
+    std::vector<FileFingerprint*> fingerprints;
+
+    for (auto& file : unfingerprinted)
+        fingerprints.emplace_back(&results[file.first].fingerprint);
+
+    auto open = [&](size_t i) -> std::unique_ptr<InputStreamAccess> {
+        auto& newpath = unfingerprinted[i].second;
+        auto size = fingerprints[i]->size;
+
         // Try and open the file for reading.
-        UnixStreamAccess isAccess(newpath.toPath(false).c_str(), result.fingerprint.size);
+        auto isAccess = std::make_unique<UnixStreamAccess>(newpath.toPath(false).c_str(), size);
 
         // Only fingerprint the file if we could actually open it.
-        if (!isAccess)
+        if (!*isAccess)
         {
             LOG_warn << "directoryScan: "
                      << "Unable to open file for fingerprinting: " << newpath
                      << ". Error was: " << errno;
-            continue;
+            return nullptr;
         }
 
-        // Fingerprint the file.
-        result.fingerprint.genfingerprint(
-          &isAccess, result.fingerprint.mtime);
-
-        ++nFingerprinted;
-    }
+        return isAccess;
+    };
 
-    // We're done iterating the directory.
-    closedir(directory);
+    nFingerprinted += static_cast<unsigned>(
+      FileFingerprint::genfingerprints(fingerprints, open, FINGERPRINT_THREADS));
 
     return SCAN_SUCCESS;
 }
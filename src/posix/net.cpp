@@ -333,6 +333,9 @@ CurlHttpIO::CurlHttpIO()
     curl_multi_setopt(curlm[API], CURLMOPT_TIMERDATA, this);
     curltimeoutreset[API] = -1;
     arerequestspaused[API] = false;
+#ifdef USE_EPOLL
+    arecurleventspaused[API] = false;
+#endif
 
     curl_multi_setopt(curlm[GET], CURLMOPT_SOCKETFUNCTION, download_socket_callback);
     curl_multi_setopt(curlm[GET], CURLMOPT_SOCKETDATA, this);
@@ -343,6 +346,9 @@ CurlHttpIO::CurlHttpIO()
 #endif
     curltimeoutreset[GET] = -1;
     arerequestspaused[GET] = false;
+#ifdef USE_EPOLL
+    arecurleventspaused[GET] = false;
+#endif
 
     curl_multi_setopt(curlm[PUT], CURLMOPT_SOCKETFUNCTION, upload_socket_callback);
     curl_multi_setopt(curlm[PUT], CURLMOPT_SOCKETDATA, this);
@@ -354,6 +360,9 @@ CurlHttpIO::CurlHttpIO()
 
     curltimeoutreset[PUT] = -1;
     arerequestspaused[PUT] = false;
+#ifdef USE_EPOLL
+    arecurleventspaused[PUT] = false;
+#endif
 
     curlsh = curl_share_init();
     curl_share_setopt(curlsh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
@@ -413,6 +422,34 @@ void CurlHttpIO::addcurlevents(Waiter* eventWaiter, direction_t d)
 #endif
 
     SockInfoMap &socketmap = curlsockets[d];
+
+#ifdef USE_EPOLL
+    // sockets stay watched between waits, so only their changes need applying
+    auto* posixWaiter = static_cast<PosixWaiter*>(eventWaiter);
+    for (auto fd : changedcurlsockets[d])
+    {
+        auto it = socketmap.find(fd);
+        if (it != socketmap.end() && it->second.mode)
+        {
+            posixWaiter->watch(fd, it->second.mode & SockInfo::READ, it->second.mode & SockInfo::WRITE);
+        }
+        else
+        {
+            // closed sockets leave epoll by themselves, and their fd may be watched for
+            // another direction already, but curl also removes sockets it keeps open
+            if (!iscurlsocketwatched(fd, d))
+            {
+                posixWaiter->unwatch(fd);
+            }
+
+            if (it != socketmap.end())
+            {
+                socketmap.erase(it);
+            }
+        }
+    }
+    changedcurlsockets[d].clear();
+#else
     for (SockInfoMap::iterator it = socketmap.begin(); it != socketmap.end(); it++)
     {
         SockInfo &info = it->second;
@@ -440,6 +477,7 @@ void CurlHttpIO::addcurlevents(Waiter* eventWaiter, direction_t d)
         }
 #endif
    }
+#endif
 
 #if defined(_WIN32)
     if (anyWriters)
@@ -473,10 +511,87 @@ void CurlHttpIO::closecurlevents(direction_t d)
     {
         it->second.closeEvent(false);
     }
+#endif
+#ifdef USE_EPOLL
+    // the sockets are closed by now, which removes them from epoll too
+    changedcurlsockets[d].clear();
+    arecurleventspaused[d] = false;
 #endif
     socketmap.clear();
 }
 
+// stop waiting for the sockets of paused requests: they stay ready, and
+// would wake the waiter up again and again until the requests are resumed
+void CurlHttpIO::pausecurlevents(direction_t d)
+{
+#ifdef USE_EPOLL
+    if (arecurleventspaused[d] || !waiter)
+    {
+        return;
+    }
+
+    for (auto& socket : curlsockets[d])
+    {
+        // removed sockets are left to addcurlevents()
+        if (socket.second.mode)
+        {
+            waiter->unwatch(socket.first);
+        }
+    }
+
+    arecurleventspaused[d] = true;
+#else
+    // sockets are only set for a single wait, and not set while paused
+    static_cast<void>(d);
+#endif
+}
+
+void CurlHttpIO::resumecurlevents(direction_t d)
+{
+#ifdef USE_EPOLL
+    if (!arecurleventspaused[d])
+    {
+        return;
+    }
+
+    for (auto& socket : curlsockets[d])
+    {
+        SockInfo& info = socket.second;
+
+        if (info.mode)
+        {
+            waiter->watch(socket.first, info.mode & SockInfo::READ, info.mode & SockInfo::WRITE);
+        }
+    }
+
+    arecurleventspaused[d] = false;
+#else
+    static_cast<void>(d);
+#endif
+}
+
+#ifdef USE_EPOLL
+// whether a direction other than d is waiting for events on fd
+bool CurlHttpIO::iscurlsocketwatched(curl_socket_t fd, direction_t d) const
+{
+    for (int other = GET; other <= API; other++)
+    {
+        if (other == d || arecurleventspaused[other])
+        {
+            continue;
+        }
+
+        auto it = curlsockets[other].find(fd);
+        if (it != curlsockets[other].end() && it->second.mode)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+#endif
+
 void CurlHttpIO::processcurlevents(direction_t d)
 {
 #ifdef MEGA_MEASURE_CODE
@@ -494,6 +609,40 @@ void CurlHttpIO::processcurlevents(direction_t d)
     SockInfoMap *socketmap = &curlsockets[d];
     bool *paused = &arerequestspaused[d];
 
+#ifdef USE_EPOLL
+    // the sets only hold ready fds, so there's no need to look at every socket
+    std::vector<std::pair<curl_socket_t, int>> ready;
+
+    for (auto fd : *rfds)
+    {
+        ready.emplace_back(fd, CURL_CSELECT_IN | (MEGA_FD_ISSET(fd, wfds) ? CURL_CSELECT_OUT : 0));
+    }
+
+    for (auto fd : *wfds)
+    {
+        if (!MEGA_FD_ISSET(fd, rfds))
+        {
+            ready.emplace_back(fd, CURL_CSELECT_OUT);
+        }
+    }
+
+    for (auto it = ready.begin(); !(*paused) && it != ready.end(); it++)
+    {
+        auto info = socketmap->find(it->first);
+        if (info == socketmap->end() || !info->second.mode)
+        {
+            continue;
+        }
+
+        int action = ((info->second.mode & SockInfo::READ) ? it->second & CURL_CSELECT_IN : 0)
+                     | ((info->second.mode & SockInfo::WRITE) ? it->second & CURL_CSELECT_OUT : 0);
+
+        if (action)
+        {
+            curl_multi_socket_action(curlm[d], it->first, action, &dummy);
+        }
+    }
+#else
     for (SockInfoMap::iterator it = socketmap->begin(); !(*paused) && it != socketmap->end();)
     {
         SockInfo &info = (it++)->second;
@@ -521,6 +670,7 @@ void CurlHttpIO::processcurlevents(direction_t d)
         }
 #endif
     }
+#endif
 
     if (curltimeoutreset[d] >= 0 && curltimeoutreset[d] <= Waiter::ds)
     {
@@ -529,6 +679,8 @@ void CurlHttpIO::processcurlevents(direction_t d)
         curl_multi_socket_action(curlm[d], CURL_SOCKET_TIMEOUT, 0, &dummy);
     }
 
+#ifndef USE_EPOLL
+    // with epoll, removed sockets are dropped once unwatched by addcurlevents()
     for (SockInfoMap::iterator it = socketmap->begin(); it != socketmap->end();)
     {
         SockInfo &info = it->second;
@@ -541,6 +693,7 @@ void CurlHttpIO::processcurlevents(direction_t d)
             it++;
         }
     }
+#endif
 }
 
 CurlHttpIO::~CurlHttpIO()
@@ -644,6 +797,9 @@ void CurlHttpIO::disconnect()
     curl_multi_setopt(curlm[API], CURLMOPT_TIMERDATA, this);
     curltimeoutreset[API] = -1;
     arerequestspaused[API] = false;
+#ifdef USE_EPOLL
+    arecurleventspaused[API] = false;
+#endif
 
     curl_multi_setopt(curlm[GET], CURLMOPT_SOCKETFUNCTION, download_socket_callback);
     curl_multi_setopt(curlm[GET], CURLMOPT_SOCKETDATA, this);
@@ -654,6 +810,9 @@ void CurlHttpIO::disconnect()
 #endif
     curltimeoutreset[GET] = -1;
     arerequestspaused[GET] = false;
+#ifdef USE_EPOLL
+    arecurleventspaused[GET] = false;
+#endif
 
 
     curl_multi_setopt(curlm[PUT], CURLMOPT_SOCKETFUNCTION, upload_socket_callback);
@@ -665,6 +824,9 @@ void CurlHttpIO::disconnect()
 #endif
     curltimeoutreset[PUT] = -1;
     arerequestspaused[PUT] = false;
+#ifdef USE_EPOLL
+    arecurleventspaused[PUT] = false;
+#endif
 
     disconnecting = false;
     if (proxyurl.size() && !proxyip.size())
@@ -765,6 +927,8 @@ void CurlHttpIO::addevents(Waiter* w, int)
     {
         if (arerequestspaused[d])
         {
+            pausecurlevents((direction_t)d);
+
             if (curltimeoutms < 0 || curltimeoutms > 100)
             {
                 curltimeoutms = 100;
@@ -1535,6 +1699,8 @@ bool CurlHttpIO::doio()
 
             if (!arerequestspaused[d])
             {
+                resumecurlevents((direction_t)d);
+
                 int dummy;
                 curl_multi_socket_action(curlm[d], CURL_SOCKET_TIMEOUT, 0, &dummy);
             }
@@ -2220,6 +2386,10 @@ int CurlHttpIO::socket_callback(CURL *, curl_socket_t s, int what, void *userp,
 #endif
     }
 
+#ifdef USE_EPOLL
+    httpio->changedcurlsockets[d].push_back(s);
+#endif
+
     return 0;
 }
 
@@ -22,7 +22,7 @@
 #include "mega.h"
 
 
-#ifdef USE_POLL
+#if defined(USE_POLL) || defined(USE_EPOLL)
     #include <poll.h> //poll
 #endif
 
@@ -42,6 +42,18 @@ PosixWaiter::PosixWaiter()
         LOG_err << "fcntl error";
     }
 
+#ifdef USE_EPOLL
+    mEpoll = epoll_create1(EPOLL_CLOEXEC);
+
+    if (mEpoll < 0)
+    {
+        LOG_fatal << "Error creating epoll instance";
+        throw std::runtime_error("Error creating epoll instance");
+    }
+
+    mEpollEvents.resize(64);
+#endif
+
     maxfd = -1;
 }
 
@@ -49,6 +61,10 @@ PosixWaiter::~PosixWaiter()
 {
     close(m_pipe[0]);
     close(m_pipe[1]);
+
+#ifdef USE_EPOLL
+    close(mEpoll);
+#endif
 }
 
 void PosixWaiter::init(dstime ds)
@@ -138,6 +154,86 @@ int PosixWaiter::wait()
         polli++;
     }
     numfd = poll(fds, total, timeoutInMs);
+#elif defined(USE_EPOLL)
+    int timeoutInMs = -1;
+    if (EVER(maxds) && maxds <= std::numeric_limits<int>::max() / 100)
+    {
+        timeoutInMs = static_cast<int>(maxds) * 100;
+    }
+
+    // fds set for this wait only are polled together with the epoll instance,
+    // which is readable whenever a watched fd is ready
+    auto numrfds = rfds.size();
+    auto numwfds = wfds.size();
+    std::vector<pollfd> fds;
+    fds.reserve(numrfds + numwfds + efds.size() + 1);
+
+    for (auto fd : rfds)
+    {
+        fds.push_back(pollfd{fd, POLLIN_SET, 0});
+    }
+
+    for (auto fd : wfds)
+    {
+        fds.push_back(pollfd{fd, POLLOUT_SET, 0});
+    }
+
+    for (auto fd : efds)
+    {
+        fds.push_back(pollfd{fd, POLLEX_SET, 0});
+    }
+
+    fds.push_back(pollfd{mEpoll, POLLIN, 0});
+
+    numfd = poll(fds.data(), static_cast<nfds_t>(fds.size()), timeoutInMs);
+
+    // from now on the sets only hold ready fds, as they would after select()
+    MEGA_FD_ZERO(&rfds);
+    MEGA_FD_ZERO(&wfds);
+    MEGA_FD_ZERO(&efds);
+
+    bool triggered = false;
+
+    for (size_t i = 0; numfd > 0 && i + 1 < fds.size(); i++)
+    {
+        if (!fds[i].revents)
+        {
+            continue;
+        }
+
+        auto* set = i < numrfds ? &rfds : (i < numrfds + numwfds ? &wfds : &efds);
+        MEGA_FD_SET(fds[i].fd, set);
+        triggered = triggered || !MEGA_FD_ISSET(fds[i].fd, &ignorefds);
+    }
+
+    if (numfd > 0 && fds.back().revents)
+    {
+        int numevents;
+
+        do
+        {
+            numevents = epoll_wait(mEpoll, mEpollEvents.data(), static_cast<int>(mEpollEvents.size()), 0);
+
+            for (int i = 0; i < numevents; i++)
+            {
+                auto fd = mEpollEvents[i].data.fd;
+                auto events = mEpollEvents[i].events;
+
+                if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                {
+                    MEGA_FD_SET(fd, &rfds);
+                }
+
+                if (events & (EPOLLOUT | EPOLLERR))
+                {
+                    MEGA_FD_SET(fd, &wfds);
+                }
+
+                triggered = true;
+            }
+        }
+        while (numevents == static_cast<int>(mEpollEvents.size()));
+    }
 #else
     numfd = select(maxfd + 1, &rfds, &wfds, &efds, EVER(maxds) ? &tv : NULL);
 #endif
@@ -162,7 +258,9 @@ int PosixWaiter::wait()
     }
 
     // request exec() to be run only if a non-ignored fd was triggered
-#ifdef USE_POLL
+#if defined(USE_EPOLL)
+    return triggered ? NEEDEXEC : 0;
+#elif defined(USE_POLL)
     for (unsigned int i = 0 ; i < total ; i++)
     {
         if  ((fds[i].revents & (POLLIN_SET | POLLOUT_SET | POLLEX_SET) )  && !MEGA_FD_ISSET(fds[i].fd, &ignorefds) )
@@ -179,6 +277,31 @@ int PosixWaiter::wait()
 #endif
 }
 
+#ifdef USE_EPOLL
+void PosixWaiter::watch(int fd, bool read, bool write)
+{
+    epoll_event event{};
+    event.events = (read ? EPOLLIN : 0u) | (write ? EPOLLOUT : 0u);
+    event.data.fd = fd;
+
+    // EEXIST: the fd was already being watched, maybe for other events
+    if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, fd, &event) < 0
+        && (errno != EEXIST || epoll_ctl(mEpoll, EPOLL_CTL_MOD, fd, &event) < 0))
+    {
+        LOG_err << "Unable to watch fd " << fd << ": " << errno;
+    }
+}
+
+void PosixWaiter::unwatch(int fd)
+{
+    // epoll forgets about fds on their own once they're closed
+    if (epoll_ctl(mEpoll, EPOLL_CTL_DEL, fd, nullptr) < 0 && errno != ENOENT && errno != EBADF)
+    {
+        LOG_warn << "Unable to unwatch fd " << fd << ": " << errno;
+    }
+}
+#endif
+
 void PosixWaiter::notify()
 {
     std::lock_guard<std::mutex> g(mMutex);
@@ -28,6 +28,22 @@
 
 #undef min //avoids issues with std::min
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MEGA_RAID_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX2 is only used when the CPU reports it, so it needs per-function target support.
+#if MEGA_RAID_SSE2 && defined(__GNUC__) && defined(__x86_64__)
+#define MEGA_RAID_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MEGA_RAID_NEON 1
+#include <arm_neon.h>
+#endif
+
 namespace mega
 {
 
@@ -106,6 +122,279 @@ struct FaultyServers
 
 FaultyServers g_faultyServers;
 
+namespace
+{
+
+// Index of the null entry in parts, or RAIDPARTS if every part is present.
+unsigned missingRaidPart(const byte* const parts[RAIDPARTS])
+{
+    for (unsigned i = 0; i < RAIDPARTS; ++i)
+    {
+        if (!parts[i])
+        {
+            return i;
+        }
+    }
+    return RAIDPARTS;
+}
+
+// Portable reference kernels, operating on a sector at a time as two 64 bit words.
+struct ScalarOps
+{
+    struct V
+    {
+        uint64_t w[2];
+    };
+
+    static V load(const byte* p)
+    {
+        V v;
+        memcpy(v.w, p, RAIDSECTOR);
+        return v;
+    }
+
+    static void store(byte* p, const V& v)
+    {
+        memcpy(p, v.w, RAIDSECTOR);
+    }
+
+    static V zero()
+    {
+        return V{{0, 0}};
+    }
+
+    static V exclusiveOr(const V& a, const V& b)
+    {
+        return V{{a.w[0] ^ b.w[0], a.w[1] ^ b.w[1]}};
+    }
+};
+
+#if MEGA_RAID_SSE2
+struct SSE2Ops
+{
+    using V = __m128i;
+
+    static V load(const byte* p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+
+    static void store(byte* p, V v)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+    }
+
+    static V zero()
+    {
+        return _mm_setzero_si128();
+    }
+
+    static V exclusiveOr(V a, V b)
+    {
+        return _mm_xor_si128(a, b);
+    }
+};
+#endif // MEGA_RAID_SSE2
+
+#if MEGA_RAID_NEON
+struct NEONOps
+{
+    using V = uint8x16_t;
+
+    static V load(const byte* p)
+    {
+        return vld1q_u8(p);
+    }
+
+    static void store(byte* p, V v)
+    {
+        vst1q_u8(p, v);
+    }
+
+    static V zero()
+    {
+        return vdupq_n_u8(0);
+    }
+
+    static V exclusiveOr(V a, V b)
+    {
+        return veorq_u8(a, b);
+    }
+};
+#endif // MEGA_RAID_NEON
+
+// One sector (one line) per iteration, for any type holding a whole sector.
+template<typename Ops>
+void combineSectors(byte* dest, const byte* const parts[RAIDPARTS], size_t lines)
+{
+    auto missing = missingRaidPart(parts);
+
+    // Parity only needs reading when a data part has to be rebuilt.
+    auto rebuild = missing > 0 && missing < RAIDPARTS;
+    auto first = rebuild ? 0u : 1u;
+
+    typename Ops::V sectors[RAIDPARTS];
+
+    for (size_t offset = 0; lines--; offset += RAIDSECTOR, dest += RAIDLINE)
+    {
+        auto rebuilt = Ops::zero();
+
+        for (auto i = first; i < RAIDPARTS; ++i)
+        {
+            if (i == missing)
+                continue;
+
+            sectors[i] = Ops::load(parts[i] + offset);
+
+            if (rebuild)
+                rebuilt = Ops::exclusiveOr(rebuilt, sectors[i]);
+        }
+
+        if (rebuild)
+            sectors[missing] = rebuilt;
+
+        for (unsigned i = 1; i < RAIDPARTS; ++i)
+            Ops::store(dest + (i - 1) * RAIDSECTOR, sectors[i]);
+    }
+}
+
+template<typename Ops>
+void recoverSectors(byte* data, const byte* parity, unsigned missing, size_t lines)
+{
+    assert(missing < EFFECTIVE_RAIDPARTS);
+
+    for (; lines--; data += RAIDLINE, parity += RAIDSECTOR)
+    {
+        auto rebuilt = Ops::load(parity);
+
+        for (unsigned i = 0; i < EFFECTIVE_RAIDPARTS; ++i)
+        {
+            if (i != missing)
+                rebuilt = Ops::exclusiveOr(rebuilt, Ops::load(data + i * RAIDSECTOR));
+        }
+
+        Ops::store(data + missing * RAIDSECTOR, rebuilt);
+    }
+}
+
+#if MEGA_RAID_AVX2
+// Two lines per iteration: each 32 byte load covers the same part's sector in both lines.
+__attribute__((target("avx2")))
+void combineSectorsAVX2(byte* dest, const byte* const parts[RAIDPARTS], size_t lines)
+{
+    auto missing = missingRaidPart(parts);
+    auto rebuild = missing > 0 && missing < RAIDPARTS;
+    auto first = rebuild ? 0u : 1u;
+
+    __m256i sectors[RAIDPARTS];
+    size_t offset = 0;
+
+    for (; lines >= 2; lines -= 2, offset += 2 * RAIDSECTOR, dest += 2 * RAIDLINE)
+    {
+        auto rebuilt = _mm256_setzero_si256();
+
+        for (auto i = first; i < RAIDPARTS; ++i)
+        {
+            if (i == missing)
+                continue;
+
+            sectors[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(parts[i] + offset));
+
+            if (rebuild)
+                rebuilt = _mm256_xor_si256(rebuilt, sectors[i]);
+        }
+
+        if (rebuild)
+            sectors[missing] = rebuilt;
+
+        for (unsigned i = 1; i < RAIDPARTS; ++i)
+        {
+            auto* target = dest + (i - 1) * RAIDSECTOR;
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target),
+                             _mm256_castsi256_si128(sectors[i]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target + RAIDLINE),
+                             _mm256_extracti128_si256(sectors[i], 1));
+        }
+    }
+
+    if (!lines)
+        return;
+
+    // Odd line out.
+    const byte* rest[RAIDPARTS];
+
+    for (unsigned i = 0; i < RAIDPARTS; ++i)
+        rest[i] = parts[i] ? parts[i] + offset : nullptr;
+
+    combineSectors<SSE2Ops>(dest, rest, lines);
+}
+#endif // MEGA_RAID_AVX2
+
+const RaidKernels scalarKernels = {
+    "scalar",
+    combineSectors<ScalarOps>,
+    recoverSectors<ScalarOps>
+};
+
+#if MEGA_RAID_SSE2
+const RaidKernels sse2Kernels = {
+    "sse2",
+    combineSectors<SSE2Ops>,
+    recoverSectors<SSE2Ops>
+};
+#endif // MEGA_RAID_SSE2
+
+#if MEGA_RAID_AVX2
+// A single raid line sector is only 16 bytes wide so recovery stays on SSE2.
+const RaidKernels avx2Kernels = {
+    "avx2",
+    combineSectorsAVX2,
+    recoverSectors<SSE2Ops>
+};
+#endif // MEGA_RAID_AVX2
+
+#if MEGA_RAID_NEON
+const RaidKernels neonKernels = {
+    "neon",
+    combineSectors<NEONOps>,
+    recoverSectors<NEONOps>
+};
+#endif // MEGA_RAID_NEON
+
+} // namespace
+
+const std::vector<const RaidKernels*>& RaidKernels::available()
+{
+    static const std::vector<const RaidKernels*> kernels = []() {
+        std::vector<const RaidKernels*> result = {&scalarKernels};
+
+#if MEGA_RAID_SSE2
+        result.emplace_back(&sse2Kernels);
+#endif // MEGA_RAID_SSE2
+
+#if MEGA_RAID_AVX2
+        if (__builtin_cpu_supports("avx2"))
+            result.emplace_back(&avx2Kernels);
+#endif // MEGA_RAID_AVX2
+
+#if MEGA_RAID_NEON
+        result.emplace_back(&neonKernels);
+#endif // MEGA_RAID_NEON
+
+        return result;
+    }();
+
+    return kernels;
+}
+
+const RaidKernels& RaidKernels::best()
+{
+    static const RaidKernels& kernels = *available().back();
+
+    return kernels;
+}
+
 
 RaidBufferManager::FilePiece::FilePiece()
     : pos(0)
@@ -603,7 +892,9 @@ RaidBufferManager::FilePiece* RaidBufferManager::combineRaidParts(size_t partsle
     // usual case, for simple and fast processing: all input buffers are the same size, and aligned, and a multiple of raidsector
     if (partslen > 0)
     {
-        byte* inputbufs[RAIDPARTS];
+        assert(partslen % RAIDSECTOR == 0);
+
+        const byte* inputbufs[RAIDPARTS];
         for (unsigned i = RAIDPARTS; i--; )
         {
             FilePiece* inputPiece = raidinputparts[i].front();
@@ -611,51 +902,13 @@ RaidBufferManager::FilePiece* RaidBufferManager::combineRaidParts(size_t partsle
         }
 
         byte* b = result->buf.datastart() + prevleftoverchunk.buf.datalen();
-        byte* endpos = b + partslen * EFFECTIVE_RAIDPARTS;
+        assert(b + partslen * EFFECTIVE_RAIDPARTS <= result->buf.datastart() + result->buf.datalen());
 
-        for (unsigned i = 0; b < endpos; i += RAIDSECTOR)
-        {
-            for (unsigned j = 1; j < RAIDPARTS; ++j)
-            {
-                assert(b + RAIDSECTOR <= result->buf.datastart() + result->buf.datalen());
-                if (inputbufs[j])
-                {
-                    memcpy(b, inputbufs[j] + i, RAIDSECTOR);
-                }
-                else
-                {
-                    recoverSectorFromParity(b, inputbufs, i);
-                }
-                b += RAIDSECTOR;
-            }
-        }
-        assert(b == endpos);
+        RaidKernels::best().combine(b, inputbufs, partslen / RAIDSECTOR);
     }
     return result;
 }
 
-void RaidBufferManager::recoverSectorFromParity(byte* dest, byte* inputbufs[], unsigned offset)
-{
-    assert(sizeof(m_off_t)*2 == RAIDSECTOR);
-    bool set = false;
-    for (unsigned i = RAIDPARTS; i--; )
-    {
-        if (inputbufs[i])
-        {
-            if (!set)
-            {
-                memcpy(dest, inputbufs[i] + offset, RAIDSECTOR);
-                set = true;
-            }
-            else
-            {
-                *(m_off_t*)dest ^= *(m_off_t*)(inputbufs[i] + offset);
-                *(m_off_t*)(dest + sizeof(m_off_t)) ^= *(m_off_t*)(inputbufs[i] + offset + sizeof(m_off_t));
-            }
-        }
-    }
-}
-
 void RaidBufferManager::combineLastRaidLine(byte* dest, size_t remainingbytes)
 {
     // we have to be careful to use the right number of bytes from each sector
@@ -732,6 +985,26 @@ bool RaidBufferManager::FilePiece::finalize(bool parallel, m_off_t filesize, int
     m_off_t endpos = ChunkedHash::chunkceil(startpos, finalpos);
     unsigned chunksize = static_cast<unsigned>(endpos - startpos);
 
+    // chunks completed here are independent, so they are decrypted together
+    vector<chunkmac_map::CtrChunk> finishing;
+
+    auto decryptFinishing = [&]()
+    {
+        if (finishing.empty())
+        {
+            return;
+        }
+
+        chunkmacs.ctr_decrypt(finishing, cipher, ctriv);
+
+        for (auto& c : finishing)
+        {
+            LOG_debug << "Finished chunk: " << c.startpos << " - " << c.startpos + c.chunksize << "   Size: " << c.chunksize;
+        }
+
+        finishing.clear();
+    };
+
     while (chunksize)
     {
         m_off_t chunkid = ChunkedHash::chunkfloor(startpos);
@@ -747,8 +1020,12 @@ bool RaidBufferManager::FilePiece::finalize(bool parallel, m_off_t filesize, int
                 {
                     // executing on a worker thread (or synchronously on transferslot destruction)
                     // these are independent chunks, or the earlier part of the chunk is already done.
-                    chunkmacs.ctr_decrypt(chunkid, cipher, chunkstart, chunksize, startpos, ctriv, true);
-                    LOG_debug << "Finished chunk: " << startpos << " - " << endpos << "   Size: " << chunksize;
+                    finishing.push_back({chunkid, chunkstart, chunksize, startpos});
+
+                    if (finishing.size() == SymmCipher::CTR_LANES)
+                    {
+                        decryptFinishing();
+                    }
                 }
                 else
                 {
@@ -768,6 +1045,8 @@ bool RaidBufferManager::FilePiece::finalize(bool parallel, m_off_t filesize, int
         chunksize = static_cast<unsigned>(endpos - startpos);
     }
 
+    decryptFinishing();
+
     finalized = !queueParallel;
     if (finalized)
         finalizedCV.notify_one();
@@ -934,7 +1213,12 @@ std::pair<m_off_t, m_off_t> TransferBufferManager::nextNPosForConnection(unsigne
     {
         // Calc limit for request size value depending on connection/transfer/progress heuristics.
         m_off_t maxReqSize = 0;
-        if (transfer->type == PUT)
+        if (transfer->type == PUT && transfer->slot && transfer->slot->mUploadController)
+        {
+            // sized from the measured bandwidth and round trip time of this upload
+            maxReqSize = transfer->slot->mUploadController->requestSize(transfer->pos);
+        }
+        else if (transfer->type == PUT)
         {
             // choose upload chunks that are big enough to saturate the connection, so we don't start HTTP PUT request too frequently
             // make them smaller at the end of the file so we still have the last parts delivered in parallel
@@ -1069,6 +1069,21 @@ void RaidReq::procdata(uint8_t part, byte* ptr, m_off_t pos, m_off_t len)
 
     // merge new consecutive completed RAID lines so they are ready to be sent, direct from the data[] array
     auto old_completed = mCompleted;
+
+    // consecutive lines missing the same part are rebuilt from parity in a single pass
+    auto runStart = mCompleted;
+    int runIndex = 0;
+
+    auto recoverRun = [&]() {
+        if (runIndex > 0 && mCompleted > runStart)
+        {
+            RaidKernels::best().recover(mData.get() + RAIDLINE * runStart,
+                                        mParity.get() + RAIDSECTOR * runStart,
+                                        static_cast<unsigned>(runIndex - 1),
+                                        static_cast<size_t>(mCompleted - runStart));
+        }
+    };
+
     for (; mCompleted < until; mCompleted++)
     {
         unsigned char mask = static_cast<unsigned char>(mInvalid[static_cast<size_t>(mCompleted)]);
@@ -1080,51 +1095,41 @@ void RaidReq::procdata(uint8_t part, byte* ptr, m_off_t pos, m_off_t len)
         {
             break;
         }
-        else
-        {
-            if (!(mask & 1))
-            {
-                // parity involved in this line
 
-                int index = -1;
+        // index of the part still missing from this line (0 meaning parity, so there's nothing to rebuild)
+        int index = -1;
 #ifdef _MSC_VER
-                unsigned long bitIndex;
-                if (_BitScanForward(&bitIndex, mask))
-                {
-                    index = static_cast<int>(bitIndex);
-                }
+        unsigned long bitIndex;
+        if (_BitScanForward(&bitIndex, mask))
+        {
+            index = static_cast<int>(bitIndex);
+        }
 #else
-                // __GNUC__ is defined for both GCC and Clang
+        // __GNUC__ is defined for both GCC and Clang
 #if defined(__GNUC__)
-                index = __builtin_ctz(mask); // counts least significant consecutive 0 bits (ie 0-based index of least significant 1 bit).  Windows equivalent is _bitScanForward
+        index = __builtin_ctz(mask); // counts least significant consecutive 0 bits (ie 0-based index of least significant 1 bit).  Windows equivalent is _bitScanForward
 #else
-                // Fallback to a loop for other compilers
-                for (uint8_t i = 0; i < RAIDLINE; ++i)
-                {
-                    if (mask & (1 << i))
-                    {
-                        index = i;
-                        break;
-                    }
-                }
+        // Fallback to a loop for other compilers
+        for (uint8_t i = 0; i < RAIDLINE; ++i)
+        {
+            if (mask & (1 << i))
+            {
+                index = i;
+                break;
+            }
+        }
 #endif
 #endif
-                if (index != -1) // index > 0 && index < RAIDLINE
-                {
-                    auto sectors = reinterpret_cast<raidsector_t*>(mData.get() + (RAIDLINE * mCompleted));
-                    raidsector_t& target = sectors[index - 1];
-
-                    target = reinterpret_cast<raidsector_t*>(mParity.get())[mCompleted];
-                    if (!(mask & (1 << 1))) target ^= sectors[0]; // this method requires source and target are both aligned to their size
-                    if (!(mask & (1 << 2))) target ^= sectors[1];
-                    if (!(mask & (1 << 3))) target ^= sectors[2];
-                    if (!(mask & (1 << 4))) target ^= sectors[3];
-                    if (!(mask & (1 << 5))) target ^= sectors[4];
-                }
-            }
+        if (index != runIndex) // index >= 0 && index < RAIDPARTS
+        {
+            recoverRun();
+            runStart = mCompleted;
+            runIndex = index;
         }
     }
 
+    recoverRun();
+
     if (mCompleted > old_completed)
     {
         lastdata = Waiter::ds;
@@ -23,6 +23,7 @@
 #include <cctype>
 #include <future>
 #include <memory>
+#include <numeric>
 #include <type_traits>
 
 #ifdef ENABLE_SYNC
@@ -628,6 +629,47 @@ std::pair<error, SyncConfig> buildSyncConfig(const SyncConfig::Type syncType,
     return {API_OK, syncConfig};
 }
 
+void RecurseSlice::start(bool sliced, Clock::time_point now)
+{
+    mExpired = false;
+    mDeadline = sliced ? now + std::chrono::milliseconds(mSliceMs) : Clock::time_point::max();
+}
+
+bool RecurseSlice::expired()
+{
+    // unsliced passes don't need to look at the clock
+    return mExpired || (mDeadline != Clock::time_point::max() && expired(Clock::now()));
+}
+
+bool RecurseSlice::expired(Clock::time_point now)
+{
+    if (!mExpired && mDeadline != Clock::time_point::max() && now >= mDeadline)
+    {
+        mExpired = true;
+    }
+
+    return mExpired;
+}
+
+bool RecurseSlice::finish(bool completed)
+{
+    auto yielded = mExpired;
+
+    if (yielded)
+    {
+        mSliceMs = std::min(mSliceMs * 2, MAX_MS);
+    }
+    else if (completed)
+    {
+        mSliceMs = INITIAL_MS;
+    }
+
+    mDeadline = Clock::time_point::max();
+    mExpired = false;
+
+    return yielded;
+}
+
 // new Syncs are automatically inserted into the session's syncs list
 // and a full read of the subtree is initiated
 Sync::Sync(UnifiedSync& us, const std::string& logname, SyncError& e):
@@ -844,6 +886,34 @@ bool Sync::isBackupMonitoring() const
     return getConfig().getBackupState() == SYNC_BACKUP_MONITOR;
 }
 
+std::shared_ptr<ScanService::ScanRequest>* Sync::availableUnscannedScanSlot()
+{
+    // The general slot takes one of the scan threads.
+    mActiveScanRequestsUnscanned.resize(std::max<size_t>(ScanService::numThreads(), 2) - 1);
+
+    for (auto& slot : mActiveScanRequestsUnscanned)
+    {
+        if (!slot || slot->completed())
+            return &slot;
+    }
+
+    return nullptr;
+}
+
+bool Sync::unscannedScanSlotsBusy() const
+{
+    if (mActiveScanRequestsUnscanned.empty())
+        return false;
+
+    for (auto& slot : mActiveScanRequestsUnscanned)
+    {
+        if (!slot || slot->completed())
+            return false;
+    }
+
+    return true;
+}
+
 void Sync::setBackupMonitoring()
 {
     assert(syncs.onSyncThread());
@@ -1733,12 +1803,17 @@ void SyncStallInfo::setNoProgress()
     }
 }
 
-void SyncStallInfo::moveFromButKeepCounters(SyncStallInfo& source)
+void SyncStallInfo::moveFromButKeepCounters(SyncStallInfo& source, const set<handle>& unfinished)
 {
     for (auto sourceSyncStallInfoMapIt = source.syncStallInfoMaps.begin(); sourceSyncStallInfoMapIt != source.syncStallInfoMaps.end(); )
     {
         auto&& [id, sourceSyncStallInfoMap] = *sourceSyncStallInfoMapIt;
-        if (sourceSyncStallInfoMap.empty())
+        if (unfinished.count(id))
+        {
+            // only part of this sync's stalls are known yet: keep collecting them
+            ++sourceSyncStallInfoMapIt;
+        }
+        else if (sourceSyncStallInfoMap.empty())
         {
             // if there are no stalls, this key is obsolete: remove entry in the source map and update iterator
             sourceSyncStallInfoMapIt = source.syncStallInfoMaps.erase(sourceSyncStallInfoMapIt);
@@ -1752,12 +1827,13 @@ void SyncStallInfo::moveFromButKeepCounters(SyncStallInfo& source)
     }
 }
 
-void SyncStallInfo::clearObsoleteKeys(SyncStallInfo& source)
+void SyncStallInfo::clearObsoleteKeys(SyncStallInfo& source, const set<handle>& unfinished)
 {
     // Clear obsolete keys
     for (auto syncStallInfoMapIt = syncStallInfoMaps.begin(); syncStallInfoMapIt != syncStallInfoMaps.end(); )
     {
-        if (source.syncStallInfoMaps.find(syncStallInfoMapIt->first) == source.syncStallInfoMaps.end())
+        if (!unfinished.count(syncStallInfoMapIt->first) &&
+            source.syncStallInfoMaps.find(syncStallInfoMapIt->first) == source.syncStallInfoMaps.end())
         {
             syncStallInfoMapIt = syncStallInfoMaps.erase(syncStallInfoMapIt);
         }
@@ -1768,10 +1844,10 @@ void SyncStallInfo::clearObsoleteKeys(SyncStallInfo& source)
     }
 }
 
-void SyncStallInfo::moveFromButKeepCountersAndClearObsoleteKeys(SyncStallInfo& source)
+void SyncStallInfo::moveFromButKeepCountersAndClearObsoleteKeys(SyncStallInfo& source, const set<handle>& unfinished)
 {
-    moveFromButKeepCounters(source);
-    clearObsoleteKeys(source);
+    moveFromButKeepCounters(source, unfinished);
+    clearObsoleteKeys(source, unfinished);
 }
 
 #ifndef NDEBUG
@@ -7964,92 +8040,78 @@ auto Sync::computeSyncTriplets(vector<CloudNode>& cloudNodes, const LocalNode& s
 
     CodeCounter::ScopeTimer rst(syncs.mClient.performanceStats.computeSyncTripletsTime);
 
+    auto count = cloudNodes.size() + syncParent.children.size() + fsNodes.size();
+
     vector<SyncRow> triplets;
-    triplets.reserve(cloudNodes.size() + syncParent.children.size() + fsNodes.size());
+    triplets.reserve(count);
+
+    // Although it would be great to efficiently compare cloud names in utf8 directly against filesystem names
+    // in utf16, without any conversions or copied and manipulated strings, unfortunately we have
+    // a few obstacles to that.  Mainly, that the utf8 encoding can differ - especially on Mac
+    // where they normalize the names that go to the filesystem, but with a different normalization
+    // than we chose for the Node names.  In order to compare these effectively and efficiently
+    // we pretty much have to first duplicate and convert both strings to a single utf8 normalization first.
+    //
+    // The names are then decoded and case-folded once per row, rather than on each of the
+    // O(n log n) comparisons, which matters for folders with very many entries.
+    vector<CollationKey> keys;
+    keys.reserve(count);
+
+    for (auto& cn : cloudNodes)
+    {
+        triplets.emplace_back(&cn, nullptr, nullptr);
+        keys.emplace_back(cn.name, true, mCaseInsensitive);
+    }
+
+    for (auto& sn : syncParent.children)
+    {
+        // Sanity.
+        assert(!sn.second->localname.empty());
 
-    for (auto& cn : cloudNodes)          triplets.emplace_back(&cn, nullptr, nullptr);
-    for (auto& sn : syncParent.children) triplets.emplace_back(nullptr, sn.second, nullptr);
-    for (auto& fsn : fsNodes)            triplets.emplace_back(nullptr, nullptr, &fsn);
+        triplets.emplace_back(nullptr, sn.second, nullptr);
+        keys.emplace_back(sn.second->toName_of_localname, false, mCaseInsensitive);
+    }
 
-    auto tripletCompare = [this](const SyncRow& lhs, const SyncRow& rhs) -> int {
+    for (auto& fsn : fsNodes)
+    {
         // Sanity.
-        assert(!lhs.fsNode || !lhs.fsNode->localname.empty());
-        assert(!rhs.fsNode || !rhs.fsNode->localname.empty());
-        assert(!lhs.syncNode || !lhs.syncNode->localname.empty());
-        assert(!rhs.syncNode || !rhs.syncNode->localname.empty());
+        assert(!fsn.localname.empty());
 
-        // Although it would be great to efficiently compare cloud names in utf8 directly against filesystem names
-        // in utf16, without any conversions or copied and manipulated strings, unfortunately we have
-        // a few obstacles to that.  Mainly, that the utf8 encoding can differ - especially on Mac
-        // where they normalize the names that go to the filesystem, but with a different normalization
-        // than we chose for the Node names.  In order to compare these effectively and efficiently
-        // we pretty much have to first duplicate and convert both strings to a single utf8 normalization first.
+        triplets.emplace_back(nullptr, nullptr, &fsn);
+        keys.emplace_back(fsn.toName_of_localname(*syncs.fsaccess), false, mCaseInsensitive);
+    }
 
-        if (lhs.cloudNode)
-        {
-            if (rhs.cloudNode)
-            {
-                return compareUtf(lhs.cloudNode->name, true, rhs.cloudNode->name, true, mCaseInsensitive);
-            }
-            else if (rhs.syncNode)
-            {
-                return compareUtf(lhs.cloudNode->name, true, rhs.syncNode->toName_of_localname, false, mCaseInsensitive);
-            }
-            else // rhs.fsNode
-            {
-                return compareUtf(lhs.cloudNode->name, true, rhs.fsNode->toName_of_localname(*syncs.fsaccess), false, mCaseInsensitive);
-            }
-        }
-        else if (lhs.syncNode)
-        {
-            if (rhs.cloudNode)
-            {
-                return compareUtf(lhs.syncNode->toName_of_localname, false, rhs.cloudNode->name, true, mCaseInsensitive);
-            }
-            else if (rhs.syncNode)
-            {
-                return compareUtf(lhs.syncNode->toName_of_localname, false, rhs.syncNode->toName_of_localname, false, mCaseInsensitive);
-            }
-            else // rhs.fsNode
-            {
-                return compareUtf(lhs.syncNode->toName_of_localname, false, rhs.fsNode->toName_of_localname(*syncs.fsaccess), false, mCaseInsensitive);
-            }
-        }
-        else // lhs.fsNode
-        {
-            if (rhs.cloudNode)
-            {
-                return compareUtf(lhs.fsNode->toName_of_localname(*syncs.fsaccess), false, rhs.cloudNode->name, true, mCaseInsensitive);
-            }
-            else if (rhs.syncNode)
-            {
-                return compareUtf(lhs.fsNode->toName_of_localname(*syncs.fsaccess), false, rhs.syncNode->toName_of_localname, false, mCaseInsensitive);
-            }
-            else // rhs.fsNode
-            {
-                return compareUtf(lhs.fsNode->toName_of_localname(*syncs.fsaccess), false, rhs.fsNode->toName_of_localname(*syncs.fsaccess), false, mCaseInsensitive);
-            }
-        }
-    };
+    // Sort the rows by name, moving each of them only once.
+    vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), size_t(0));
+
+    std::sort(order.begin(), order.end(),
+           [&keys](size_t lhs, size_t rhs)
+           { return keys[lhs].compare(keys[rhs]) < 0; });
 
-    std::sort(triplets.begin(), triplets.end(),
-           [=](const SyncRow& lhs, const SyncRow& rhs)
-           { return tripletCompare(lhs, rhs) < 0; });
+    vector<SyncRow> sorted;
+    sorted.reserve(count);
 
-    auto currSet = triplets.begin();
-    auto end  = triplets.end();
+    for (auto i : order)
+    {
+        sorted.emplace_back(std::move(triplets[i]));
+    }
+
+    triplets = std::move(sorted);
 
-    while (currSet != end)
+    size_t currSet = 0;
+
+    while (currSet != count)
     {
         // Determine the next set that are all comparator-equal
-        auto nextSet = currSet;
-        ++nextSet;
-        while (nextSet != end && 0 == tripletCompare(*currSet, *nextSet))
+        auto nextSet = currSet + 1;
+        while (nextSet != count && 0 == keys[order[currSet]].compare(keys[order[nextSet]]))
         {
             ++nextSet;
         }
 
-        combineTripletSet(currSet, nextSet);
+        combineTripletSet(triplets.begin() + static_cast<ptrdiff_t>(currSet),
+                          triplets.begin() + static_cast<ptrdiff_t>(nextSet));
 
         currSet = nextSet;
     }
@@ -8399,7 +8461,9 @@ bool Sync::recursiveSync(SyncRow& row, SyncPath& fullPath, bool belowRemovedClou
                     // in case of sync failing while we recurse
                     if (getConfig().mError) return false;
 
-                    if (syncs.mSyncFlags->earlyRecurseExitRequested)
+                    bool sliceUsedUp = recurseSlice.expired();
+
+                    if (syncs.mSyncFlags->earlyRecurseExitRequested || sliceUsedUp)
                     {
                         // restore flags to at least what they were, for when we revisit on next full recurse
                         row.syncNode->scanAgain = std::max<TreeState>(row.syncNode->scanAgain, originalScanAgain);
@@ -8408,7 +8472,9 @@ bool Sync::recursiveSync(SyncRow& row, SyncPath& fullPath, bool belowRemovedClou
                         row.syncNode->conflicts = std::max<TreeState>(row.syncNode->conflicts, originalConflicsFlag);
 
                         LOG_debug << syncname
-                            << "recursiveSync early exit due to pending outside request with "
+                            << "recursiveSync early exit due to "
+                            << (sliceUsedUp ? "time slice used up" : "pending outside request")
+                            << " with "
                             << row.syncNode->scanAgain  << "-"
                             << row.syncNode->checkMovesAgain << "-"
                             << row.syncNode->syncAgain << " ("
@@ -13242,6 +13308,7 @@ void Syncs::syncLoop()
         }
 
         bool earlyExit = false;
+        set<handle> yieldedSyncs; // their time slice expired midway through their pass
         auto recurseStart = std::chrono::high_resolution_clock::now();
         CodeCounter::ScopeTimer rst(mClient.performanceStats.recursiveSyncTime);
 
@@ -13269,6 +13336,12 @@ void Syncs::syncLoop()
 
         unsigned skippedForScanning = 0;
 
+        // With several syncs, a pass over one huge sync is time sliced so the others keep progressing.
+        auto runningSyncs = std::count_if(mSyncVec.begin(), mSyncVec.end(), [](const unique_ptr<UnifiedSync>& us)
+        {
+            return us->mSync && !us->mConfig.mError;
+        });
+
         for (auto& us : mSyncVec)
         {
             Sync* sync = us->mSync.get();
@@ -13332,12 +13405,11 @@ void Syncs::syncLoop()
                     bool activeIncomplete = sync->mActiveScanRequestGeneral &&
                         !sync->mActiveScanRequestGeneral->completed();
 
-                    bool unscannedIncomplete = sync->mActiveScanRequestUnscanned &&
-                        !sync->mActiveScanRequestUnscanned->completed();
+                    bool unscannedBusy = sync->unscannedScanSlotsBusy();
 
-                    if ((activeIncomplete && unscannedIncomplete) ||
+                    if ((activeIncomplete && unscannedBusy) ||
                         (activeIncomplete && sync->threadSafeState->neverScannedFolderCount.load() == 0) ||
-                        (unscannedIncomplete && !sync->mActiveScanRequestGeneral))
+                        (unscannedBusy && !sync->mActiveScanRequestGeneral))
                     {
                         // Save CPU by not starting another recurse of the LocalNode tree
                         // if a scan is not finished yet.  Scans can take a fair while for large
@@ -13358,13 +13430,28 @@ void Syncs::syncLoop()
                     FSNode rootFsNode(sync->localroot->getLastSyncedFSDetails());
                     SyncRow row{&sync->cloudRoot, sync->localroot.get(), &rootFsNode};
 
+                    bool completed = false;
+
                     {
                         // later we can make this lock much finer-grained
                         std::lock_guard<std::timed_mutex> g(mLocalNodeChangeMutex);
 
                         DBTableTransactionCommitter committer(sync->statecachetable);
 
-                        if (!sync->recursiveSync(row, pathBuffer, false, false, 0))
+                        sync->recurseSlice.start(runningSyncs > 1);
+
+                        completed = sync->recursiveSync(row, pathBuffer, false, false, 0);
+
+                        if (sync->recurseSlice.finish(completed))
+                        {
+                            // Only this sync's pass is unfinished. Carry on from where we stopped
+                            // without waiting, and don't let it rely on its moves being complete
+                            // until it gets through a whole pass.
+                            sync->unsetScanningWasComplete();
+                            yieldedSyncs.insert(sync->getConfig().mBackupId);
+                            skipWait = true;
+                        }
+                        else if (!completed)
                         {
                             earlyExit = true;
                         }
@@ -13372,7 +13459,7 @@ void Syncs::syncLoop()
                         sync->cachenodes();
                     }
 
-                    if (!earlyExit)
+                    if (!earlyExit && completed)
                     {
                         if (sync->isBackupAndMirroring() &&
                             !sync->localroot->scanRequired() &&
@@ -13455,6 +13542,13 @@ void Syncs::syncLoop()
         {
             mSyncFlags->isInitialPass = false;
 
+            if (!yieldedSyncs.empty())
+            {
+                // Not every node was visited, so the lack of progress can't be judged yet.
+                mSyncFlags->scanningWasComplete = false;
+                mSyncFlags->reachableNodesAllScannedThisPass = false;
+            }
+
             // Process name conflicts
             processSyncConflicts();
 
@@ -13477,9 +13571,12 @@ void Syncs::syncLoop()
             }
 
             // Process stall issues
-            processSyncStalls();
+            processSyncStalls(yieldedSyncs);
 
-            ++completedPassCount;
+            if (yieldedSyncs.empty())
+            {
+                ++completedPassCount;
+            }
         }
 
         // Process throttling queue
@@ -13804,7 +13901,7 @@ void Syncs::processSyncConflicts()
     }
 }
 
-void Syncs::processSyncStalls()
+void Syncs::processSyncStalls(const set<handle>& yieldedSyncs)
 {
     assert(onSyncThread());
 
@@ -13884,8 +13981,9 @@ void Syncs::processSyncStalls()
         mSyncFlags->stall.updateNoProgress();
 
         lock_guard<mutex> g(stallReportMutex);
-        // Update stall report with the stalls created during the loop
-        stallReport.moveFromButKeepCountersAndClearObsoleteKeys(mSyncFlags->stall);
+        // Update stall report with the stalls created during the loop.
+        // Syncs that yielded keep reporting those of their last complete pass.
+        stallReport.moveFromButKeepCountersAndClearObsoleteKeys(mSyncFlags->stall, yieldedSyncs);
 
         // Check immediate stalls and progress lack stalls
         bool immediateStall = hasImmediateStall(stallReport);
@@ -439,6 +439,7 @@ void Transfer::failed(const Error& e, TransferDbCommitter& committer, dstime tim
             client->activateoverquota(timeleft, (e == API_EPAYWALL));
             client->app->transfer_failed(this, e, timeleft);
             ++client->performanceStats.transferTempErrors;
+            client->performanceStats.transferTempErrorsTotal.add();
         }
         else
         {
@@ -479,6 +480,7 @@ void Transfer::failed(const Error& e, TransferDbCommitter& committer, dstime tim
         state = TRANSFERSTATE_RETRYING;
         client->app->transfer_failed(this, e, timeleft);
         ++client->performanceStats.transferTempErrors;
+        client->performanceStats.transferTempErrorsTotal.add();
     }
 
     for (file_list::iterator it = files.begin(); it != files.end();)
@@ -590,6 +592,7 @@ void Transfer::failed(const Error& e, TransferDbCommitter& committer, dstime tim
         }
         client->app->transfer_removed(this);
         ++client->performanceStats.transferFails;
+        client->performanceStats.transferFailsTotal.add();
         delete this;
     }
 }
@@ -2761,10 +2764,14 @@ void TransferList::addtransfer(Transfer *transfer, TransferDbCommitter& committe
         assert(it == transfers[transfer->type].end() || it->transfer->priority != transfer->priority);
         transfers[transfer->type].insert(it, transfer);
     }
+
+    schedule(transfer);
 }
 
 void TransferList::removetransfer(Transfer *transfer)
 {
+    unschedule(transfer);
+
     transfer_list::iterator it;
     if (getIterator(transfer, it, true))
     {
@@ -2831,8 +2838,10 @@ void TransferList::movetransfer(transfer_list::iterator it, transfer_list::itera
         prepareDecreasePriority(transfer, it, dstit);
 
         transfers[transfer->type].erase(it);
+        unschedule(transfer);
         currentpriority += PRIORITY_STEP;
         transfer->priority = currentpriority;
+        schedule(transfer);
         assert(!transfers[transfer->type].size() || transfers[transfer->type][transfers[transfer->type].size() - 1]->priority < transfer->priority);
         transfers[transfer->type].push_back(transfer);
         client->transfercacheadd(transfer, &committer);
@@ -2870,7 +2879,9 @@ void TransferList::movetransfer(transfer_list::iterator it, transfer_list::itera
         {
             Transfer* t = transfers[transfer->type][static_cast<size_t>(i)];
             LOG_debug << "Adjusting priority of transfer " << i << " to " << fixedPriority;
+            unschedule(t);
             t->priority = fixedPriority;
+            schedule(t);
             client->transfercacheadd(t, &committer);
             client->app->transfer_update(t);
             fixedPriority += PRIORITY_STEP;
@@ -2879,7 +2890,10 @@ void TransferList::movetransfer(transfer_list::iterator it, transfer_list::itera
         LOG_debug << "Fixed priority: " << fixedPriority;
     }
 
+    unschedule(transfer);
     transfer->priority = newpriority;
+    schedule(transfer);
+
     if (srcindex > dstindex)
     {
         prepareIncreasePriority(transfer, it, dstit, committer);
@@ -2993,6 +3007,7 @@ error TransferList::pause(Transfer *transfer, bool enable, TransferDbCommitter&
         transfer_list::iterator it;
         if (getIterator(transfer, it))
         {
+            schedule(transfer);
             prepareIncreasePriority(transfer, it, it, committer);
         }
 
@@ -3015,6 +3030,7 @@ error TransferList::pause(Transfer *transfer, bool enable, TransferDbCommitter&
             transfer->slot = NULL;
         }
         transfer->state = TRANSFERSTATE_PAUSED;
+        unschedule(transfer);
         client->transfercacheadd(transfer, &committer);
         client->app->transfer_update(transfer);
         return API_OK;
@@ -3067,8 +3083,40 @@ std::array<vector<Transfer*>, 6> TransferList::nexttransfers(std::function<bool(
 
     for (direction_t direction : putget)
     {
-        for (Transfer *transfer : transfers[direction])
+        auto& large = scheduleQueue(direction, LARGEFILE);
+        auto& small = scheduleQueue(direction, SMALLFILE);
+
+        // where each queue resumes: priorities rather than iterators, as transfers may be
+        // removed meanwhile
+        uint64_t largeFrom = 0;
+        uint64_t smallFrom = 0;
+
+        bool continueLarge = true;
+        bool continueSmall = true;
+
+        for (;;)
         {
+            // the next transfer in priority order, among the categories that may take more
+            auto largeit = continueLarge ? large.lower_bound(largeFrom) : large.end();
+            auto smallit = continueSmall ? small.lower_bound(smallFrom) : small.end();
+
+            bool takeLarge = largeit != large.end();
+            bool takeSmall = smallit != small.end();
+
+            if (takeLarge && takeSmall)
+            {
+                takeLarge = largeit->first < smallit->first;
+            }
+            else if (!takeLarge && !takeSmall)
+            {
+                break;
+            }
+
+            auto it = takeLarge ? largeit : smallit;
+            (takeLarge ? largeFrom : smallFrom) = it->first + 1;
+
+            Transfer* transfer = it->second;
+
             if (!transfer->slot)
             {
                 // check for cancellation here before we go to the trouble of requesting a download/upload URL
@@ -3083,34 +3131,18 @@ std::array<vector<Transfer*>, 6> TransferList::nexttransfers(std::function<bool(
             // don't traverse the whole list if we already have as many as we are going to get
             if (!directionContinuefunction(direction)) break;
 
-            bool continueLarge = true;
-            bool continueSmall = true;
-
             if ((!transfer->slot && isReady(transfer))
                 || (transfer->asyncopencontext
                     && transfer->asyncopencontext->finished))
             {
                 TransferCategory tc(transfer);
 
-                if (tc.sizetype == LARGEFILE && continueLarge)
-                {
-                    continueLarge = continuefunction(transfer);
-                    if (continueLarge)
-                    {
-                        chosenTransfers[tc.index()].push_back(transfer);
-                    }
-                }
-                else if (tc.sizetype == SMALLFILE && continueSmall)
-                {
-                    continueSmall = continuefunction(transfer);
-                    if (continueSmall)
-                    {
-                        chosenTransfers[tc.index()].push_back(transfer);
-                    }
-                }
-                if (!continueLarge && !continueSmall)
+                auto& continueCategory = tc.sizetype == LARGEFILE ? continueLarge : continueSmall;
+
+                continueCategory = continuefunction(transfer);
+                if (continueCategory)
                 {
-                    break;
+                    chosenTransfers[tc.index()].push_back(transfer);
                 }
             }
         }
@@ -3127,6 +3159,53 @@ Transfer *TransferList::transferat(direction_t direction, unsigned int position)
     return NULL;
 }
 
+void TransferList::clear()
+{
+    transfers[GET].clear();
+    transfers[PUT].clear();
+
+    for (auto& queue : mSchedule)
+    {
+        queue.clear();
+    }
+}
+
+auto TransferList::scheduleQueue(direction_t direction, filesizetype_t sizetype) -> schedule_queue&
+{
+    assert(direction == GET || direction == PUT);
+    return mSchedule[static_cast<size_t>(direction * 2 + sizetype)];
+}
+
+void TransferList::schedule(Transfer *transfer)
+{
+    if (transfer->state == TRANSFERSTATE_PAUSED)
+    {
+        return;
+    }
+
+    TransferCategory tc(transfer);
+
+    auto inserted = scheduleQueue(tc.direction, tc.sizetype).emplace(transfer->priority, transfer);
+    assert(inserted.first->second == transfer);
+    static_cast<void>(inserted);
+}
+
+void TransferList::unschedule(Transfer *transfer)
+{
+    // its size, and so its category, may have changed since it was scheduled
+    for (auto sizetype : { LARGEFILE, SMALLFILE })
+    {
+        auto& queue = scheduleQueue(transfer->type, sizetype);
+        auto it = queue.find(transfer->priority);
+
+        if (it != queue.end() && it->second == transfer)
+        {
+            queue.erase(it);
+            return;
+        }
+    }
+}
+
 void TransferList::prepareIncreasePriority(Transfer *transfer, transfer_list::iterator /*srcit*/, transfer_list::iterator dstit, TransferDbCommitter& committer)
 {
     assert(transfer->type == PUT || transfer->type == GET);
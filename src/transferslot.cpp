@@ -83,6 +83,129 @@ double stats::TransferSlotStats::averageStartTransferTime() const
                       static_cast<double>(mNumRequestsWithCalculatedLatency));
 }
 
+std::string UploadController::Decisions::toString() const
+{
+    std::ostringstream oss;
+    oss << "connections: " << mInitialConnections << " initially, " << mPeakConnections
+        << " at most, " << mConnectionChanges << " changes. requests: " << mRequests
+        << ", from " << mMinRequestSize << " to " << mMaxRequestSize << " bytes. rtt: " << mRttMs
+        << " ms";
+    return oss.str();
+}
+
+UploadController::UploadController(m_off_t fileSize, unsigned maxConnections, m_off_t expectedSpeed, dstime now)
+    : mFileSize(fileSize)
+    , mMaxConnections(std::max(maxConnections, 1u))
+    , mSpeed(expectedSpeed)
+    , mLastEvaluation(now)
+{
+    // No more connections than the file has requests of minimum size
+    auto minimumRequests = std::max<m_off_t>(1, (fileSize + MIN_REQUEST_SIZE - 1) / MIN_REQUEST_SIZE);
+
+    mConnections = static_cast<unsigned>(std::min<m_off_t>(std::min(mMaxConnections, INITIAL_CONNECTIONS), minimumRequests));
+
+    mDecisions.mInitialConnections = mConnections;
+    mDecisions.mPeakConnections = mConnections;
+}
+
+m_off_t UploadController::requestSize(m_off_t pos)
+{
+    m_off_t size = MIN_REQUEST_SIZE;
+
+    if (auto perConnection = mSpeed / mConnections)
+    {
+        size = std::max(size, perConnection * REQUEST_DS / SpeedController::DS_PER_SECOND);
+
+        // Long enough that the round trip waiting for the reply doesn't leave the connection idle for long
+        auto bandwidthDelay = static_cast<m_off_t>(static_cast<double>(perConnection) * mRttMs / 1000);
+        size = std::max(size, bandwidthDelay * RTT_FACTOR);
+    }
+
+    size = std::min(size, MAX_REQUEST_SIZE);
+
+    // Share what's left between the connections, so that the last requests still go in parallel
+    auto remaining = mFileSize - pos;
+    if (remaining < size * mConnections)
+    {
+        size = std::max(MIN_REQUEST_SIZE, (remaining + mConnections - 1) / mConnections);
+    }
+
+    ++mDecisions.mRequests;
+    mDecisions.mMinRequestSize = mDecisions.mMinRequestSize ? std::min(mDecisions.mMinRequestSize, size) : size;
+    mDecisions.mMaxRequestSize = std::max(mDecisions.mMaxRequestSize, size);
+
+    return size;
+}
+
+void UploadController::onConnected(double connectMs)
+{
+    // Reused connections report 0. The quickest connection is the closest to the round trip time,
+    // as the first one includes name resolution.
+    if (connectMs > 0)
+    {
+        mRttMs = mRttMs > 0 ? std::min(mRttMs, connectMs) : connectMs;
+        mDecisions.mRttMs = mRttMs;
+    }
+}
+
+void UploadController::onSpeed(m_off_t speed, dstime now)
+{
+    if (speed <= 0)
+    {
+        return;
+    }
+
+    mSpeed = speed;
+
+    if (now - mLastEvaluation < EVALUATION_DS)
+    {
+        return;
+    }
+
+    mLastEvaluation = now;
+    mBestSpeed = std::max(mBestSpeed, speed);
+
+    if (!mProbing)
+    {
+        // Conditions changed: probe again from here
+        if (speed < mBestSpeed * 3 / 4)
+        {
+            mProbing = true;
+            mSpeedBeforeChange = 0;
+            mBestSpeed = speed;
+        }
+        return;
+    }
+
+    if (mSpeedBeforeChange &&
+        static_cast<double>(speed) < static_cast<double>(mSpeedBeforeChange) * (1 + MIN_CONNECTION_GAIN))
+    {
+        // The last connection added didn't pay off
+        mProbing = false;
+        setConnections(mConnections - 1);
+    }
+    else if (mConnections < mMaxConnections)
+    {
+        mSpeedBeforeChange = speed;
+        setConnections(mConnections + 1);
+    }
+    else
+    {
+        mProbing = false;
+    }
+}
+
+void UploadController::setConnections(unsigned connections)
+{
+    LOG_debug << "[UploadController] Connections: " << mConnections << " -> " << connections
+              << " at " << (mSpeed / 1024) << " KB/s";
+
+    mConnections = connections;
+
+    ++mDecisions.mConnectionChanges;
+    mDecisions.mPeakConnections = std::max(mDecisions.mPeakConnections, connections);
+}
+
 // transfer attempts are considered failed after XFERTIMEOUT deciseconds
 // without data flow
 const dstime TransferSlot::XFERTIMEOUT = 600;
@@ -184,6 +307,17 @@ bool TransferSlot::createconnectionsonce()
         }
 #endif
         LOG_debug << "Populating transfer slot with " << connections << " connections, max request size of " << maxRequestSize << " bytes [transferbuf.isNewRaid() = " << transferbuf.isNewRaid() << "] [isDownload = " << (transfer->type == GET) << "]";
+        if (transfer->type == PUT)
+        {
+            // Previous uploads hint at the speed to expect
+            auto expectedSpeed = transfer->client->mTransferStatsManager.collectMetrics(PUT).mWeightedAverageSpeed;
+
+            mUploadController = std::make_unique<UploadController>(transfer->size,
+                                                                   static_cast<unsigned>(connections),
+                                                                   expectedSpeed,
+                                                                   Waiter::ds);
+        }
+
         reqs.resize(static_cast<size_t>(connections));
         mReqSpeeds.resize(static_cast<size_t>(connections));
         asyncIO = new AsyncIOContext*[static_cast<size_t>(connections)]();
@@ -333,6 +467,7 @@ TransferSlot::~TransferSlot()
 
         transfer->client->tslots.erase(slots_it);
         transfer->client->performanceStats.transferFinishes += 1;
+        transfer->client->performanceStats.transferFinishesTotal.add();
     }
 
     if (pendingcmd)
@@ -392,6 +527,12 @@ void TransferSlot::processTransferStats()
                 << ". [Transfer->name = " << transfer->localfilename << "]"
                 << " [cloudRaid = " << (void*)(cloudRaid.get()) << "]";
 
+    if (mUploadController)
+    {
+        LOG_verbose << "[TransferSlot::processTransferStats] " << transferTypeStrV
+                    << " Upload controller decisions: " << mUploadController->decisions().toString();
+    }
+
     const auto addedToTransferStats = transfer->addTransferStats();
     LOG_verbose << "[TransferSlot::processTransferStats] " << transferTypeStrV
                 << " Stats for this transfer have " << (addedToTransferStats ? "" : "NOT ")
@@ -958,7 +1099,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                                         outputPiece->finalize(true, filesize, ctriv, &sc, nullptr);
                                         LOG_debug << "Conn " << i << " : REQ_DECRYPTED [parallel]";
                                         req->status = REQ_DECRYPTED;
-                                    }, false);  // not discardable:  if we downloaded the data, don't waste it - decrypt and write as much as we can to file
+                                    }, false, this);  // not discardable:  if we downloaded the data, don't waste it - decrypt and write as much as we can to file
                                 }
                                 else
                                 {
@@ -1112,7 +1253,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
                                                      pos,
                                                      npos);
                                         req->status = REQ_PREPARED;
-                                    }, true);   // discardable - if the transfer or client are being destroyed, we won't be sending that data.
+                                    }, true, this);   // discardable - if the transfer or client are being destroyed, we won't be sending that data.
                             }
                             else
                             {
@@ -1196,6 +1337,12 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
         {
             if (!reqs[i] || (reqs[i]->status == REQ_READY))
             {
+                // Leave idle the connections the upload controller doesn't want right now
+                if (mUploadController && i >= mUploadController->connections() && !asyncIO[i])
+                {
+                    continue;
+                }
+
                 bool newInputBufferSupplied = false;
                 bool pauseConnectionInputForRaid = false;
                 std::pair<m_off_t, m_off_t> posrange =
@@ -1437,6 +1584,10 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
             m_off_t naturalDiff = std::max<m_off_t>(diff, 0);
             speed = mTransferSpeed.calculateSpeed(naturalDiff);
             meanSpeed = mTransferSpeed.getMeanSpeed();
+            if (mUploadController)
+            {
+                mUploadController->onSpeed(speed, Waiter::ds);
+            }
             if ((Waiter::ds % 50 == 0) || (diff < 0) || (p > transfer->size)) // every 5s
             {
                 if (transferbuf.isRaid() || transferbuf.isNewRaid())
@@ -1515,6 +1666,7 @@ void TransferSlot::doio(MegaClient* client, TransferDbCommitter& committer)
             LOG_warn << "Chunk failed due to a timeout";
             client->app->transfer_failed(transfer, API_EFAILED);
             ++client->performanceStats.transferTempErrors;
+            client->performanceStats.transferTempErrorsTotal.add();
         }
     }
 
@@ -1710,6 +1862,7 @@ std::pair<error, dstime> TransferSlot::processRequestFailure(MegaClient* client,
             client->app->transfer_failed(transfer, API_EFAILED);
             client->setchunkfailed(&httpReq->posturl);
             ++client->performanceStats.transferTempErrors;
+            client->performanceStats.transferTempErrorsTotal.add();
 
             if (changeport)
             {
@@ -1803,6 +1956,11 @@ void TransferSlot::processRequestLatency(const std::shared_ptr<HttpReqXfer>& req
     tsStats.mTotalStartTransferTime += req->mStartTransferTime;
     ++tsStats.mNumRequestsWithCalculatedLatency;
     req->isLatencyProcessed = true;
+
+    if (mUploadController)
+    {
+        mUploadController->onConnected(req->mConnectTime);
+    }
 }
 
 } // namespace
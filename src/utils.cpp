@@ -465,21 +465,91 @@ bool CacheableReader::unserializebinary(byte* data, size_t len)
 }
 
 
+chunkmac_map::MacVector::iterator chunkmac_map::MacVector::find(m_off_t pos)
+{
+    auto it = std::lower_bound(mEntries.begin(), mEntries.end(), pos,
+                               [](const value_type& e, m_off_t p) { return e.first < p; });
+
+    return it != mEntries.end() && it->first == pos ? it : mEntries.end();
+}
+
+chunkmac_map::ChunkMAC& chunkmac_map::MacVector::operator[](m_off_t pos)
+{
+    // most often the last chunk or a new one after it
+    if (mEntries.empty() || mEntries.back().first < pos)
+    {
+        mEntries.emplace_back(pos, ChunkMAC());
+        return mEntries.back().second;
+    }
+
+    auto it = std::lower_bound(mEntries.begin(), mEntries.end(), pos,
+                               [](const value_type& e, m_off_t p) { return e.first < p; });
+
+    if (it->first != pos)
+    {
+        it = mEntries.emplace(it, pos, ChunkMAC());
+    }
+
+    return it->second;
+}
+
+// Older versions stored the number of entries followed by the raw entries. A count that
+// they never reached flags the portable format, in which each entry takes about 20 bytes:
+// the distance from the previous chunk, its state and its MAC.
+static const unsigned short COMPACT_CHUNKMACS = 0xFFFF;
+
+enum ChunkMacState : uint8_t
+{
+    CHUNKMAC_PARTIAL = 0,   // followed by the offset
+    CHUNKMAC_FINISHED = 1,
+    CHUNKMAC_MACSMAC_SO_FAR = 2,
+};
+
 void chunkmac_map::serialize(string& d) const
 {
-    unsigned short ll = (unsigned short)size();
-    d.append((char*)&ll, sizeof(ll));
+    CacheableWriter w(d);
+
+    w.serializeu16(COMPACT_CHUNKMACS);
+    w.serializecompressedu64(mMacMap.size());
+
+    m_off_t last = 0;
     for (auto& it : mMacMap)
     {
-        d.append((char*)&it.first, sizeof(it.first));
-        d.append((char*)&it.second, sizeof(it.second));
+        w.serializecompressedu64(static_cast<uint64_t>(it.first - last));
+        last = it.first;
+
+        if (it.second.isMacsmacSoFar())
+        {
+            w.serializeu8(CHUNKMAC_MACSMAC_SO_FAR);
+        }
+        else if (it.second.finished)
+        {
+            w.serializeu8(CHUNKMAC_FINISHED);
+        }
+        else
+        {
+            w.serializeu8(CHUNKMAC_PARTIAL);
+            w.serializecompressedu64(it.second.offset);
+        }
+
+        d.append(reinterpret_cast<const char*>(it.second.mac), sizeof(it.second.mac));
     }
 }
 
 bool chunkmac_map::unserialize(const char*& ptr, const char* end)
 {
     unsigned short ll;
-    if ((ptr + sizeof(ll) > end) || ptr + (ll = MemAccess::get<unsigned short>(ptr)) * (sizeof(m_off_t) + sizeof(ChunkMAC)) + sizeof(ll) > end)
+    if (ptr + sizeof(ll) > end)
+    {
+        return false;
+    }
+
+    if ((ll = MemAccess::get<unsigned short>(ptr)) == COMPACT_CHUNKMACS)
+    {
+        return unserializeCompact(ptr, end);
+    }
+
+    if (ptr + ll * (sizeof(m_off_t) + sizeof(ChunkMAC)) + sizeof(ll) > end)
     {
         return false;
     }
@@ -491,10 +561,11 @@ bool chunkmac_map::unserialize(const char*& ptr, const char* end)
         m_off_t pos = MemAccess::get<m_off_t>(ptr);
         ptr += sizeof(m_off_t);
 
-        memcpy(&(mMacMap[pos]), ptr, sizeof(ChunkMAC));
+        auto& chunk = mMacMap[pos];
+        memcpy(&chunk, ptr, sizeof(ChunkMAC));
         ptr += sizeof(ChunkMAC);
 
-        if (mMacMap[pos].isMacsmacSoFar())
+        if (chunk.isMacsmacSoFar())
         {
             macsmacSoFarPos = pos;
             assert(i == 0);
@@ -507,6 +578,101 @@ bool chunkmac_map::unserialize(const char*& ptr, const char* end)
     return true;
 }
 
+bool chunkmac_map::unserializeCompact(const char*& ptr, const char* end)
+{
+    // nothing is consumed unless all of it can be read
+    const char* p = ptr + sizeof(unsigned short);
+
+    auto next = [&p, end](uint64_t& value)
+    {
+        int length;
+        if (p >= end || (length = Serialize64::unserialize((byte*)p, static_cast<int>(end - p), &value)) < 0)
+        {
+            return false;
+        }
+
+        p += length;
+        return true;
+    };
+
+    uint64_t count;
+    if (!next(count))
+    {
+        return false;
+    }
+
+    MacVector entries;
+    m_off_t pos = 0;
+    m_off_t soFarPos = -1;
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        uint64_t distance;
+        if (!next(distance) || (i && !distance) || p >= end)
+        {
+            return false;
+        }
+
+        pos += static_cast<m_off_t>(distance);
+
+        ChunkMAC& chunk = entries[pos];
+
+        switch (static_cast<uint8_t>(*p++))
+        {
+            case CHUNKMAC_MACSMAC_SO_FAR:
+                if (i)
+                {
+                    return false;
+                }
+
+                chunk.finished = true;
+                chunk.offset = unsigned(-1);
+                soFarPos = pos;
+                break;
+
+            case CHUNKMAC_FINISHED:
+                chunk.finished = true;
+                break;
+
+            case CHUNKMAC_PARTIAL:
+            {
+                uint64_t offset;
+                if (!next(offset) || offset >= unsigned(-1))
+                {
+                    return false;
+                }
+
+                chunk.offset = static_cast<unsigned>(offset);
+                break;
+            }
+
+            default:
+                return false;
+        }
+
+        if (end - p < static_cast<ptrdiff_t>(sizeof(chunk.mac)))
+        {
+            return false;
+        }
+
+        memcpy(chunk.mac, p, sizeof(chunk.mac));
+        p += sizeof(chunk.mac);
+    }
+
+    for (auto& e : entries)
+    {
+        mMacMap[e.first] = e.second;
+    }
+
+    if (soFarPos >= 0)
+    {
+        macsmacSoFarPos = soFarPos;
+    }
+
+    ptr = p;
+    return true;
+}
+
 void chunkmac_map::calcprogress(m_off_t size, m_off_t& chunkpos, m_off_t& progresscompleted, m_off_t* sumOfPartialChunks)
 {
     chunkpos = 0;
@@ -659,6 +825,57 @@ void chunkmac_map::ctr_decrypt(m_off_t chunkid, SymmCipher *cipher, byte *chunks
     }
 }
 
+void chunkmac_map::ctr_encrypt(const vector<CtrChunk>& chunks, SymmCipher *cipher, int64_t ctriv, bool finishesChunk)
+{
+    vector<SymmCipher::CtrLane> lanes;
+    lanes.reserve(chunks.size());
+
+    // entries move as others are added, so add them all before pointing at them
+    for (auto& c : chunks)
+    {
+        assert(c.chunkid == c.startpos);
+        assert(c.startpos > macsmacSoFarPos);
+
+        mMacMap[c.chunkid];
+    }
+
+    for (auto& c : chunks)
+    {
+        auto& chunk = mMacMap[c.chunkid];
+        lanes.push_back({c.chunkstart, c.chunksize, c.startpos, chunk.mac, true});
+        chunk.offset = 0;
+        chunk.finished = finishesChunk;
+    }
+
+    cipher->ctr_crypt_lanes(lanes.data(), lanes.size(), static_cast<uint64_t>(ctriv), true);
+}
+
+void chunkmac_map::ctr_decrypt(const vector<CtrChunk>& chunks, SymmCipher *cipher, int64_t ctriv)
+{
+    vector<SymmCipher::CtrLane> lanes;
+    lanes.reserve(chunks.size());
+
+    // entries move as others are added, so add them all before pointing at them
+    for (auto& c : chunks)
+    {
+        assert(c.chunkid > macsmacSoFarPos);
+        assert(c.startpos >= c.chunkid);
+        assert(c.startpos + c.chunksize <= ChunkedHash::chunkceil(c.chunkid));
+
+        mMacMap[c.chunkid];
+    }
+
+    for (auto& c : chunks)
+    {
+        ChunkMAC& chunk = mMacMap[c.chunkid];
+        lanes.push_back({c.chunkstart, c.chunksize, c.startpos, chunk.mac, chunk.notStarted()});
+        chunk.finished = true;
+        chunk.offset = 0;
+    }
+
+    cipher->ctr_crypt_lanes(lanes.data(), lanes.size(), static_cast<uint64_t>(ctriv), false);
+}
+
 void chunkmac_map::setProgressContiguous(const m_off_t p)
 {
     progresscontiguous = p;
@@ -678,7 +895,7 @@ void chunkmac_map::finishedUploadChunks(chunkmac_map& macs)
     for (auto& m : macs.mMacMap)
     {
         assert(m.first > macsmacSoFarPos);
-        assert(mMacMap.find(m.first) == mMacMap.end() || !mMacMap[m.first].isMacsmacSoFar());
+        assert(mMacMap.find(m.first) == mMacMap.end() || !mMacMap.find(m.first)->second.isMacsmacSoFar());
 
         m.second.finished = true;
         mMacMap[m.first] = m.second;
@@ -709,42 +926,45 @@ m_off_t chunkmac_map::updateContiguousProgress(m_off_t fileSize)
 
 void chunkmac_map::updateMacsmacProgress(SymmCipher *cipher)
 {
+    // entries folded into the next one are erased together at the end
+    auto first = mMacMap.begin();
     bool updated = false;
+
     while (macsmacSoFarPos + 1024 * 1024 * 5 < progresscontiguous  // never go past contiguous-from-start section
-           && size() > 32 * 3 + 5)   // leave enough room for the mac-with-late-gaps corrective calculation to occur
+           && static_cast<size_t>(mMacMap.end() - first) > 32 * 3 + 5)   // leave enough room for the mac-with-late-gaps corrective calculation to occur
     {
-        if (mMacMap.begin()->second.isMacsmacSoFar())
+        if (first->second.isMacsmacSoFar())
         {
-            auto it = mMacMap.begin();
-            auto& calcSoFar = it->second;
-            auto& next = (++it)->second;
+            auto& calcSoFar = first->second;
+            auto& next = (first + 1)->second;
 
-            assert(it->first == ChunkedHash::chunkfloor(it->first));
+            assert((first + 1)->first == ChunkedHash::chunkfloor((first + 1)->first));
             SymmCipher::xorblock(next.mac, calcSoFar.mac);
             cipher->ecb_encrypt(calcSoFar.mac);
             memcpy(next.mac, calcSoFar.mac, sizeof(next.mac));
 
-            macsmacSoFarPos = it->first;
+            macsmacSoFarPos = (++first)->first;
             next.offset = unsigned(-1);
             assert(next.isMacsmacSoFar());
-            mMacMap.erase(mMacMap.begin());
         }
-        else if (mMacMap.begin()->first == 0 && finishedAt(0))
+        else if (first->first == 0 && finishedAt(0))
         {
-            auto& first = mMacMap.begin()->second;
+            auto& chunk = first->second;
 
             byte mac[SymmCipher::BLOCKSIZE] = { 0 };
-            SymmCipher::xorblock(first.mac, mac);
+            SymmCipher::xorblock(chunk.mac, mac);
             cipher->ecb_encrypt(mac);
-            memcpy(first.mac, mac, sizeof(mac));
+            memcpy(chunk.mac, mac, sizeof(mac));
 
-            first.offset = unsigned(-1);
-            assert(first.isMacsmacSoFar());
+            chunk.offset = unsigned(-1);
+            assert(chunk.isMacsmacSoFar());
             macsmacSoFarPos = 0;
         }
         updated = true;
     }
 
+    mMacMap.erase(mMacMap.begin(), first);
+
     if (updated)
     {
         LOG_verbose << "Macsmac calculation advanced to " << mMacMap.begin()->first;
@@ -2501,7 +2721,7 @@ bool CompareLocalFileMetaMacWithNode(FileAccess* fa, Node* node)
     return CompareLocalFileMetaMacWithNodeKey(fa, node->nodekey(), node->type);
 }
 
-void MegaClientAsyncQueue::push(std::function<void(SymmCipher&)> f, bool discardable)
+void MegaClientAsyncQueue::push(Task f, bool discardable, const void* affinity)
 {
     if (mThreads.empty())
     {
@@ -2512,24 +2732,135 @@ void MegaClientAsyncQueue::push(std::function<void(SymmCipher&)> f, bool discard
     }
     else
     {
+        auto& worker = *mWorkers[workerFor(affinity)];
+
+        ++mPending;
+        {
+            std::lock_guard<std::mutex> g(worker.mMutex);
+            worker.mQueue.emplace_back(discardable, std::move(f));
+        }
+        wakeUp(1);
+    }
+}
+
+void MegaClientAsyncQueue::push(std::vector<Task>&& fs, bool discardable)
+{
+    if (mThreads.empty())
+    {
+        for (auto& f : fs)
+        {
+            if (f)
+            {
+                f(mZeroThreadsCipher);
+            }
+        }
+    }
+    else if (!fs.empty())
+    {
+        // consecutive tasks to consecutive workers, each queue locked once
+        size_t first = workerFor(nullptr);
+        size_t workers = std::min(fs.size(), mWorkers.size());
+
+        mPending += fs.size();
+
+        for (size_t w = 0; w < workers; ++w)
+        {
+            auto& worker = *mWorkers[(first + w) % mWorkers.size()];
+            std::lock_guard<std::mutex> g(worker.mMutex);
+
+            for (size_t i = w; i < fs.size(); i += workers)
+            {
+                worker.mQueue.emplace_back(discardable, std::move(fs[i]));
+            }
+        }
+
+        wakeUp(fs.size());
+    }
+}
+
+size_t MegaClientAsyncQueue::workerFor(const void* affinity)
+{
+    if (affinity)
+    {
+        return affinityWorker(affinity, mWorkers.size());
+    }
+
+    return mNextWorker++ % mWorkers.size();
+}
+
+size_t MegaClientAsyncQueue::affinityWorker(const void* affinity, size_t workers)
+{
+    // affinities are pointers to aligned objects, whose low bits are always zero:
+    // drop them, and spread the rest over the high bits (Fibonacci hashing)
+    auto bits = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(affinity) >> 4);
+
+    return static_cast<size_t>((bits * 0x9E3779B97F4A7C15ull) >> 32) % workers;
+}
+
+void MegaClientAsyncQueue::wakeUp(size_t tasks)
+{
+    // mPending was increased before, and an idle worker counts itself before
+    // checking mPending, so one of the two sees the other
+    if (mIdle)
+    {
+        std::lock_guard<std::mutex> g(mIdleMutex);
+        if (tasks > 1)
+        {
+            mIdleConditionVariable.notify_all();
+        }
+        else
         {
-            std::lock_guard<std::mutex> g(mMutex);
-            mQueue.emplace_back(discardable, std::move(f));
+            mIdleConditionVariable.notify_one();
         }
-        mConditionVariable.notify_one();
     }
 }
 
+bool MegaClientAsyncQueue::take(size_t worker, Task& f)
+{
+    // oldest of our own first, then the newest of somebody else's
+    for (size_t i = 0; i < mWorkers.size(); ++i)
+    {
+        auto& victim = *mWorkers[(worker + i) % mWorkers.size()];
+        std::lock_guard<std::mutex> g(victim.mMutex);
+
+        if (victim.mQueue.empty())
+        {
+            continue;
+        }
+
+        if (!i)
+        {
+            f = std::move(victim.mQueue.front().f);
+            victim.mQueue.pop_front();
+        }
+        else
+        {
+            f = std::move(victim.mQueue.back().f);
+            victim.mQueue.pop_back();
+        }
+
+        --mPending;
+        return true;
+    }
+
+    return false;
+}
+
 MegaClientAsyncQueue::MegaClientAsyncQueue(Waiter& w, unsigned threadCount)
     : mWaiter(w)
 {
     for (unsigned i = threadCount; i--;)
+    {
+        mWorkers.emplace_back(std::make_unique<Worker>());
+    }
+
+    for (size_t i = 0; i < mWorkers.size(); ++i)
     {
         try
         {
-            mThreads.emplace_back([this]()
+            mThreads.emplace_back([this, i]()
             {
-                asyncThreadLoop();
+                asyncThreadLoop(i);
             });
         }
         catch (std::system_error& e)
@@ -2538,14 +2869,20 @@ MegaClientAsyncQueue::MegaClientAsyncQueue(Waiter& w, unsigned threadCount)
             break;
         }
     }
+
+    // if some threads failed to start, their queues are served by stealing
     LOG_debug << "MegaClient Worker threads running: " << mThreads.size();
 }
 
 MegaClientAsyncQueue::~MegaClientAsyncQueue()
 {
     clearDiscardable();
-    push(nullptr, false);
-    mConditionVariable.notify_all();
+    {
+        // the remaining tasks are still executed
+        std::lock_guard<std::mutex> g(mIdleMutex);
+        mExiting = true;
+    }
+    mIdleConditionVariable.notify_all();
     LOG_warn << "~MegaClientAsyncQueue() joining threads";
     for (auto& t : mThreads)
     {
@@ -2556,27 +2893,37 @@ MegaClientAsyncQueue::~MegaClientAsyncQueue()
 
 void MegaClientAsyncQueue::clearDiscardable()
 {
-    std::lock_guard<std::mutex> g(mMutex);
-    auto newEnd = std::remove_if(mQueue.begin(), mQueue.end(), [](Entry& entry){ return entry.discardable; });
-    mQueue.erase(newEnd, mQueue.end());
+    for (auto& worker : mWorkers)
+    {
+        std::lock_guard<std::mutex> g(worker->mMutex);
+        auto newEnd = std::remove_if(worker->mQueue.begin(), worker->mQueue.end(), [](Entry& entry){ return entry.discardable; });
+        mPending -= static_cast<size_t>(std::distance(newEnd, worker->mQueue.end()));
+        worker->mQueue.erase(newEnd, worker->mQueue.end());
+    }
 }
 
-void MegaClientAsyncQueue::asyncThreadLoop()
+void MegaClientAsyncQueue::asyncThreadLoop(size_t worker)
 {
     SymmCipher cipher;
     for (;;)
     {
-        std::function<void(SymmCipher&)> f;
+        Task f;
+        if (take(worker, f))
+        {
+            if (f) f(cipher);
+            mWaiter.notify();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> g(mIdleMutex);
+        ++mIdle;
+        mIdleConditionVariable.wait(g, [this]() { return mPending || mExiting; });
+        --mIdle;
+
+        if (mExiting && !mPending)
         {
-            std::unique_lock<std::mutex> g(mMutex);
-            mConditionVariable.wait(g, [this]() { return !mQueue.empty(); });
-            assert(!mQueue.empty());
-            f = std::move(mQueue.front().f);
-            if (!f) return;   // nullptr is not popped, and causes all the threads to exit
-            mQueue.pop_front();
+            return;
         }
-        f(cipher);
-        mWaiter.notify();
     }
 }
 
@@ -3300,11 +3647,11 @@ std::set<std::string>::iterator getTagPosition(std::set<std::string>& tokens,
         });
 }
 
-bool foldCaseAccentEqual(uint32_t codePoint1, uint32_t codePoint2, bool stripAccents)
-{
-    // 8 is big enough decompose one unicode point
-    using Buffer = std::array<utf8proc_int32_t, 8>;
+// 8 is big enough decompose one unicode point
+using FoldBuffer = std::array<utf8proc_int32_t, 8>;
 
+static utf8proc_ssize_t foldCaseAccentChar(uint32_t codePoint, FoldBuffer& buff, bool stripAccents)
+{
     // convenience.
     auto options = UTF8PROC_CASEFOLD | UTF8PROC_COMPOSE | UTF8PROC_NULLTERM | UTF8PROC_STABLE;
 
@@ -3314,18 +3661,19 @@ bool foldCaseAccentEqual(uint32_t codePoint1, uint32_t codePoint2, bool stripAcc
         options |= UTF8PROC_STRIPMARK;
     }
 
-    auto foldCaseAccent = [options](uint32_t codePoint, Buffer& buff)
-    {
-        return utf8proc_decompose_char((utf8proc_int32_t)codePoint,
-                                       buff.data(),
-                                       static_cast<utf8proc_ssize_t>(buff.size()),
-                                       static_cast<utf8proc_option_t>(options),
-                                       nullptr);
-    };
+    return utf8proc_decompose_char((utf8proc_int32_t)codePoint,
+                                   buff.data(),
+                                   static_cast<utf8proc_ssize_t>(buff.size()),
+                                   static_cast<utf8proc_option_t>(options),
+                                   nullptr);
+}
 
-    Buffer buf1{0};
-    Buffer buf2{0};
-    if (foldCaseAccent(codePoint1, buf1) >= 0 && foldCaseAccent(codePoint2, buf2) >= 0)
+bool foldCaseAccentEqual(uint32_t codePoint1, uint32_t codePoint2, bool stripAccents)
+{
+    FoldBuffer buf1{0};
+    FoldBuffer buf2{0};
+    if (foldCaseAccentChar(codePoint1, buf1, stripAccents) >= 0 &&
+        foldCaseAccentChar(codePoint2, buf2, stripAccents) >= 0)
     {
         return buf1 == buf2;
     }
@@ -3335,6 +3683,52 @@ bool foldCaseAccentEqual(uint32_t codePoint1, uint32_t codePoint2, bool stripAcc
            u_foldCase(codePoint1, U_FOLD_CASE_DEFAULT);
 }
 
+std::string foldCaseAccent(const std::string& text, bool stripAccents)
+{
+    std::string result;
+    result.reserve(text.size());
+
+    auto* position = reinterpret_cast<const utf8proc_uint8_t*>(text.data());
+    auto remaining = static_cast<utf8proc_ssize_t>(text.size());
+
+    while (remaining > 0)
+    {
+        utf8proc_int32_t codePoint;
+        auto length = utf8proc_iterate(position, remaining, &codePoint);
+
+        // Keep invalid sequences as they are.
+        if (length <= 0)
+        {
+            result.push_back(static_cast<char>(*position++));
+            --remaining;
+            continue;
+        }
+
+        position += length;
+        remaining -= length;
+
+        FoldBuffer folded{0};
+        auto count = foldCaseAccentChar(static_cast<uint32_t>(codePoint), folded, stripAccents);
+
+        if (count < 0)
+        {
+            folded[0] = codePoint;
+            count = 1;
+        }
+
+        auto last = std::min(static_cast<size_t>(count), folded.size());
+
+        for (size_t i = 0; i < last && folded[i]; ++i)
+        {
+            utf8proc_uint8_t encoded[4];
+            auto n = utf8proc_encode_char(folded[i], encoded);
+            result.append(reinterpret_cast<const char*>(encoded), static_cast<size_t>(n));
+        }
+    }
+
+    return result;
+}
+
 // This code has been taken from sqlite repository (https://www.sqlite.org/src/file?name=ext/icu/icu.c)
 
 /*
@@ -7069,6 +7069,53 @@ TEST_F(SyncTest, BasicSync_MassNotifyFromLocalFolderTree)
 
 
 
+// How long matching up the entries of one huge folder takes, as they're scanned and their
+// uploads are queued: run with --gtest_also_run_disabled_tests.
+TEST_F(SyncTest, DISABLED_BasicSync_HugeFlatFolderTriplets)
+{
+    const int files = 100000;
+
+    fs::path localtestroot = makeNewTestRoot();
+    StandardClientInUse clientA1 = g_clientManager->getCleanStandardClient(0, localtestroot);
+    ASSERT_TRUE(clientA1->resetBaseFolderMulticlient());
+    ASSERT_TRUE(clientA1->makeCloudSubdirs("f", 0, 0));
+    ASSERT_TRUE(CatchupClients(clientA1));
+
+    handle backupId1 = clientA1->setupSync_mainthread("sync1", "f", false, true);
+    ASSERT_NE(backupId1, UNDEF);
+    waitonsyncs(std::chrono::seconds(4), clientA1);
+
+    // Every file in the same folder.
+    ASSERT_TRUE(buildLocalFolders(clientA1->syncSet(backupId1).localpath, "flat", 0, 0, files));
+
+    auto started = std::chrono::steady_clock::now();
+
+    clientA1->triggerPeriodicScanEarly(backupId1);
+
+    Model model;
+    model.root->addkid(model.buildModelSubdirs("flat", 0, 0, files));
+
+    clientA1->localNodesMustHaveNodes = false;
+    ASSERT_TRUE(clientA1->waitFor([&](StandardClient&){ return clientA1->transfersAdded.load() >= static_cast<unsigned>(files); },
+                                  std::chrono::minutes(10)));
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+
+    ASSERT_TRUE(clientA1->confirmModel_mainthread(model.root.get(), backupId1, false, StandardClient::CONFIRM_LOCAL));
+
+    out() << files << " files matched up and queued in " << elapsed.count() << " s";
+
+#ifdef MEGA_MEASURE_CODE
+    // Calls, total and longest milliseconds.
+    auto report = clientA1->thread_do<string>([](StandardClient& sc, PromiseStringSP p)
+    {
+        p->set_value(sc.client.performanceStats.computeSyncTripletsTime.report());
+    }, __FILE__, __LINE__);
+
+    out() << report.get();
+#endif // MEGA_MEASURE_CODE
+}
+
 /* this one is too slow for regular testing with the current algorithm
 TEST_F(SyncTest, BasicSync_MAX_NEWNODES1)
 {
@@ -0,0 +1,205 @@
+/**
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+#include <mega.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace mega;
+
+TEST(MegaClientAsyncQueue, noThreadsRunsSynchronously)
+{
+    WAIT_CLASS waiter;
+    MegaClientAsyncQueue queue(waiter, 0);
+
+    EXPECT_EQ(queue.threadCount(), 0u);
+
+    auto caller = std::this_thread::get_id();
+    std::thread::id ranOn;
+
+    queue.push([&](SymmCipher&) { ranOn = std::this_thread::get_id(); }, false);
+
+    EXPECT_EQ(ranOn, caller);
+}
+
+TEST(MegaClientAsyncQueue, everyTaskRunsOnce)
+{
+    WAIT_CLASS waiter;
+    std::atomic<int> runs{0};
+
+    {
+        MegaClientAsyncQueue queue(waiter, 4);
+
+        for (int i = 0; i < 1000; ++i)
+            queue.push([&](SymmCipher&) { ++runs; }, false, i % 3 ? &runs : nullptr);
+
+        std::vector<MegaClientAsyncQueue::Task> tasks(1000, [&](SymmCipher&) { ++runs; });
+        queue.push(std::move(tasks), false);
+
+        // Non-discardable tasks are still run on destruction.
+    }
+
+    EXPECT_EQ(runs, 2000);
+}
+
+TEST(MegaClientAsyncQueue, discardableTasksAreCleared)
+{
+    WAIT_CLASS waiter;
+    std::atomic<int> discardableRuns{0};
+    std::atomic<int> otherRuns{0};
+    std::atomic<int> busy{0};
+    std::promise<void> release;
+    auto released = release.get_future().share();
+
+    {
+        MegaClientAsyncQueue queue(waiter, 2);
+
+        // Keep both threads busy.
+        for (int i = 0; i < 2; ++i)
+            queue.push([&busy, released](SymmCipher&) { ++busy; released.wait(); }, false);
+
+        while (busy < 2)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        for (int i = 0; i < 100; ++i)
+        {
+            queue.push([&](SymmCipher&) { ++discardableRuns; }, true);
+            queue.push([&](SymmCipher&) { ++otherRuns; }, false);
+        }
+
+        queue.clearDiscardable();
+        release.set_value();
+    }
+
+    EXPECT_EQ(discardableRuns, 0);
+    EXPECT_EQ(otherRuns, 100);
+}
+
+TEST(MegaClientAsyncQueue, idleThreadsSteal)
+{
+    WAIT_CLASS waiter;
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::atomic<int> runs{0};
+    int affinity = 0;
+
+    MegaClientAsyncQueue queue(waiter, 4);
+
+    // The first task blocks the thread that all of them have affinity to.
+    queue.push([released](SymmCipher&) { released.wait(); }, false, &affinity);
+
+    for (int i = 0; i < 10; ++i)
+        queue.push([&](SymmCipher&) { ++runs; }, false, &affinity);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (runs < 10 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    EXPECT_EQ(runs, 10);
+
+    release.set_value();
+}
+
+TEST(MegaClientAsyncQueue, affinitiesSpreadOverWorkers)
+{
+    // Aligned like the transfer slots that tasks have affinity to.
+    struct alignas(16) Slot
+    {
+        char data[16 * 5];
+    };
+
+    std::vector<std::unique_ptr<Slot>> slots;
+    for (int i = 0; i < 256; ++i)
+        slots.emplace_back(new Slot);
+
+    for (size_t workers : {2u, 3u, 4u, 8u})
+    {
+        std::set<size_t> used;
+
+        for (auto& slot : slots)
+        {
+            auto worker = MegaClientAsyncQueue::affinityWorker(slot.get(), workers);
+
+            ASSERT_LT(worker, workers);
+            used.insert(worker);
+
+            // Always the same one.
+            EXPECT_EQ(worker, MegaClientAsyncQueue::affinityWorker(slot.get(), workers));
+        }
+
+        EXPECT_EQ(used.size(), workers) << workers << " workers";
+    }
+}
+
+// Small tasks pushed by one thread, as TransferSlot::doio() does, against the
+// number of workers: run with --gtest_also_run_disabled_tests.
+TEST(MegaClientAsyncQueue, DISABLED_contention)
+{
+    const int tasks = 200000;
+
+    for (unsigned threads : {1u, 4u, 16u, 32u})
+    {
+        for (bool batched : {false, true})
+        {
+            WAIT_CLASS waiter;
+            std::atomic<int> runs{0};
+
+            auto started = std::chrono::steady_clock::now();
+
+            {
+                MegaClientAsyncQueue queue(waiter, threads);
+
+                // Roughly what it takes to decrypt a small piece.
+                auto task = [&runs](SymmCipher&)
+                {
+                    volatile unsigned x = 0;
+                    for (unsigned i = 0; i < 2000; ++i)
+                        x = x + i;
+                    ++runs;
+                };
+
+                if (batched)
+                {
+                    for (int i = 0; i < tasks; i += 64)
+                        queue.push(std::vector<MegaClientAsyncQueue::Task>(64, task), false);
+                }
+                else
+                {
+                    // a few transfers, so a few affinities
+                    for (int i = 0; i < tasks; ++i)
+                        queue.push(task, false, reinterpret_cast<const void*>(uintptr_t(i % 8 + 1)));
+                }
+            }
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+
+            ASSERT_EQ(runs, tasks);
+
+            std::cout << threads << " threads" << (batched ? ", batched: " : ": ")
+                      << tasks / elapsed.count() / 1000 << " k tasks/s" << std::endl;
+        }
+    }
+}
@@ -29,6 +29,12 @@
 #include "utils.h"
 #include "mega.h"
 
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
 class CacheLRU: public testing::Test
 {
 protected:
@@ -626,3 +632,238 @@ TEST_F(CacheLRU, reduceCacheLRUSize)
     // Root node + rubbish + vault + folder
     ASSERT_EQ(numNodesTotal(), numNodes + 4);
 }
+
+TEST_F(CacheLRU, lookupInRAM_movesNodeToFrontOfLRU)
+{
+    auto rootNode = init(8);
+    auto folder = addNode(mega::nodetype_t::FOLDERNODE, rootNode, false, true);
+
+    std::vector<std::weak_ptr<mega::Node>> files;
+    for (uint32_t i = 0; i < mLruSize - 4; i++)
+    {
+        files.emplace_back(addNode(mega::nodetype_t::FILENODE, folder, true, false));
+    }
+
+    // Both files are at the LRU and the first one is the oldest
+    ASSERT_FALSE(files[0].expired());
+    ASSERT_FALSE(files[1].expired());
+
+    // This lookup only needs the mutex shared and defers its LRU touch
+    auto handle = files[0].lock()->nodeHandle();
+    ASSERT_EQ(mClient->mNodeManager.getNodeByHandle(handle).get(), files[0].lock().get());
+
+    // Adding nodes evicts the second file before the first one
+    while (!files[1].expired())
+    {
+        ASSERT_FALSE(files[0].expired());
+        addNode(mega::nodetype_t::FILENODE, folder, true, false);
+    }
+
+    ASSERT_FALSE(files[0].expired());
+    ASSERT_LE(numNodesInCacheLru(), mLruSize);
+}
+
+TEST_F(CacheLRU, concurrentLookups)
+{
+    auto rootNode = init(64);
+    auto folder = addNode(mega::nodetype_t::FOLDERNODE, rootNode, false, true);
+
+    // Files without a size would be read back from DB as folders
+    auto setSize = [this](mega::Node& file)
+    {
+        file.size = static_cast<m_off_t>(mIndex);
+    };
+
+    std::vector<mega::NodeHandle> handles;
+    for (uint32_t i = 0; i < 2 * mLruSize; i++)
+    {
+        handles.emplace_back(
+            addNode(mega::nodetype_t::FILENODE, folder, true, false, setSize)->nodeHandle());
+    }
+
+    auto& nodeMgr = mClient->mNodeManager;
+    std::atomic<bool> done{false};
+    std::atomic<size_t> mismatches{0};
+
+    auto reader = [&](size_t seed)
+    {
+        for (size_t i = seed; !done; i++)
+        {
+            auto handle = handles[i % handles.size()];
+            auto node = nodeMgr.getNodeByHandle(handle);
+            if (!node || node->nodeHandle() != handle)
+            {
+                ++mismatches;
+            }
+
+            if (i % 64 == 0 && nodeMgr.getChildren(folder.get()).size() < handles.size())
+            {
+                ++mismatches;
+            }
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < 4; i++)
+    {
+        readers.emplace_back(reader, i * 7919);
+    }
+
+    // Meanwhile, keep adding nodes and resizing the LRU
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        addNode(mega::nodetype_t::FILENODE, folder, true, false, setSize);
+        if (i % 32 == 0)
+        {
+            setLruMaxSize(i % 64 ? 32 : 64);
+        }
+    }
+
+    done = true;
+    for (auto& thread : readers)
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ(mismatches, 0u);
+    ASSERT_LE(numNodesInCacheLru(), mLruSize);
+    ASSERT_EQ(nodeMgr.getChildren(folder.get()).size(), handles.size() + 256);
+}
+
+// Lookups per second with a growing number of readers: run with
+// --gtest_also_run_disabled_tests.
+TEST_F(CacheLRU, DISABLED_concurrentLookups_throughput)
+{
+    auto rootNode = init(4096);
+    auto folder = addNode(mega::nodetype_t::FOLDERNODE, rootNode, false, true);
+
+    std::vector<mega::NodeHandle> handles;
+    for (uint32_t i = 0; i < mLruSize / 2; i++)
+    {
+        handles.emplace_back(addNode(mega::nodetype_t::FILENODE, folder, false, true)->nodeHandle());
+    }
+
+    auto& nodeMgr = mClient->mNodeManager;
+    const size_t lookups = 1 << 20;
+
+    for (size_t numReaders : {1u, 2u, 4u, 8u})
+    {
+        auto started = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> readers;
+        for (size_t r = 0; r < numReaders; r++)
+        {
+            readers.emplace_back(
+                [&, r]()
+                {
+                    for (size_t i = r; i < lookups; i += numReaders)
+                    {
+                        nodeMgr.getNodeByHandle(handles[i % handles.size()]);
+                    }
+                });
+        }
+
+        for (auto& thread : readers)
+        {
+            thread.join();
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+
+        std::cout << numReaders << " readers: " << static_cast<double>(lookups) / elapsed.count()
+                  << " lookups/s" << std::endl;
+    }
+}
+
+TEST_F(CacheLRU, nodeIndex)
+{
+    init(8);
+
+    mega::NodeIndex index;
+    auto makeEntry = [this](uint64_t h)
+    {
+        auto handle = mega::NodeHandle().set6byte(h);
+        return std::make_pair(handle, mega::NodeManagerNode(mClient->mNodeManager, handle));
+    };
+
+    // Iterators must survive the growth of the table
+    auto entry = makeEntry(1);
+    auto first = index.emplace(entry.first, std::move(entry.second)).first;
+
+    const uint64_t numEntries = 5000;
+    for (uint64_t h = 2; h <= numEntries; h++)
+    {
+        auto e = makeEntry(h);
+        ASSERT_TRUE(index.emplace(e.first, std::move(e.second)).second);
+    }
+
+    ASSERT_EQ(index.size(), numEntries);
+    ASSERT_EQ(first->first, mega::NodeHandle().set6byte(1));
+    ASSERT_TRUE(first == index.find(mega::NodeHandle().set6byte(1)));
+
+    auto duplicate = makeEntry(7);
+    ASSERT_FALSE(index.emplace(duplicate.first, std::move(duplicate.second)).second);
+
+    // Erase the even handles and check every other one is still found
+    for (uint64_t h = 2; h <= numEntries; h += 2)
+    {
+        index.erase(index.find(mega::NodeHandle().set6byte(h)));
+    }
+
+    ASSERT_EQ(index.size(), numEntries / 2);
+    for (uint64_t h = 1; h <= numEntries; h++)
+    {
+        auto it = index.find(mega::NodeHandle().set6byte(h));
+        ASSERT_EQ(it != index.end(), h % 2 == 1) << h;
+    }
+
+    size_t visited = 0;
+    for (auto& it : index)
+    {
+        ASSERT_EQ(it.first.as8byte() % 2, 1u);
+        visited++;
+    }
+    ASSERT_EQ(visited, index.size());
+
+    // Erased positions are reused
+    auto memoryUsage = index.memoryUsage();
+    for (uint64_t h = 2; h <= numEntries; h += 2)
+    {
+        auto e = makeEntry(h);
+        ASSERT_TRUE(index.emplace(e.first, std::move(e.second)).second);
+    }
+    ASSERT_EQ(index.size(), numEntries);
+    ASSERT_EQ(index.memoryUsage(), memoryUsage);
+
+    index.clear();
+    ASSERT_TRUE(index.empty());
+    ASSERT_TRUE(index.begin() == index.end());
+}
+
+TEST_F(CacheLRU, memoryUsage)
+{
+    auto rootNode = init(8);
+    auto folder = addNode(mega::nodetype_t::FOLDERNODE, rootNode, false, true);
+
+    for (uint32_t i = 0; i < 4 * mLruSize; i++)
+    {
+        addNode(mega::nodetype_t::FILENODE, folder, true, false);
+    }
+
+    auto& nodeMgr = mClient->mNodeManager;
+    auto usage = nodeMgr.getMemoryUsage();
+
+    ASSERT_GT(usage.mIndex, 0u);
+    ASSERT_GT(usage.mChildren, 0u);
+    ASSERT_GE(usage.mNodesInRam, numNodesInRam() * sizeof(mega::Node));
+    ASSERT_EQ(usage.total(),
+              usage.mIndex + usage.mChildren + usage.mNodesInRam + usage.mCacheLRU +
+                  usage.mFingerprints);
+
+    // Nodes unloaded from RAM only keep their index entries
+    setLruMaxSize(4);
+    ASSERT_LT(nodeMgr.getMemoryUsage().mNodesInRam, usage.mNodesInRam);
+    ASSERT_EQ(nodeMgr.getMemoryUsage().mIndex, usage.mIndex);
+
+    nodeMgr.reportMemoryUsage();
+}
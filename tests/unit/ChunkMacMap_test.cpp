@@ -18,11 +18,223 @@
 
 #include <gtest/gtest.h>
 
+#include <mega/filefingerprint.h>
 #include <mega/utils.h>
 
+#include <algorithm>
+#include <random>
+
 namespace mega {
 
+namespace
+{
+
+class ChunkMacMapTest: public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        byte key[SymmCipher::KEYLENGTH];
+        std::fill_n(key, sizeof key, byte(0x33));
+        mCipher.setkey(key);
+    }
+
+    // Positions of the first `count` chunks of a file.
+    static std::vector<m_off_t> chunkPositions(size_t count)
+    {
+        std::vector<m_off_t> positions;
+
+        for (m_off_t pos = 0; positions.size() < count; pos = ChunkedHash::chunkceil(pos))
+            positions.emplace_back(pos);
+
+        return positions;
+    }
+
+    // Finishes the chunks at `positions`, all at once. Only a few bytes of each are MAC'd.
+    void finish(chunkmac_map& macs, const std::vector<m_off_t>& positions)
+    {
+        std::vector<std::array<byte, 16>> data(positions.size());
+        std::vector<chunkmac_map::CtrChunk> chunks;
+
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            data[i].fill(static_cast<byte>(positions[i] >> 17));
+            chunks.push_back({positions[i], data[i].data(), 16, positions[i]});
+        }
+
+        macs.ctr_encrypt(chunks, &mCipher, 7, true);
+    }
+
+    // Reads back what `macs` serializes to.
+    static chunkmac_map roundTrip(const chunkmac_map& macs)
+    {
+        std::string serialized;
+        macs.serialize(serialized);
+
+        chunkmac_map result;
+        const char* ptr = serialized.data();
+
+        EXPECT_TRUE(result.unserialize(ptr, serialized.data() + serialized.size()));
+        EXPECT_EQ(ptr, serialized.data() + serialized.size());
+
+        return result;
+    }
+
+    SymmCipher mCipher;
+}; // ChunkMacMapTest
+
+} // namespace
+
+TEST_F(ChunkMacMapTest, chunksAddedInAnyOrder)
+{
+    auto positions = chunkPositions(40);
 
+    chunkmac_map inOrder;
+    for (auto pos : positions)
+        finish(inOrder, {pos});
+
+    // Several new chunks per call, so entries are added while others are being processed.
+    std::shuffle(positions.begin(), positions.end(), std::mt19937(1));
+
+    chunkmac_map shuffled;
+    for (size_t i = 0; i < positions.size(); i += 8)
+        finish(shuffled, {positions.begin() + static_cast<long>(i), positions.begin() + static_cast<long>(i + 8)});
+
+    EXPECT_EQ(shuffled.size(), inOrder.size());
+    EXPECT_EQ(shuffled.macsmac(&mCipher), inOrder.macsmac(&mCipher));
+}
+
+TEST_F(ChunkMacMapTest, serializeKeepsProgressAndMac)
+{
+    auto positions = chunkPositions(12);
+    auto fileSize = ChunkedHash::chunkceil(positions.back());
+
+    chunkmac_map macs;
+    finish(macs, {positions.begin(), positions.begin() + 4});
+    finish(macs, {positions[6], positions[9]});
+
+    // A chunk that's partly downloaded.
+    byte data[32] = {};
+    macs.ctr_decrypt(positions[7], &mCipher, data, sizeof data, positions[7], 7, false);
+
+    auto result = roundTrip(macs);
+
+    m_off_t pos, completed, partial = 0;
+    m_off_t resultPos, resultCompleted, resultPartial = 0;
+
+    macs.calcprogress(fileSize, pos, completed, &partial);
+    result.calcprogress(fileSize, resultPos, resultCompleted, &resultPartial);
+
+    EXPECT_EQ(resultPos, pos);
+    EXPECT_EQ(resultCompleted, completed);
+    EXPECT_EQ(resultPartial, 32);
+    EXPECT_EQ(result.nextUnprocessedPosFrom(positions[7]), positions[7] + 32);
+    EXPECT_EQ(result.macsmac(&mCipher), macs.macsmac(&mCipher));
+
+    // An entry used to take 32 bytes.
+    std::string serialized;
+    macs.serialize(serialized);
+    EXPECT_LT(serialized.size(), 2 + macs.size() * 24);
 }
 
+TEST_F(ChunkMacMapTest, foldingKeepsMac)
+{
+    auto positions = chunkPositions(200);
+    auto fileSize = ChunkedHash::chunkceil(positions.back());
+
+    chunkmac_map macs;
+    finish(macs, positions);
+
+    auto unfolded = macs;
 
+    macs.updateContiguousProgress(fileSize);
+    macs.updateMacsmacProgress(&mCipher);
+
+    // What's left for the corrective calculation, starting with the MAC so far.
+    EXPECT_EQ(macs.size(), 32u * 3 + 5);
+    EXPECT_EQ(macs.macsmac(&mCipher), unfolded.macsmac(&mCipher));
+
+    auto result = roundTrip(macs);
+
+    EXPECT_EQ(result.size(), macs.size());
+    EXPECT_EQ(result.macsmac(&mCipher), unfolded.macsmac(&mCipher));
+
+    m_off_t pos, completed;
+    result.calcprogress(fileSize, pos, completed);
+
+    EXPECT_EQ(pos, fileSize);
+    EXPECT_EQ(completed, fileSize);
+}
+
+TEST_F(ChunkMacMapTest, readsEntriesOfOlderVersions)
+{
+    // The raw entries older versions wrote.
+    struct OldEntry
+    {
+        byte mac[SymmCipher::BLOCKSIZE];
+        unsigned int offset;
+        bool finished;
+    };
+
+    auto positions = chunkPositions(3);
+
+    std::string serialized;
+    unsigned short count = 3;
+    serialized.append(reinterpret_cast<const char*>(&count), sizeof count);
+
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        OldEntry entry{};
+        std::fill_n(entry.mac, sizeof entry.mac, static_cast<byte>(i + 1));
+        entry.offset = i == 1 ? 1000 : 0;
+        entry.finished = i != 1;
+
+        serialized.append(reinterpret_cast<const char*>(&positions[i]), sizeof positions[i]);
+        serialized.append(reinterpret_cast<const char*>(&entry), sizeof entry);
+    }
+
+    chunkmac_map macs;
+    const char* ptr = serialized.data();
+
+    ASSERT_TRUE(macs.unserialize(ptr, serialized.data() + serialized.size()));
+    EXPECT_EQ(ptr, serialized.data() + serialized.size());
+
+    auto fileSize = ChunkedHash::chunkceil(positions.back());
+
+    m_off_t pos, completed;
+    macs.calcprogress(fileSize, pos, completed);
+
+    EXPECT_EQ(pos, positions[1]);
+    EXPECT_EQ(completed, positions[1] + 1000 + (fileSize - positions[2]));
+
+    // And they're written in the compact format from then on.
+    auto result = roundTrip(macs);
+
+    EXPECT_EQ(result.macsmac(&mCipher), macs.macsmac(&mCipher));
+}
+
+TEST_F(ChunkMacMapTest, truncatedDataIsRejected)
+{
+    auto positions = chunkPositions(6);
+
+    chunkmac_map macs;
+    finish(macs, {positions.begin(), positions.begin() + 5});
+
+    byte data[32] = {};
+    macs.ctr_decrypt(positions[5], &mCipher, data, sizeof data, positions[5], 7, false);
+
+    std::string serialized;
+    macs.serialize(serialized);
+
+    for (size_t length = 0; length < serialized.size(); ++length)
+    {
+        chunkmac_map result;
+        const char* ptr = serialized.data();
+
+        EXPECT_FALSE(result.unserialize(ptr, serialized.data() + length)) << length;
+        EXPECT_EQ(ptr, serialized.data()) << length;
+        EXPECT_EQ(result.size(), 0u) << length;
+    }
+}
+
+}
@@ -22,6 +22,10 @@
 
 #include <cryptopp/hex.h>
 
+#include <array>
+#include <chrono>
+#include <functional>
+#include <iostream>
 #include <math.h>
 
 using namespace mega;
@@ -564,3 +568,137 @@ TEST(Crypto, SymmCipher_KeyRotationBreaksOldCipher)
     ASSERT_TRUE(cipher.cbc_decrypt(data1, sizeof(data1), iv.data()));
     EXPECT_TRUE(equalBuf(data1, kPlain, SymmCipher::BLOCKSIZE, "Round-trip failed"));
 }
+
+namespace
+{
+
+// ctr_crypt() one block at a time, as it was before lanes
+void referenceCtrCrypt(SymmCipher& cipher, byte* data, unsigned len, m_off_t pos, SymmCipher::ctr_iv ctriv, byte* mac, bool encrypt)
+{
+    byte ctr[SymmCipher::BLOCKSIZE], tmp[SymmCipher::BLOCKSIZE];
+
+    MemAccess::set<int64_t>(ctr, static_cast<int64_t>(ctriv));
+    SymmCipher::setint64(pos / SymmCipher::BLOCKSIZE, ctr + sizeof ctriv);
+
+    memcpy(mac, ctr, sizeof ctriv);
+    memcpy(mac + sizeof ctriv, ctr, sizeof ctriv);
+
+    for (; (int)len > 0; len -= SymmCipher::BLOCKSIZE, data += SymmCipher::BLOCKSIZE)
+    {
+        if (encrypt)
+        {
+            SymmCipher::xorblock(data, mac);
+            cipher.ecb_encrypt(mac);
+        }
+
+        cipher.ecb_encrypt(ctr, tmp);
+        SymmCipher::xorblock(tmp, data);
+
+        if (!encrypt)
+        {
+            SymmCipher::xorblock(data, mac, static_cast<int>(std::min<unsigned>(len, SymmCipher::BLOCKSIZE)));
+            cipher.ecb_encrypt(mac);
+        }
+
+        SymmCipher::incblock(ctr);
+    }
+}
+
+} // namespace
+
+TEST(Crypto, SymmCipher_CtrCryptLanesMatchesBlockByBlock)
+{
+    SymmCipher cipher;
+    cipher.setkey(randomBytes(SymmCipher::KEYLENGTH).data());
+
+    const SymmCipher::ctr_iv ctriv = 0x0123456789abcdefull;
+
+    // More buffers than lanes, of different lengths, some not whole blocks.
+    const unsigned lengths[] = {1024, 131072, 17, 0, 4096, 3000, 65536, 16, 262144, 999, 48};
+    const size_t count = sizeof lengths / sizeof *lengths;
+
+    for (bool encrypt : {true, false})
+    {
+        std::vector<std::vector<byte>> data(count), expected(count);
+        std::vector<std::array<byte, SymmCipher::BLOCKSIZE>> macs(count), expectedMacs(count);
+        std::vector<SymmCipher::CtrLane> lanes;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            data[i] = randomBytes(lengths[i] + SymmCipher::BLOCKSIZE);
+            std::fill_n(data[i].data() + lengths[i], SymmCipher::BLOCKSIZE, byte(0));
+            expected[i] = data[i];
+
+            m_off_t pos = static_cast<m_off_t>(i) * 1048576;
+
+            referenceCtrCrypt(cipher, expected[i].data(), lengths[i], pos, ctriv, expectedMacs[i].data(), encrypt);
+            lanes.push_back({data[i].data(), lengths[i], pos, macs[i].data(), true});
+        }
+
+        cipher.ctr_crypt_lanes(lanes.data(), lanes.size(), ctriv, encrypt);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            EXPECT_TRUE(equalBuf(data[i].data(), expected[i].data(), lengths[i], "Data differs"))
+                << "buffer " << i << (encrypt ? " encrypting" : " decrypting");
+            EXPECT_EQ(macs[i], expectedMacs[i])
+                << "buffer " << i << (encrypt ? " encrypting" : " decrypting");
+        }
+    }
+}
+
+// Single core CTR + CBC-MAC throughput of transfer chunks, one at a time and
+// interleaved: run with --gtest_also_run_disabled_tests.
+TEST(Crypto, DISABLED_SymmCipher_CtrCryptLanesThroughput)
+{
+    const unsigned chunkSize = 1048576;
+    const int rounds = 16;
+
+    SymmCipher cipher;
+    cipher.setkey(randomBytes(SymmCipher::KEYLENGTH).data());
+
+    std::vector<std::vector<byte>> chunks;
+    for (size_t i = 0; i < SymmCipher::CTR_LANES; ++i)
+        chunks.emplace_back(randomBytes(chunkSize + SymmCipher::BLOCKSIZE));
+
+    std::vector<std::array<byte, SymmCipher::BLOCKSIZE>> macs(chunks.size());
+
+    for (bool encrypt : {true, false})
+    {
+        auto measure = [&](const char* name, std::function<void()> crypt)
+        {
+            auto started = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < rounds; ++i)
+                crypt();
+
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+
+            auto gigabytes = static_cast<double>(chunkSize) * static_cast<double>(chunks.size() * rounds) / (1 << 30);
+
+            std::cout << (encrypt ? "encrypt, " : "decrypt, ") << name << ": "
+                      << gigabytes / elapsed.count() << " GB/s" << std::endl;
+        };
+
+        measure("block by block", [&]()
+        {
+            for (size_t i = 0; i < chunks.size(); ++i)
+                referenceCtrCrypt(cipher, chunks[i].data(), chunkSize, static_cast<m_off_t>(i) * chunkSize, 1, macs[i].data(), encrypt);
+        });
+
+        measure("one chunk at a time", [&]()
+        {
+            for (size_t i = 0; i < chunks.size(); ++i)
+                cipher.ctr_crypt(chunks[i].data(), chunkSize, static_cast<m_off_t>(i) * chunkSize, 1, macs[i].data(), encrypt);
+        });
+
+        measure("interleaved", [&]()
+        {
+            std::vector<SymmCipher::CtrLane> lanes;
+            for (size_t i = 0; i < chunks.size(); ++i)
+                lanes.push_back({chunks[i].data(), chunkSize, static_cast<m_off_t>(i) * chunkSize, macs[i].data(), true});
+
+            cipher.ctr_crypt_lanes(lanes.data(), lanes.size(), 1, encrypt);
+        });
+    }
+}
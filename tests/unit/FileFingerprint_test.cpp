@@ -117,6 +117,38 @@ namespace {
 //    MockFileAccess mFa;
 //};
 
+// Serves a file held in memory.
+class MemoryInputStreamAccess : public mega::InputStreamAccess
+{
+public:
+    explicit MemoryInputStreamAccess(const std::vector<mega::byte>& content)
+    : mContent(content)
+    {}
+
+    m_off_t size() override
+    {
+        return static_cast<m_off_t>(mContent.size());
+    }
+
+    bool read(mega::byte* buffer, const unsigned size) override
+    {
+        if (mOffset + size > mContent.size())
+        {
+            return false;
+        }
+        if (buffer)
+        {
+            std::copy_n(mContent.begin() + static_cast<std::ptrdiff_t>(mOffset), size, buffer);
+        }
+        mOffset += size;
+        return true;
+    }
+
+private:
+    const std::vector<mega::byte>& mContent;
+    size_t mOffset = 0;
+};
+
 } // anonymous
 
 TEST(FileFingerprint, FileFingerprintCmp_compareNotSmaller)
@@ -294,6 +326,58 @@ TEST(FileFingerprint, comparisonOperator_compareNotEqualBecauseOfCrc)
     ASSERT_FALSE(ffp == ffp2);
 }
 
+TEST(FileFingerprint, genfingerprints_matchesGenfingerprint)
+{
+    // tiny, small and large files
+    std::vector<std::vector<mega::byte>> contents;
+    for (size_t size : {3u, 4u, 100u, 8192u, 8193u, 20000u, 1u << 20})
+    {
+        contents.emplace_back(size);
+        std::iota(contents.back().begin(), contents.back().end(), static_cast<mega::byte>(size));
+    }
+
+    for (unsigned threads : {1u, 3u, 16u})
+    {
+        std::vector<mega::FileFingerprint> fingerprints(contents.size());
+        std::vector<mega::FileFingerprint*> pointers;
+        for (size_t i = 0; i < fingerprints.size(); ++i)
+        {
+            fingerprints[i].mtime = static_cast<mega::m_time_t>(i);
+            pointers.emplace_back(&fingerprints[i]);
+        }
+
+        // the second file can't be opened
+        auto open = [&contents](size_t i) -> std::unique_ptr<mega::InputStreamAccess>
+        {
+            if (i == 1)
+            {
+                return nullptr;
+            }
+            return std::make_unique<MemoryInputStreamAccess>(contents[i]);
+        };
+
+        ASSERT_EQ(mega::FileFingerprint::genfingerprints(pointers, open, threads),
+                  contents.size() - 1);
+
+        // invalid fingerprints never compare equal
+        ASSERT_FALSE(fingerprints[1].isvalid);
+
+        for (size_t i = 0; i < contents.size(); ++i)
+        {
+            if (i == 1)
+            {
+                continue;
+            }
+
+            mega::FileFingerprint expected;
+            expected.mtime = static_cast<mega::m_time_t>(i);
+            MemoryInputStreamAccess is{contents[i]};
+            expected.genfingerprint(&is, expected.mtime);
+            ASSERT_EQ(fingerprints[i], expected) << "file " << i << ", threads " << threads;
+        }
+    }
+}
+
 TEST(FileFingerprint, serialize_unserialize)
 {
     mega::FileFingerprint ffp;
@@ -6,11 +6,23 @@
 #include "mega/gfx/isolatedprocess.h"
 #include "mega/scoped_timer.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
+using mega::GfxDimension;
+using mega::GfxProc;
+using mega::GfxProcessPool;
 using mega::LocalPath;
 using mega::ScopedSteadyTimer;
+using std::chrono::milliseconds;
 using std::chrono::seconds;
 using Params = mega::GfxIsolatedProcess::Params;
 
@@ -79,3 +91,190 @@ TEST(Isolatedprocess, ParamsConstructedWithDuplidatedExtraParametersAreKeptAsExp
         params.toArgs(),
         testing::ElementsAre(expectedExec, "-n=endpoint", "-l=20", "-n=anotherEndplint", "-l=20"));
 }
+
+// Each process of a pool has an endpoint of its own.
+TEST(Isolatedprocess, ParamsForPoolMembersHaveTheirOwnEndpoint)
+{
+    const std::string exec{"the/path is/exe"};
+    const std::string expectedExec{LocalPath::fromAbsolutePath(exec).toPath(false)};
+    const auto rawArgs = std::vector<std::string>{"-t=1"};
+
+    Params params{"endpoint", exec, seconds{20}, rawArgs};
+    ASSERT_THAT(params.forPoolMember(0).toArgs(),
+                testing::ElementsAre(expectedExec, "-n=endpoint", "-l=20", "-t=1"));
+    ASSERT_THAT(params.forPoolMember(2).toArgs(),
+                testing::ElementsAre(expectedExec, "-n=endpoint_2", "-l=20", "-t=1"));
+}
+
+TEST(GfxProcessPool, ConcurrentJobsNeverShareAProcess)
+{
+    GfxProcessPool pool(4);
+
+    std::vector<std::atomic<int>> users(pool.size());
+    std::atomic<bool> shared{false};
+    std::mutex usedMutex;
+    std::set<size_t> used;
+
+    std::vector<std::thread> jobs;
+    for (int i = 0; i < 16; ++i)
+    {
+        jobs.emplace_back(
+            [&]()
+            {
+                for (int j = 0; j < 50; ++j)
+                {
+                    auto process = pool.acquire();
+
+                    if (++users[process.first] > 1)
+                        shared = true;
+
+                    std::this_thread::yield();
+                    --users[process.first];
+
+                    std::lock_guard<std::mutex> g(usedMutex);
+                    used.insert(process.first);
+                }
+            });
+    }
+
+    for (auto& job : jobs)
+        job.join();
+
+    EXPECT_FALSE(shared);
+    EXPECT_EQ(used.size(), pool.size());
+}
+
+TEST(GfxProcessPool, ProcessIsReleasedWhenTheJobFails)
+{
+    GfxProcessPool pool(1);
+
+    try
+    {
+        auto process = pool.acquire();
+        throw std::runtime_error("The isolated process crashed");
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+
+    // The only process isn't left busy.
+    auto acquired = std::async(std::launch::async,
+                               [&pool]()
+                               {
+                                   return pool.acquire().first;
+                               });
+
+    ASSERT_EQ(acquired.wait_for(seconds(10)), std::future_status::ready);
+    EXPECT_EQ(acquired.get(), 0u);
+}
+
+namespace
+{
+
+// How many calls to a provider run at once.
+struct Overlap
+{
+    std::mutex mMutex;
+    std::condition_variable mChanged;
+    size_t mInFlight = 0;
+    size_t mMaxInFlight = 0;
+};
+
+// Generates nothing, after waiting a while for other calls to overlap with.
+class FakeConcurrentProvider: public mega::IGfxProvider
+{
+public:
+    FakeConcurrentProvider(size_t concurrency,
+                           size_t callers,
+                           milliseconds overlapWait,
+                           std::shared_ptr<Overlap> overlap):
+        mConcurrency(concurrency),
+        mCallers(callers),
+        mOverlapWait(overlapWait),
+        mOverlap(std::move(overlap))
+    {}
+
+    std::vector<std::string> generateImages(const LocalPath&,
+                                            const std::vector<GfxDimension>& dimensions) override
+    {
+        std::unique_lock<std::mutex> l(mOverlap->mMutex);
+
+        mOverlap->mMaxInFlight = std::max(mOverlap->mMaxInFlight, ++mOverlap->mInFlight);
+        mOverlap->mChanged.notify_all();
+
+        mOverlap->mChanged.wait_for(l,
+                                    mOverlapWait,
+                                    [this]()
+                                    {
+                                        return mOverlap->mMaxInFlight == mCallers;
+                                    });
+
+        --mOverlap->mInFlight;
+
+        return std::vector<std::string>(dimensions.size());
+    }
+
+    const char* supportedformats() override
+    {
+        return "all";
+    }
+
+    const char* supportedvideoformats() override
+    {
+        return nullptr;
+    }
+
+    size_t concurrency() override
+    {
+        return mConcurrency;
+    }
+
+private:
+    size_t mConcurrency;
+    size_t mCallers;
+    milliseconds mOverlapWait;
+    std::shared_ptr<Overlap> mOverlap;
+};
+
+// The most calls to the provider that ran at once, when callers generate an image each.
+size_t maxOverlap(size_t concurrency, size_t callers, milliseconds overlapWait)
+{
+    auto overlap = std::make_shared<Overlap>();
+
+    GfxProc processor(
+        std::make_unique<FakeConcurrentProvider>(concurrency, callers, overlapWait, overlap));
+    processor.startProcessingThread();
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < callers; ++i)
+    {
+        threads.emplace_back(
+            [&processor]()
+            {
+                // Nothing's generated, so nothing's saved.
+                EXPECT_FALSE(processor.savefa(LocalPath::fromRelativePath("image.jpg"),
+                                              GfxDimension(200, 0),
+                                              LocalPath::fromRelativePath("thumbnail.jpg")));
+            });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    std::lock_guard<std::mutex> g(overlap->mMutex);
+    return overlap->mMaxInFlight;
+}
+
+} // namespace
+
+// Providers that can run several calls at once aren't serialised.
+TEST(GfxProc, ConcurrentProviderIsCalledFromSeveralThreadsAtOnce)
+{
+    EXPECT_EQ(maxOverlap(4, 4, seconds(10)), 4u);
+}
+
+// Others are, as they may not be thread safe.
+TEST(GfxProc, SerialProviderIsCalledFromOneThreadAtATime)
+{
+    EXPECT_EQ(maxOverlap(1, 4, milliseconds(100)), 1u);
+}
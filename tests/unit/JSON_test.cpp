@@ -0,0 +1,244 @@
+/**
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+#include <mega/json.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace mega;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+using Filters = std::map<std::string, std::function<bool(JSON*)>>;
+
+// Roughly what the API sends for each node in a fetchnodes response.
+std::string fetchnodesPayload(size_t nodes)
+{
+    std::mt19937 generator(1);
+
+    auto base64 = [&generator](size_t length)
+    {
+        static const char alphabet[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+        std::string result(length, 'A');
+
+        for (auto& c : result)
+            c = alphabet[generator() % 64];
+
+        return result;
+    };
+
+    std::string payload = "{\"f\":[";
+
+    for (size_t i = 0; i < nodes; ++i)
+    {
+        if (i)
+            payload += ',';
+
+        payload += "{\"h\":\"" + base64(8) + "\",\"p\":\"" + base64(8) + "\",\"u\":\""
+                   + base64(11) + "\",\"t\":" + std::to_string(i % 5 ? 0 : 1) + ",\"a\":\""
+                   + base64(64 + generator() % 128) + "\",\"k\":\"" + base64(8) + ":"
+                   + base64(43) + "\",\"s\":" + std::to_string(generator() % 100000000)
+                   + ",\"ts\":" + std::to_string(1700000000 + i) + "}";
+    }
+
+    payload += "],\"ok\":[],\"s\":[],\"u\":[],\"sn\":\"" + base64(11) + "\"}";
+
+    return payload;
+}
+
+} // namespace
+
+TEST(JSONKernels, best_is_available)
+{
+    auto& available = JSONKernels::available();
+
+    ASSERT_FALSE(available.empty());
+    EXPECT_EQ(&JSONKernels::best(), available.back());
+}
+
+TEST(JSONKernels, stringEnd_matches_scalar)
+{
+    auto& scalar = *JSONKernels::available().front();
+
+    std::mt19937 generator(42);
+
+    // Every alignment, with quotes and backslashes in runs that straddle blocks.
+    const char alphabet[] = {'a', 'a', 'a', '"', '\\', '\\'};
+
+    std::string buffer(256, '\0');
+
+    for (int round = 0; round < 2000; ++round)
+    {
+        auto length = generator() % 160;
+        auto offset = generator() % 64;
+
+        std::fill(buffer.begin(), buffer.end(), '\0');
+
+        for (size_t i = 0; i < length; ++i)
+            buffer[offset + i] = alphabet[generator() % sizeof alphabet];
+
+        auto* start = &buffer[offset];
+        auto* expected = scalar.stringEnd(start);
+
+        for (auto* kernels : JSONKernels::available())
+        {
+            EXPECT_EQ(kernels->stringEnd(start), expected)
+                << kernels->name << ": " << std::string(start, length);
+        }
+    }
+}
+
+TEST(JSON, storeobject_skips_escaped_quotes)
+{
+    JSON json(R"({"a":"x\"}y\\","b":[1,"]"]},"next")");
+
+    std::string object;
+
+    ASSERT_TRUE(json.storeobject(&object));
+    EXPECT_EQ(object, R"({"a":"x\"}y\\","b":[1,"]"]})");
+    EXPECT_STREQ(json.pos, R"(,"next")");
+
+    std::string next;
+
+    ASSERT_TRUE(json.storeobject(&next));
+    EXPECT_EQ(next, "next");
+}
+
+TEST(JSON, storeobject_fails_on_unterminated_string)
+{
+    JSON json(R"({"a":"abc\")");
+
+    EXPECT_FALSE(json.storeobject());
+}
+
+TEST(JSONSplitter, escaped_strings_split_anywhere)
+{
+    const std::string stream = R"({"a":"abc\"de\\","b":[1,22],"c":"\\\""})";
+
+    for (size_t split = 1; split < stream.size(); ++split)
+    {
+        JSONSplitter splitter;
+        std::string a;
+        std::string c;
+
+        Filters filters = {
+            {"{\"a", [&a](JSON* json) { return json->storeobject(&a); }},
+            {"{\"c", [&c](JSON* json) { return json->storeobject(&c); }},
+        };
+
+        auto pending = stream.substr(0, static_cast<size_t>(split));
+        auto consumed = splitter.processChunk(&filters, pending.c_str());
+
+        ASSERT_FALSE(splitter.hasFailed()) << "split at " << split;
+
+        pending = pending.substr(static_cast<size_t>(consumed)) + stream.substr(split);
+        splitter.processChunk(&filters, pending.c_str());
+
+        ASSERT_TRUE(splitter.hasFinished()) << "split at " << split;
+        EXPECT_EQ(a, R"(abc\"de\\)") << "split at " << split;
+        EXPECT_EQ(c, R"(\\\")") << "split at " << split;
+    }
+}
+
+// String scanning throughput of each kernel set, and what fetchnodes parsing
+// achieves with the preferred one: run with --gtest_also_run_disabled_tests.
+TEST(JSONKernels, DISABLED_fetchnodes_throughput)
+{
+    const size_t nodes = 2000000;
+    const size_t chunkSize = 1 << 20;
+
+    auto payload = fetchnodesPayload(nodes);
+    auto megabytes = static_cast<double>(payload.size()) / (1 << 20);
+
+    std::cout << nodes << " nodes, " << megabytes << " MB" << std::endl;
+
+    for (auto* kernels : JSONKernels::available())
+    {
+        size_t strings = 0;
+        auto started = Clock::now();
+
+        for (auto* p = std::strchr(payload.c_str(), '"'); p; p = std::strchr(p + 1, '"'))
+        {
+            p = kernels->stringEnd(p + 1);
+            ++strings;
+        }
+
+        std::chrono::duration<double> elapsed = Clock::now() - started;
+
+        std::cout << kernels->name << " scanning " << strings << " strings: "
+                  << megabytes / elapsed.count() << " MB/s" << std::endl;
+    }
+
+    // As the fetchnodes response is received and its nodes read.
+    size_t parsed = 0;
+
+    Filters filters = {
+        {"{[f{", [&parsed](JSON* json)
+        {
+            if (!json->enterobject())
+                return false;
+
+            std::string value;
+
+            while (json->getnameid() != EOO)
+            {
+                if (!json->storeobject(&value))
+                    return false;
+            }
+
+            ++parsed;
+
+            return json->leaveobject();
+        }},
+    };
+
+    JSONSplitter splitter;
+    std::string buffer;
+
+    auto started = Clock::now();
+
+    for (size_t offset = 0; offset < payload.size(); offset += chunkSize)
+    {
+        buffer.append(payload, offset, chunkSize);
+
+        auto consumed = splitter.processChunk(&filters, buffer.c_str());
+
+        ASSERT_FALSE(splitter.hasFailed());
+
+        buffer.erase(0, static_cast<size_t>(consumed));
+    }
+
+    std::chrono::duration<double> elapsed = Clock::now() - started;
+
+    ASSERT_TRUE(splitter.hasFinished());
+    ASSERT_EQ(parsed, nodes);
+
+    std::cout << JSONKernels::best().name << " fetchnodes: " << megabytes / elapsed.count()
+              << " MB/s, " << static_cast<double>(nodes) / elapsed.count() / 1000
+              << " k nodes/s" << std::endl;
+}
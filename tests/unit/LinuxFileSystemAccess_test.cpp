@@ -0,0 +1,231 @@
+/**
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(ENABLE_SYNC)
+
+#include <gtest/gtest.h>
+#include <mega.h>
+
+#ifdef HAVE_FANOTIFY
+
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace mega
+{
+
+// Reaches into the fanotify state of LinuxFileSystemAccess.
+class FanotifyTest: public ::testing::Test
+{
+protected:
+    FanotifyTest():
+        mRoot(fs::temp_directory_path() / "fanotify_test")
+    {
+        fs::remove_all(mRoot);
+        fs::create_directories(mRoot / "watched");
+        fs::create_directories(mRoot / "unwatched");
+    }
+
+    ~FanotifyTest()
+    {
+        fs::remove_all(mRoot);
+    }
+
+    static LocalPath localPath(const fs::path& path)
+    {
+        return LocalPath::fromAbsolutePath(path.string());
+    }
+
+    static bool watch(LinuxFileSystemAccess& fsAccess, const fs::path& path, uint64_t& filesystem)
+    {
+        return fsAccess.fanotifyWatch(localPath(path), filesystem);
+    }
+
+    static int notifyFd(LinuxFileSystemAccess& fsAccess)
+    {
+        return fsAccess.mNotifyFd;
+    }
+
+    static string key(uint64_t filesystem, const fs::path& directory)
+    {
+        return LinuxFileSystemAccess::fanotifyKey(filesystem, localPath(directory));
+    }
+
+    // Registers a watch for directory that no event may reach: it has no node to notify.
+    static void watchWithoutNode(LinuxFileSystemAccess& fsAccess,
+                                 uint64_t filesystem,
+                                 const fs::path& directory)
+    {
+        auto entry = fsAccess.mWatches.emplace(LinuxFileSystemAccess::FANOTIFY_WATCH,
+                                               WatchEntry(nullptr, UNDEF));
+
+        fsAccess.mFanotifyWatches.emplace(key(filesystem, directory), entry);
+    }
+
+    static int checkEvents(LinuxFileSystemAccess& fsAccess)
+    {
+        PosixWaiter waiter;
+
+        waiter.init(0);
+        fsAccess.addevents(&waiter, 0);
+
+        return fsAccess.checkFanotifyEvents(waiter);
+    }
+
+    // The keys of the directories that pending events report.
+    static std::vector<string> pendingEventKeys(LinuxFileSystemAccess& fsAccess)
+    {
+        std::vector<string> keys;
+
+        alignas(fanotify_event_metadata) char buf[16384];
+        ssize_t length;
+
+        while ((length = read(fsAccess.mFanotifyFd, buf, sizeof(buf))) > 0)
+        {
+            auto* event = reinterpret_cast<fanotify_event_metadata*>(buf);
+
+            for ( ; FAN_EVENT_OK(event, length); event = FAN_EVENT_NEXT(event, length))
+            {
+                auto* info = reinterpret_cast<fanotify_event_info_fid*>(event + 1);
+
+                if (event->event_len < sizeof(*event) + sizeof(*info)
+                    || info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME)
+                    continue;
+
+                uint64_t filesystem;
+                memcpy(&filesystem, &info->fsid, sizeof(filesystem));
+
+                keys.emplace_back(LinuxFileSystemAccess::fanotifyKey(
+                    filesystem,
+                    *reinterpret_cast<struct file_handle*>(info->handle)));
+            }
+        }
+
+        return keys;
+    }
+
+    // Runs check without the privileges to watch filesystems: in a child that's dropped them, if
+    // we're root.
+    static bool runUnprivileged(std::function<bool()> check)
+    {
+        if (geteuid())
+            return check();
+
+        auto child = fork();
+
+        if (!child)
+        {
+            // Nobody.
+            if (setgid(65534) || setuid(65534))
+                _exit(2);
+
+            // So that we can still use our own descriptors through /proc.
+            prctl(PR_SET_DUMPABLE, 1);
+
+            _exit(check() ? 0 : 1);
+        }
+
+        int status = 0;
+
+        return child > 0 && waitpid(child, &status, 0) == child && WIFEXITED(status)
+               && !WEXITSTATUS(status);
+    }
+
+    static void touch(const fs::path& path)
+    {
+        std::ofstream(path) << "x";
+    }
+
+    fs::path mRoot;
+}; // FanotifyTest
+
+TEST_F(FanotifyTest, fallsBackToInotifyWhenUnprivileged)
+{
+    EXPECT_TRUE(runUnprivileged(
+        [this]()
+        {
+            LinuxFileSystemAccess fsAccess;
+            uint64_t filesystem = 0;
+
+            // Marking whole filesystems takes CAP_SYS_ADMIN: directories are watched with inotify.
+            return fsAccess.initFilesystemNotificationSystem()
+                   && !watch(fsAccess, mRoot, filesystem)
+                   && notifyFd(fsAccess) >= 0;
+        }));
+}
+
+TEST_F(FanotifyTest, keysIdentifyEventDirectories)
+{
+    LinuxFileSystemAccess fsAccess;
+    uint64_t filesystem = 0;
+
+    ASSERT_TRUE(fsAccess.initFilesystemNotificationSystem());
+
+    if (!watch(fsAccess, mRoot, filesystem))
+        GTEST_SKIP() << "Unable to watch the filesystem with fanotify";
+
+    auto watched = key(filesystem, mRoot / "watched");
+    auto unwatched = key(filesystem, mRoot / "unwatched");
+
+    ASSERT_FALSE(watched.empty());
+    ASSERT_FALSE(unwatched.empty());
+    EXPECT_NE(watched, unwatched);
+    EXPECT_EQ(watched, key(filesystem, mRoot / "watched"));
+
+    touch(mRoot / "watched" / "file");
+
+    auto keys = pendingEventKeys(fsAccess);
+
+    EXPECT_NE(std::find(keys.begin(), keys.end(), watched), keys.end());
+    EXPECT_EQ(std::find(keys.begin(), keys.end(), unwatched), keys.end());
+}
+
+TEST_F(FanotifyTest, dismissesEventsForUnwatchedDirectories)
+{
+    LinuxFileSystemAccess fsAccess;
+    uint64_t filesystem = 0;
+
+    ASSERT_TRUE(fsAccess.initFilesystemNotificationSystem());
+
+    if (!watch(fsAccess, mRoot, filesystem))
+        GTEST_SKIP() << "Unable to watch the filesystem with fanotify";
+
+    // Were an event for it not dismissed, we'd dereference its missing node.
+    watchWithoutNode(fsAccess, filesystem, mRoot / "watched");
+
+    touch(mRoot / "unwatched" / "file");
+    fs::create_directory(mRoot / "unwatched" / "directory");
+    fs::remove(mRoot / "unwatched" / "file");
+
+    EXPECT_EQ(checkEvents(fsAccess), 0);
+}
+
+} // mega
+
+#endif // HAVE_FANOTIFY
+
+#endif // __linux__ && !__ANDROID__ && ENABLE_SYNC
@@ -0,0 +1,273 @@
+/**
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+#include <megaapi_impl.h>
+
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace mega;
+
+namespace
+{
+
+// Records the transfer callbacks it gets, and can be held in onTransferStart.
+class RecordingListener: public MegaTransferListener
+{
+public:
+    void onTransferStart(MegaApi*, MegaTransfer*) override
+    {
+        record("start");
+
+        if (mHold)
+        {
+            mStarted.set_value();
+            mReleased.get_future().wait();
+        }
+    }
+
+    void onTransferUpdate(MegaApi*, MegaTransfer* transfer) override
+    {
+        record("update " + std::to_string(transfer->getTransferredBytes()));
+    }
+
+    void onTransferFinish(MegaApi*, MegaTransfer*, MegaError*) override
+    {
+        record("finish");
+        mFinished.set_value();
+    }
+
+    void record(const std::string& call)
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        mCalls.emplace_back(call);
+    }
+
+    std::vector<std::string> calls()
+    {
+        std::lock_guard<std::mutex> g(mMutex);
+        return mCalls;
+    }
+
+    bool mHold = false;
+    std::promise<void> mStarted;
+    std::promise<void> mReleased;
+    std::promise<void> mFinished;
+
+private:
+    std::mutex mMutex;
+    std::vector<std::string> mCalls;
+}; // RecordingListener
+
+bool finishes(std::promise<void>& finished)
+{
+    return finished.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+}
+
+// A node as a nodes update delivers it, named after the update
+std::unique_ptr<MegaNode> updatedNode(MegaHandle handle, const char* name, uint64_t changes)
+{
+    std::string empty;
+    std::unique_ptr<MegaNodePrivate> node{new MegaNodePrivate(name,
+                                                              MegaNode::TYPE_FILE,
+                                                              0,
+                                                              0,
+                                                              0,
+                                                              handle,
+                                                              &empty,
+                                                              &empty,
+                                                              nullptr,
+                                                              nullptr,
+                                                              INVALID_HANDLE)};
+    node->addChanges(changes);
+    return node;
+}
+
+std::vector<std::string> names(const MegaNodeList& nodes)
+{
+    std::vector<std::string> names;
+    for (int i = 0; i < nodes.size(); ++i)
+    {
+        names.emplace_back(nodes.get(i)->getName());
+    }
+    return names;
+}
+
+} // namespace
+
+TEST(ListenerDispatcher, transferUpdatesAreCoalesced)
+{
+    ListenerDispatcher dispatcher(nullptr);
+    RecordingListener listener;
+    listener.mHold = true;
+
+    std::set<MegaTransferListener*> transferListeners{&listener};
+    std::set<MegaListener*> listeners;
+
+    MegaTransferPrivate transfer(MegaTransfer::TYPE_DOWNLOAD);
+    transfer.setTag(1);
+
+    dispatcher.postTransfer(ListenerDispatcher::TRANSFER_START, transferListeners, listeners, &transfer);
+    listener.mStarted.get_future().wait();
+
+    // Posted while the listener is busy: only the latest is delivered.
+    for (int i = 1; i <= 100; ++i)
+    {
+        transfer.setTransferredBytes(i);
+        dispatcher.postTransfer(ListenerDispatcher::TRANSFER_UPDATE, transferListeners, listeners, &transfer);
+    }
+
+    MegaErrorPrivate e(API_OK);
+    dispatcher.postTransfer(ListenerDispatcher::TRANSFER_FINISH, transferListeners, listeners, &transfer, &e);
+
+    listener.mReleased.set_value();
+    ASSERT_TRUE(finishes(listener.mFinished));
+
+    std::vector<std::string> expected{"start", "update 100", "finish"};
+    EXPECT_EQ(listener.calls(), expected);
+
+    auto stats = dispatcher.stats();
+    EXPECT_NE(stats.find("merged: 99"), std::string::npos) << stats;
+}
+
+TEST(ListenerDispatcher, updatesDontOvertakeFinish)
+{
+    ListenerDispatcher dispatcher(nullptr);
+    RecordingListener blocker;
+    RecordingListener listener;
+    blocker.mHold = true;
+
+    std::set<MegaTransferListener*> transferListeners{&listener};
+    std::set<MegaListener*> listeners;
+
+    MegaTransferPrivate other(MegaTransfer::TYPE_UPLOAD);
+    other.setTag(2);
+    dispatcher.postTransfer(ListenerDispatcher::TRANSFER_START, {&blocker}, listeners, &other);
+    blocker.mStarted.get_future().wait();
+
+    MegaTransferPrivate transfer(MegaTransfer::TYPE_DOWNLOAD);
+    transfer.setTag(1);
+
+    MegaErrorPrivate e(API_EAGAIN);
+
+    transfer.setTransferredBytes(1);
+    dispatcher.postTransfer(ListenerDispatcher::TRANSFER_UPDATE, transferListeners, listeners, &transfer);
+    dispatcher.postTransfer(ListenerDispatcher::TRANSFER_TEMPORARY_ERROR, transferListeners, listeners, &transfer, &e);
+    transfer.setTransferredBytes(2);
+    dispatcher.postTransfer(ListenerDispatcher::TRANSFER_UPDATE, transferListeners, listeners, &transfer);
+    dispatcher.postTransfer(ListenerDispatcher::TRANSFER_FINISH, transferListeners, listeners, &transfer, &e);
+
+    blocker.mReleased.set_value();
+    ASSERT_TRUE(finishes(listener.mFinished));
+
+    std::vector<std::string> expected{"update 1", "update 2", "finish"};
+    EXPECT_EQ(listener.calls(), expected);
+}
+
+TEST(ListenerDispatcher, forgottenListenerIsNotCalled)
+{
+    ListenerDispatcher dispatcher(nullptr);
+    RecordingListener blocker;
+    RecordingListener forgotten;
+    RecordingListener kept;
+    blocker.mHold = true;
+
+    std::set<MegaListener*> listeners;
+
+    MegaTransferPrivate transfer(MegaTransfer::TYPE_DOWNLOAD);
+    transfer.setTag(1);
+
+    dispatcher.postTransfer(ListenerDispatcher::TRANSFER_START, {&blocker}, listeners, &transfer);
+    blocker.mStarted.get_future().wait();
+
+    MegaErrorPrivate e(API_OK);
+    dispatcher.postTransfer(ListenerDispatcher::TRANSFER_FINISH, {&forgotten, &kept}, listeners, &transfer, &e);
+
+    dispatcher.forget(&forgotten, true);
+
+    blocker.mReleased.set_value();
+    ASSERT_TRUE(finishes(kept.mFinished));
+
+    EXPECT_TRUE(forgotten.calls().empty());
+}
+
+TEST(ListenerDispatcher, shutdownDeliversQueuedEvents)
+{
+    ListenerDispatcher dispatcher(nullptr);
+    RecordingListener blocker;
+    RecordingListener finished;
+    blocker.mHold = true;
+
+    std::set<MegaListener*> listeners;
+
+    MegaTransferPrivate transfer(MegaTransfer::TYPE_DOWNLOAD);
+    transfer.setTag(1);
+
+    dispatcher.postTransfer(ListenerDispatcher::TRANSFER_START, {&blocker}, listeners, &transfer);
+    blocker.mStarted.get_future().wait();
+
+    MegaErrorPrivate e(API_OK);
+    dispatcher.postTransfer(ListenerDispatcher::TRANSFER_FINISH, {&finished}, listeners, &transfer, &e);
+
+    blocker.mReleased.set_value();
+    dispatcher.shutdown();
+
+    // Delivered by the time shutdown() returns, not discarded.
+    std::vector<std::string> expected{"finish"};
+    EXPECT_EQ(finished.calls(), expected);
+}
+
+TEST(ListenerDispatcher, mergedNodeUpdatesKeepTheLatestCopy)
+{
+    MegaNodeListPrivate older;
+    older.addNode(updatedNode(1, "older 1", MegaNode::CHANGE_TYPE_ATTRIBUTES));
+    older.addNode(updatedNode(2, "older 2", MegaNode::CHANGE_TYPE_PARENT));
+    older.addNode(updatedNode(3, "older 3", MegaNode::CHANGE_TYPE_ATTRIBUTES));
+
+    MegaNodeListPrivate newer;
+    newer.addNode(updatedNode(4, "newer 4", MegaNode::CHANGE_TYPE_NEW));
+    newer.addNode(updatedNode(2, "newer 2", MegaNode::CHANGE_TYPE_REMOVED));
+
+    older.mergeUpdates(std::move(newer));
+
+    // Nodes only in the older update keep their place, followed by those of the newer one. A
+    // node in both is the newer copy, in its place in the newer update, with the older changes.
+    std::vector<std::string> expected{"older 1", "older 3", "newer 4", "newer 2"};
+    EXPECT_EQ(names(older), expected);
+
+    EXPECT_EQ(older.get(0)->getChanges(), static_cast<uint64_t>(MegaNode::CHANGE_TYPE_ATTRIBUTES));
+    EXPECT_EQ(older.get(2)->getChanges(), static_cast<uint64_t>(MegaNode::CHANGE_TYPE_NEW));
+    EXPECT_EQ(older.get(3)->getChanges(),
+              static_cast<uint64_t>(MegaNode::CHANGE_TYPE_PARENT | MegaNode::CHANGE_TYPE_REMOVED));
+
+    // The newer update's nodes are taken.
+    EXPECT_EQ(newer.size(), 0);
+
+    // Merging into an empty update, or an empty one in, keeps what there is.
+    MegaNodeListPrivate empty;
+    empty.mergeUpdates(std::move(older));
+    EXPECT_EQ(names(empty), expected);
+
+    MegaNodeListPrivate none;
+    empty.mergeUpdates(std::move(none));
+    EXPECT_EQ(names(empty), expected);
+}
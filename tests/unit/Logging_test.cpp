@@ -19,6 +19,10 @@
 
 #include <mega/logging.h>
 
+#include <chrono>
+#include <iostream>
+#include <thread>
+
 #ifdef ENABLE_LOG_PERFORMANCE
 namespace {
 
@@ -426,6 +430,7 @@ public:
         EXPECT_NE(nullptr, message);
         mLogLevel.insert(loglevel);
         mMessage.push_back(message);
+        mSource.push_back(source);
     }
 
     void checkLogLevel(const int expLogLevel) const
@@ -435,11 +440,27 @@ public:
     }
 
     std::vector<std::string> mMessage;
+    std::vector<std::string> mSource;
 
 private:
     std::set<int> mLogLevel;
 };
 
+// Messages are output on a background thread while this is alive.
+class AsyncOutput
+{
+public:
+    explicit AsyncOutput(size_t bufferSize = mega::SimpleLogger::ASYNC_BUFFER_SIZE)
+    {
+        mega::SimpleLogger::setAsyncOutput(true, bufferSize);
+    }
+
+    ~AsyncOutput()
+    {
+        mega::SimpleLogger::setAsyncOutput(false);
+    }
+};
+
 }
 
 #endif
@@ -592,3 +613,362 @@ TEST(Logging, Extract_file_name_from_full_path)
     ASSERT_EQ(0, strcmp(::mega::log_file_leafname("include/mega/logging.h"), "logging.h"));
     ASSERT_EQ(0, strcmp(::mega::log_file_leafname("include\\mega\\logging.h"), "logging.h" ));
 }
+
+#ifndef ENABLE_LOG_PERFORMANCE
+namespace {
+
+enum Unscoped
+{
+    UNSCOPED_VALUE = 7
+};
+
+struct Printable
+{
+    int value;
+};
+
+std::ostream& operator<<(std::ostream& ostream, const Printable& printable)
+{
+    return ostream << "printable " << printable.value;
+}
+
+// Logs values of every kind that SimpleLogger encodes.
+void logValues()
+{
+    int i = -42;
+    const char* cstring = "cstring";
+    const std::string string = "string";
+    const std::string_view view = "view";
+    auto unique = std::make_unique<int>(5);
+    std::shared_ptr<Printable> shared;
+
+    LOG_info << "literal " << string << ' ' << view << ' ' << cstring << ' ' << i << ' ' << 42u
+             << ' ' << -7ll << ' ' << 18446744073709551615ull << ' ' << short(-3) << ' '
+             << static_cast<unsigned char>('u') << ' ' << 1.5 << ' ' << 0.1f << ' ' << true << ' '
+             << 'c' << ' ' << &i << ' ' << static_cast<int*>(nullptr) << ' ' << UNSCOPED_VALUE
+             << ' ' << Printable{3} << ' ' << std::hex << 255 << ' ' << -1 << ' '
+             << UNSCOPED_VALUE + 8 << std::dec << ' ' << 255 << ' ' << unique << ' ' << shared
+             << ' ' << mega::DirectMessage("direct", 3);
+}
+
+}
+
+TEST(Logging, asyncOutput_formatsAsSynchronousOutput)
+{
+    MockLogger logger;
+    mega::SimpleLogger::setLogLevel(mega::logInfo);
+
+    logValues();
+
+    {
+        AsyncOutput output;
+        logValues();
+    }
+
+    ASSERT_EQ(2u, logger.mMessage.size());
+    EXPECT_EQ(logger.mMessage[0], logger.mMessage[1]);
+    EXPECT_EQ(logger.mSource[0], logger.mSource[1]);
+    EXPECT_NE(logger.mMessage[0].find(" ff ffffffff f 255 5 <empty shared ptr> dir"),
+              std::string::npos) << logger.mMessage[0];
+}
+
+TEST(Logging, asyncOutput_keepsTheOrderOfEachThread)
+{
+    MockLogger logger;
+    mega::SimpleLogger::setLogLevel(mega::logInfo);
+
+    const auto dropped = mega::SimpleLogger::droppedAsyncMessages();
+    const int threads = 4;
+    const int messages = 1000;
+
+    {
+        AsyncOutput output;
+        std::vector<std::thread> workers;
+
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([t]()
+            {
+                for (int i = 0; i < messages; ++i)
+                    LOG_info << t << " " << i;
+            });
+        }
+
+        for (auto& worker : workers)
+            worker.join();
+
+        mega::SimpleLogger::flushAsyncOutput();
+    }
+
+    ASSERT_EQ(dropped, mega::SimpleLogger::droppedAsyncMessages());
+    ASSERT_EQ(static_cast<size_t>(threads * messages), logger.mMessage.size());
+
+    std::vector<int> next(threads);
+
+    for (auto& message : logger.mMessage)
+    {
+        std::istringstream istream(message);
+        int t, i;
+
+        ASSERT_TRUE(istream >> t >> i) << message;
+        EXPECT_EQ(next[static_cast<size_t>(t)]++, i);
+    }
+}
+
+TEST(Logging, asyncOutput_messagesLoggedWhileLogging)
+{
+    MockLogger logger;
+    mega::SimpleLogger::setLogLevel(mega::logInfo);
+
+    auto inner = []()
+    {
+        LOG_info << "inner " << Printable{1};
+        return 2;
+    };
+
+    AsyncOutput output;
+
+    LOG_info << "outer " << std::hex << inner() << " " << Printable{10};
+    LOG_info << "after";
+
+    mega::SimpleLogger::flushAsyncOutput();
+
+    ASSERT_EQ(3u, logger.mMessage.size());
+    EXPECT_EQ("inner printable 1", logger.mMessage[0]);
+    EXPECT_EQ("outer 2 printable a", logger.mMessage[1]);
+    EXPECT_EQ("after", logger.mMessage[2]);
+}
+
+TEST(Logging, asyncOutput_postLogKeepsTheFilename)
+{
+    MockLogger logger;
+    mega::SimpleLogger::setLogLevel(mega::logInfo);
+
+    AsyncOutput output;
+
+    {
+        std::string filename = "app.cpp";
+        mega::SimpleLogger::postLog(mega::logInfo, "from the app", filename.c_str(), 12);
+        filename.assign("changed");
+    }
+
+    mega::SimpleLogger::flushAsyncOutput();
+
+    ASSERT_EQ(1u, logger.mMessage.size());
+    EXPECT_EQ("from the app", logger.mMessage[0]);
+    EXPECT_EQ("app.cpp:12", logger.mSource[0]);
+}
+
+TEST(Logging, asyncOutput_longMessagesAreOutputDirectly)
+{
+    MockLogger logger;
+    mega::SimpleLogger::setLogLevel(mega::logInfo);
+
+    AsyncOutput output(4096);
+
+    const std::string message(10000, 'x');
+    LOG_info << message;
+
+    // Without waiting.
+    ASSERT_EQ(1u, logger.mMessage.size());
+    EXPECT_EQ(message, logger.mMessage[0]);
+}
+
+TEST(Logging, asyncOutput_longMessagesComeAfterQueuedOnes)
+{
+    MockLogger logger;
+    mega::SimpleLogger::setLogLevel(mega::logInfo);
+
+    AsyncOutput output(4096);
+
+    const std::string message(10000, 'x');
+    LOG_info << "queued";
+    LOG_info << message;
+
+    ASSERT_EQ(2u, logger.mMessage.size());
+    EXPECT_EQ("queued", logger.mMessage[0]);
+    EXPECT_EQ(message, logger.mMessage[1]);
+}
+
+TEST(Logging, asyncOutput_stoppingKeepsEveryMessageInOrder)
+{
+    const int threads = 4;
+    const int messages = 20000;
+
+    // Called by the output thread, and by the threads that log while it's stopped.
+    class OrderLogger: public mega::Logger
+    {
+    public:
+        OrderLogger()
+        {
+            mega::SimpleLogger::setOutputClass(this);
+        }
+
+        ~OrderLogger()
+        {
+            mega::SimpleLogger::setOutputClass(nullptr);
+        }
+
+        void log(const char*, int, const char*, const char* message) override
+        {
+            std::istringstream istream(message);
+            int t, i;
+
+            std::lock_guard<std::mutex> guard(mMutex);
+
+            ASSERT_TRUE(istream >> t >> i) << message;
+            EXPECT_EQ(mNext[static_cast<size_t>(t)]++, i);
+        }
+
+        std::mutex mMutex;
+        std::vector<int> mNext = std::vector<int>(threads);
+    } logger;
+
+    mega::SimpleLogger::setLogLevel(mega::logInfo);
+
+    const auto dropped = mega::SimpleLogger::droppedAsyncMessages();
+    std::atomic<int> running{threads};
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([t, &running]()
+        {
+            for (int i = 0; i < messages; ++i)
+                LOG_info << t << " " << i;
+
+            --running;
+        });
+    }
+
+    // Messages being logged while the output thread stops are neither lost nor reordered.
+    // Rings that hold every message of their thread, so that none is dropped.
+    while (running)
+    {
+        AsyncOutput output(1 << 22);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+
+    ASSERT_EQ(dropped, mega::SimpleLogger::droppedAsyncMessages());
+
+    for (auto next : logger.mNext)
+        EXPECT_EQ(messages, next);
+}
+
+TEST(Logging, asyncOutput_countsDroppedMessages)
+{
+    // Holds the output thread while the test logs.
+    class HeldLogger: public MockLogger
+    {
+    public:
+        void log(const char* time, int loglevel, const char* source, const char* message) override
+        {
+            mEntered = true;
+            std::lock_guard<std::mutex> guard(mHold);
+            MockLogger::log(time, loglevel, source, message);
+        }
+
+        std::atomic<bool> mEntered{false};
+        std::mutex mHold;
+    } logger;
+
+    mega::SimpleLogger::setLogLevel(mega::logInfo);
+
+    const auto dropped = mega::SimpleLogger::droppedAsyncMessages();
+    const int messages = 1000;
+
+    AsyncOutput output(4096);
+
+    {
+        std::unique_lock<std::mutex> hold(logger.mHold);
+
+        LOG_info << "first";
+
+        while (!logger.mEntered)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        for (int i = 0; i < messages; ++i)
+            LOG_info << "message " << i;
+    }
+
+    mega::SimpleLogger::flushAsyncOutput();
+
+    const auto lost = mega::SimpleLogger::droppedAsyncMessages() - dropped;
+
+    ASSERT_GT(lost, 0u);
+    ASSERT_EQ(messages + 2 - lost, logger.mMessage.size());
+    EXPECT_EQ("first", logger.mMessage.front());
+    EXPECT_EQ(std::to_string(lost) + " log messages were dropped: the buffer of the thread "
+                                     "that logged them was full",
+              logger.mMessage.back());
+
+    // The oldest are kept.
+    EXPECT_EQ("message 0", logger.mMessage[1]);
+}
+
+// What a message costs the thread that logs it, with and without the output thread:
+// run with --gtest_also_run_disabled_tests.
+TEST(Logging, DISABLED_asyncOutput_overhead)
+{
+    class NullLogger: public mega::Logger
+    {
+    public:
+        void log(const char*, int, const char*, const char*) override
+        {
+            ++mCount;
+        }
+
+        std::atomic<uint64_t> mCount{0};
+    } logger;
+
+    mega::SimpleLogger::setOutputClass(&logger);
+    mega::SimpleLogger::setLogLevel(mega::logDebug);
+
+    const int iterations = 1000000;
+    const std::string name = "some/file/name.txt";
+
+    for (int threads : {1, 4})
+    {
+        for (auto async : {false, true})
+        {
+            const auto dropped = mega::SimpleLogger::droppedAsyncMessages();
+            logger.mCount = 0;
+
+            if (async)
+                mega::SimpleLogger::setAsyncOutput(true, 4 << 20);
+
+            auto started = std::chrono::steady_clock::now();
+
+            std::vector<std::thread> workers;
+
+            for (int t = 0; t < threads; ++t)
+            {
+                workers.emplace_back([&]()
+                {
+                    for (int i = 0; i < iterations; ++i)
+                        LOG_debug << "Uploading " << name << ": " << i << " of " << iterations
+                                  << " bytes, " << 0.5 << "%";
+                });
+            }
+
+            for (auto& worker : workers)
+                worker.join();
+
+            std::chrono::duration<double, std::nano> elapsed =
+                std::chrono::steady_clock::now() - started;
+
+            mega::SimpleLogger::setAsyncOutput(false);
+
+            std::cout << threads << (async ? " threads, asynchronous: " : " threads, synchronous: ")
+                      << elapsed.count() / iterations << " ns per message, "
+                      << mega::SimpleLogger::droppedAsyncMessages() - dropped << " dropped, "
+                      << logger.mCount << " output" << std::endl;
+        }
+    }
+
+    mega::SimpleLogger::setOutputClass(nullptr);
+}
+#endif
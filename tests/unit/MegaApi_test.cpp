@@ -496,3 +496,144 @@ TEST(MegaApi, UseCurrentPathIfNoBasePathIsGiven)
 
     ASSERT_STREQ(std::filesystem::current_path().string().c_str(), megaApi.getBasePath());
 }
+
+#if defined(HAVE_LIBUV) && !defined(_WIN32)
+
+namespace
+{
+
+// Stores data in a streaming cache the way the HTTP server does, and waits for it to be written.
+class StreamingCacheStorer
+{
+public:
+    StreamingCacheStorer()
+    {
+        uv_loop_init(&mLoop);
+    }
+
+    ~StreamingCacheStorer()
+    {
+        uv_loop_close(&mLoop);
+    }
+
+    void store(StreamingCache& cache,
+               std::shared_ptr<StreamingCache::File> file,
+               m_off_t offset,
+               const string& data)
+    {
+        cache.store(&mLoop, std::move(file), offset, string(data));
+        uv_run(&mLoop, UV_RUN_DEFAULT);
+    }
+
+private:
+    uv_loop_t mLoop;
+}; // StreamingCacheStorer
+
+} // namespace
+
+TEST(MegaApi, StreamingCache_availableAfterStore)
+{
+    auto directory = std::filesystem::temp_directory_path() / "streaming_cache_test";
+    std::filesystem::create_directories(directory);
+
+    auto cache =
+        std::make_shared<StreamingCache>(LocalPath::fromAbsolutePath(directory.string()), 1 << 20);
+    StreamingCacheStorer storer;
+
+    auto file = cache->open(1);
+    ASSERT_TRUE(file);
+    EXPECT_EQ(file, cache->open(1));
+
+    string data(300, 'x');
+
+    storer.store(*cache, file, 100, data.substr(0, 100));
+    storer.store(*cache, file, 300, data.substr(0, 100));
+
+    EXPECT_EQ(file->available(0, 1000), 0);
+    EXPECT_EQ(file->available(150, 1000), 50);
+    EXPECT_EQ(file->available(150, 20), 20);
+    EXPECT_EQ(file->available(200, 1000), 0);
+    EXPECT_EQ(cache->size(), 200);
+
+    // Filling the gap joins both ranges, storing again takes no more space.
+    storer.store(*cache, file, 150, data.substr(0, 200));
+    EXPECT_EQ(file->available(100, 1000), 300);
+    EXPECT_EQ(cache->size(), 300);
+
+    // The data is in the file, for sendfile().
+    string read(300, '\0');
+    ASSERT_EQ(pread(file->descriptor(), &read[0], read.size(), 100), 300);
+    EXPECT_EQ(read, data);
+
+    file.reset();
+    std::filesystem::remove_all(directory);
+}
+
+TEST(MegaApi, StreamingCache_notAvailableUntilWritten)
+{
+    auto directory = std::filesystem::temp_directory_path() / "streaming_cache_pending_test";
+    std::filesystem::create_directories(directory);
+
+    auto cache =
+        std::make_shared<StreamingCache>(LocalPath::fromAbsolutePath(directory.string()), 1 << 20);
+
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    auto file = cache->open(1);
+    ASSERT_TRUE(file);
+
+    // The caller doesn't wait for the write: the data isn't served until it's on disk.
+    cache->store(&loop, file, 0, string(100, 'x'));
+    EXPECT_EQ(file->available(0, 100), 0);
+    EXPECT_EQ(cache->size(), 100);
+
+    uv_run(&loop, UV_RUN_DEFAULT);
+    EXPECT_EQ(file->available(0, 100), 100);
+    EXPECT_EQ(cache->size(), 100);
+
+    uv_loop_close(&loop);
+
+    file.reset();
+    std::filesystem::remove_all(directory);
+}
+
+TEST(MegaApi, StreamingCache_evictsLeastRecentlyUsed)
+{
+    auto directory = std::filesystem::temp_directory_path() / "streaming_cache_evict_test";
+    std::filesystem::create_directories(directory);
+
+    auto cache =
+        std::make_shared<StreamingCache>(LocalPath::fromAbsolutePath(directory.string()), 250);
+    StreamingCacheStorer storer;
+
+    string data(100, 'x');
+
+    storer.store(*cache, cache->open(1), 0, data);
+    storer.store(*cache, cache->open(2), 0, data);
+
+    // Files in use are never evicted.
+    auto inUse = cache->open(3);
+    cache->open(1);
+    storer.store(*cache, inUse, 0, data);
+
+    EXPECT_EQ(cache->size(), 200);
+    EXPECT_EQ(cache->open(1)->available(0, 100), 100);
+    EXPECT_EQ(cache->open(2)->available(0, 100), 0);
+    EXPECT_EQ(inUse->available(0, 100), 100);
+
+    // Once only files in use are left, data that doesn't fit isn't stored.
+    auto other = cache->open(4);
+    storer.store(*cache, inUse, 100, data);
+    storer.store(*cache, other, 0, data);
+
+    EXPECT_EQ(inUse->available(0, 200), 200);
+    EXPECT_EQ(other->available(0, 100), 0);
+    EXPECT_EQ(cache->size(), 200);
+
+    other.reset();
+    inUse.reset();
+    std::filesystem::remove_all(directory);
+}
+
+#endif
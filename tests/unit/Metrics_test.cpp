@@ -0,0 +1,198 @@
+/**
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+#include <mega/metrics.h>
+
+#include <chrono>
+
+using namespace mega;
+using namespace std::chrono;
+
+namespace
+{
+
+class MetricsTest: public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        metrics::setEnabled(true);
+    }
+
+    void TearDown() override
+    {
+        metrics::setEnabled(false);
+    }
+}; // MetricsTest
+
+} // namespace
+
+TEST(Histogram, buckets_are_contiguous_and_narrow)
+{
+    using metrics::Histogram;
+
+    uint64_t start = 0;
+
+    for (unsigned bucket = 0; bucket + 1 < Histogram::BUCKETS; ++bucket)
+    {
+        auto end = Histogram::bucketEnd(bucket);
+
+        EXPECT_EQ(Histogram::bucket(start), bucket) << start;
+        EXPECT_EQ(Histogram::bucket(end - 1), bucket) << end - 1;
+        EXPECT_LE((end - start) * Histogram::SUB_BUCKETS, std::max<uint64_t>(end, Histogram::SUB_BUCKETS));
+
+        start = end;
+    }
+
+    // Longer durations are all in the last bucket.
+    EXPECT_EQ(Histogram::bucket(start), Histogram::BUCKETS - 1);
+    EXPECT_EQ(Histogram::bucket(UINT64_MAX), Histogram::BUCKETS - 1);
+}
+
+TEST_F(MetricsTest, histogram_quantiles)
+{
+    metrics::Histogram histogram;
+
+    for (int i = 1; i <= 100; ++i)
+        histogram.record(microseconds(i));
+
+    EXPECT_EQ(histogram.count(), 100u);
+    EXPECT_EQ(histogram.sum(), microseconds(5050));
+
+    // Within the width of a bucket.
+    auto median = histogram.quantile(0.5);
+    EXPECT_GT(median, microseconds(50));
+    EXPECT_LE(median, microseconds(50) * 5 / 4);
+
+    auto p99 = histogram.quantile(0.99);
+    EXPECT_GT(p99, microseconds(99));
+    EXPECT_LE(p99, microseconds(99) * 5 / 4);
+
+    // Powers of two are bucket boundaries.
+    EXPECT_EQ(histogram.countBelow(nanoseconds(1 << 15)), 32u);
+
+    histogram.reset();
+
+    EXPECT_EQ(histogram.count(), 0u);
+    EXPECT_EQ(histogram.quantile(0.5), nanoseconds(0));
+}
+
+TEST_F(MetricsTest, nothing_recorded_while_disabled)
+{
+    auto& registry = metrics::Registry::instance();
+    auto& counter = registry.counter("test_disabled_total", "Counted while disabled");
+    auto& histogram = registry.histogram("test_disabled_seconds", "Timed while disabled");
+
+    metrics::setEnabled(false);
+
+    counter.add();
+    histogram.record(milliseconds(1));
+
+    CodeCounter::ScopeStats stats = {"test", "test_disabled_seconds"};
+    CodeCounter::ScopeTimer(stats).complete();
+    stats.add(milliseconds(1));
+
+    EXPECT_EQ(counter.value(), 0u);
+    EXPECT_EQ(histogram.count(), 0u);
+
+    metrics::setEnabled(true);
+
+    counter.add();
+    CodeCounter::ScopeTimer(stats).complete();
+    stats.add(milliseconds(1));
+
+    EXPECT_EQ(counter.value(), 1u);
+    EXPECT_EQ(histogram.count(), 2u);
+}
+
+TEST_F(MetricsTest, registry_returns_the_same_metric_by_name)
+{
+    auto& registry = metrics::Registry::instance();
+
+    auto& first = registry.counter("test_same_total", "Counted twice");
+    auto& second = registry.counter("test_same_total", "Counted twice");
+
+    EXPECT_EQ(&first, &second);
+}
+
+TEST_F(MetricsTest, gauge_shares_add_up)
+{
+    auto& gauge = metrics::gauge("test_shared", "Shared by several contributors");
+
+    metrics::GaugeShare first(gauge);
+
+    {
+        metrics::GaugeShare second(gauge);
+
+        first.set(3);
+        second.set(4);
+        EXPECT_EQ(gauge.value(), 7);
+
+        // Each changes only its own part.
+        first.set(1);
+        EXPECT_EQ(gauge.value(), 5);
+    }
+
+    // The second's part went with it.
+    EXPECT_EQ(gauge.value(), 1);
+
+    metrics::Registry::instance().reset();
+    EXPECT_EQ(gauge.value(), 1);
+}
+
+TEST_F(MetricsTest, prometheus_text)
+{
+    auto& registry = metrics::Registry::instance();
+
+    registry.counter("test_requests_total", "Requests sent").add(3);
+    registry.gauge("test_queued", "Requests queued").set(-2);
+
+    auto& histogram = registry.histogram("test_request_seconds", "Request latency");
+    histogram.record(microseconds(500));
+    histogram.record(milliseconds(3));
+    histogram.record(hours(2));
+
+    auto text = registry.prometheus();
+
+    EXPECT_NE(text.find("# HELP test_requests_total Requests sent\n"
+                        "# TYPE test_requests_total counter\n"
+                        "test_requests_total 3\n"), string::npos) << text;
+
+    EXPECT_NE(text.find("# TYPE test_queued gauge\n"
+                        "test_queued -2\n"), string::npos) << text;
+
+    // Cumulative, in seconds.
+    EXPECT_NE(text.find("# TYPE test_request_seconds histogram\n"), string::npos) << text;
+    EXPECT_NE(text.find("test_request_seconds_bucket{le=\"1.024e-06\"} 0\n"), string::npos) << text;
+    EXPECT_NE(text.find("test_request_seconds_bucket{le=\"0.000262144\"} 0\n"), string::npos) << text;
+    EXPECT_NE(text.find("test_request_seconds_bucket{le=\"0.00104858\"} 1\n"), string::npos) << text;
+    EXPECT_NE(text.find("test_request_seconds_bucket{le=\"0.0041943\"} 2\n"), string::npos) << text;
+    EXPECT_NE(text.find("test_request_seconds_bucket{le=\"1099.51\"} 2\n"), string::npos) << text;
+    EXPECT_NE(text.find("test_request_seconds_bucket{le=\"+Inf\"} 3\n"
+                        "test_request_seconds_sum 7200\n"
+                        "test_request_seconds_count 3\n"), string::npos) << text;
+
+    registry.reset();
+
+    text = registry.prometheus();
+
+    EXPECT_EQ(histogram.count(), 0u);
+    EXPECT_NE(text.find("test_requests_total 0\n"), string::npos) << text;
+    EXPECT_NE(text.find("test_queued -2\n"), string::npos) << text;
+}
@@ -0,0 +1,425 @@
+/**
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mega/base64.h>
+#include <mega/json.h>
+#include <mega/megaapp.h>
+#include <mega/megaclient.h>
+
+#include "DefaultedDbTable.h"
+#include "utils.h"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+using namespace mega;
+
+namespace
+{
+
+// Keeps the nodes written to it, and the order they're written in
+class NodeTable: public mt::DefaultedDbTable
+{
+public:
+    using DefaultedDbTable::DefaultedDbTable;
+
+    bool put(Node* node) override
+    {
+        auto& serialized = mNodes[node->nodeHandle()];
+        serialized.mNodeCounter = node->getCounter().serialize();
+        serialized.mNode.clear();
+        EXPECT_TRUE(node->serialize(&serialized.mNode));
+
+        mWritten.push_back(node->nodeHandle());
+        return true;
+    }
+
+    bool getNode(NodeHandle nodeHandle, NodeSerialized& serialized) override
+    {
+        auto it = mNodes.find(nodeHandle);
+        if (it == mNodes.end())
+        {
+            return false;
+        }
+
+        serialized = it->second;
+        return true;
+    }
+
+    std::map<NodeHandle, NodeSerialized> mNodes;
+    std::vector<NodeHandle> mWritten;
+}; // NodeTable
+
+class NodeKeyDecryptionTest: public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        makeClient(WORKER_THREADS);
+    }
+
+    // A client with a table for its nodes, and workers to decrypt them
+    void makeClient(unsigned workerThreads)
+    {
+        mClient = mt::makeClient(mApp, nullptr, workerThreads);
+
+        byte masterKey[SymmCipher::KEYLENGTH];
+        std::fill_n(masterKey, sizeof masterKey, byte(0x5a));
+        mClient->key.setkey(masterKey);
+
+        mTable = new NodeTable(mRng);
+        mClient->sctable.reset(mTable);
+        mClient->mNodeManager.setTable(mTable);
+    }
+
+    // The key and attributes of a node as fetchnodes delivers them: the key wrapped by the
+    // master key, and the attributes encrypted with the key, both in base64.
+    void encryptNode(nodetype_t type, const std::string& name, std::string& attrstring, std::string& nodeKey)
+    {
+        byte key[FILENODEKEYLENGTH];
+        size_t keyLength = type == FILENODE ? FILENODEKEYLENGTH : FOLDERNODEKEYLENGTH;
+        for (size_t i = 0; i < keyLength; ++i)
+            key[i] = static_cast<byte>(mNextHandle + i);
+
+        SymmCipher cipher;
+        std::string rawKey(reinterpret_cast<const char*>(key), keyLength);
+        cipher.setkey(&rawKey);
+
+        AttrMap attrs;
+        attrs.map['n'] = name;
+
+        std::string json;
+        attrs.getjson(&json);
+
+        std::string encrypted;
+        MegaClient::makeattr(&cipher, &encrypted, json.c_str());
+        attrstring = Base64::btoa(encrypted);
+
+        mClient->key.ecb_encrypt(key, key, keyLength);
+        nodeKey = Base64::btoa(std::string(reinterpret_cast<const char*>(key), keyLength));
+    }
+
+    // A file node as fetchnodes delivers it, not known to the client.
+    std::shared_ptr<Node> makeEncryptedNode(const std::string& name)
+    {
+        auto node = std::make_shared<Node>(*mClient,
+                                           NodeHandle().set6byte(mNextHandle),
+                                           NodeHandle(),
+                                           FILENODE,
+                                           -1,
+                                           UNDEF,
+                                           nullptr,
+                                           0);
+
+        std::string attrstring;
+        std::string nodeKey;
+        encryptNode(FILENODE, name, attrstring, nodeKey);
+        ++mNextHandle;
+
+        node->attrstring.reset(new std::string(attrstring));
+        node->setKey(nodeKey);
+
+        return node;
+    }
+
+    // A node of the "f" array of a fetchnodes reply. Returns its handle.
+    handle addNodeJson(std::ostringstream& json, nodetype_t type, handle parent, const std::string& name = "")
+    {
+        handle h = mNextHandle;
+
+        json << (json.tellp() > 1 ? "," : "") << "{\"h\":\"" << Base64Str<MegaClient::NODEHANDLE>(h)
+             << "\",\"t\":" << type;
+
+        if (type == FILENODE || type == FOLDERNODE)
+        {
+            std::string attrstring;
+            std::string nodeKey;
+            encryptNode(type, name, attrstring, nodeKey);
+
+            json << ",\"p\":\"" << Base64Str<MegaClient::NODEHANDLE>(parent) << "\",\"a\":\""
+                 << attrstring << "\",\"k\":\"" << nodeKey << "\"";
+
+            if (type == FILENODE)
+            {
+                json << ",\"s\":1000";
+            }
+        }
+
+        json << ",\"ts\":1}";
+
+        ++mNextHandle;
+        return h;
+    }
+
+    // A root, a folder in it, and files in that folder, which are only written to the DB while
+    // fetching nodes. Their handles, in the order they come.
+    std::string makeNodesJson(size_t files, std::vector<handle>& handles)
+    {
+        std::ostringstream json;
+        json << "[";
+
+        handle root = addNodeJson(json, ROOTNODE, UNDEF);
+        handle folder = addNodeJson(json, FOLDERNODE, root, "folder");
+        handles = {root, folder};
+
+        for (size_t i = 0; i < files; ++i)
+        {
+            handles.push_back(addNodeJson(json, FILENODE, folder, fileName(i)));
+        }
+
+        json << "]";
+        return json.str();
+    }
+
+    static std::string fileName(size_t i)
+    {
+        return "file " + std::to_string(i) + ".jpg";
+    }
+
+    // The name of a node, as the client gets it back
+    std::string nameOf(handle h)
+    {
+        auto node = mClient->mNodeManager.getNodeByHandle(NodeHandle().set6byte(h));
+        if (!node)
+        {
+            return "(not found)";
+        }
+
+        EXPECT_TRUE(node->keyApplied()) << toNodeHandle(h);
+        return node->attrs.map['n'];
+    }
+
+    std::vector<NodeHandle> nodeHandles(const std::vector<handle>& handles)
+    {
+        std::vector<NodeHandle> nodeHandles;
+        for (auto h: handles)
+            nodeHandles.push_back(NodeHandle().set6byte(h));
+        return nodeHandles;
+    }
+
+    static constexpr unsigned WORKER_THREADS = 2;
+
+    MegaApp mApp;
+    // used by the table, which the client owns
+    PrnGen mRng;
+    std::shared_ptr<MegaClient> mClient;
+    NodeTable* mTable = nullptr;
+    handle mNextHandle = 1;
+}; // NodeKeyDecryptionTest
+
+} // namespace
+
+TEST_F(NodeKeyDecryptionTest, stepsMatchApplykey)
+{
+    auto applied = makeEncryptedNode("applied");
+    auto stepped = makeEncryptedNode("stepped");
+
+    ASSERT_FALSE(applied->keyApplied());
+    ASSERT_FALSE(stepped->keyApplied());
+
+    EXPECT_TRUE(applied->applykey());
+    EXPECT_EQ(applied->attrs.map['n'], "applied");
+    EXPECT_FALSE(applied->attrstring);
+
+    Node::KeyDecryption decryption;
+    ASSERT_TRUE(stepped->prepareKeyDecryption(decryption));
+
+    // The decryption is done with a cipher of its own, as on a worker thread.
+    SymmCipher cipher;
+    decryption.decrypt(cipher);
+
+    EXPECT_TRUE(stepped->applyKeyDecryption(decryption));
+    EXPECT_TRUE(stepped->keyApplied());
+    EXPECT_EQ(stepped->attrs.map['n'], "stepped");
+    EXPECT_FALSE(stepped->attrstring);
+
+    // Nothing left to do.
+    Node::KeyDecryption again;
+    EXPECT_FALSE(stepped->prepareKeyDecryption(again));
+}
+
+TEST_F(NodeKeyDecryptionTest, badAttributesKeepAttrstring)
+{
+    auto node = makeEncryptedNode("name");
+
+    node->attrstring->assign("AAAA");
+
+    Node::KeyDecryption decryption;
+    ASSERT_TRUE(node->prepareKeyDecryption(decryption));
+
+    SymmCipher cipher;
+    decryption.decrypt(cipher);
+
+    EXPECT_FALSE(decryption.mAttrsDecrypted);
+
+    // The key is still applied, as applykey() does for nodes of our own.
+    EXPECT_TRUE(node->applyKeyDecryption(decryption));
+    EXPECT_TRUE(node->attrstring);
+}
+
+TEST_F(NodeKeyDecryptionTest, flushWritesTheBatchInOrder)
+{
+    std::vector<std::shared_ptr<Node>> nodes;
+    std::vector<NodeHandle> handles;
+
+    for (size_t i = 0; i < 100; ++i)
+    {
+        nodes.emplace_back(makeEncryptedNode(fileName(i)));
+        handles.push_back(nodes.back()->nodeHandle());
+
+        // Nodes whose key is applied already are only written.
+        if (i == 50)
+        {
+            ASSERT_TRUE(nodes.back()->applykey());
+        }
+
+        mClient->mNodeDecryptions.emplace_back();
+        auto& decryption = mClient->mNodeDecryptions.back();
+        decryption.mPrepared = nodes.back()->prepareKeyDecryption(decryption.mDecryption);
+        decryption.mNode = nodes.back();
+
+        EXPECT_EQ(decryption.mPrepared, i != 50);
+    }
+
+    mClient->flushNodeDecryptions();
+
+    EXPECT_TRUE(mClient->mNodeDecryptions.empty());
+    EXPECT_EQ(mTable->mWritten, handles);
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        EXPECT_TRUE(nodes[i]->keyApplied()) << i;
+        EXPECT_FALSE(nodes[i]->attrstring) << i;
+        EXPECT_EQ(nodes[i]->attrs.map['n'], fileName(i));
+    }
+
+    // Nothing to do for an empty batch.
+    mClient->flushNodeDecryptions();
+    EXPECT_EQ(mTable->mWritten.size(), nodes.size());
+}
+
+TEST_F(NodeKeyDecryptionTest, readnodeDecryptsFullBatches)
+{
+    mClient->fetchingnodes = true;
+
+    const size_t batch = MegaClient::NODE_DECRYPTION_BATCH;
+
+    std::vector<handle> handles;
+    auto json = makeNodesJson(batch + 10, handles);
+
+    JSON j(json);
+    ASSERT_TRUE(j.enterarray());
+
+    NodeManager::MissingParentNodes missingParentNodes;
+    handle previousHandleForAlert = UNDEF;
+
+    for (size_t i = 0; i < handles.size(); ++i)
+    {
+        ASSERT_EQ(mClient->readnode(&j,
+                                    0,
+                                    PUTNODES_APP,
+                                    nullptr,
+                                    false,
+                                    true,
+                                    missingParentNodes,
+                                    previousHandleForAlert,
+                                    nullptr,
+                                    nullptr,
+                                    nullptr),
+                  1)
+            << i;
+
+        // The batch is decrypted and written once it's full.
+        ASSERT_EQ(mClient->mNodeDecryptions.size(), (i + 1) % batch) << i;
+        ASSERT_EQ(mTable->mWritten.size(), (i + 1) / batch * batch) << i;
+    }
+
+    // Nodes waiting in the batch are found, still encrypted. Without keeping them, as the
+    // client expects to hold the last reference when they're written.
+    auto waiting = NodeHandle().set6byte(handles.back());
+    EXPECT_FALSE(mClient->mNodeManager.getNodeByHandle(waiting)->keyApplied());
+    EXPECT_EQ(mClient->mNodeManager.getNodeByHandle(waiting),
+              mClient->mNodeManager.getNodeByHandle(waiting));
+
+    mClient->flushNodeDecryptions();
+
+    EXPECT_TRUE(mClient->mNodeDecryptions.empty());
+    EXPECT_EQ(mTable->mWritten, nodeHandles(handles));
+
+    // Once written, they're loaded from the DB.
+    EXPECT_EQ(nameOf(handles[1]), "folder");
+    for (size_t i = 2; i < handles.size(); ++i)
+    {
+        EXPECT_EQ(nameOf(handles[i]), fileName(i - 2));
+    }
+}
+
+TEST_F(NodeKeyDecryptionTest, readnodesWritesEveryNodeInOrder)
+{
+    mClient->fetchingnodes = true;
+
+    std::vector<handle> handles;
+    auto json = makeNodesJson(2 * MegaClient::NODE_DECRYPTION_BATCH + 5, handles);
+
+    JSON j(json);
+    EXPECT_EQ(mClient->readnodes(&j, 0, PUTNODES_APP, nullptr, false, true, nullptr, nullptr), 1);
+
+    EXPECT_TRUE(mClient->mNodeDecryptions.empty());
+    EXPECT_EQ(mTable->mWritten, nodeHandles(handles));
+
+    for (size_t i = 2; i < handles.size(); ++i)
+    {
+        EXPECT_EQ(nameOf(handles[i]), fileName(i - 2));
+    }
+}
+
+// Wall time of readnodes() for a fetchnodes of 100k nodes, against the number of worker threads
+// decrypting them: run with --gtest_also_run_disabled_tests.
+TEST_F(NodeKeyDecryptionTest, DISABLED_fetchnodesThroughput)
+{
+    const size_t count = 100000;
+
+    std::vector<handle> handles;
+    auto json = makeNodesJson(count, handles);
+
+    // without workers, each node is decrypted as it's read
+    for (unsigned workers: {0u, 1u, 2u, 4u, 8u})
+    {
+        makeClient(workers);
+        mClient->fetchingnodes = true;
+
+        JSON j(json);
+
+        auto started = std::chrono::steady_clock::now();
+
+        ASSERT_EQ(mClient->readnodes(&j, 0, PUTNODES_APP, nullptr, false, true, nullptr, nullptr), 1);
+
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - started;
+
+        std::cout << workers << " workers: " << elapsed.count() << " ms for " << count
+                  << " nodes" << std::endl;
+
+        ASSERT_EQ(mTable->mWritten.size(), handles.size());
+    }
+}
@@ -0,0 +1,182 @@
+/**
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+#include <mega/raid.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace mega;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// The sectors of every data part plus their parity, for some number of lines.
+struct RaidParts
+{
+    explicit RaidParts(size_t lines)
+      : mLines(lines)
+    {
+        std::mt19937 generator(static_cast<unsigned>(lines));
+
+        for (unsigned i = 1; i < RAIDPARTS; ++i)
+        {
+            mParts[i].resize(lines * RAIDSECTOR);
+
+            for (auto& b : mParts[i])
+                b = static_cast<byte>(generator());
+        }
+
+        mParts[0].assign(lines * RAIDSECTOR, 0);
+
+        for (unsigned i = 1; i < RAIDPARTS; ++i)
+        {
+            for (size_t j = 0; j < mParts[0].size(); ++j)
+                mParts[0][j] = static_cast<byte>(mParts[0][j] ^ mParts[i][j]);
+        }
+    }
+
+    // The parts as a download would see them, with `missing` absent.
+    std::vector<const byte*> pointers(unsigned missing) const
+    {
+        std::vector<const byte*> result;
+
+        for (unsigned i = 0; i < RAIDPARTS; ++i)
+            result.emplace_back(i == missing ? nullptr : mParts[i].data());
+
+        return result;
+    }
+
+    // What the assembled file content should be.
+    std::vector<byte> expected() const
+    {
+        std::vector<byte> result;
+
+        for (size_t j = 0; j < mLines; ++j)
+        {
+            for (unsigned i = 1; i < RAIDPARTS; ++i)
+            {
+                auto* sector = &mParts[i][j * RAIDSECTOR];
+                result.insert(result.end(), sector, sector + RAIDSECTOR);
+            }
+        }
+
+        return result;
+    }
+
+    size_t mLines;
+    std::vector<byte> mParts[RAIDPARTS];
+}; // RaidParts
+
+} // namespace
+
+TEST(RaidKernels, best_is_available)
+{
+    auto& available = RaidKernels::available();
+
+    ASSERT_FALSE(available.empty());
+    EXPECT_EQ(&RaidKernels::best(), available.back());
+}
+
+TEST(RaidKernels, combine_matches_expected)
+{
+    // Odd line counts exercise kernels that handle several lines at once.
+    for (size_t lines : {1u, 2u, 3u, 17u, 64u})
+    {
+        RaidParts parts(lines);
+
+        auto expected = parts.expected();
+
+        for (auto* kernels : RaidKernels::available())
+        {
+            // RAIDPARTS means every part is present.
+            for (unsigned missing = 0; missing <= RAIDPARTS; ++missing)
+            {
+                std::vector<byte> computed(expected.size());
+
+                kernels->combine(computed.data(), parts.pointers(missing).data(), lines);
+
+                EXPECT_EQ(computed, expected)
+                    << kernels->name << ": lines " << lines << ", missing " << missing;
+            }
+        }
+    }
+}
+
+TEST(RaidKernels, recover_matches_expected)
+{
+    const size_t lines = 33;
+
+    RaidParts parts(lines);
+
+    auto expected = parts.expected();
+
+    for (auto* kernels : RaidKernels::available())
+    {
+        for (unsigned missing = 0; missing < EFFECTIVE_RAIDPARTS; ++missing)
+        {
+            auto computed = expected;
+
+            // Clobber the missing sector of every line.
+            for (size_t j = 0; j < lines; ++j)
+                std::fill_n(&computed[j * RAIDLINE + missing * RAIDSECTOR], RAIDSECTOR, byte(0xa5));
+
+            kernels->recover(computed.data(), parts.mParts[0].data(), missing, lines);
+
+            EXPECT_EQ(computed, expected) << kernels->name << ": missing " << missing;
+        }
+    }
+}
+
+// Throughput of each kernel set: run with --gtest_also_run_disabled_tests.
+TEST(RaidKernels, DISABLED_combine_throughput)
+{
+    const size_t lines = 1 << 16;
+    const int rounds = 64;
+
+    RaidParts parts(lines);
+
+    std::vector<byte> computed(lines * RAIDLINE);
+
+    for (auto* kernels : RaidKernels::available())
+    {
+        for (unsigned missing : {0u, 3u})
+        {
+            auto pointers = parts.pointers(missing);
+            auto started = Clock::now();
+
+            for (int i = 0; i < rounds; ++i)
+                kernels->combine(computed.data(), pointers.data(), lines);
+
+            std::chrono::duration<double> elapsed = Clock::now() - started;
+
+            auto megabytes = static_cast<double>(computed.size() * rounds) / (1 << 20);
+
+            std::cout << kernels->name
+                      << (missing ? " rebuilding a data part: " : " interleaving: ")
+                      << megabytes / elapsed.count()
+                      << " MB/s"
+                      << std::endl;
+        }
+    }
+}
@@ -0,0 +1,152 @@
+/**
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef _WIN32
+
+#include <gtest/gtest.h>
+#include <mega.h>
+
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <vector>
+
+using namespace mega;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Directories each holding a few files and a subdirectory.
+class ScanTree
+{
+public:
+    ScanTree(size_t directories, size_t files)
+      : mRoot(fs::temp_directory_path() / "scan_service_test")
+    {
+        fs::remove_all(mRoot);
+
+        for (size_t i = 0; i < directories; ++i)
+        {
+            auto directory = mRoot / ("d" + std::to_string(i));
+
+            fs::create_directories(directory / "sub");
+
+            for (size_t j = 0; j < files; ++j)
+                std::ofstream(directory / ("f" + std::to_string(j))) << std::string(j + 1, 'x');
+
+            mDirectories.emplace_back(std::move(directory));
+        }
+    }
+
+    ~ScanTree()
+    {
+        fs::remove_all(mRoot);
+    }
+
+    fs::path mRoot;
+    std::vector<fs::path> mDirectories;
+}; // ScanTree
+
+} // namespace
+
+TEST(ScanService, scansDirectoriesConcurrently)
+{
+    const size_t numFiles = 50;
+
+    ScanTree tree(8, numFiles);
+
+    ScanService::setNumThreads(4);
+
+    {
+        FSACCESS_CLASS fsAccess;
+        ScanService service;
+        auto waiter = std::make_shared<WAIT_CLASS>();
+
+        std::vector<ScanService::RequestPtr> requests;
+
+        for (auto& directory : tree.mDirectories)
+        {
+            auto path = LocalPath::fromAbsolutePath(directory.string());
+            auto fsid = fsAccess.fsidOf(path, false, false, FSLogging::logOnError);
+
+            requests.emplace_back(service.queueScan(path, fsid, false, {}, waiter));
+        }
+
+        for (auto& request : requests)
+        {
+            while (!request->completed())
+            {
+                waiter->init(10);
+                waiter->wait();
+            }
+
+            ASSERT_EQ(request->completionResult(), SCAN_SUCCESS);
+
+            auto results = request->resultNodes();
+            ASSERT_EQ(results.size(), numFiles + 1);
+
+            std::set<m_off_t> sizes;
+
+            for (auto& node : results)
+            {
+                if (node.type == FOLDERNODE)
+                {
+                    EXPECT_EQ(node.localname.toPath(false), "sub");
+                    continue;
+                }
+
+                ASSERT_EQ(node.type, FILENODE);
+                EXPECT_TRUE(node.fingerprint.isvalid);
+                EXPECT_NE(node.fsid, UNDEF);
+
+                sizes.emplace(node.fingerprint.size);
+            }
+
+            // Every file was seen, with its own size.
+            EXPECT_EQ(sizes.size(), numFiles);
+        }
+    }
+
+    ScanService::setNumThreads(ScanService::DEFAULT_THREADS);
+}
+
+TEST(ScanService, detectsFsidMismatch)
+{
+    ScanTree tree(1, 1);
+
+    FSACCESS_CLASS fsAccess;
+    ScanService service;
+    auto waiter = std::make_shared<WAIT_CLASS>();
+
+    auto path = LocalPath::fromAbsolutePath(tree.mDirectories[0].string());
+    auto fsid = fsAccess.fsidOf(path, false, false, FSLogging::logOnError);
+
+    auto request = service.queueScan(path, fsid + 1, false, {}, waiter);
+
+    while (!request->completed())
+    {
+        waiter->init(10);
+        waiter->wait();
+    }
+
+    EXPECT_EQ(request->completionResult(), SCAN_FSID_MISMATCH);
+}
+
+#endif // ! _WIN32
@@ -3,13 +3,18 @@
  * This test suite validates sqlite functionalites
  */
 
+#include "utils.h"
+
 #include <gtest/gtest.h>
 #include <mega/db/sqlite.h>
 #include <mega/localpath.h>
 
+#include <chrono>
 #include <filesystem>
+#include <iostream>
 #include <mega.h>
 #include <string>
+#include <thread>
 
 using namespace mega;
 
@@ -100,3 +105,924 @@ TEST(Sqlite, renameDB)
             << "File " << aux << "doesn't exit when it should";
     }
 }
+
+/**
+ * @brief Validate the full-text queries used to narrow down node searches
+ *
+ * Steps:
+ *  - Build queries for name, description and tag criteria
+ *  - Check that they are folded, split at wildcards and combined as the filter requires
+ *  - Check that criteria the index can't narrow down don't produce a query
+ */
+TEST(Sqlite, searchIndexQuery)
+{
+    NodeSearchFilter filter;
+    EXPECT_EQ(SqliteAccountState::searchIndexQuery(filter), "");
+
+    // Case and accents are folded as likeCompare does.
+    filter.byName("ÁbcD");
+    EXPECT_EQ(SqliteAccountState::searchIndexQuery(filter), "(name : \"abcd\")");
+
+    // Wildcards split the pattern and runs shorter than a trigram are skipped.
+    filter.byName("photo*20?4.jpg");
+    EXPECT_EQ(SqliteAccountState::searchIndexQuery(filter),
+              "(name : \"photo\" AND name : \"4.jpg\")");
+
+    filter.byName("ab");
+    EXPECT_EQ(SqliteAccountState::searchIndexQuery(filter), "");
+
+    // Escaped wildcards and quotes are literal.
+    filter.byName("a\\*\"b");
+    EXPECT_EQ(SqliteAccountState::searchIndexQuery(filter), "(name : \"a*\"\"b\")");
+
+    // Criteria are combined as the filter says.
+    filter.byName("report");
+    filter.byDescription("quarterly");
+    filter.byTag("finance");
+    EXPECT_EQ(SqliteAccountState::searchIndexQuery(filter),
+              "(name : \"report\") AND (description : \"quarterly\") AND (tags : \"finance\")");
+
+    filter.useAndForTextQuery(false);
+    EXPECT_EQ(SqliteAccountState::searchIndexQuery(filter),
+              "(name : \"report\") OR (description : \"quarterly\") OR (tags : \"finance\")");
+
+    // Any node might match a short tag, so ORed criteria can't be narrowed down.
+    filter.byTag("tx");
+    EXPECT_EQ(SqliteAccountState::searchIndexQuery(filter), "");
+
+    filter.useAndForTextQuery(true);
+    EXPECT_EQ(SqliteAccountState::searchIndexQuery(filter),
+              "(name : \"report\") AND (description : \"quarterly\")");
+}
+
+/**
+ * @brief Validate opening a database with the search index enabled and disabled
+ *
+ * Steps:
+ *  - Create a new database with the search index enabled
+ *  - Reopen it with the index disabled, and enabled again
+ */
+TEST(Sqlite, openWithSearchIndex)
+{
+    auto pathString{std::filesystem::current_path() / "searchIndexFolder"};
+
+    const MrProper cleanUp(
+        [pathString]()
+        {
+            std::filesystem::remove_all(pathString);
+        });
+
+    std::filesystem::create_directory(pathString);
+    LocalPath folderPath = LocalPath::fromAbsolutePath(pathString.u8string());
+    SqliteDbAccess dbAccess{folderPath};
+
+    std::unique_ptr<FileSystemAccess> fsaccess{new FSACCESS_CLASS};
+    const std::string dbName{"dbName"};
+    PrnGen rng;
+
+    for (int flags: {static_cast<int>(DB_OPEN_FLAG_SEARCH_INDEX),
+                     0,
+                     static_cast<int>(DB_OPEN_FLAG_SEARCH_INDEX)})
+    {
+        std::unique_ptr<DbTable> db{
+            dbAccess.openTableWithNodes(rng, *fsaccess, dbName, flags, nullptr)};
+        ASSERT_TRUE(db) << "Failure opening DB with flags " << flags;
+
+        auto nodesTable = dynamic_cast<DBTableNodes*>(db.get());
+        ASSERT_TRUE(nodesTable);
+        EXPECT_TRUE(nodesTable->removeNodes());
+    }
+}
+
+/**
+ * @brief Validate that writes committed asynchronously are read back and persisted
+ *
+ * Steps:
+ *  - Open a database with asynchronous writes
+ *  - Write, delete and truncate records in transactions, and read them back before and after
+ *    they're committed
+ *  - Abort a transaction, and read a transaction's own writes back through a full scan
+ *  - Scan from another thread while a transaction is open, which sees only what's committed
+ *  - Reopen the database synchronously and check what was persisted
+ */
+TEST(Sqlite, asyncWrites)
+{
+    auto pathString{std::filesystem::current_path() / "asyncWritesFolder"};
+
+    const MrProper cleanUp(
+        [pathString]()
+        {
+            std::filesystem::remove_all(pathString);
+        });
+
+    std::filesystem::create_directory(pathString);
+    LocalPath folderPath = LocalPath::fromAbsolutePath(pathString.u8string());
+    SqliteDbAccess dbAccess{folderPath};
+
+    std::unique_ptr<FileSystemAccess> fsaccess{new FSACCESS_CLASS};
+    const std::string dbName{"dbName"};
+    PrnGen rng;
+
+    auto id = [](uint32_t i)
+    {
+        return i * DbTable::IDSPACING + MegaClient::CACHEDUSER;
+    };
+
+    std::string content;
+
+    {
+        std::unique_ptr<DbTable> db{
+            dbAccess.openTableWithNodes(rng, *fsaccess, dbName, DB_OPEN_FLAG_ASYNC_WRITES, nullptr)};
+        ASSERT_TRUE(db) << "Failure opening DB";
+
+        std::string first{"first"};
+        std::string second{"second"};
+
+        db->begin();
+        db->put(id(1), &first);
+        db->put(id(2), &second);
+        db->del(id(2));
+
+        // Pending writes are read back.
+        EXPECT_TRUE(db->get(id(1), &content));
+        EXPECT_EQ(content, first);
+        EXPECT_FALSE(db->get(id(2), &content));
+
+        db->commit();
+
+        // Whether committed already or not.
+        EXPECT_TRUE(db->get(id(1), &content));
+        EXPECT_EQ(content, first);
+
+        // Aborted writes are gone.
+        db->begin();
+        db->put(id(2), &second);
+        db->abort();
+        EXPECT_FALSE(db->get(id(2), &content));
+
+        // A full scan sees the writes of its own transaction.
+        db->begin();
+        db->truncate();
+        for (uint32_t i = 10; i < 20; ++i)
+        {
+            std::string value = std::to_string(i);
+            db->put(id(i), &value);
+        }
+
+        // Other threads see what's committed: they don't take the transaction over.
+        size_t committed = 0;
+        std::thread(
+            [&db, &committed]()
+            {
+                uint32_t index = 0;
+                std::string value;
+
+                db->rewind();
+                while (db->next(&index, &value))
+                {
+                    ++committed;
+                }
+            })
+            .join();
+        EXPECT_EQ(committed, 1u);
+
+        uint32_t index = 0;
+        size_t count = 0;
+        db->rewind();
+        while (db->next(&index, &content))
+        {
+            EXPECT_EQ(content, std::to_string(index / DbTable::IDSPACING));
+            ++count;
+        }
+        EXPECT_EQ(count, 10u);
+
+        db->put(id(1), &second);
+        db->commit();
+
+        auto stats = dynamic_cast<SqliteAccountState&>(*db).asyncWriteStats();
+        EXPECT_GT(stats.commits, 0u);
+        EXPECT_GE(stats.writes, stats.rows);
+    }
+
+    std::unique_ptr<DbTable> db{dbAccess.openTableWithNodes(rng, *fsaccess, dbName, 0, nullptr)};
+    ASSERT_TRUE(db) << "Failure reopening DB";
+
+    EXPECT_TRUE(db->get(id(1), &content));
+    EXPECT_EQ(content, "second");
+    EXPECT_FALSE(db->get(id(2), &content));
+    EXPECT_TRUE(db->get(id(15), &content));
+    EXPECT_EQ(content, "15");
+}
+
+namespace
+{
+
+// Nodes put in a table with nodes, by handle
+class NodeTree
+{
+public:
+    NodeTree(MegaClient& client, DBTableNodes& table):
+        mClient(client),
+        mTable(table)
+    {}
+
+    // Puts a node, or moves it if it was put already
+    void put(handle h, handle parent, nodetype_t type = FOLDERNODE, const char* tags = nullptr)
+    {
+        auto& node = mNodes[h];
+        if (!node)
+        {
+            node.reset(&mt::makeNode(mClient, type, NodeHandle().set6byte(h)));
+        }
+
+        if (tags)
+        {
+            node->attrs.map[AttrMap::string2nameid(MegaClient::NODE_ATTRIBUTE_TAGS)] = tags;
+        }
+
+        node->parenthandle = parent;
+        EXPECT_TRUE(mTable.put(node.get()));
+    }
+
+    bool isAncestor(handle node, handle ancestor)
+    {
+        return mTable.isAncestor(NodeHandle().set6byte(node),
+                                 NodeHandle().set6byte(ancestor),
+                                 CancelToken());
+    }
+
+    // Handles of the nodes searchNodes() finds below 'ancestor'
+    std::set<handle> below(handle ancestor,
+                           NodeSearchFilter::BoolFilter bySensitivity =
+                               NodeSearchFilter::BoolFilter::disabled)
+    {
+        NodeSearchFilter filter;
+        filter.byAncestors({ancestor, UNDEF, UNDEF});
+        filter.bySensitivity(bySensitivity);
+
+        std::vector<std::pair<NodeHandle, NodeSerialized>> nodes;
+        EXPECT_TRUE(mTable.searchNodes(filter,
+                                       OrderByClause::DEFAULT_ASC,
+                                       nodes,
+                                       CancelToken(),
+                                       NodeSearchPage(0, 0)));
+
+        std::set<handle> handles;
+        for (auto& node: nodes)
+        {
+            handles.insert(node.first.as8byte());
+        }
+        return handles;
+    }
+
+    // Handles of the children getChildren() finds
+    std::set<handle> children(handle parent)
+    {
+        NodeSearchFilter filter;
+        filter.byAncestors({parent, UNDEF, UNDEF});
+
+        std::vector<std::pair<NodeHandle, NodeSerialized>> nodes;
+        EXPECT_TRUE(mTable.getChildren(filter,
+                                       OrderByClause::DEFAULT_ASC,
+                                       nodes,
+                                       CancelToken(),
+                                       NodeSearchPage(0, 0)));
+
+        std::set<handle> handles;
+        for (auto& node: nodes)
+        {
+            handles.insert(node.first.as8byte());
+        }
+        return handles;
+    }
+
+    std::set<std::string> tagsBelow(handle ancestor)
+    {
+        auto tags = mTable.getNodeTagsBelow(CancelToken(), NodeHandle().set6byte(ancestor), "");
+        EXPECT_TRUE(tags);
+        return tags ? *tags : std::set<std::string>();
+    }
+
+private:
+    MegaClient& mClient;
+    DBTableNodes& mTable;
+    std::map<handle, std::unique_ptr<Node>> mNodes;
+}; // NodeTree
+
+} // namespace
+
+/**
+ * @brief Validate ancestry look-ups as nodes are put, moved and removed
+ *
+ * Steps:
+ *  - Put a tree, children before their parents, and look up ancestors and descendants
+ *    before and after indexes are created
+ *  - Move a folder, and put one above nodes put already
+ *  - Remove every node and put them again
+ */
+TEST(Sqlite, ancestryIndex)
+{
+    auto pathString{std::filesystem::current_path() / "ancestryIndexFolder"};
+
+    const MrProper cleanUp(
+        [pathString]()
+        {
+            std::filesystem::remove_all(pathString);
+        });
+
+    std::filesystem::create_directory(pathString);
+    LocalPath folderPath = LocalPath::fromAbsolutePath(pathString.u8string());
+    SqliteDbAccess dbAccess{folderPath};
+
+    std::unique_ptr<FileSystemAccess> fsaccess{new FSACCESS_CLASS};
+    PrnGen rng;
+    MegaApp app;
+    auto client = mt::makeClient(app);
+
+    // root: 1, folders: 2 to 4, 6 and 7, files: 5 and 8
+    //
+    // 1 +- 2 - 3 +- 5
+    //   |        +- 6
+    //   +- 4
+    for (int flags: {0, static_cast<int>(DB_OPEN_FLAG_ASYNC_WRITES)})
+    {
+        const std::string dbName{"dbName" + std::to_string(flags)};
+        std::unique_ptr<DbTable> db{
+            dbAccess.openTableWithNodes(rng, *fsaccess, dbName, flags, nullptr)};
+        ASSERT_TRUE(db) << "Failure opening DB with flags " << flags;
+
+        auto table = dynamic_cast<DBTableNodes*>(db.get());
+        ASSERT_TRUE(table);
+
+        NodeTree tree(*client, *table);
+
+        tree.put(5, 3, FILENODE, "fox");
+        tree.put(6, 3, FOLDERNODE, "dog");
+        tree.put(3, 2);
+        tree.put(2, 1);
+        tree.put(4, 1);
+        tree.put(1, UNDEF, ROOTNODE);
+
+        for (bool indexed: {false, true})
+        {
+            if (indexed)
+            {
+                table->createIndexes();
+            }
+
+            EXPECT_TRUE(tree.isAncestor(5, 1)) << indexed;
+            EXPECT_TRUE(tree.isAncestor(5, 2)) << indexed;
+            EXPECT_TRUE(tree.isAncestor(6, 3)) << indexed;
+            EXPECT_FALSE(tree.isAncestor(5, 4)) << indexed;
+            EXPECT_FALSE(tree.isAncestor(2, 5)) << indexed;
+            EXPECT_FALSE(tree.isAncestor(5, 5)) << indexed;
+
+            EXPECT_EQ(tree.below(2), (std::set<handle>{3, 5, 6})) << indexed;
+            EXPECT_EQ(tree.below(4), std::set<handle>()) << indexed;
+            EXPECT_EQ(tree.tagsBelow(2), (std::set<std::string>{"dog", "fox"})) << indexed;
+            EXPECT_EQ(tree.tagsBelow(6), std::set<std::string>{"dog"}) << indexed;
+        }
+
+        // What's below a folder moves with it.
+        tree.put(3, 4);
+
+        EXPECT_TRUE(tree.isAncestor(5, 4));
+        EXPECT_FALSE(tree.isAncestor(5, 2));
+        EXPECT_TRUE(tree.isAncestor(5, 1));
+        EXPECT_EQ(tree.below(2), std::set<handle>());
+        EXPECT_EQ(tree.below(4), (std::set<handle>{3, 5, 6}));
+        EXPECT_EQ(tree.tagsBelow(4), (std::set<std::string>{"dog", "fox"}));
+
+        // Nodes put before a parent of theirs get its ancestors when it's put.
+        tree.put(8, 7, FILENODE);
+        EXPECT_FALSE(tree.isAncestor(8, 1));
+
+        tree.put(7, 6);
+        EXPECT_TRUE(tree.isAncestor(8, 1));
+        EXPECT_TRUE(tree.isAncestor(8, 4));
+
+        // Walking down the tree, as it's done to leave out nodes below sensitive ones, agrees.
+        EXPECT_EQ(tree.below(1), (std::set<handle>{2, 3, 4, 5, 6, 7, 8}));
+        EXPECT_EQ(tree.below(1, NodeSearchFilter::BoolFilter::onlyTrue), tree.below(1));
+
+        // Once every node is removed, they're looked up by walking the tree until indexes are
+        // created again.
+        EXPECT_TRUE(table->removeNodes());
+
+        tree.put(5, 3, FILENODE);
+        tree.put(3, 1);
+        tree.put(1, UNDEF, ROOTNODE);
+
+        EXPECT_TRUE(tree.isAncestor(5, 1));
+        EXPECT_EQ(tree.below(1), (std::set<handle>{3, 5}));
+
+        table->createIndexes();
+
+        EXPECT_TRUE(tree.isAncestor(5, 1));
+        EXPECT_EQ(tree.below(1), (std::set<handle>{3, 5}));
+    }
+}
+
+/**
+ * @brief Validate that queries from other threads see the node writes of an open transaction
+ *
+ * Steps:
+ *  - Put a tree, and stage more nodes and a move in a transaction
+ *  - Query children, descendants, ancestors and tags from another thread
+ *  - Abort the transaction, and check the writes are gone for every thread
+ *  - Do it again, committing the transaction
+ */
+TEST(Sqlite, asyncWritesSeenByOtherThreads)
+{
+    auto pathString{std::filesystem::current_path() / "asyncWritesThreadsFolder"};
+
+    const MrProper cleanUp(
+        [pathString]()
+        {
+            std::filesystem::remove_all(pathString);
+        });
+
+    std::filesystem::create_directory(pathString);
+    LocalPath folderPath = LocalPath::fromAbsolutePath(pathString.u8string());
+    SqliteDbAccess dbAccess{folderPath};
+
+    std::unique_ptr<FileSystemAccess> fsaccess{new FSACCESS_CLASS};
+    PrnGen rng;
+    MegaApp app;
+    auto client = mt::makeClient(app);
+
+    std::unique_ptr<DbTable> db{
+        dbAccess.openTableWithNodes(rng, *fsaccess, "dbName", DB_OPEN_FLAG_ASYNC_WRITES, nullptr)};
+    ASSERT_TRUE(db) << "Failure opening DB";
+
+    auto table = dynamic_cast<DBTableNodes*>(db.get());
+    ASSERT_TRUE(table);
+
+    NodeTree tree(*client, *table);
+
+    // 1 +- 2
+    //   +- 3
+    tree.put(1, UNDEF, ROOTNODE);
+    tree.put(2, 1);
+    tree.put(3, 1);
+    table->createIndexes();
+
+    auto onOtherThread = [](std::function<void()> queries)
+    {
+        std::thread(queries).join();
+    };
+
+    for (bool committed: {false, true})
+    {
+        // 1 +- 2 - 3 - 4
+        db->begin();
+        tree.put(4, 3, FILENODE, "fox");
+        tree.put(3, 2);
+
+        onOtherThread(
+            [&tree]()
+            {
+                EXPECT_EQ(tree.children(1), std::set<handle>{2});
+                EXPECT_EQ(tree.children(3), std::set<handle>{4});
+                EXPECT_EQ(tree.below(2), (std::set<handle>{3, 4}));
+                EXPECT_TRUE(tree.isAncestor(4, 2));
+                EXPECT_EQ(tree.tagsBelow(1), std::set<std::string>{"fox"});
+            });
+
+        // The writes are still the transaction's to commit or abort.
+        if (committed)
+        {
+            db->commit();
+        }
+        else
+        {
+            db->abort();
+        }
+
+        for (bool otherThread: {false, true})
+        {
+            auto queries = [&tree, committed]()
+            {
+                EXPECT_EQ(tree.children(1),
+                          committed ? std::set<handle>{2} : (std::set<handle>{2, 3}));
+                EXPECT_EQ(tree.isAncestor(4, 2), committed);
+                EXPECT_EQ(tree.tagsBelow(1).size(), committed ? 1u : 0u);
+            };
+
+            if (otherThread)
+            {
+                onOtherThread(queries);
+            }
+            else
+            {
+                queries();
+            }
+        }
+
+        // The node moved by the aborted transaction is back where it was, also for the tree.
+        if (!committed)
+        {
+            tree.put(3, 1);
+        }
+    }
+}
+
+/**
+ * @brief Validate node writes, as they're coalesced until they're committed asynchronously
+ *
+ * Steps:
+ *  - Put, remove and put a node again, and update the counter of a pending row and of no row
+ *  - Remove every node and put more
+ *  - Commit two transactions that update the same nodes, which are committed together
+ *  - Read the nodes back before and after the writes are committed
+ */
+TEST(Sqlite, asyncNodeWrites)
+{
+    auto pathString{std::filesystem::current_path() / "asyncNodeWritesFolder"};
+
+    const MrProper cleanUp(
+        [pathString]()
+        {
+            std::filesystem::remove_all(pathString);
+        });
+
+    std::filesystem::create_directory(pathString);
+    LocalPath folderPath = LocalPath::fromAbsolutePath(pathString.u8string());
+    SqliteDbAccess dbAccess{folderPath};
+
+    std::unique_ptr<FileSystemAccess> fsaccess{new FSACCESS_CLASS};
+    PrnGen rng;
+    MegaApp app;
+    auto client = mt::makeClient(app);
+
+    std::unique_ptr<DbTable> db{
+        dbAccess.openTableWithNodes(rng, *fsaccess, "dbName", DB_OPEN_FLAG_ASYNC_WRITES, nullptr)};
+    ASSERT_TRUE(db) << "Failure opening DB";
+
+    auto table = dynamic_cast<DBTableNodes*>(db.get());
+    ASSERT_TRUE(table);
+
+    NodeTree tree(*client, *table);
+
+    auto nodeHandle = [](handle h)
+    {
+        return NodeHandle().set6byte(h);
+    };
+
+    auto counter = [](m_off_t storage)
+    {
+        NodeCounter nodeCounter;
+        nodeCounter.storage = storage;
+        return nodeCounter.serialize();
+    };
+
+    // The storage of the node's counter, through getNode() and getNodeSizeTypeAndFlags(), which
+    // have to agree. -1 if the node isn't found.
+    auto storage = [&table, &nodeHandle](handle h) -> m_off_t
+    {
+        NodeSerialized serialized;
+        bool found = table->getNode(nodeHandle(h), serialized);
+
+        m_off_t size = 0;
+        nodetype_t type = TYPE_UNKNOWN;
+        uint64_t flags = 0;
+        EXPECT_EQ(table->getNodeSizeTypeAndFlags(nodeHandle(h), size, type, flags), found) << h;
+
+        if (!found)
+        {
+            return -1;
+        }
+
+        EXPECT_EQ(NodeCounter(serialized.mNodeCounter).storage, size) << h;
+        return size;
+    };
+
+    auto flags = [&table, &nodeHandle](handle h)
+    {
+        m_off_t size = 0;
+        nodetype_t type = TYPE_UNKNOWN;
+        uint64_t flags = 0;
+        EXPECT_TRUE(table->getNodeSizeTypeAndFlags(nodeHandle(h), size, type, flags)) << h;
+        return flags;
+    };
+
+    // Once the writes are committed, queries that pending writes can't answer read them back.
+    auto waitForCommit = [&tree]()
+    {
+        tree.below(1);
+    };
+
+    // 1 - 2
+    db->begin();
+    tree.put(1, UNDEF, ROOTNODE);
+    tree.put(2, 1, FILENODE);
+    table->remove(nodeHandle(2));
+    EXPECT_EQ(storage(2), -1);
+
+    tree.put(2, 1, FILENODE);
+    table->updateCounter(nodeHandle(2), counter(100));
+
+    // Nothing to update without a row.
+    table->updateCounter(nodeHandle(3), counter(5));
+
+    for (int step = 0; step < 3; ++step)
+    {
+        if (step == 1)
+        {
+            db->commit();
+        }
+        else if (step == 2)
+        {
+            waitForCommit();
+        }
+
+        EXPECT_EQ(storage(2), 100) << step;
+        EXPECT_EQ(storage(3), -1) << step;
+        EXPECT_EQ(tree.children(1), std::set<handle>{2}) << step;
+    }
+
+    // 4 - 5
+    db->begin();
+    tree.put(3, 1, FILENODE);
+    EXPECT_TRUE(table->removeNodes());
+    tree.put(4, UNDEF, ROOTNODE);
+    tree.put(5, 4, FILENODE);
+    table->updateCounter(nodeHandle(2), counter(200));
+    table->updateCounter(nodeHandle(5), counter(50));
+
+    for (int step = 0; step < 3; ++step)
+    {
+        if (step == 1)
+        {
+            db->commit();
+        }
+        else if (step == 2)
+        {
+            waitForCommit();
+        }
+
+        EXPECT_EQ(storage(1), -1) << step;
+        EXPECT_EQ(storage(2), -1) << step;
+        EXPECT_EQ(storage(3), -1) << step;
+        EXPECT_EQ(storage(5), 50) << step;
+        EXPECT_EQ(tree.children(1), std::set<handle>()) << step;
+        EXPECT_EQ(tree.children(4), std::set<handle>{5}) << step;
+    }
+
+    auto before = dynamic_cast<SqliteAccountState&>(*db).asyncWriteStats();
+
+    // not one that leaves the node out of children, as versions are
+    const uint64_t sensitive = 1 << Node::FLAGS_IS_MARKED_SENSTIVE;
+
+    // 4 +- 5
+    //   +- 7
+    db->begin();
+    tree.put(6, 4, FILENODE);
+    table->updateCounter(nodeHandle(6), counter(60));
+    table->updateCounterAndFlags(nodeHandle(5), sensitive, counter(51));
+    db->commit();
+
+    db->begin();
+    table->remove(nodeHandle(6));
+    tree.put(7, 4, FILENODE);
+    table->updateCounter(nodeHandle(7), counter(70));
+    table->updateCounter(nodeHandle(5), counter(52));
+    db->commit();
+
+    for (int step = 0; step < 2; ++step)
+    {
+        if (step == 1)
+        {
+            waitForCommit();
+        }
+
+        EXPECT_EQ(storage(5), 52) << step;
+        EXPECT_EQ(flags(5), sensitive) << step;
+        EXPECT_EQ(storage(6), -1) << step;
+        EXPECT_EQ(storage(7), 70) << step;
+        EXPECT_EQ(tree.children(4), (std::set<handle>{5, 7})) << step;
+    }
+
+    // Usually committed together, unless the first one was already on its way.
+    auto after = dynamic_cast<SqliteAccountState&>(*db).asyncWriteStats();
+    EXPECT_GE(after.commits - before.commits, 1u);
+    EXPECT_LE(after.commits - before.commits, 2u);
+    EXPECT_LT(after.rows - before.rows, after.writes - before.writes);
+}
+
+// How long ancestry look-ups take in a tree 50 folders deep, with 5M nodes, before and after the
+// ancestry index is created: run with --gtest_also_run_disabled_tests.
+TEST(Sqlite, DISABLED_ancestryIndexPerformance)
+{
+    constexpr handle DEPTH = 50;
+    constexpr handle NODES = 5000000;
+    constexpr int LOOKUPS = 10000;
+
+    auto pathString{std::filesystem::current_path() / "ancestryIndexPerformanceFolder"};
+
+    const MrProper cleanUp(
+        [pathString]()
+        {
+            std::filesystem::remove_all(pathString);
+        });
+
+    std::filesystem::create_directory(pathString);
+    LocalPath folderPath = LocalPath::fromAbsolutePath(pathString.u8string());
+    SqliteDbAccess dbAccess{folderPath};
+
+    std::unique_ptr<FileSystemAccess> fsaccess{new FSACCESS_CLASS};
+    PrnGen rng;
+    MegaApp app;
+    auto client = mt::makeClient(app);
+
+    std::unique_ptr<DbTable> db{dbAccess.openTableWithNodes(rng, *fsaccess, "dbName", 0, nullptr)};
+    ASSERT_TRUE(db);
+
+    auto table = dynamic_cast<DBTableNodes*>(db.get());
+    ASSERT_TRUE(table);
+
+    using namespace std::chrono;
+
+    auto elapsed = [](steady_clock::time_point started)
+    {
+        return duration_cast<milliseconds>(steady_clock::now() - started).count();
+    };
+
+    // A chain of folders (handles 1 to DEPTH), with files spread over them.
+    // A single node is put again and again, with different handles.
+    auto& folder = mt::makeNode(*client, FOLDERNODE, NodeHandle().set6byte(NODES + DEPTH));
+    auto& file = mt::makeNode(*client, FILENODE, NodeHandle().set6byte(NODES + DEPTH + 1));
+
+    auto started = steady_clock::now();
+
+    db->begin();
+
+    for (handle h = 1; h <= DEPTH; ++h)
+    {
+        folder.nodehandle = h;
+        folder.parenthandle = h > 1 ? h - 1 : UNDEF;
+        table->put(&folder);
+    }
+
+    for (handle h = DEPTH + 1; h <= NODES; ++h)
+    {
+        file.nodehandle = h;
+        file.parenthandle = 1 + h % DEPTH;
+        table->put(&file);
+    }
+
+    db->commit();
+
+    std::cout << "put " << NODES << " nodes: " << elapsed(started) << " ms" << std::endl;
+
+    // Files in the deepest folder, and the folders it's in.
+    const handle deepest = DEPTH + DEPTH - 1;
+    const handle subtree = DEPTH - 2;
+
+    auto measure = [&](const char* what)
+    {
+        auto started = steady_clock::now();
+        bool found = true;
+
+        for (int i = 0; i < LOOKUPS; ++i)
+        {
+            found &= table->isAncestor(NodeHandle().set6byte(deepest),
+                                       NodeHandle().set6byte(1),
+                                       CancelToken());
+        }
+
+        auto ancestorTime = duration_cast<microseconds>(steady_clock::now() - started).count();
+        EXPECT_TRUE(found);
+
+        NodeSearchFilter filter;
+        filter.byAncestors({subtree, UNDEF, UNDEF});
+        std::vector<std::pair<NodeHandle, NodeSerialized>> nodes;
+
+        started = steady_clock::now();
+        EXPECT_TRUE(table->searchNodes(filter,
+                                       OrderByClause::DEFAULT_ASC,
+                                       nodes,
+                                       CancelToken(),
+                                       NodeSearchPage(0, 0)));
+        auto searchTime = elapsed(started);
+
+        started = steady_clock::now();
+        EXPECT_TRUE(table->getNodeTagsBelow(CancelToken(), NodeHandle().set6byte(subtree), ""));
+        auto tagsTime = elapsed(started);
+
+        std::cout << what << ": isAncestor " << static_cast<double>(ancestorTime) / LOOKUPS
+                  << " us, searchNodes " << searchTime << " ms (" << nodes.size()
+                  << " nodes), getNodeTagsBelow " << tagsTime << " ms" << std::endl;
+    };
+
+    measure("walking the tree");
+
+    started = steady_clock::now();
+    table->createIndexes();
+    std::cout << "createIndexes: " << elapsed(started) << " ms" << std::endl;
+
+    measure("ancestry index");
+
+    // Moving the folder with the most below it.
+    started = steady_clock::now();
+    folder.nodehandle = 2;
+    folder.parenthandle = UNDEF;
+    table->put(&folder);
+    std::cout << "moving the second folder: " << elapsed(started) << " ms" << std::endl;
+}
+
+// How long searches by name take with 100k, 1M and 5M nodes, with and without the search index:
+// run with --gtest_also_run_disabled_tests.
+TEST(Sqlite, DISABLED_searchIndexPerformance)
+{
+    constexpr int LOOKUPS = 10;
+    const std::vector<std::string> words{"holiday", "invoice", "report", "summer", "family",
+                                         "backup", "draft", "scan", "project", "meeting"};
+
+    auto pathString{std::filesystem::current_path() / "searchIndexPerformanceFolder"};
+
+    const MrProper cleanUp(
+        [pathString]()
+        {
+            std::filesystem::remove_all(pathString);
+        });
+
+    std::filesystem::create_directory(pathString);
+    LocalPath folderPath = LocalPath::fromAbsolutePath(pathString.u8string());
+    SqliteDbAccess dbAccess{folderPath};
+
+    std::unique_ptr<FileSystemAccess> fsaccess{new FSACCESS_CLASS};
+    PrnGen rng;
+    MegaApp app;
+    auto client = mt::makeClient(app);
+
+    using namespace std::chrono;
+
+    auto elapsed = [](steady_clock::time_point started)
+    {
+        return duration_cast<milliseconds>(steady_clock::now() - started).count();
+    };
+
+    // A single node is put again and again, with different handles and names.
+    auto& file = mt::makeNode(*client, FILENODE, NodeHandle().set6byte(UNDEF >> 16));
+
+    for (handle nodeCount: {100000, 1000000, 5000000})
+    {
+        for (int flags: {0, static_cast<int>(DB_OPEN_FLAG_SEARCH_INDEX)})
+        {
+            const std::string dbName{"dbName" + std::to_string(nodeCount) + "_" +
+                                     std::to_string(flags)};
+            const std::string what{std::to_string(nodeCount) + " nodes, " +
+                                   (flags ? "search index" : "no search index")};
+
+            std::unique_ptr<DbTable> db{
+                dbAccess.openTableWithNodes(rng, *fsaccess, dbName, flags, nullptr)};
+            ASSERT_TRUE(db);
+
+            auto table = dynamic_cast<DBTableNodes*>(db.get());
+            ASSERT_TRUE(table);
+
+            auto started = steady_clock::now();
+
+            db->begin();
+
+            for (handle h = 1; h <= nodeCount; ++h)
+            {
+                file.nodehandle = h;
+                file.parenthandle = UNDEF;
+                file.attrs.map['n'] = words[h % words.size()] + " " + std::to_string(h) + ".jpg";
+                table->put(&file);
+            }
+
+            db->commit();
+
+            std::cout << what << ": put " << elapsed(started) << " ms" << std::endl;
+
+            // A name most nodes don't have, and a word a tenth of them have.
+            for (const char* name: {"*54321*", "*Holiday*"})
+            {
+                NodeSearchFilter filter;
+                filter.byName(name);
+                std::vector<std::pair<NodeHandle, NodeSerialized>> nodes;
+
+                started = steady_clock::now();
+
+                for (int i = 0; i < LOOKUPS; ++i)
+                {
+                    nodes.clear();
+                    EXPECT_TRUE(table->searchNodes(filter,
+                                                   OrderByClause::DEFAULT_ASC,
+                                                   nodes,
+                                                   CancelToken(),
+                                                   NodeSearchPage(0, 0)));
+                }
+
+                std::cout << what << ": searchNodes \"" << name << "\" "
+                          << static_cast<double>(elapsed(started)) / LOOKUPS << " ms ("
+                          << nodes.size() << " nodes)" << std::endl;
+            }
+
+            db->remove();
+        }
+    }
+}
@@ -1139,5 +1139,135 @@ TEST_F(SyncConfigStoreTest, Write)
 
 } // SyncConfigTests
 
+namespace RecurseSliceTests
+{
+
+using namespace mega;
+using namespace std::chrono;
+
+// Walks subtrees the way recursiveSync() does: those still flagged are visited in order, and the
+// walk yields when the slice is used up, leaving the rest flagged. Each visit takes 100ms.
+bool walk(RecurseSlice& slice, std::vector<bool>& flagged, RecurseSlice::Clock::time_point& now)
+{
+    for (size_t i = 0; i < flagged.size(); ++i)
+    {
+        if (!flagged[i])
+            continue;
+
+        if (slice.expired(now))
+            return false;
+
+        flagged[i] = false;
+        now += milliseconds(100);
+    }
+
+    return true;
+}
+
+TEST(RecurseSlice, UnslicedPassNeverYields)
+{
+    RecurseSlice slice;
+    RecurseSlice::Clock::time_point now{};
+    std::vector<bool> flagged(1000, true);
+
+    slice.start(false, now);
+    EXPECT_TRUE(walk(slice, flagged, now));
+    EXPECT_FALSE(slice.finish(true));
+    EXPECT_EQ(slice.sliceMs(), RecurseSlice::INITIAL_MS);
+}
+
+TEST(RecurseSlice, LongPassYieldsAndResumes)
+{
+    RecurseSlice slice;
+    RecurseSlice::Clock::time_point now{};
+    std::vector<bool> flagged(100, true);
+
+    // Each pass carries on from where the previous one stopped, with twice the time.
+    std::vector<size_t> visitedPerPass;
+
+    for (bool completed = false; !completed;)
+    {
+        auto before = std::count(flagged.begin(), flagged.end(), true);
+
+        slice.start(true, now);
+        completed = walk(slice, flagged, now);
+
+        visitedPerPass.emplace_back(before - std::count(flagged.begin(), flagged.end(), true));
+
+        EXPECT_EQ(slice.finish(completed), !completed);
+    }
+
+    // 250ms, 500ms, 1s, 2s, 4s, and the last 22 subtrees.
+    EXPECT_EQ(visitedPerPass, (std::vector<size_t>{3, 5, 10, 20, 40, 22}));
+    EXPECT_EQ(std::count(flagged.begin(), flagged.end(), true), 0);
+
+    // The next pass starts over with the initial slice.
+    EXPECT_EQ(slice.sliceMs(), RecurseSlice::INITIAL_MS);
+}
+
+TEST(RecurseSlice, SliceIsCapped)
+{
+    RecurseSlice slice;
+    RecurseSlice::Clock::time_point now{};
+
+    for (int i = 0; i < 20; ++i)
+    {
+        slice.start(true, now);
+        now += milliseconds(slice.sliceMs());
+        EXPECT_TRUE(slice.expired(now));
+        EXPECT_TRUE(slice.finish(false));
+    }
+
+    EXPECT_EQ(slice.sliceMs(), RecurseSlice::MAX_MS);
+
+    // A pass cut short by something else keeps the slice it had.
+    slice.start(true, now);
+    EXPECT_FALSE(slice.finish(false));
+    EXPECT_EQ(slice.sliceMs(), RecurseSlice::MAX_MS);
+}
+
+void stallLocal(SyncStallInfo& stalls, handle backupId, const std::string& path)
+{
+    auto localPath = LocalPath::fromAbsolutePath(path);
+
+    stalls.waitingLocal(backupId, localPath, SyncStallEntry(
+        SyncWaitReason::FileIssue, true, false,
+        {},
+        {},
+        {localPath, PathProblem::IgnoreFileMalformed},
+        {}));
+}
+
+TEST(RecurseSlice, YieldedSyncKeepsItsLastStallReport)
+{
+    SyncStallInfo loop;
+    SyncStallInfo report;
+
+    // Both syncs complete a pass.
+    stallLocal(loop, 1, "/a/x");
+    stallLocal(loop, 2, "/b/x");
+    report.moveFromButKeepCountersAndClearObsoleteKeys(loop);
+    ASSERT_EQ(report.size(), 2u);
+
+    // Sync 1 yields midway through its next pass, having only found /a/y so far,
+    // while sync 2 completes its pass without stalls.
+    stallLocal(loop, 1, "/a/y");
+    report.moveFromButKeepCountersAndClearObsoleteKeys(loop, {1});
+
+    ASSERT_EQ(report.size(), 1u);
+    EXPECT_EQ(report.syncStallInfoMaps[1].local.count(LocalPath::fromAbsolutePath("/a/x")), 1u);
+    EXPECT_FALSE(report.isSyncStalled(2));
+
+    // Sync 1 completes its pass: its report is the whole of it.
+    stallLocal(loop, 1, "/a/z");
+    report.moveFromButKeepCountersAndClearObsoleteKeys(loop);
+
+    ASSERT_EQ(report.size(), 2u);
+    EXPECT_EQ(report.syncStallInfoMaps[1].local.count(LocalPath::fromAbsolutePath("/a/y")), 1u);
+    EXPECT_EQ(report.syncStallInfoMaps[1].local.count(LocalPath::fromAbsolutePath("/a/z")), 1u);
+}
+
+} // RecurseSliceTests
+
 #endif
 
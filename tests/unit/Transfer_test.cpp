@@ -26,6 +26,9 @@
 #include "utils.h"
 #include "mega.h"
 
+#include <chrono>
+#include <iostream>
+
 namespace
 {
 
@@ -46,6 +49,87 @@ void checkTransfers(const mega::Transfer& exp, const mega::Transfer& act)
     ASSERT_EQ(exp.priority, act.priority);
 }
 
+class TransferListTest: public ::testing::Test
+{
+protected:
+    using Chosen = std::array<std::vector<mega::Transfer*>, 6>;
+
+    ~TransferListTest() override
+    {
+        // Transfers leave the list as they're destroyed.
+        for (auto& transfer : mTransfers)
+            transfer->files.clear();
+    }
+
+    mega::TransferList& list()
+    {
+        return mClient->transferlist;
+    }
+
+    mega::Transfer* add(mega::direction_t direction, m_off_t size)
+    {
+        mTransfers.emplace_back(new mega::Transfer(mClient.get(), direction));
+
+        auto* transfer = mTransfers.back().get();
+        transfer->size = size;
+        transfer->files.push_back(&mFile);
+
+        mega::TransferDbCommitter committer(mClient->tctable);
+        list().addtransfer(transfer, committer);
+
+        return transfer;
+    }
+
+    // What nexttransfers() picks when each category takes at most `limit` transfers.
+    Chosen next(size_t limit)
+    {
+        std::array<size_t, 6> taken{};
+
+        std::function<bool(mega::Transfer*)> continueCategory = [&](mega::Transfer* transfer)
+        {
+            auto& count = taken[mega::TransferCategory(transfer).index()];
+
+            if (count == limit)
+                return false;
+
+            ++count;
+            return true;
+        };
+
+        std::function<bool(mega::direction_t)> continueDirection = [](mega::direction_t)
+        {
+            return true;
+        };
+
+        mega::TransferDbCommitter committer(mClient->tctable);
+        return list().nexttransfers(continueCategory, continueDirection, committer);
+    }
+
+    // What a walk of the whole list in priority order picks.
+    Chosen expected(size_t limit)
+    {
+        Chosen chosen;
+
+        for (auto direction : {mega::PUT, mega::GET})
+        {
+            for (mega::Transfer* transfer : list().transfers[direction])
+            {
+                auto& category = chosen[mega::TransferCategory(transfer).index()];
+
+                if (transfer->state != mega::TRANSFERSTATE_PAUSED && category.size() < limit)
+                    category.push_back(transfer);
+            }
+        }
+
+        return chosen;
+    }
+
+    mega::MegaApp mApp;
+    std::shared_ptr<mega::MegaClient> mClient = mt::makeClient(mApp);
+    mega::File mFile;
+    std::vector<std::unique_ptr<mega::Transfer>> mTransfers;
+}; // TransferListTest
+
 }
 
 TEST(Transfer, serialize_unserialize)
@@ -87,3 +171,65 @@ TEST(Transfer, serialize_unserialize)
 }
 
 
+
+TEST_F(TransferListTest, nexttransfers_follows_priority)
+{
+    for (int i = 0; i < 60; ++i)
+        add(i % 3 ? mega::PUT : mega::GET, i % 4 ? 1000 : 1 << 20);
+
+    mega::TransferDbCommitter committer(mClient->tctable);
+
+    list().movetofirst(mTransfers[41].get(), committer);
+    list().movetolast(mTransfers[2].get(), committer);
+    list().movetransfer(mTransfers[30].get(), 5, committer);
+    list().movedown(mTransfers[1].get(), committer);
+    list().pause(mTransfers[4].get(), true, committer);
+    list().pause(mTransfers[7].get(), true, committer);
+
+    for (size_t limit : {1, 3, 100})
+        EXPECT_EQ(next(limit), expected(limit)) << limit;
+
+    // Resumed transfers are picked again.
+    list().pause(mTransfers[4].get(), false, committer);
+
+    EXPECT_EQ(next(100), expected(100));
+}
+
+TEST_F(TransferListTest, nexttransfers_skips_removed_transfers)
+{
+    for (int i = 0; i < 10; ++i)
+        add(mega::PUT, 1000);
+
+    mTransfers[3]->files.clear();
+    mTransfers.erase(mTransfers.begin() + 3);
+
+    auto chosen = next(100);
+    auto& small = chosen[mega::TransferCategory(mega::PUT, mega::SMALLFILE).index()];
+
+    EXPECT_EQ(small.size(), 9u);
+    EXPECT_EQ(chosen, expected(100));
+}
+
+// The cost of picking the next transfers to start against the number queued, as when
+// uploading a huge folder: run with --gtest_also_run_disabled_tests.
+TEST_F(TransferListTest, DISABLED_nexttransfers_scaling)
+{
+    const int rounds = 100;
+
+    size_t queued = 0;
+
+    for (size_t count : {1000u, 10000u, 100000u, 1000000u})
+    {
+        for (; queued < count; ++queued)
+            add(mega::PUT, queued % 16 ? 20000 : 1 << 20);
+
+        auto started = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < rounds; ++i)
+            ASSERT_EQ(next(16)[mega::TransferCategory(mega::PUT, mega::SMALLFILE).index()].size(), 16u);
+
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - started;
+
+        std::cout << count << " transfers: " << elapsed.count() / rounds << " us per dispatch" << std::endl;
+    }
+}
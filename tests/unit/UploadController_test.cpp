@@ -0,0 +1,144 @@
+/**
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#include <gtest/gtest.h>
+#include <mega.h>
+
+using namespace mega;
+
+namespace
+{
+
+constexpr m_off_t MB = 1024 * 1024;
+
+// Report the same speed for as long as it takes to reconsider the connections.
+void settle(UploadController& controller, m_off_t speed, dstime& now)
+{
+    now += UploadController::EVALUATION_DS;
+    controller.onSpeed(speed, now);
+}
+
+} // namespace
+
+TEST(UploadController, smallFileUsesOneConnectionAndOneRequest)
+{
+    UploadController controller(100 * 1024, 6, 0, 0);
+
+    EXPECT_EQ(controller.connections(), 1u);
+    EXPECT_EQ(controller.requestSize(0), UploadController::MIN_REQUEST_SIZE);
+}
+
+TEST(UploadController, requestSizeFollowsBandwidthAndLatency)
+{
+    const m_off_t fileSize = 1024 * MB;
+
+    // Unknown speed: the minimum.
+    {
+        UploadController controller(fileSize, 4, 0, 0);
+        EXPECT_EQ(controller.requestSize(0), UploadController::MIN_REQUEST_SIZE);
+    }
+
+    // 40 MB/s over 4 connections: 2 seconds of each connection's share.
+    {
+        UploadController controller(fileSize, 4, 40 * MB, 0);
+        ASSERT_EQ(controller.connections(), 4u);
+        EXPECT_EQ(controller.requestSize(0), 20 * MB);
+
+        // A long round trip needs larger requests to keep the connection busy, up to the maximum.
+        controller.onConnected(500);
+        EXPECT_EQ(controller.requestSize(0), UploadController::MAX_REQUEST_SIZE);
+    }
+}
+
+TEST(UploadController, lastRequestsAreSharedBetweenConnections)
+{
+    const m_off_t fileSize = 1024 * MB;
+
+    UploadController controller(fileSize, 4, 40 * MB, 0);
+
+    EXPECT_EQ(controller.requestSize(fileSize - 40 * MB), 10 * MB);
+    EXPECT_EQ(controller.requestSize(fileSize - 2 * MB), UploadController::MIN_REQUEST_SIZE);
+
+    auto& decisions = controller.decisions();
+    EXPECT_EQ(decisions.mRequests, 2u);
+    EXPECT_EQ(decisions.mMinRequestSize, UploadController::MIN_REQUEST_SIZE);
+    EXPECT_EQ(decisions.mMaxRequestSize, 10 * MB);
+}
+
+TEST(UploadController, connectionsAreAddedWhileTheyPayOff)
+{
+    dstime now = 0;
+    UploadController controller(1024 * MB, 8, 0, now);
+
+    ASSERT_EQ(controller.connections(), UploadController::INITIAL_CONNECTIONS);
+
+    // Too soon to tell.
+    controller.onSpeed(10 * MB, now + 1);
+    EXPECT_EQ(controller.connections(), 4u);
+
+    // Each connection so far brought 20% more.
+    settle(controller, 10 * MB, now);
+    EXPECT_EQ(controller.connections(), 5u);
+
+    settle(controller, 12 * MB, now);
+    EXPECT_EQ(controller.connections(), 6u);
+
+    // The 6th one barely helped: back to 5, and stay there.
+    settle(controller, 12 * MB + 100 * 1024, now);
+    EXPECT_EQ(controller.connections(), 5u);
+
+    settle(controller, 12 * MB, now);
+    settle(controller, 12 * MB, now);
+    EXPECT_EQ(controller.connections(), 5u);
+
+    auto& decisions = controller.decisions();
+    EXPECT_EQ(decisions.mInitialConnections, 4u);
+    EXPECT_EQ(decisions.mPeakConnections, 6u);
+    EXPECT_EQ(decisions.mConnectionChanges, 3u);
+}
+
+TEST(UploadController, connectionsAreNeverAboveTheMaximum)
+{
+    dstime now = 0;
+    UploadController controller(1024 * MB, 2, 0, now);
+
+    ASSERT_EQ(controller.connections(), 2u);
+
+    for (m_off_t speed = MB; speed < 64 * MB; speed *= 2)
+    {
+        settle(controller, speed, now);
+        EXPECT_EQ(controller.connections(), 2u);
+    }
+}
+
+TEST(UploadController, slowdownProbesAgain)
+{
+    dstime now = 0;
+    UploadController controller(1024 * MB, 8, 0, now);
+
+    // 5 connections is best.
+    settle(controller, 10 * MB, now);
+    settle(controller, 12 * MB, now);
+    settle(controller, 12 * MB, now);
+    ASSERT_EQ(controller.connections(), 5u);
+
+    // The network got much slower: try adding connections again.
+    settle(controller, 4 * MB, now);
+    settle(controller, 4 * MB, now);
+    EXPECT_EQ(controller.connections(), 6u);
+}
@@ -0,0 +1,355 @@
+/**
+ * (c) 2026 by Mega Limited, New Zealand
+ *
+ * This file is part of the MEGA SDK - Client Access Engine.
+ *
+ * Applications using the MEGA API must present a valid application key
+ * and comply with the the rules set forth in the Terms of Service.
+ *
+ * The MEGA SDK is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * @copyright Simplified (2-clause) BSD License.
+ *
+ * You should have received a copy of the license along with this
+ * program.
+ */
+
+#ifndef _WIN32
+
+#include <gtest/gtest.h>
+#include <mega.h>
+
+#include <sys/socket.h>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace mega;
+
+namespace
+{
+
+// A copy that gtest can take the address of: Waiter::NEEDEXEC is declared, but not defined.
+constexpr int NEEDEXEC = Waiter::NEEDEXEC;
+
+// Connected pairs of sockets, standing in for network connections.
+class SocketPairs
+{
+public:
+    explicit SocketPairs(size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+                break;
+
+            mLocal.emplace_back(fds[0]);
+            mRemote.emplace_back(fds[1]);
+        }
+    }
+
+    ~SocketPairs()
+    {
+        for (auto fd : mLocal)
+            close(fd);
+
+        for (auto fd : mRemote)
+            close(fd);
+    }
+
+    // Make the i-th local socket readable.
+    void send(size_t i)
+    {
+        char c = 0;
+        ASSERT_EQ(write(mRemote[i], &c, 1), 1);
+    }
+
+    // Consume what was sent to the i-th local socket.
+    void receive(size_t i)
+    {
+        char c;
+        ASSERT_EQ(read(mLocal[i], &c, 1), 1);
+    }
+
+    std::vector<int> mLocal;
+    std::vector<int> mRemote;
+}; // SocketPairs
+
+} // namespace
+
+TEST(PosixWaiter, readableFdIsReported)
+{
+    PosixWaiter waiter;
+    SocketPairs sockets(2);
+
+    ASSERT_EQ(sockets.mLocal.size(), 2u);
+
+    sockets.send(1);
+
+    waiter.init(10);
+    MEGA_FD_SET(sockets.mLocal[0], &waiter.rfds);
+    MEGA_FD_SET(sockets.mLocal[1], &waiter.rfds);
+    waiter.bumpmaxfd(sockets.mLocal[1]);
+
+    EXPECT_EQ(waiter.wait(), NEEDEXEC);
+    EXPECT_TRUE(MEGA_FD_ISSET(sockets.mLocal[1], &waiter.rfds));
+}
+
+TEST(PosixWaiter, ignoredFdDoesNotNeedExec)
+{
+    PosixWaiter waiter;
+    SocketPairs sockets(1);
+
+    ASSERT_EQ(sockets.mLocal.size(), 1u);
+
+    sockets.send(0);
+
+    waiter.init(1);
+    MEGA_FD_SET(sockets.mLocal[0], &waiter.rfds);
+    MEGA_FD_SET(sockets.mLocal[0], &waiter.ignorefds);
+    waiter.bumpmaxfd(sockets.mLocal[0]);
+
+    EXPECT_EQ(waiter.wait(), 0);
+}
+
+#ifdef USE_EPOLL
+
+TEST(PosixWaiter, watchedFdsStayWatched)
+{
+    PosixWaiter waiter;
+    SocketPairs sockets(8);
+
+    ASSERT_EQ(sockets.mLocal.size(), 8u);
+
+    for (auto fd : sockets.mLocal)
+        waiter.watch(fd, true, false);
+
+    // Watched fds need no setting up before each wait.
+    for (size_t i = 0; i < sockets.mLocal.size(); ++i)
+    {
+        sockets.send(i);
+
+        waiter.init(10);
+        ASSERT_EQ(waiter.wait(), NEEDEXEC);
+
+        for (size_t j = 0; j < sockets.mLocal.size(); ++j)
+            EXPECT_EQ(MEGA_FD_ISSET(sockets.mLocal[j], &waiter.rfds), i == j);
+
+        sockets.receive(i);
+    }
+
+    // Nothing is reported once unwatched.
+    waiter.unwatch(sockets.mLocal[3]);
+    sockets.send(3);
+
+    waiter.init(1);
+    EXPECT_EQ(waiter.wait(), NEEDEXEC); // timeout
+    EXPECT_FALSE(MEGA_FD_ISSET(sockets.mLocal[3], &waiter.rfds));
+
+    // Watching for writability.
+    waiter.watch(sockets.mLocal[5], true, true);
+
+    waiter.init(10);
+    EXPECT_EQ(waiter.wait(), NEEDEXEC);
+    EXPECT_TRUE(MEGA_FD_ISSET(sockets.mLocal[5], &waiter.wfds));
+}
+
+// What CurlHttpIO does with the sockets of paused requests, whose data is left unread.
+TEST(PosixWaiter, pausedFdDoesNotWake)
+{
+    PosixWaiter waiter;
+    SocketPairs sockets(1);
+
+    ASSERT_EQ(sockets.mLocal.size(), 1u);
+
+    waiter.watch(sockets.mLocal[0], true, false);
+    sockets.send(0);
+
+    waiter.init(10);
+    ASSERT_EQ(waiter.wait(), NEEDEXEC);
+    ASSERT_TRUE(MEGA_FD_ISSET(sockets.mLocal[0], &waiter.rfds));
+
+    // Paused: each wait lasts until its timeout, rather than returning at once.
+    waiter.unwatch(sockets.mLocal[0]);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        auto started = std::chrono::steady_clock::now();
+
+        waiter.init(1);
+        EXPECT_EQ(waiter.wait(), NEEDEXEC); // timeout
+        EXPECT_FALSE(MEGA_FD_ISSET(sockets.mLocal[0], &waiter.rfds));
+        EXPECT_GE(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(90));
+    }
+
+    // Resumed: the data that arrived meanwhile is reported.
+    waiter.watch(sockets.mLocal[0], true, false);
+
+    waiter.init(10);
+    EXPECT_EQ(waiter.wait(), NEEDEXEC);
+    EXPECT_TRUE(MEGA_FD_ISSET(sockets.mLocal[0], &waiter.rfds));
+}
+
+#ifdef USE_CURL
+
+namespace
+{
+
+// Tells CurlHttpIO about sockets as curl's callbacks do.
+class CurlSockets: public CurlHttpIO
+{
+public:
+    explicit CurlSockets(PosixWaiter& waiter)
+    {
+        this->waiter = &waiter;
+    }
+
+    void socket(curl_socket_t fd, int what, direction_t d)
+    {
+        socket_callback(nullptr, fd, what, this, nullptr, d);
+    }
+
+    void add(direction_t d)
+    {
+        addcurlevents(waiter, d);
+    }
+
+    void pause(direction_t d)
+    {
+        pausecurlevents(d);
+    }
+}; // CurlSockets
+
+} // namespace
+
+// A download's socket is closed, and its fd reused for an API request's before the download's
+// removal is applied: the API request's socket mustn't be unwatched.
+TEST(PosixWaiter, reusedCurlFdStaysWatched)
+{
+    PosixWaiter waiter;
+    SocketPairs sockets(1);
+    CurlSockets io(waiter);
+
+    ASSERT_EQ(sockets.mLocal.size(), 1u);
+
+    auto fd = sockets.mLocal[0];
+
+    io.socket(fd, CURL_POLL_IN, GET);
+    io.add(GET);
+
+    io.socket(fd, CURL_POLL_REMOVE, GET);
+    io.socket(fd, CURL_POLL_IN, API);
+
+    // As addevents() does.
+    io.add(API);
+    io.add(GET);
+
+    sockets.send(0);
+
+    waiter.init(10);
+    EXPECT_EQ(waiter.wait(), NEEDEXEC);
+    EXPECT_TRUE(MEGA_FD_ISSET(fd, &waiter.rfds));
+}
+
+// The same, with the downloads paused before their removed socket is dropped.
+TEST(PosixWaiter, reusedCurlFdStaysWatchedWhilePaused)
+{
+    PosixWaiter waiter;
+    SocketPairs sockets(1);
+    CurlSockets io(waiter);
+
+    ASSERT_EQ(sockets.mLocal.size(), 1u);
+
+    auto fd = sockets.mLocal[0];
+
+    io.socket(fd, CURL_POLL_IN, GET);
+    io.add(GET);
+
+    io.socket(fd, CURL_POLL_REMOVE, GET);
+    io.socket(fd, CURL_POLL_IN, API);
+
+    io.add(API);
+    io.pause(GET);
+
+    sockets.send(0);
+
+    waiter.init(10);
+    EXPECT_EQ(waiter.wait(), NEEDEXEC);
+    EXPECT_TRUE(MEGA_FD_ISSET(fd, &waiter.rfds));
+}
+
+#endif // USE_CURL
+
+#endif // USE_EPOLL
+
+// Cost of a wait with one active connection among many idle ones: run with
+// --gtest_also_run_disabled_tests.
+TEST(PosixWaiter, DISABLED_wait_overhead)
+{
+    const int rounds = 2000;
+
+    for (size_t connections : {100u, 1000u})
+    {
+        SocketPairs sockets(connections);
+
+        ASSERT_EQ(sockets.mLocal.size(), connections) << "Raise the limit of open files";
+
+        auto measure = [&](const char* name, PosixWaiter& waiter, bool setEveryWait)
+        {
+            auto started = std::chrono::steady_clock::now();
+
+            for (int i = 0; i < rounds; ++i)
+            {
+                sockets.send(0);
+
+                waiter.init(10);
+
+                // What CurlHttpIO::addcurlevents() does for each socket without epoll.
+                for (size_t j = 0; setEveryWait && j < connections; ++j)
+                {
+                    MEGA_FD_SET(sockets.mLocal[j], &waiter.rfds);
+                    waiter.bumpmaxfd(sockets.mLocal[j]);
+                }
+
+                waiter.wait();
+                sockets.receive(0);
+            }
+
+            std::chrono::duration<double, std::micro> elapsed =
+                std::chrono::steady_clock::now() - started;
+
+            std::cout << connections << " connections, " << name << ": "
+                      << elapsed.count() / rounds << " us per wait" << std::endl;
+        };
+
+#ifdef USE_EPOLL
+        {
+            PosixWaiter waiter;
+
+            for (auto fd : sockets.mLocal)
+                waiter.watch(fd, true, false);
+
+            measure("watched", waiter, false);
+        }
+#endif // USE_EPOLL
+
+        // select() can't go past FD_SETSIZE.
+#if defined(USE_POLL) || defined(USE_EPOLL)
+        const bool canSetAll = true;
+#else
+        const bool canSetAll = sockets.mLocal.back() < FD_SETSIZE;
+#endif
+
+        if (canSetAll)
+        {
+            PosixWaiter waiter;
+            measure("set before every wait", waiter, true);
+        }
+    }
+}
+
+#endif // ! _WIN32
@@ -44,7 +44,7 @@ mega::handle nextFsId()
     return fsId++;
 }
 
-std::shared_ptr<mega::MegaClient> makeClient(mega::MegaApp& app, mega::DbAccess* dbAccess)
+std::shared_ptr<mega::MegaClient> makeClient(mega::MegaApp& app, mega::DbAccess* dbAccess, unsigned workerThreadCount)
 {
     struct HttpIo : mega::HttpIO
     {
@@ -68,7 +68,7 @@ std::shared_ptr<mega::MegaClient> makeClient(mega::MegaApp& app, mega::DbAccess*
     auto waiter = std::make_shared<WAIT_CLASS>();
 
     std::shared_ptr<mega::MegaClient> client{new mega::MegaClient{
-            &app, waiter, httpio, dbAccess, nullptr, "XXX", "unit_test", 0
+            &app, waiter, httpio, dbAccess, nullptr, "XXX", "unit_test", workerThreadCount
         }, deleter};
 
     return client;
@@ -432,6 +432,47 @@ TEST_F(ComparatorTest, CompareLocalPathAgainstString)
     }
 }
 
+TEST_F(ComparatorTest, CollationKeysCompareAsNames)
+{
+    // Names as they'd appear in the cloud (with escapes) and on disk (without).
+    const vector<pair<string, bool>> names = {
+        {"abc", false},
+        {"ABC", false},
+        {"abcd", false},
+        {"a0b", false},
+        {"a%30b", true},
+        {"a%30b", false},
+        {"%61%62%63", true},
+        {"a%qb%", true},
+        {"a%", true},
+        {"x%aa", true},
+        {"x%aa", false},
+        {"x\xc2\xaa", false},
+        {"\xc3\xa9t\xc3\xa9", false},
+        {"\xc3\x89T\xc3\x89", true},
+        {"", false},
+    };
+
+    for (bool caseInsensitive : {false, true})
+    {
+        for (auto& lhs : names)
+        {
+            CollationKey lhsKey(lhs.first, lhs.second, caseInsensitive);
+
+            for (auto& rhs : names)
+            {
+                CollationKey rhsKey(rhs.first, rhs.second, caseInsensitive);
+
+                auto expected = compareUtf(lhs.first, lhs.second, rhs.first, rhs.second, caseInsensitive);
+                auto actual = lhsKey.compare(rhsKey);
+
+                EXPECT_EQ(actual < 0, expected < 0) << lhs.first << " " << rhs.first;
+                EXPECT_EQ(actual == 0, expected == 0) << lhs.first << " " << rhs.first;
+            }
+        }
+    }
+}
+
 TEST(Conversion, HexVal)
 {
     // Decimal [0-9]